@@ -0,0 +1,511 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <stdexcept>
+
+#include <QFile>
+#include <QStack>
+#include <QApplication>
+#include <QDebug>
+
+#include "global.h"
+#include "binarydatareader.h"
+#include "binaryformat.h"
+#include "security/gcmauthenticator.h"
+#include "security/encodinghelper.h"
+
+/**
+ * @class BinaryDataReader
+ *
+ * @brief Reads a data file in the binary format and reports its contents to a DataHandler.
+ *
+ * The format is described in BinaryFormat. The whole file is read into memory because
+ * the authentication tag is stored at the end and no data must be passed to the handler
+ * before the tag was checked. Since the binary file is smaller than the XML file and there
+ * are no intermediate objects, this still needs less memory than the XmlDataReader.
+ *
+ * Raw password values are converted to Base 64, so the handler receives the same strings
+ * as from the XmlDataReader.
+ *
+ * For the read-only mode, the reader can also work on the contents of a file in memory
+ * (see ReadOnlyDataFile). Then readIndex() reports the structure without the
+ * properties and position() tells where the properties of an entry start, so they can be
+ * read later with readProperties().
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @brief Creates a new instance of a BinaryDataReader.
+ *
+ * @param device the device to read from, it must be open for reading and must stay valid
+ *        as long as this object exists
+ */
+BinaryDataReader::BinaryDataReader(QIODevice* device)
+    : m_device(device)
+    , m_position(0)
+    , m_end(0)
+    , m_useCard(false)
+    , m_authenticated(false)
+{
+    QFile* file = qobject_cast<QFile*>(device);
+    if (file)
+        m_fileName = file->fileName();
+}
+
+
+/**
+ * @brief Creates a new instance of a BinaryDataReader that reads from memory.
+ *
+ * @param data the contents of the file. It may be created with QByteArray::fromRawData(),
+ *        the memory is never copied or modified and must stay valid as long as this object
+ *        exists.
+ * @param fileName the name of the file, only used for error messages
+ */
+BinaryDataReader::BinaryDataReader(const QByteArray& data, const QString& fileName)
+    : m_device(0)
+    , m_fileName(fileName)
+    , m_data(data)
+    , m_position(0)
+    , m_end(data.size())
+    , m_useCard(false)
+    , m_authenticated(false)
+{}
+
+
+/**
+ * @brief Checks if the file in @p device has the binary format.
+ *
+ * The position of the device is not changed.
+ *
+ * @param device the device, must be open for reading
+ * @return @c true if it's a binary file, @c false if it should be a XML file
+ */
+bool BinaryDataReader::isBinary(QIODevice* device)
+{
+    return BinaryFormat::isBinary(device->peek(BinaryFormat::MAGIC_LENGTH));
+}
+
+
+/**
+ * @brief Reads the file and the application data.
+ *
+ * The tag is not checked here because the password is not checked yet. Wrong passwords
+ * should not be reported as modified file, so authenticate() must be called after the
+ * password has been checked.
+ *
+ * @return the application data
+ * @exception ReadWriteException if the file could not be read or is no valid binary file
+ */
+AppData BinaryDataReader::readAppData()
+    throw (ReadWriteException)
+{
+    if (m_device)
+        m_data = m_device->readAll();
+    m_position = 0;
+    m_end = m_data.size();
+
+    if (!BinaryFormat::isBinary(m_data))
+        invalid(QObject::tr("The file has no binary header."));
+    m_position = BinaryFormat::MAGIC_LENGTH;
+
+    const int version = readUInt16();
+    if (version > BinaryFormat::VERSION)
+        invalid(QObject::tr("The file was written by a newer version of QPaMaT."));
+    else if (version < BinaryFormat::VERSION)
+        invalid(QObject::tr("The version %1 of the file is unknown.").arg(version));
+
+    m_useCard = readUInt16() & BinaryFormat::FUseCard;
+    m_authenticated = false;
+    m_nonce = readBytes(GcmAuthenticator::NONCE_LENGTH);
+
+    AppData appData;
+    appData.version = QString::fromUtf8(readString());
+    appData.date = QString::fromUtf8(readString());
+    appData.cryptAlgorithm = QString::fromUtf8(readString());
+    appData.passwordHash = QString::fromUtf8(readString());
+    appData.useCard = m_useCard;
+    appData.cardId = readUInt32();
+
+    appData.kdfAlgorithm = QString::fromUtf8(readString());
+    appData.kdfIterations = readUInt32();
+    appData.kdfSalt = readString();
+    if (appData.kdfAlgorithm.isEmpty())
+        invalid(QObject::tr("The key derivation is missing."));
+
+    return appData;
+}
+
+
+/**
+ * @brief Checks the authentication tag at the end of the file.
+ *
+ * readAppData() must be called before.
+ *
+ * @param key the key that was derived with the KeyDerivation of the AppData, see
+ *        KeyDerivation::deriveKey()
+ * @exception ReadWriteException if the tag is wrong or GCM is not available
+ */
+void BinaryDataReader::authenticate(const ByteSpan& key)
+    throw (ReadWriteException)
+{
+    const int dataLength = m_data.size() - GcmAuthenticator::TAG_LENGTH;
+    if (dataLength < m_position)
+        invalid(QObject::tr("The file is truncated."));
+    if (key.isEmpty())
+        invalid(QObject::tr("The file was modified after it was written."));
+
+    bool ok;
+    try {
+        GcmAuthenticator authenticator(key, m_nonce);
+        authenticator.update(m_data.constData(), dataLength);
+        ok = authenticator.verify(m_data.mid(dataLength));
+    } catch (const NoSuchAlgorithmException& e) {
+        qDebug() << CURRENT_FUNCTION << e.what();
+        throw ReadWriteException(QObject::tr("The file (%1) is in the binary format but "
+            "your\nOpenSSL library doesn't support AES-GCM.").arg(m_fileName),
+            ReadWriteException::CNoAlgorithm);
+    }
+
+    if (!ok)
+        invalid(QObject::tr("The file was modified after it was written."));
+
+    // the tag must not be read as record, m_data must not be modified since it
+    // may be raw data
+    m_end = dataLength;
+    m_authenticated = true;
+}
+
+
+/**
+ * @brief Reads the passwords and reports them to the handler.
+ *
+ * authenticate() must be called before.
+ *
+ * @param handler the handler that receives the data
+ * @param enc the encryptor used to decrypt the passwords, may be 0 if the passwords
+ *        should be passed as they are stored in the file
+ * @exception ReadWriteException if the file was not authenticated or is invalid or if a
+ *            password could not be decrypted
+ */
+void BinaryDataReader::readPasswords(DataHandler& handler, StringEncryptor* enc)
+    throw (ReadWriteException)
+{
+    checkAuthenticated();
+
+    try {
+        readRecords(handler, enc, false);
+    } catch (const ReadWriteException&) {
+        throw;
+    } catch (const std::exception& e) {
+        qDebug() << CURRENT_FUNCTION << "Decryption failed:" << e.what();
+        invalid(QObject::tr("A password could not be decrypted."));
+    }
+
+    if (m_device)
+        m_data.clear();
+}
+
+
+/**
+ * @brief Reports the structure without properties.
+ *
+ * Each entry is reported with startEntry() and endEntry() only. While the handler is
+ * in startEntry(), position() returns the offset that must be passed to readProperties()
+ * to read the properties of that entry.
+ *
+ * authenticate() must be called before.
+ *
+ * @param handler the handler that receives the categories and entries
+ * @exception ReadWriteException if the file was not authenticated or is invalid
+ */
+void BinaryDataReader::readIndex(DataHandler& handler)
+    throw (ReadWriteException)
+{
+    checkAuthenticated();
+    readRecords(handler, 0, true);
+}
+
+
+/**
+ * @brief Reads the properties of one entry.
+ *
+ * readIndex() must be called before.
+ *
+ * @param offset the offset returned by position() in DataHandler::startEntry()
+ * @param handler the handler that receives the properties
+ * @param enc the encryptor used to decrypt the passwords, may be 0
+ * @exception ReadWriteException if the offset is invalid or a password could not
+ *            be decrypted
+ */
+void BinaryDataReader::readProperties(quint32 offset, DataHandler& handler, StringEncryptor* enc)
+    throw (ReadWriteException)
+{
+    if (offset > quint32(m_end))
+        invalid(QObject::tr("Invalid offset %1.").arg(offset));
+    m_position = offset;
+
+    try {
+        for (;;) {
+            const unsigned char record = readByte();
+            if (record == BinaryFormat::RProperty)
+                readProperty(handler, enc);
+            else if (record == BinaryFormat::REnd)
+                return;
+            else
+                invalid(QObject::tr("Unknown record type %1.").arg(record));
+        }
+    } catch (const ReadWriteException&) {
+        throw;
+    } catch (const std::exception& e) {
+        qDebug() << CURRENT_FUNCTION << "Decryption failed:" << e.what();
+        invalid(QObject::tr("A password could not be decrypted."));
+    }
+}
+
+
+/**
+ * @brief Returns the current read position.
+ *
+ * @return the offset from the beginning of the file
+ */
+quint32 BinaryDataReader::position() const
+{
+    return m_position;
+}
+
+
+/**
+ * @brief Makes sure that no data is reported before the tag was checked.
+ *
+ * @exception ReadWriteException if authenticate() was not successful
+ */
+void BinaryDataReader::checkAuthenticated() const
+    throw (ReadWriteException)
+{
+    if (!m_authenticated)
+        invalid(QObject::tr("The file was not authenticated."));
+}
+
+
+/**
+ * @brief Reads all records and passes them to the handler.
+ *
+ * @param handler the handler that receives the data
+ * @param enc the encryptor for the passwords, may be 0
+ * @param skipProperties if @c true, the properties are not reported
+ * @exception ReadWriteException if the structure is invalid
+ */
+void BinaryDataReader::readRecords(DataHandler& handler, StringEncryptor* enc,
+                                   bool skipProperties)
+    throw (ReadWriteException)
+{
+    QStack<unsigned char> open;
+
+    for (;;) {
+        const unsigned char record = readByte();
+        switch (record) {
+            case BinaryFormat::RCategory: {
+                if (!open.isEmpty() && open.top() != BinaryFormat::RCategory)
+                    invalid(QObject::tr("A category is inside an entry."));
+                const unsigned char flags = readByte();
+                const QString name = QString::fromUtf8(readString());
+                handler.startCategory(name, flags & BinaryFormat::FWasOpen,
+                    flags & BinaryFormat::FIsSelected);
+                open.push(record);
+                break;
+            }
+
+            case BinaryFormat::REntry: {
+                if (!open.isEmpty() && open.top() != BinaryFormat::RCategory)
+                    invalid(QObject::tr("An entry is inside an entry."));
+                const unsigned char flags = readByte();
+                const QString name = QString::fromUtf8(readString());
+                handler.startEntry(name, flags & BinaryFormat::FIsSelected);
+                open.push(record);
+                break;
+            }
+
+            case BinaryFormat::RProperty:
+                if (open.isEmpty() || open.top() != BinaryFormat::REntry)
+                    invalid(QObject::tr("A property is outside of an entry."));
+                if (skipProperties) {
+                    readBytes(2);
+                    skipString();
+                    skipString();
+                } else
+                    readProperty(handler, enc);
+                break;
+
+            case BinaryFormat::REnd:
+                if (open.isEmpty())
+                    invalid(QObject::tr("There are more ends than starts."));
+                if (open.pop() == BinaryFormat::RCategory)
+                    handler.endCategory();
+                else
+                    handler.endEntry();
+                break;
+
+            case BinaryFormat::REndOfData:
+                if (!open.isEmpty() || m_position != m_end)
+                    invalid(QObject::tr("The data ends unexpectedly."));
+                return;
+
+            default:
+                invalid(QObject::tr("Unknown record type %1.").arg(record));
+        }
+    }
+}
+
+
+/**
+ * @brief Reads the contents of a property record and passes it to the handler.
+ *
+ * @param handler the handler
+ * @param enc the encryptor for the passwords, may be 0
+ * @exception ReadWriteException if the record is invalid
+ */
+void BinaryDataReader::readProperty(DataHandler& handler, StringEncryptor* enc)
+    throw (ReadWriteException)
+{
+    const unsigned char type = readByte();
+    const unsigned char flags = readByte();
+    if (type > Property::URL)
+        invalid(QObject::tr("A property has an unknown type."));
+    const QString key = QString::fromUtf8(readString());
+    const QByteArray bytes = readString();
+
+    QString value;
+    if (flags & BinaryFormat::FRawValue) {
+        value = EncodingHelper::toBase64(ByteSpan(
+            reinterpret_cast<const unsigned char*>(bytes.constData()), bytes.size()));
+    } else
+        value = QString::fromUtf8(bytes);
+
+    if (enc && type == Property::PASSWORD)
+        value = enc->decryptStrFromStr(value);
+
+    handler.appendProperty(key, value, Property::Type(type),
+        flags & BinaryFormat::FEncrypted, flags & BinaryFormat::FHidden);
+}
+
+
+/**
+ * @brief Reads one byte.
+ *
+ * @return the byte
+ * @exception ReadWriteException if the end of the data is reached
+ */
+unsigned char BinaryDataReader::readByte()
+    throw (ReadWriteException)
+{
+    if (m_position >= m_end)
+        invalid(QObject::tr("The file is truncated."));
+    return m_data.at(m_position++);
+}
+
+
+/**
+ * @brief Reads a 16 bit number in big endian byte order.
+ *
+ * @return the number
+ * @exception ReadWriteException if the end of the data is reached
+ */
+quint16 BinaryDataReader::readUInt16()
+    throw (ReadWriteException)
+{
+    quint16 high = readByte();
+    return (high << 8) | readByte();
+}
+
+
+/**
+ * @brief Reads a 32 bit number in big endian byte order.
+ *
+ * @return the number
+ * @exception ReadWriteException if the end of the data is reached
+ */
+quint32 BinaryDataReader::readUInt32()
+    throw (ReadWriteException)
+{
+    quint32 high = readUInt16();
+    return (high << 16) | readUInt16();
+}
+
+
+/**
+ * @brief Reads @p length bytes.
+ *
+ * @param length the number of bytes
+ * @return the bytes
+ * @exception ReadWriteException if there are not enough bytes
+ */
+QByteArray BinaryDataReader::readBytes(int length)
+    throw (ReadWriteException)
+{
+    if (length < 0 || length > m_end - m_position)
+        invalid(QObject::tr("The file is truncated."));
+
+    QByteArray result = m_data.mid(m_position, length);
+    m_position += length;
+    return result;
+}
+
+
+/**
+ * @brief Reads a string, i.e. a length and the bytes.
+ *
+ * @return the bytes
+ * @exception ReadWriteException if there are not enough bytes
+ */
+QByteArray BinaryDataReader::readString()
+    throw (ReadWriteException)
+{
+    const quint32 length = readUInt32();
+    if (length > quint32(m_end - m_position))
+        invalid(QObject::tr("The file is truncated."));
+    return readBytes(length);
+}
+
+
+/**
+ * @brief Skips a string without copying it.
+ *
+ * @exception ReadWriteException if there are not enough bytes
+ */
+void BinaryDataReader::skipString()
+    throw (ReadWriteException)
+{
+    const quint32 length = readUInt32();
+    if (length > quint32(m_end - m_position))
+        invalid(QObject::tr("The file is truncated."));
+    m_position += length;
+}
+
+
+/**
+ * @brief Throws a ReadWriteException that says that the file is invalid.
+ *
+ * @param reason the detailed reason
+ * @exception ReadWriteException always
+ */
+void BinaryDataReader::invalid(const QString& reason) const
+    throw (ReadWriteException)
+{
+    qDebug() << CURRENT_FUNCTION << reason;
+    throw ReadWriteException(QObject::tr("The data file (%1) may be corrupted.\nThe "
+        "error message was: %2").arg(m_fileName, reason), ReadWriteException::CInvalidData);
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
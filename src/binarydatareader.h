@@ -0,0 +1,88 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef BINARYDATAREADER_H
+#define BINARYDATAREADER_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QString>
+
+#include "dataformat.h"
+#include "security/encryptor.h"
+
+class BinaryDataReader : public DataReader
+{
+    public:
+        BinaryDataReader(QIODevice* device);
+        BinaryDataReader(const QByteArray& data, const QString& fileName);
+
+    public:
+        AppData readAppData()
+            throw (ReadWriteException);
+        void authenticate(const ByteSpan& key)
+            throw (ReadWriteException);
+
+        void readPasswords(DataHandler& handler, StringEncryptor* enc)
+            throw (ReadWriteException);
+
+        void readIndex(DataHandler& handler)
+            throw (ReadWriteException);
+        void readProperties(quint32 offset, DataHandler& handler, StringEncryptor* enc)
+            throw (ReadWriteException);
+        quint32 position() const;
+
+        static bool isBinary(QIODevice* device);
+
+    private:
+        void checkAuthenticated() const
+            throw (ReadWriteException);
+        void readRecords(DataHandler& handler, StringEncryptor* enc, bool skipProperties)
+            throw (ReadWriteException);
+        void readProperty(DataHandler& handler, StringEncryptor* enc)
+            throw (ReadWriteException);
+
+        unsigned char readByte()
+            throw (ReadWriteException);
+        quint16 readUInt16()
+            throw (ReadWriteException);
+        quint32 readUInt32()
+            throw (ReadWriteException);
+        QByteArray readBytes(int length)
+            throw (ReadWriteException);
+        QByteArray readString()
+            throw (ReadWriteException);
+        void skipString()
+            throw (ReadWriteException);
+        void invalid(const QString& reason) const
+            throw (ReadWriteException);
+
+    private:
+        BinaryDataReader(const BinaryDataReader&);
+        BinaryDataReader& operator=(const BinaryDataReader&);
+
+    private:
+        QIODevice*      m_device;
+        QString         m_fileName;
+        QByteArray      m_data;
+        int             m_position;
+        int             m_end;
+        QByteArray      m_nonce;
+        bool            m_useCard;
+        bool            m_authenticated;
+};
+
+#endif // BINARYDATAREADER_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,299 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QFile>
+#include <QApplication>
+#include <QDebug>
+
+#include "global.h"
+#include "binarydatawriter.h"
+#include "binaryformat.h"
+#include "security/encodinghelper.h"
+
+// -------------------------------------------------------------------------------------------------
+//                                     Static members
+// -------------------------------------------------------------------------------------------------
+
+const int BinaryDataWriter::BUFFER_SIZE = 64 * 1024;
+
+/**
+ * @class BinaryDataWriter
+ *
+ * @brief A DataWriter that writes the data file in the binary format.
+ *
+ * The format is described in BinaryFormat. The records are collected in a buffer and
+ * written to the device in blocks, the authentication tag is computed while writing.
+ * Encrypted passwords that are passed as Base 64 are stored as raw bytes.
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @brief Creates a new instance of a BinaryDataWriter.
+ *
+ * @param device the device to write to, it must be open for writing and must stay valid
+ *        as long as this object exists
+ * @param enc the encryptor used to encrypt the passwords, may be 0 if the passwords should
+ *        be written as they are passed
+ * @param key the key of the KeyDerivation, the key for the authentication tag is computed
+ *        from it. The memory must stay valid as long as this object exists.
+ */
+BinaryDataWriter::BinaryDataWriter(QIODevice* device, StringEncryptor* enc,
+                                   const ByteSpan& key)
+    : m_device(device)
+    , m_encryptor(enc)
+    , m_key(key)
+    , m_useCard(false)
+    , m_writeError(false)
+{
+    m_buffer.reserve(BUFFER_SIZE);
+}
+
+
+/**
+ * @brief Writes the header and the application data.
+ *
+ * A new nonce is created for each file.
+ *
+ * @param appData the application data
+ * @exception ReadWriteException if the authentication is not available
+ */
+void BinaryDataWriter::writeAppData(const AppData& appData)
+    throw (ReadWriteException)
+{
+    Q_ASSERT(!m_key.isEmpty());
+
+    QByteArray nonce;
+    try {
+        nonce = GcmAuthenticator::randomBytes(GcmAuthenticator::NONCE_LENGTH);
+        m_authenticator.reset(new GcmAuthenticator(m_key, nonce));
+    } catch (const std::exception& e) {
+        qDebug() << CURRENT_FUNCTION << e.what();
+        throw ReadWriteException(QObject::tr("The data could not be saved in the binary "
+            "format:\n%1\nChoose the XML format in the settings.").arg(e.what()),
+            ReadWriteException::CNoAlgorithm);
+    }
+
+    m_useCard = appData.useCard;
+
+    m_buffer.append(BinaryFormat::MAGIC, BinaryFormat::MAGIC_LENGTH);
+    writeUInt16(BinaryFormat::VERSION);
+    writeUInt16(m_useCard ? BinaryFormat::FUseCard : 0);
+    m_buffer.append(nonce);
+    writeString(appData.version.toUtf8());
+    writeString(appData.date.toUtf8());
+    writeString(appData.cryptAlgorithm.toUtf8());
+    writeString(appData.passwordHash.toUtf8());
+    writeUInt32(m_useCard ? appData.cardId : 0);
+    writeString(appData.kdfAlgorithm.toUtf8());
+    writeUInt32(appData.kdfIterations);
+    writeString(appData.kdfSalt);
+}
+
+
+/**
+ * @brief Writes the end of the data and the authentication tag and flushes the device.
+ *
+ * @exception ReadWriteException if the data could not be written
+ */
+void BinaryDataWriter::finish()
+    throw (ReadWriteException)
+{
+    Q_ASSERT(m_authenticator);
+
+    writeByte(BinaryFormat::REndOfData);
+    flushBuffer();
+
+    // the tag is not part of the authenticated data
+    const QByteArray tag = m_authenticator->tag();
+    if (m_device->write(tag) != tag.size())
+        m_writeError = true;
+
+    QFile* file = qobject_cast<QFile*>(m_device);
+    if (file && (!file->flush() || file->error() != QFile::NoError))
+        m_writeError = true;
+
+    if (m_writeError) {
+        qDebug() << CURRENT_FUNCTION << m_device->errorString();
+        throw ReadWriteException(QObject::tr("The data could not be saved. There "
+            "was an\nerror while writing the file:\n%1").arg(qApp->translate("QFile",
+            m_device->errorString())), ReadWriteException::CIOError);
+    }
+}
+
+
+/**
+ * @copydoc DataHandler::startCategory(const QString&, bool, bool)
+ */
+void BinaryDataWriter::startCategory(const QString& name, bool wasOpen, bool isSelected)
+{
+    writeByte(BinaryFormat::RCategory);
+    writeByte((wasOpen ? BinaryFormat::FWasOpen : 0)
+        | (isSelected ? BinaryFormat::FIsSelected : 0));
+    writeString(name.toUtf8());
+}
+
+
+/**
+ * @copydoc DataHandler::endCategory()
+ */
+void BinaryDataWriter::endCategory()
+{
+    writeByte(BinaryFormat::REnd);
+}
+
+
+/**
+ * @copydoc DataHandler::startEntry(const QString&, bool)
+ */
+void BinaryDataWriter::startEntry(const QString& name, bool isSelected)
+{
+    writeByte(BinaryFormat::REntry);
+    writeByte(isSelected ? BinaryFormat::FIsSelected : 0);
+    writeString(name.toUtf8());
+}
+
+
+/**
+ * @copydoc DataHandler::endEntry()
+ */
+void BinaryDataWriter::endEntry()
+{
+    writeByte(BinaryFormat::REnd);
+}
+
+
+/**
+ * @copydoc DataHandler::appendProperty(const QString&, const QString&, Property::Type, bool, bool)
+ */
+void BinaryDataWriter::appendProperty(const QString& key, const QString& value,
+                                      Property::Type type, bool encrypted, bool hidden)
+{
+    unsigned char flags = (encrypted ? BinaryFormat::FEncrypted : 0)
+        | (hidden ? BinaryFormat::FHidden : 0);
+
+    QByteArray bytes;
+    if (type == Property::PASSWORD) {
+        const QString stored = m_encryptor ? m_encryptor->encryptStrToStr(value) : value;
+
+        // only store the raw bytes if converting back yields exactly the same string
+        ByteVector raw;
+        if (isBase64(stored))
+            raw = EncodingHelper::fromBase64(stored);
+        if (!raw.empty() && EncodingHelper::toBase64(raw) == stored) {
+            flags |= BinaryFormat::FRawValue;
+            bytes = QByteArray(reinterpret_cast<const char*>(raw.constData()), raw.size());
+        } else
+            bytes = stored.toUtf8();
+    } else
+        bytes = value.toUtf8();
+
+    writeByte(BinaryFormat::RProperty);
+    writeByte(type);
+    writeByte(flags);
+    writeString(key.toUtf8());
+    writeString(bytes);
+}
+
+
+/**
+ * @brief Checks if @p string only consists of Base 64 characters and has a valid length.
+ *
+ * @param string the string to check
+ * @return @c true if EncodingHelper::fromBase64() can decode it, @c false otherwise
+ */
+bool BinaryDataWriter::isBase64(const QString& string)
+{
+    if (string.length() % 4 != 0)
+        return false;
+
+    for (int i = 0; i < string.length(); ++i) {
+        const ushort c = string[i].unicode();
+        if (!((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+                || c == '+' || c == '/' || c == '='))
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Appends one byte.
+ *
+ * @param byte the byte
+ */
+void BinaryDataWriter::writeByte(unsigned char byte)
+{
+    m_buffer.append(char(byte));
+}
+
+
+/**
+ * @brief Appends a 16 bit number in big endian byte order.
+ *
+ * @param number the number
+ */
+void BinaryDataWriter::writeUInt16(quint16 number)
+{
+    m_buffer.append(char(number >> 8));
+    m_buffer.append(char(number));
+}
+
+
+/**
+ * @brief Appends a 32 bit number in big endian byte order.
+ *
+ * @param number the number
+ */
+void BinaryDataWriter::writeUInt32(quint32 number)
+{
+    m_buffer.append(char(number >> 24));
+    m_buffer.append(char(number >> 16));
+    m_buffer.append(char(number >> 8));
+    m_buffer.append(char(number));
+}
+
+
+/**
+ * @brief Appends the length and the bytes of @p string.
+ *
+ * If the buffer is full after that, it is written to the device.
+ *
+ * @param string the bytes
+ */
+void BinaryDataWriter::writeString(const QByteArray& string)
+{
+    writeUInt32(string.size());
+    m_buffer.append(string);
+
+    if (m_buffer.size() >= BUFFER_SIZE)
+        flushBuffer();
+}
+
+
+/**
+ * @brief Passes the buffer to the authenticator and writes it to the device.
+ *
+ * Errors are remembered and reported by finish().
+ */
+void BinaryDataWriter::flushBuffer()
+{
+    m_authenticator->update(m_buffer.constData(), m_buffer.size());
+    if (!m_writeError && m_device->write(m_buffer) != m_buffer.size())
+        m_writeError = true;
+    m_buffer.resize(0);
+    m_buffer.reserve(BUFFER_SIZE);
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
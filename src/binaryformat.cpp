@@ -0,0 +1,85 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <cstring>
+
+#include "binaryformat.h"
+
+// -------------------------------------------------------------------------------------------------
+//                                     Static members
+// -------------------------------------------------------------------------------------------------
+
+const char BinaryFormat::MAGIC[] = "\x89QPAMAT\n";
+const int  BinaryFormat::MAGIC_LENGTH = 8;
+const int  BinaryFormat::VERSION = 1;
+
+/**
+ * @class BinaryFormat
+ *
+ * @brief Constants of the binary data file format.
+ *
+ * The binary format contains the same data as the XML format (see qpamat.dtd), so a
+ * file can be converted in both directions without losing anything. Passwords are
+ * stored as raw ciphertext instead of Base 64 and no text has to be escaped or parsed.
+ *
+ * All integers are big endian. A @e string is an unsigned 32 bit length followed by
+ * that number of bytes (UTF-8 for text). The file looks like this:
+ *
+ * <table>
+ * <tr><th>Size</th><th>Contents</th></tr>
+ * <tr><td>8</td><td>MAGIC</td></tr>
+ * <tr><td>2</td><td>VERSION</td></tr>
+ * <tr><td>2</td><td>flags, FUseCard</td></tr>
+ * <tr><td>12</td><td>the GCM nonce</td></tr>
+ * <tr><td>4 strings</td><td>version, date, crypt algorithm and password hash</td></tr>
+ * <tr><td>4</td><td>the card id</td></tr>
+ * <tr><td>1 string</td><td>the name of the KeyDerivation</td></tr>
+ * <tr><td>4</td><td>the number of iterations of the KeyDerivation</td></tr>
+ * <tr><td>1 string</td><td>the salt of the KeyDerivation</td></tr>
+ * <tr><td>...</td><td>records</td></tr>
+ * <tr><td>1</td><td>REndOfData</td></tr>
+ * <tr><td>16</td><td>the GCM tag</td></tr>
+ * </table>
+ *
+ * The records are
+ *
+ *  - RCategory, 1 byte flags (FWasOpen, FIsSelected), the name
+ *  - REntry, 1 byte flags (FIsSelected), the name
+ *  - RProperty, 1 byte Property::Type, 1 byte flags (FEncrypted, FHidden, FRawValue),
+ *    the key, the value
+ *  - REnd which closes the category or entry that was started last
+ *
+ * If FRawValue is set, the value contains the bytes that are Base 64 encoded in the XML
+ * file. This is done for encrypted passwords and for the references of a CollectEncryptor
+ * to the passwords on a smartcard.
+ *
+ * The tag is computed by a GcmAuthenticator over everything in front of it. The key is
+ * computed from the key of the KeyDerivation, so a modified file is detected before any
+ * data is passed to the application and the tag doesn't help to guess the password.
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @brief Checks if the data starts like a binary data file.
+ *
+ * @param start at least the first MAGIC_LENGTH bytes of the file
+ * @return @c true if the data is in the binary format, @c false if it should be XML
+ */
+bool BinaryFormat::isBinary(const QByteArray& start)
+{
+    return start.size() >= MAGIC_LENGTH && std::memcmp(start.constData(), MAGIC, MAGIC_LENGTH) == 0;
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,54 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef BINARYFORMAT_H
+#define BINARYFORMAT_H
+
+#include <QByteArray>
+
+class BinaryFormat
+{
+    public:
+        enum Record {
+            RCategory   = 'C',
+            REntry      = 'E',
+            RProperty   = 'P',
+            REnd        = 'X',
+            REndOfData  = 'Z'
+        };
+
+        enum Flag {
+            FUseCard    = 0x01,
+            FWasOpen    = 0x01,
+            FIsSelected = 0x02,
+            FEncrypted  = 0x01,
+            FHidden     = 0x02,
+            FRawValue   = 0x04
+        };
+
+    public:
+        static const char       MAGIC[];
+        static const int        MAGIC_LENGTH;
+        static const int        VERSION;
+
+    public:
+        static bool isBinary(const QByteArray& start);
+
+    private:
+        BinaryFormat();
+};
+
+#endif // BINARYFORMAT_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,49 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef DATAFORMAT_H
+#define DATAFORMAT_H
+
+#include "datahandler.h"
+#include "datareadwriter.h"
+#include "security/encryptor.h"
+
+class DataReader
+{
+    public:
+        virtual ~DataReader() { }
+
+    public:
+        virtual AppData readAppData()
+            throw (ReadWriteException) = 0;
+
+        virtual void readPasswords(DataHandler& handler, StringEncryptor* enc)
+            throw (ReadWriteException) = 0;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+class DataWriter : public DataHandler
+{
+    public:
+        virtual void writeAppData(const AppData& appData)
+            throw (ReadWriteException) = 0;
+
+        virtual void finish()
+            throw (ReadWriteException) = 0;
+};
+
+#endif // DATAFORMAT_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,57 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef DATAHANDLER_H
+#define DATAHANDLER_H
+
+#include <QString>
+#include <QByteArray>
+
+#include "property.h"
+
+struct AppData
+{
+    AppData()
+        : kdfIterations(0), useCard(false), cardId(0) {}
+
+    QString     version;
+    QString     date;
+    QString     cryptAlgorithm;
+    QString     kdfAlgorithm;
+    int         kdfIterations;
+    QByteArray  kdfSalt;
+    QString     passwordHash;
+    bool        useCard;
+    int         cardId;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+class DataHandler
+{
+    public:
+        virtual ~DataHandler() { }
+
+    public:
+        virtual void startCategory(const QString& name, bool wasOpen, bool isSelected) = 0;
+        virtual void endCategory() = 0;
+        virtual void startEntry(const QString& name, bool isSelected) = 0;
+        virtual void endEntry() = 0;
+        virtual void appendProperty(const QString& key, const QString& value,
+            Property::Type type, bool encrypted, bool hidden) = 0;
+};
+
+#endif // DATAHANDLER_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -33,10 +33,21 @@
 #include "qpamatwindow.h"
 #include "qpamat.h"
 #include "datareadwriter.h"
+#include "xmldatareader.h"
+#include "xmldatawriter.h"
+#include "binarydatareader.h"
+#include "binarydatawriter.h"
+#include "readonlydatafile.h"
+#include "parallelcrypthandler.h"
+#include "passwordcache.h"
+#include "tree.h"
+#include "util/atomicfile.h"
 #include "smartcard/memorycard.h"
 #include "security/passwordhash.h"
+#include "security/sessionkeystore.h"
 #include "security/symmetricencryptor.h"
 #include "security/collectencryptor.h"
+#include "security/keyderivation.h"
 #include "dialogs/insertcarddialog.h"
 #include "dialogs/waitdialog.h"
 #include "global.h"
@@ -197,11 +208,26 @@
  *
  * @par Writing
  *
- * In DOM, no XML element can exist without the context of a DomDocument. Therefore
- * you have to create an QDomDocument with the factory function createSkeletonDocument()
- * in this class. It gets filled with application-specific data and contains an empty
- * <tt>\<password\></tt> tag. The document must be passed to the Tree::writeToXML()
- * function.
+ * The Tree is passed to writeXML() which walks it with Tree::writeData() and writes
+ * the file while walking. Depending on <tt>General/FileFormat</tt>, a XmlDataWriter or
+ * a BinaryDataWriter is used. Without smartcard, the passwords are
+ * encrypted in batches on all processors by a ParallelCryptHandler, the same is done for
+ * decryption when reading. Unless <tt>General/AtomicSave</tt> is
+ * turned off, the data is written to an AtomicFile, so the old file is only replaced
+ * after everything has been written successfully. With lazy decryption, the AtomicFile is
+ * always used because a password that cannot be decrypted aborts the writing. If the
+ * passwords are stored on the smartcard, the tree is walked twice: the passwords must be on
+ * the card before the file can be written because the id of the card is stored in front of
+ * the passwords.
+ *
+ * @par Reading
+ *
+ * Reading doesn't use DOM. The format is detected from the start of the file, it is parsed
+ * with a XmlDataReader or a BinaryDataReader and the contents is passed to a DataHandler
+ * (normally a TreeBuilder) while the file is read.
+ *
+ * In read-only mode, openReadOnly() reads a binary file into memory and the properties are
+ * only read when they are needed, see ReadOnlyDataFile.
  *
  * @bug PIN verification does not work here: I get 90 00 as response after verifying, but
  *       writing fails with 62 00 error !??
@@ -221,55 +247,6 @@ DataReadWriter::DataReadWriter(QWidget* parent)
 {}
 
 
-/**
- * @brief Creates a skeleton document that must be used for writing the XML tree to the
- *        harddisk.
- *
- * As described in the constructor documentation, it contains all application data.
- *
- * @return the QDomDocument object
- */
-QDomDocument DataReadWriter::createSkeletonDocument() throw ()
-{
-    const char url[] = "http://qpamat.berlios.de/qpamat.dtd";
-    QDomDocument doc(QDomImplementation().createDocumentType( "qpamat", 0, url));
-
-    // add application-specific data
-    QDomElement root = doc.createElement("qpamat");
-    doc.appendChild(root);
-    QDomElement appData = doc.createElement("app-data");
-    root.appendChild(appData);
-
-    QDomElement version = doc.createElement("version");
-    QDomText versionValue = doc.createTextNode(VERSION_STRING);
-    version.appendChild(versionValue);
-    appData.appendChild(version);
-
-    QDomElement date = doc.createElement("date");
-    QDomText algo = doc.createTextNode(QDateTime::currentDateTime(Qt::UTC).toString(Qt::ISODate));
-    date.appendChild(algo);
-    appData.appendChild(date);
-
-    QDomElement cryptAlgorithm = doc.createElement("crypt-algorithm");
-    QpamatWindow *win = Qpamat::instance()->getWindow();
-    QDomText algorithm = doc.createTextNode(win->set().readEntry("Security/CipherAlgorithm"));
-    cryptAlgorithm.appendChild(algorithm);
-    appData.appendChild(cryptAlgorithm);
-
-    QDomElement passwordhash = doc.createElement("passwordhash");
-    appData.appendChild(passwordhash);
-
-    QDomElement smartcard = doc.createElement("smartcard");
-    smartcard.setAttribute("useCard", win->set().readBoolEntry("Smartcard/UseCard"));
-    appData.appendChild(smartcard);
-
-    // add the empty passwords child
-    QDomElement passwords = doc.createElement("passwords");
-    root.appendChild(passwords);
-
-    return doc;
-}
-
 // -------------------------------------------------------------------------------------------------
 #ifndef DOXYGEN
 
@@ -277,9 +254,10 @@ class ReadWriteThread : public QThread
 {
     public:
         ReadWriteThread(MemoryCard& card, ByteVector& bytes, bool write,
-                        unsigned char& randomNumber, const QString& password, const QString& pin)
+                        unsigned char& randomNumber, const QString& password,
+                        const ByteSpan& key, const QString& pin)
             : m_card(card), m_bytes(bytes), m_write(write), m_randomNumber(randomNumber),
-              m_password(password), m_exception(0), m_pin(pin) { }
+              m_password(password), m_key(key), m_exception(0), m_pin(pin) { }
 
         virtual ~ReadWriteThread();
 
@@ -296,6 +274,7 @@ class ReadWriteThread : public QThread
         const bool          m_write;
         unsigned char&      m_randomNumber;
         const QString&      m_password;
+        const ByteSpan      m_key;
         ReadWriteException* m_exception;
         const QString&      m_pin;
 };
@@ -322,7 +301,7 @@ class ReadWriteThread : public QThread
  */
 
 /**
- * @fn ReadWriteThread::ReadWriteThread(MemoryCard&, ByteVector&, bool, unsigned char&, const QString&)
+ * @fn ReadWriteThread::ReadWriteThread(MemoryCard&, ByteVector&, bool, unsigned char&, const QString&, const ByteSpan&, const QString&)
  *
  * @brief Creates a new instance of a ReadWriteThread.
  *
@@ -333,7 +312,10 @@ class ReadWriteThread : public QThread
  * @param bytes the read or write bytes
  * @param write @c true if a write operation should be made, @c false for a read operation
  * @param randomNumber the random number
- * @param password the password to check
+ * @param password the password to check, only used to read the hash of older files
+ * @param key the key from KeyDerivation::deriveKey(), its hash is written to the card;
+ *        empty when reading a file without key derivation
+ * @param pin the PIN or a null string
  */
 
 /**
@@ -369,9 +351,12 @@ void ReadWriteThread::run()
             qDebug() << CURRENT_FUNCTION << "Writing random =" << byteVector[0];
             m_card.write(0, byteVector);
 
-            // write the password hash and include a length information
-            ByteVector pwHash = PasswordHash::generateHash(m_password);
-            pwHash.insert(pwHash.begin(), pwHash.size());
+            // write the hash of the key and include a length information
+            const ByteVector hash = PasswordHash::generateKeyHash(m_key);
+            ByteVector pwHash;
+            pwHash.reserve(hash.size() + 1);
+            pwHash.append(static_cast<unsigned char>(hash.size()));
+            pwHash.append(hash);
             m_card.write(1, pwHash);
 
             qDebug() << CURRENT_FUNCTION << "Password hash length = " << (pwHash.size()-1);
@@ -403,7 +388,10 @@ void ReadWriteThread::run()
 
             qDebug() << CURRENT_FUNCTION << "Password hash length =" << len;
 
-            if (!PasswordHash::isCorrect(m_password, pwHash)) {
+            // older files have a hash of the password
+            const bool correct = (!m_key.isEmpty() && PasswordHash::isCorrectKey(m_key, pwHash))
+                || (!m_password.isNull() && PasswordHash::isCorrect(m_password, pwHash));
+            if (!correct) {
                 m_exception = new ReadWriteException(QObject::tr("The given password was wrong."),
                     ReadWriteException::CWrongPassword);
                 return;
@@ -467,28 +455,138 @@ ReadWriteException* ReadWriteThread::getException() const
  * @return the exception
  */
 
+// -------------------------------------------------------------------------------------------------
+
+/**
+ * @class PasswordSizer
+ *
+ * @brief DataHandler that sums up the maximum size of the encrypted passwords.
+ *
+ * This is used to size the smartcard image before the passwords are collected.
+ */
+class PasswordSizer : public DataHandler
+{
+    public:
+        PasswordSizer(const SymmetricEncryptor& enc)
+            : m_encryptor(enc), m_size(0) { }
+
+        void startCategory(const QString&, bool, bool) { }
+        void endCategory() { }
+        void startEntry(const QString&, bool) { }
+        void endEntry() { }
+
+        void appendProperty(const QString&, const QString& value, Property::Type type, bool, bool)
+        {
+            if (type == Property::PASSWORD)
+                m_size += m_encryptor.maximumEncryptedSize(value.toUtf8().size());
+        }
+
+        int getSize() const
+            { return m_size; }
+
+    private:
+        const SymmetricEncryptor&   m_encryptor;
+        int                         m_size;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+/**
+ * @class PasswordCollector
+ *
+ * @brief DataHandler that only encrypts the passwords and remembers the result.
+ *
+ * This is used for the first pass when writing to the smartcard.
+ */
+class PasswordCollector : public DataHandler
+{
+    public:
+        PasswordCollector(StringEncryptor& enc)
+            : m_encryptor(enc) { }
+
+        void startCategory(const QString&, bool, bool) { }
+        void endCategory() { }
+        void startEntry(const QString&, bool) { }
+        void endEntry() { }
+
+        void appendProperty(const QString&, const QString& value, Property::Type type, bool, bool)
+        {
+            if (type == Property::PASSWORD)
+                m_encrypted.append(m_encryptor.encryptStrToStr(value));
+        }
+
+        const QStringList& getEncrypted() const
+            { return m_encrypted; }
+
+    private:
+        StringEncryptor&    m_encryptor;
+        QStringList         m_encrypted;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+/**
+ * @class ReplayEncryptor
+ *
+ * @brief StringEncryptor that returns the results of a PasswordCollector.
+ *
+ * The passwords must be encrypted in the same order in which they were collected.
+ * This is used for the second pass when writing to the smartcard.
+ */
+class ReplayEncryptor : public StringEncryptor
+{
+    public:
+        ReplayEncryptor(const QStringList& encrypted)
+            : m_encrypted(encrypted), m_index(0) { }
+
+        QString encryptStrToStr(const QString&)
+        {
+            Q_ASSERT(m_index < m_encrypted.size());
+            return m_encrypted[m_index++];
+        }
+
+        QString decryptStrFromStr(const QString&)
+        {
+            Q_ASSERT(false);
+            return QString::null;
+        }
+
+    private:
+        const QStringList&  m_encrypted;
+        int                 m_index;
+};
+
 #endif // DOXYGEN
 
 // -------------------------------------------------------------------------------------------------
 
 
 /**
- * @brief Writes the document in the file specified in the global settings.
+ * @brief Writes the tree in the file and the format specified in the global settings.
  *
- * Encryption is done before writing with the specified password. If something went wrong,
- * a ReadWriteException is thrown.
+ * Encryption is done while writing with the key of @p keys, so no key has to be derived.
+ * If something went wrong, a ReadWriteException is thrown.
  *
- * @param document the XML document to write
- * @param password the password which is used for encryption
+ * @param tree the tree to write
+ * @param keys the key of the session, it must contain a key
+ * @param cache the cache of the passwords if they are decrypted when they are needed,
+ *        0 otherwise
  * @exception ReadWriteException several reasons
+ *               - @p keys contains no key
  *               - file could not be opened
  *               - cipher algorithm is not available
  *               - error in communicating with the smart-card terminal
+ *               - a password cannot be decrypted
  */
-void DataReadWriter::writeXML(const QDomDocument& document, const QString& password)
+void DataReadWriter::writeXML(const Tree& tree, const SessionKeyStore& keys,
+                              const PasswordCache* cache)
     throw (ReadWriteException)
 {
-    QDomDocument document_cpy = document.cloneNode(true).toDocument();
+    // there's no key in read-only mode
+    if (!keys.hasKey())
+        throw ReadWriteException(QObject::tr("The data cannot be saved without a key."),
+            ReadWriteException::COtherError);
+
     QpamatWindow *win = Qpamat::instance()->getWindow();
     bool smartcard = win->set().readBoolEntry("Smartcard/UseCard");
     const QString fileName = win->set().readEntry("General/Datafile");
@@ -502,15 +600,31 @@ void DataReadWriter::writeXML(const QDomDocument& document, const QString& passw
             "the file in</nobr> the configuration dialog or change the permission of the file!"
             "</qt>"), ReadWriteException::CIOError);
 
-    // set up the needed encryptors
+    AppData appData;
+    appData.version = VERSION_STRING;
+    appData.date = QDateTime::currentDateTime(Qt::UTC).toString(Qt::ISODate);
+    appData.cryptAlgorithm = algorithm;
+    appData.useCard = smartcard;
+
+    // set up the needed encryptors, files of older versions got the key derivation when
+    // they were opened
     QScopedPointer<StringEncryptor> enc;
-    QScopedPointer<Encryptor> realEncryptor;
+    QScopedPointer<SymmetricEncryptor> realEncryptor;
     try {
+        const KeyDerivation& kdf = keys.getKeyDerivation();
+        const ByteSpan key = keys.getKey();
+        appData.kdfAlgorithm = kdf.getAlgorithm();
+        appData.kdfIterations = kdf.getIterations();
+        appData.kdfSalt = kdf.getSalt();
+        appData.passwordHash = smartcard
+            ? "SMARTCARD"
+            : PasswordHash::generateKeyHashString(key);
+
         if (smartcard) {
-            realEncryptor.reset(new SymmetricEncryptor(algorithm, password));
+            realEncryptor.reset(new SymmetricEncryptor(algorithm, key));
             enc.reset(new CollectEncryptor(*realEncryptor));
         } else
-            enc.reset(new SymmetricEncryptor(algorithm, password));
+            enc.reset(new SymmetricEncryptor(algorithm, key));
     }
     catch (const NoSuchAlgorithmException& e)
     {
@@ -519,45 +633,100 @@ void DataReadWriter::writeXML(const QDomDocument& document, const QString& passw
             "your system.\nChoose another crypto algorithm in the settings.\nThe data "
             "is not saved!").arg(algorithm), ReadWriteException::CNoAlgorithm);
     }
+    catch (const std::runtime_error& e)
+    {
+        throw ReadWriteException(QObject::tr("The data could not be saved:\n%1")
+            .arg(e.what()), ReadWriteException::COtherError);
+    }
 
-    // encrypt
-    QDomElement pwData = document_cpy.documentElement().namedItem("passwords").toElement();
-    QDomElement appData = document_cpy.documentElement().namedItem("app-data").toElement();
-    crypt(pwData, *enc, true);
+    // either write directly or replace the file after everything has been written; with
+    // lazy decryption, a password may fail to decrypt while the file is written, so the old
+    // file must be kept in that case
+    QScopedPointer<AtomicFile> atomicFile;
+    QIODevice* output = &file;
+    const bool atomic = win->set().readBoolEntry("General/AtomicSave");
+    if (atomic || (cache && cache->isActive())) {
+        atomicFile.reset(new AtomicFile(fileName,
+            atomic ? win->set().readNumEntry("General/Backups") : 0));
+        output = atomicFile.data();
+    }
 
-    // write the password hash
-    const QString hash = smartcard
-        ? "SMARTCARD"
-        : PasswordHash::generateHashString(password);
-    QDomText text = document_cpy.createTextNode(hash);
-    appData.namedItem("passwordhash").toElement().appendChild(text);
+    // a password that cannot be decrypted must never be saved as an empty value, the
+    // AtomicFile removes the temporary file if the exception leaves this function
+    try {
+        // the passwords must be on the card before the card id can be written
+        PasswordCollector collector(*enc);
+        QScopedPointer<ReplayEncryptor> replay;
+        if (smartcard) {
+            CollectEncryptor* collectEncryptor = dynamic_cast<CollectEncryptor*>(enc.data());
+            PasswordSizer sizer(*realEncryptor);
+            tree.writeData(sizer);
+            collectEncryptor->reserve(sizer.getSize());
+
+            tree.writeData(collector);
+            replay.reset(new ReplayEncryptor(collector.getEncrypted()));
+
+            unsigned char id = 0;
+            ByteVector vec;
+            collectEncryptor->swapBytes(vec);
+            writeOrReadSmartcard(vec, true, id, QString(), keys.getKey());
+            appData.cardId = id;
+        }
 
-    unsigned char id = 0;
-    if (smartcard) {
-        ByteVector vec = dynamic_cast<CollectEncryptor*>(enc.data())->getBytes();
-        writeOrReadSmartcard(vec, true, id, password);
-        appData.namedItem("smartcard").toElement().setAttribute("card-id", id);
+        if (!output->open(QIODevice::WriteOnly))
+            throw ReadWriteException(QObject::tr("The data could not be saved. There "
+                "was an\nerror while creating the file:\n%1").arg( qApp->translate("QFile",
+                output->errorString())), ReadWriteException::CIOError);
+
+        QScopedPointer<DataWriter> writer;
+        if (win->set().readEntry("General/FileFormat") == "Binary")
+            writer.reset(new BinaryDataWriter(output, replay.data(), keys.getKey()));
+        else
+            writer.reset(new XmlDataWriter(output, replay.data()));
+
+        writer->writeAppData(appData);
+        if (smartcard)
+            tree.writeData(*writer);
+        else {
+            // the CollectEncryptor depends on the order, so only encrypt in parallel without
+            // card
+            try {
+                ParallelCryptHandler encryptor(*writer, static_cast<SymmetricEncryptor&>(*enc),
+                    ParallelCryptHandler::Encrypt);
+                tree.writeData(encryptor);
+                encryptor.flush();
+            } catch (const std::invalid_argument& e) {
+                throw ReadWriteException(QObject::tr("The data could not be saved. Encrypting "
+                    "failed:\n%1").arg(e.what()), ReadWriteException::COtherError);
+            }
+        }
+        writer->finish();
+    } catch (const DecryptionException& e) {
+        throw ReadWriteException(QObject::tr("A password could not be decrypted, the data "
+            "is not saved:\n%1").arg(e.what()), ReadWriteException::COtherError);
     }
 
-    if (!file.open(QIODevice::WriteOnly))
+    if (atomicFile && !atomicFile->commit())
         throw ReadWriteException(QObject::tr("The data could not be saved. There "
-            "was an\nerror while creating the file:\n%1").arg( qApp->translate("QFile",
-            file.errorString())), ReadWriteException::CIOError);
-
-    QTextStream stream(&file);
-    stream.setEncoding(QTextStream::UnicodeUTF8);
-    stream << document_cpy.toString();
+            "was an\nerror while writing the file:\n%1\nThe old file is unchanged.").arg(
+            qApp->translate("QFile", atomicFile->errorString())), ReadWriteException::CIOError);
 }
 
 
 /**
- * @brief Reads the document from the specified XML (global settings) file and decrypts the
- *        passwords using the given \p password.
+ * @brief Reads the specified XML (global settings) file, decrypts the passwords using the
+ *        given \p password and passes the data to \p handler.
  *
- * It does also a password check.
+ * It does also a password check. The file is read in one pass, the passwords are given to
+ * the handler while the file is read. If an exception is thrown while reading the passwords,
+ * the handler may already have received a part of the data.
  *
  * @param password the decryption password
- * @return the document
+ * @param handler the handler that receives the passwords
+ * @param cache if not 0, the passwords are not decrypted but passed encrypted to the
+ *        handler, the cache gets the encryptor to decrypt them later. This is ignored
+ *        for smartcard files.
+ * @param keys if not 0, receives the key for saving the file, see storeKey()
  * @exception ReadWriteException several reasons
  *               - cannot open the XML file
  *               - invalid XML file
@@ -566,78 +735,271 @@ void DataReadWriter::writeXML(const QDomDocument& document, const QString& passw
  *               - wrong configuration of the smartcard terminal
  *               - algorithm does not exist in this OpenSSL configuration
  *               - error with communicating with the card terminal
+ *               - the passwords are on a smartcard but the application has no GUI
  */
-QDomDocument DataReadWriter::readXML(const QString& password)
+void DataReadWriter::readXML(const QString& password, DataHandler& handler,
+                             PasswordCache* cache, SessionKeyStore* keys)
     throw (ReadWriteException)
 {
     qDebug() << CURRENT_FUNCTION;
 
-    QpamatWindow *win = Qpamat::instance()->getWindow();
-    const QString& fileName = win->set().readEntry("General/Datafile");
-    bool smartcard = win->set().readBoolEntry("Smartcard/UseCard");
+    // the window is not created for the audit
+    Settings& set = Qpamat::instance()->set();
+    const QString& fileName = set.readEntry("General/Datafile");
+    bool smartcard = set.readBoolEntry("Smartcard/UseCard");
 
-    // load the XML structure
     QFile file(fileName);
     if (!file.open(QIODevice::ReadOnly))
         throw ReadWriteException(QObject::tr("The file %1 could not be opened:\n%2.").
             arg(fileName).arg(qApp->translate("QFile", file.errorString())),
             ReadWriteException::CIOError);
 
-    QDomDocument doc;
-    if (!doc.setContent(&file))
-        throw ReadWriteException(QObject::tr("The XML file (%1) may be corrupted "
-            "and\ncould not be read. Check the file with a text editor.").arg(fileName),
-            ReadWriteException::CInvalidData);
-
-    file.close();
-    QDomElement appData = doc.documentElement().namedItem("app-data").toElement();
-
-    if (appData.namedItem("smartcard").toElement().attribute("useCard").toInt() && !smartcard)
+    QScopedPointer<DataReader> reader;
+    BinaryDataReader* binaryReader = 0;
+    if (BinaryDataReader::isBinary(&file))
+        reader.reset(binaryReader = new BinaryDataReader(&file));
+    else
+        reader.reset(new XmlDataReader(&file));
+    AppData appData = reader->readAppData();
+
+    // reading the card needs dialogs
+    if (appData.useCard && QApplication::type() == QApplication::Tty)
+        throw ReadWriteException(QObject::tr("The passwords of the data file %1 are stored on "
+            "a smartcard. They can only be read with the graphical user interface.")
+            .arg(fileName), ReadWriteException::CConfigurationError);
+
+    if (appData.useCard && !smartcard)
         throw ReadWriteException(QObject::tr("<qt><nobr>The passwords of the current data file"
             " are stored</nobr> on a smartcard but you did not configure QPaMaT for reading "
             "smartcards.<p>Change the settings and try again!</qt>"),
             ReadWriteException::CConfigurationError);
 
-    smartcard = appData.namedItem("smartcard").toElement().attribute("useCard").toInt();
+    smartcard = appData.useCard;
+
+    // also checks the password
+    ByteVector key;
+    QScopedPointer<StringEncryptor> enc;
+    QScopedPointer<SymmetricEncryptor> realEncryptor;
+    if (smartcard) {
+        realEncryptor.reset(createEncryptor(appData, password, key));
+        enc.reset(new CollectEncryptor(*realEncryptor));
+    } else
+        enc.reset(createEncryptor(appData, password, key));
+
+    // read the data from the smartcard
+    if (smartcard) {
+        ByteVector vec;
+        unsigned char id = (unsigned char)appData.cardId;
+
+        // also throws exception
+        writeOrReadSmartcard(vec, false, id, password, key);
+        dynamic_cast<CollectEncryptor*>(enc.data())->swapBytes(vec);
+    }
+
+    // the password has been checked now, so a wrong tag means that the file was modified
+    if (binaryReader)
+        binaryReader->authenticate(key);
 
-    // check the password
-    if (!smartcard) {
-        const QString hash = appData.namedItem("passwordhash").toElement().text();
-        if (hash == "SMARTCARD" || !PasswordHash::isCorrect(password, hash))
-            throw ReadWriteException(QObject::tr("The password is incorrect."),
-                ReadWriteException::CWrongPassword);
+    if (smartcard)
+        reader->readPasswords(handler, enc.data());
+    else if (cache) {
+        // the passwords are decrypted when they are needed
+        cache->setEncryptor(enc.take());
+        reader->readPasswords(handler, 0);
+    } else {
+        // decrypt on all processors, the reader passes the encrypted passwords
+        ParallelCryptHandler decryptor(handler, static_cast<SymmetricEncryptor&>(*enc),
+            ParallelCryptHandler::Decrypt);
+        reader->readPasswords(decryptor, 0);
+        try {
+            decryptor.flush();
+        } catch (const std::invalid_argument& e) {
+            qDebug() << CURRENT_FUNCTION << "Decryption failed:" << e.what();
+            throw ReadWriteException(QObject::tr("The data file (%1) may be corrupted.\n"
+                "A password could not be decrypted.").arg(fileName),
+                ReadWriteException::CInvalidData);
+        }
     }
 
-    QString algorithm = appData.namedItem("crypt-algorithm").toElement().text();
-    QScopedPointer<StringEncryptor> enc;
-    QScopedPointer<Encryptor> realEncryptor;
+    if (keys)
+        storeKey(appData, password, key, *keys);
+}
+
+
+/**
+ * @brief Opens the data file for read-only access and builds the tree from its index.
+ *
+ * This only works for files in the binary format that don't use a smartcard. For other
+ * files, 0 is returned and the file must be read with readXML().
+ *
+ * @param password the decryption password
+ * @param builder the builder for the tree, the entries get the returned object as
+ *        PropertyLoader
+ * @return the file which must be deleted after the tree has been cleared or 0
+ * @exception ReadWriteException several reasons
+ *               - cannot open or read the file
+ *               - invalid or modified file
+ *               - wrong password
+ *               - algorithm does not exist in this OpenSSL configuration
+ */
+ReadOnlyDataFile* DataReadWriter::openReadOnly(const QString& password, TreeBuilder& builder)
+    throw (ReadWriteException)
+{
+    qDebug() << CURRENT_FUNCTION;
+
+    QpamatWindow *win = Qpamat::instance()->getWindow();
+    const QString& fileName = win->set().readEntry("General/Datafile");
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly) || !BinaryDataReader::isBinary(&file))
+        return 0;
+    file.close();
+
+    QScopedPointer<ReadOnlyDataFile> dataFile(new ReadOnlyDataFile(fileName));
+    AppData appData = dataFile->readAppData();
+    if (appData.useCard)
+        return 0;
+
+    ByteVector key;
+    SymmetricEncryptor* encryptor = createEncryptor(appData, password, key);
+    dataFile->readIndex(builder, encryptor, key);
+    return dataFile.take();
+}
+
+
+/**
+ * @brief Checks the password and creates the encryptor for the passwords of a data file.
+ *
+ * The key is derived with the KeyDerivation of @p appData. Files of older versions
+ * don't have one, the key is derived like before for them. The password is not checked
+ * if the hash is stored on the smartcard.
+ *
+ * @param appData the application data of the file
+ * @param password the password of the user
+ * @param key receives the derived key, it stays empty if the file has no key derivation
+ * @return the new encryptor, the caller has to delete it
+ * @exception ReadWriteException if the password is wrong or an algorithm is not available
+ */
+SymmetricEncryptor* DataReadWriter::createEncryptor(const AppData&    appData,
+                                                    const QString&    password,
+                                                    ByteVector&       key)
+    throw (ReadWriteException)
+{
+    const QString& hash = appData.passwordHash;
+    bool correct;
+    QScopedPointer<SymmetricEncryptor> encryptor;
+
     try {
-        if (smartcard) {
-            realEncryptor.reset(new SymmetricEncryptor(algorithm, password));
-            enc.reset(new CollectEncryptor(*realEncryptor));
-        } else
-            enc.reset(new SymmetricEncryptor(algorithm, password));
+        if (appData.kdfAlgorithm.isEmpty()) {
+            correct = appData.useCard
+                || (hash != "SMARTCARD" && PasswordHash::isCorrect(password, hash));
+            if (correct)
+                encryptor.reset(new SymmetricEncryptor(appData.cryptAlgorithm, password));
+        } else {
+            const KeyDerivation kdf(appData.kdfAlgorithm, appData.kdfIterations,
+                appData.kdfSalt);
+            ByteVector derived = kdf.deriveKey(password);
+            key.swap(derived);
+            correct = appData.useCard || PasswordHash::isCorrectKey(key, hash);
+            if (correct)
+                encryptor.reset(new SymmetricEncryptor(appData.cryptAlgorithm, key));
+        }
     } catch (const NoSuchAlgorithmException& ex) {
-        UNUSED(ex);
+        qDebug() << CURRENT_FUNCTION << ex.what();
+        const QString algorithm = appData.kdfAlgorithm.isEmpty()
+            ? appData.cryptAlgorithm
+            : appData.cryptAlgorithm + ", " + appData.kdfAlgorithm;
         throw ReadWriteException(QObject::tr("The algorithm '%1' is not avaible on "
                 "your system.\nIt is impossible to read the file. Try to recompile or\n"
                 "update your OpenSSL library.").arg(algorithm), ReadWriteException::CNoAlgorithm);
     }
 
-    // read the data from the smartcard
-    if (smartcard) {
-        ByteVector vec;
-        unsigned char id = (unsigned char)(appData.namedItem("smartcard").toElement().attribute("card-id").toShort());
+    if (!correct)
+        throw ReadWriteException(QObject::tr("The password is incorrect."),
+            ReadWriteException::CWrongPassword);
 
-        // also throws exception
-        writeOrReadSmartcard(vec, false, id, password);
-        dynamic_cast<CollectEncryptor*>(enc.data())->setBytes(vec);
+    return encryptor.take();
+}
+
+
+/**
+ * @brief Stores the key for saving the file that has just been read.
+ *
+ * The key of the file is used as long as it has the number of iterations that
+ * keyDerivationIterations() returns. Files of older versions without key derivation
+ * and files with other iterations get a new key, so a changed unlock time takes effect
+ * at the next login. That key is only used when the file is saved.
+ *
+ * @param appData the application data of the file
+ * @param password the password of the user, it has been checked
+ * @param key the key of the file that createEncryptor() has derived, may be empty
+ * @param keys receives the key
+ * @exception ReadWriteException if no new key could be derived
+ */
+void DataReadWriter::storeKey(const AppData&     appData,
+                              const QString&     password,
+                              const ByteSpan&    key,
+                              SessionKeyStore&   keys)
+    throw (ReadWriteException)
+{
+    if (!key.isEmpty() && appData.kdfIterations == keyDerivationIterations()) {
+        try {
+            keys.setKey(KeyDerivation(appData.kdfAlgorithm, appData.kdfIterations,
+                appData.kdfSalt), key);
+            return;
+        } catch (const NoSuchAlgorithmException& e) {
+            // the key could be derived, so this cannot happen
+            qDebug() << CURRENT_FUNCTION << e.what();
+        }
     }
 
-    QDomElement pwData = doc.documentElement().namedItem("passwords").toElement();
-    crypt(pwData, *enc, false);
+    createKey(password, keys);
+}
+
 
-    return doc;
+/**
+ * @brief Derives a new key from @p password and stores it in @p keys.
+ *
+ * This is used for new files and when the password is changed. It takes the time that
+ * is configured in <tt>Security/UnlockTime</tt>.
+ *
+ * @param password the password of the user
+ * @param keys receives the key, it's unchanged if an exception is thrown
+ * @exception ReadWriteException if the key derivation is not available
+ */
+void DataReadWriter::createKey(const QString& password, SessionKeyStore& keys)
+    throw (ReadWriteException)
+{
+    try {
+        keys.deriveKey(password, keyDerivationIterations());
+    } catch (const NoSuchAlgorithmException& e) {
+        qDebug() << CURRENT_FUNCTION << e.what();
+        throw ReadWriteException(QObject::tr("The algorithm '%1' is not avaible on "
+            "your system.").arg(KeyDerivation::PBKDF2_SHA256), ReadWriteException::CNoAlgorithm);
+    } catch (const std::runtime_error& e) {
+        throw ReadWriteException(QObject::tr("No key could be derived from the password:\n%1")
+            .arg(e.what()), ReadWriteException::COtherError);
+    }
+}
+
+
+/**
+ * @brief Returns the number of iterations for new keys.
+ *
+ * The number is calibrated once for <tt>Security/UnlockTime</tt> and stored in
+ * <tt>Security/KdfIterations</tt>. Setting that to 0 calibrates again.
+ *
+ * @return the number of iterations
+ */
+int DataReadWriter::keyDerivationIterations()
+{
+    Settings& set = Qpamat::instance()->set();
+    int iterations = set.readNumEntry("Security/KdfIterations");
+    if (iterations <= 0) {
+        iterations = KeyDerivation::calibrate(set.readNumEntry("Security/UnlockTime"));
+        set.writeEntry("Security/KdfIterations", iterations);
+    }
+    return iterations;
 }
 
 
@@ -649,11 +1011,14 @@ QDomDocument DataReadWriter::readXML(const QString& password)
  * @param bytes the bytes
  * @param write reading or writing
  * @param randomNumber the random number
+ * @param password the password, only needed to read files without key derivation
+ * @param key the derived key
  */
 void DataReadWriter::writeOrReadSmartcard(ByteVector        &bytes,
                                           bool              write,
                                           unsigned char     &randomNumber,
-                                          const QString     &password)
+                                          const QString     &password,
+                                          const ByteSpan    &key)
     throw (ReadWriteException)
 {
     QApplication::setOverrideCursor( QCursor(Qt::WaitCursor) );
@@ -700,7 +1065,7 @@ void DataReadWriter::writeOrReadSmartcard(ByteVector        &bytes,
     QApplication::setOverrideCursor( QCursor(Qt::WaitCursor) );
 
     // start the thread
-    ReadWriteThread thread(*card, bytes, write, randomNumber, password, pin);
+    ReadWriteThread thread(*card, bytes, write, randomNumber, password, key, pin);
     thread.start();
 
     // show dialog
@@ -733,27 +1098,4 @@ void DataReadWriter::writeOrReadSmartcard(ByteVector        &bytes,
     }
 }
 
-
-void DataReadWriter::crypt(QDomElement& n, StringEncryptor& enc, bool encrypt)
-{
-    QDomNodeList list = n.childNodes();
-    if (list.length() != 0) {
-        for (unsigned int i = 0; i < list.length(); ++i) {
-            QDomElement n = list.item(i).toElement();
-            crypt(n, enc, encrypt);
-        }
-    } else {
-        QDomElement el = n.toElement();
-        if (!el.isNull()) {
-            if (el.tagName() == "property" && el.attribute("type") == "PASSWORD"
-                    && el.hasAttribute("value")) {
-                if (encrypt)
-                    el.setAttribute("value", enc.encryptStrToStr(el.attribute("value")));
-                else
-                    el.setAttribute("value", enc.decryptStrFromStr(el.attribute("value")));
-            }
-        }
-    }
-}
-
 // vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
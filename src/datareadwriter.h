@@ -20,11 +20,18 @@
 #include <QObject>
 #include <QString>
 #include <QWidget>
-#include <QDomDocument>
 
 #include "global.h"
+#include "datahandler.h"
 #include "security/encryptor.h"
 
+class Tree;
+class TreeBuilder;
+class SymmetricEncryptor;
+class ReadOnlyDataFile;
+class PasswordCache;
+class SessionKeyStore;
+
 class ReadWriteException : public std::runtime_error
 {
     public:
@@ -79,21 +86,40 @@ class DataReadWriter
         DataReadWriter(QWidget* parent);
 
     public:
-        void writeXML(const QDomDocument& document, const QString& password)
+        void writeXML(const Tree& tree, const SessionKeyStore& keys,
+                      const PasswordCache* cache = 0)
             throw (ReadWriteException);
 
-        QDomDocument readXML(const QString& password)
+        void readXML(const QString& password, DataHandler& handler, PasswordCache* cache = 0,
+                     SessionKeyStore* keys = 0)
             throw (ReadWriteException);
 
-        QDomDocument createSkeletonDocument() throw ();
+        ReadOnlyDataFile* openReadOnly(const QString& password, TreeBuilder& builder)
+            throw (ReadWriteException);
+
+        static void createKey(const QString& password, SessionKeyStore& keys)
+            throw (ReadWriteException);
 
     private:
-        void writeOrReadSmartcard(ByteVector    &bytes,
-                                  bool          write,
-                                  unsigned char &randomNumber,
-                                  const QString &password)
+        static SymmetricEncryptor* createEncryptor(const AppData&    appData,
+                                                   const QString&    password,
+                                                   ByteVector&       key)
+        throw (ReadWriteException);
+
+        static void storeKey(const AppData&     appData,
+                             const QString&     password,
+                             const ByteSpan&    key,
+                             SessionKeyStore&   keys)
+        throw (ReadWriteException);
+
+        static int keyDerivationIterations();
+
+        void writeOrReadSmartcard(ByteVector        &bytes,
+                                  bool              write,
+                                  unsigned char     &randomNumber,
+                                  const QString     &password,
+                                  const ByteSpan    &key)
         throw (ReadWriteException);
-        void crypt(QDomElement& n, StringEncryptor& enc, bool encrypt);
 
     private:
         QWidget* m_parent;
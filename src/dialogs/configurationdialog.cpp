@@ -199,6 +199,7 @@ void ConfDlgGeneralTab::createAndLayout()
     QVBoxLayout* mainLayout = new QVBoxLayout(this, 0, 6);
     Q3GroupBox* startupGroup = new Q3GroupBox(1, Qt::Vertical, tr("Startup"), this);
     Q3GroupBox* locationsGroup = new Q3GroupBox(4, Qt::Vertical, tr("Locations"), this);
+    Q3GroupBox* savingGroup = new Q3GroupBox(1, Qt::Horizontal, tr("Saving"), this);
     Q3GroupBox* autoTextGroup = new Q3GroupBox(4, Qt::Vertical, tr("AutoText"), this);
 
     // auto login
@@ -207,6 +208,23 @@ void ConfDlgGeneralTab::createAndLayout()
     QLabel* datafileLabel = new QLabel(tr("&Data File:"), locationsGroup);
     m_datafileEdit = new FileLineEdit(locationsGroup, true);
 
+    // saving
+    m_atomicSaveCheckbox = new QCheckBox(tr("&Replace the data file only after writing "
+        "was successful"), savingGroup);
+    Q3HBox* backupBox = new Q3HBox(savingGroup, "BackupBox");
+    backupBox->setSpacing(6);
+    QLabel* backupLabel = new QLabel(tr("Number of &backups:"), backupBox);
+    m_backupSpinner = new QSpinBox(0, 10, 1, backupBox, "BackupSpinner");
+    backupBox->setStretchFactor(backupLabel, 5);
+    connect(m_atomicSaveCheckbox, SIGNAL(toggled(bool)), backupBox, SLOT(setEnabled(bool)));
+    Q3HBox* formatBox = new Q3HBox(savingGroup, "FormatBox");
+    formatBox->setSpacing(6);
+    QLabel* formatLabel = new QLabel(tr("File &format:"), formatBox);
+    m_formatCombo = new QComboBox(false, formatBox, "FormatCombo");
+    m_formatCombo->insertItem(tr("XML"));
+    m_formatCombo->insertItem(tr("Binary"));
+    formatBox->setStretchFactor(formatLabel, 5);
+
     // auto text
     QLabel* miscLabel = new QLabel(tr("&Misc"), autoTextGroup);
     m_miscEdit = new QLineEdit(autoTextGroup);
@@ -219,6 +237,8 @@ void ConfDlgGeneralTab::createAndLayout()
 
     // set buddys
     datafileLabel->setBuddy(m_datafileEdit);
+    backupLabel->setBuddy(m_backupSpinner);
+    formatLabel->setBuddy(m_formatCombo);
     miscLabel->setBuddy(m_miscEdit);
     usernameLabel->setBuddy(m_usernameEdit);
     passwordLabel->setBuddy(m_passwordEdit);
@@ -226,6 +246,7 @@ void ConfDlgGeneralTab::createAndLayout()
 
     mainLayout->addWidget(startupGroup);
     mainLayout->addWidget(locationsGroup);
+    mainLayout->addWidget(savingGroup);
     mainLayout->addWidget(autoTextGroup);
     mainLayout->addStretch(5);
 
@@ -246,6 +267,10 @@ void ConfDlgGeneralTab::fillSettings()
 
     m_autoLoginCheckbox->setChecked(win->set().readBoolEntry("General/AutoLogin"));
     m_datafileEdit->setContent(win->set().readEntry("General/Datafile"));
+    m_atomicSaveCheckbox->setChecked(win->set().readBoolEntry("General/AtomicSave"));
+    m_backupSpinner->setValue(win->set().readNumEntry("General/Backups"));
+    m_backupSpinner->parentWidget()->setEnabled(m_atomicSaveCheckbox->isChecked());
+    m_formatCombo->setCurrentItem(win->set().readEntry("General/FileFormat") == "Binary" ? 1 : 0);
     m_miscEdit->setText(win->set().readEntry("AutoText/Misc"));
     m_usernameEdit->setText(win->set().readEntry("AutoText/Username"));
     m_passwordEdit->setText(win->set().readEntry("AutoText/Password"));
@@ -264,6 +289,10 @@ void ConfDlgGeneralTab::applySettings()
 
     win->set().writeEntry("General/AutoLogin", m_autoLoginCheckbox->isChecked() );
     win->set().writeEntry("General/Datafile", m_datafileEdit->getContent() );
+    win->set().writeEntry("General/AtomicSave", m_atomicSaveCheckbox->isChecked() );
+    win->set().writeEntry("General/Backups", m_backupSpinner->value() );
+    win->set().writeEntry("General/FileFormat",
+        m_formatCombo->currentItem() == 1 ? QString("Binary") : QString("XML"));
     win->set().writeEntry("AutoText/Misc", m_miscEdit->text() );
     win->set().writeEntry("AutoText/Username", m_usernameEdit->text() );
     win->set().writeEntry("AutoText/Password", m_passwordEdit->text() );
@@ -305,6 +334,7 @@ ConfDlgPasswordTab::ConfDlgPasswordTab(QWidget* parent, const char* name)
     , m_strongSlider(0)
     , m_weakLabel(0)
     , m_strongLabel(0)
+    , m_checkerCombo(0)
     , m_sortButton(0)
 {
     createAndLayout();
@@ -324,7 +354,7 @@ void ConfDlgPasswordTab::createAndLayout()
     // create layouts
     QVBoxLayout* mainLayout = new QVBoxLayout(this, 0, 6);
     Q3GroupBox* passwordGroup = new Q3GroupBox(5, Qt::Vertical, tr("Generated Passwords"), this);
-    Q3GroupBox* checkerGroup = new Q3GroupBox(6, Qt::Vertical, tr("Password checker"), this);
+    Q3GroupBox* checkerGroup = new Q3GroupBox(7, Qt::Vertical, tr("Password checker"), this);
 
     QWidget* ensureGrid = new QWidget(passwordGroup, "EnsureGrid");
     QGridLayout* ensureGridLayout = new QGridLayout(ensureGrid, 2, 3, 0, 6, "EnsureGridLayout");
@@ -348,6 +378,14 @@ void ConfDlgPasswordTab::createAndLayout()
     m_externalEdit = new FileLineEdit(passwordGroup, "ExternalEdit");
 
     // checker stuff
+    Q3HBox* checkerBox = new Q3HBox(checkerGroup, "CheckerBox");
+    checkerBox->setSpacing(6);
+    QLabel* checkerLabel = new QLabel(tr("&Estimation:"), checkerBox);
+    m_checkerCombo = new QComboBox(false, checkerBox, "CheckerCombo");
+    m_checkerCombo->insertItem(tr("Dictionary and brute force"));
+    m_checkerCombo->insertItem(tr("Patterns (l33t, keyboard walks, dates, repeats)"));
+    checkerBox->setStretchFactor(checkerLabel, 5);
+
     new QLabel(tr("Limits for weak - acceptable - strong (cracking days):"), checkerGroup, "WeakLabel");
     Q3HBox* weakSliderBox = new Q3HBox(checkerGroup, "WeakSliderBox");
     weakSliderBox->setSpacing(4);
@@ -379,6 +417,7 @@ void ConfDlgPasswordTab::createAndLayout()
     lengthLabel->setBuddy(m_lengthSpinner);
     allowedLabel->setBuddy(m_allowedCharsEdit);
     dictLabel->setBuddy(m_dictionaryEdit);
+    checkerLabel->setBuddy(m_checkerCombo);
 
     mainLayout->addWidget(passwordGroup);
     mainLayout->addWidget(checkerGroup);
@@ -388,6 +427,10 @@ void ConfDlgPasswordTab::createAndLayout()
     Q3WhatsThis::add(m_sortButton, tr("<qt>For performance reasons, the dictionary file needs "
         "to be sorted by the length of the words. This function does that!<p>It saves also a "
         "copy of the old file by <i>filename.old</i>.</qt>"));
+    Q3WhatsThis::add(m_checkerCombo, tr("<qt>The <i>dictionary and brute force</i> estimation "
+        "only looks for the longest word of the dictionary in the password. The <i>pattern</i> "
+        "estimation also knows substitutions like <tt>P4ssw0rd</tt>, keyboard walks like "
+        "<tt>qwertz</tt>, dates and repeated characters.</qt>"));
 }
 
 
@@ -420,6 +463,8 @@ void ConfDlgPasswordTab::fillSettings()
     m_useExternalCB->setChecked(win->set().readEntry("Security/PasswordGenerator") =="EXTERNAL");
     m_externalEdit->setContent(win->set().readEntry("Security/PasswordGenAdditional"));
     m_dictionaryEdit->setContent(win->set().readEntry("Security/DictionaryFile"));
+    m_checkerCombo->setCurrentItem(win->set().readEntry("Security/PasswordChecker") == "PATTERN"
+        ? 1 : 0);
 
     checkboxHandler(m_useExternalCB->isChecked());
     weakSliderHandler(m_weakSlider->value());
@@ -443,6 +488,8 @@ void ConfDlgPasswordTab::applySettings()
     win->set().writeEntry("Security/Length", m_lengthSpinner->value());
     win->set().writeEntry("Security/AllowedCharacters", m_allowedCharsEdit->text());
     win->set().writeEntry("Security/DictionaryFile", m_dictionaryEdit->getContent());
+    win->set().writeEntry("Security/PasswordChecker",
+        m_checkerCombo->currentItem() == 1 ? QString("PATTERN") : QString("HYBRID"));
 }
 
 
@@ -540,7 +587,9 @@ void ConfDlgPasswordTab::sortDictionary()
  * This tab holds security general settings
  *
  *   - cipher algorithm
+ *   - time for deriving the key from the password
  *   - automatic logout
+ *   - decryption of the passwords on demand
  *
  * @ingroup gui
  * @author Bernhard Walle
@@ -578,23 +627,48 @@ void ConfDlgSecurityTab::createAndLayout()
 {
     // create layouts
     QVBoxLayout* mainLayout = new QVBoxLayout(this, 0, 6);
-    Q3GroupBox* encryptionGroup = new Q3GroupBox(1, Qt::Vertical, tr("Encryption"), this);
+    Q3GroupBox* encryptionGroup = new Q3GroupBox(2, Qt::Horizontal, tr("Encryption"), this);
     Q3GroupBox* logoutGroup = new Q3GroupBox(1, Qt::Vertical, tr("Logout"), this);
+    Q3GroupBox* memoryGroup = new Q3GroupBox(1, Qt::Horizontal, tr("Memory"), this);
 
     // algorithm stuff
     m_algorithmLabel = new QLabel(tr("Cipher &algorithm:"), encryptionGroup);
     m_algorithmCombo = new QComboBox(false, encryptionGroup);
+    m_unlockTimeLabel = new QLabel(tr("&Unlock time (milliseconds):"), encryptionGroup);
+    m_unlockTimeSpinner = new QSpinBox(100, 10000, 100, encryptionGroup, "UnlockTimeSpinner");
 
     // logout
     m_logoutLabel = new QLabel(tr("Auto &logout after inactivity:"), logoutGroup);
     m_logoutCombo = new QComboBox(false, logoutGroup);
 
+    // memory
+    m_lazyDecryptionCheckbox = new QCheckBox(tr("&Decrypt passwords only when they are "
+        "needed"), memoryGroup);
+    Q3HBox* cacheBox = new Q3HBox(memoryGroup, "CacheBox");
+    cacheBox->setSpacing(6);
+    QLabel* cacheSizeLabel = new QLabel(tr("Decrypted passwords &kept:"), cacheBox);
+    m_cacheSizeSpinner = new QSpinBox(1, 1000, 1, cacheBox, "CacheSizeSpinner");
+    cacheBox->setStretchFactor(cacheSizeLabel, 5);
+    Q3HBox* expiryBox = new Q3HBox(memoryGroup, "ExpiryBox");
+    expiryBox->setSpacing(6);
+    QLabel* cacheExpiryLabel = new QLabel(tr("&Forget unused passwords after (seconds):"),
+        expiryBox);
+    m_cacheExpirySpinner = new QSpinBox(0, 3600, 10, expiryBox, "CacheExpirySpinner");
+    m_cacheExpirySpinner->setSpecialValueText(tr("Never"));
+    expiryBox->setStretchFactor(cacheExpiryLabel, 5);
+    connect(m_lazyDecryptionCheckbox, SIGNAL(toggled(bool)), cacheBox, SLOT(setEnabled(bool)));
+    connect(m_lazyDecryptionCheckbox, SIGNAL(toggled(bool)), expiryBox, SLOT(setEnabled(bool)));
+
     // buddys
     m_algorithmLabel->setBuddy(m_algorithmCombo);
+    m_unlockTimeLabel->setBuddy(m_unlockTimeSpinner);
     m_logoutLabel->setBuddy(m_logoutCombo);
+    cacheSizeLabel->setBuddy(m_cacheSizeSpinner);
+    cacheExpiryLabel->setBuddy(m_cacheExpirySpinner);
 
     mainLayout->addWidget(encryptionGroup);
     mainLayout->addWidget(logoutGroup);
+    mainLayout->addWidget(memoryGroup);
     mainLayout->addStretch(5);
 }
 
@@ -611,6 +685,7 @@ void ConfDlgSecurityTab::fillSettings()
 
     m_algorithmCombo->insertStringList(SymmetricEncryptor::getAlgorithms());
     m_algorithmCombo->setCurrentText( win->set().readEntry( "Security/CipherAlgorithm" ));
+    m_unlockTimeSpinner->setValue(win->set().readNumEntry("Security/UnlockTime"));
 
     // Combo box
     m_logoutCombo->insertItem(tr("Disabled"));
@@ -627,6 +702,12 @@ void ConfDlgSecurityTab::fillSettings()
         logout
     );
     m_logoutCombo->setCurrentItem(val - ConfDlgSecurityTab::m_minuteMap);
+
+    m_lazyDecryptionCheckbox->setChecked(win->set().readBoolEntry("Security/LazyDecryption"));
+    m_cacheSizeSpinner->setValue(win->set().readNumEntry("Security/PlaintextCacheSize"));
+    m_cacheExpirySpinner->setValue(win->set().readNumEntry("Security/PlaintextCacheExpiry"));
+    m_cacheSizeSpinner->parentWidget()->setEnabled(m_lazyDecryptionCheckbox->isChecked());
+    m_cacheExpirySpinner->parentWidget()->setEnabled(m_lazyDecryptionCheckbox->isChecked());
 }
 
 /**
@@ -639,7 +720,15 @@ void ConfDlgSecurityTab::applySettings()
     QpamatWindow *win = Qpamat::instance()->getWindow();
     int min = ConfDlgSecurityTab::m_minuteMap[m_algorithmCombo->currentItem()];
     win->set().writeEntry("Security/CipherAlgorithm", m_algorithmCombo->currentText() );
+    if (m_unlockTimeSpinner->value() != win->set().readNumEntry("Security/UnlockTime")) {
+        // calibrate again at the next save
+        win->set().writeEntry("Security/UnlockTime", m_unlockTimeSpinner->value());
+        win->set().writeEntry("Security/KdfIterations", 0);
+    }
     win->set().writeEntry("Security/AutoLogout", min);
+    win->set().writeEntry("Security/LazyDecryption", m_lazyDecryptionCheckbox->isChecked());
+    win->set().writeEntry("Security/PlaintextCacheSize", m_cacheSizeSpinner->value());
+    win->set().writeEntry("Security/PlaintextCacheExpiry", m_cacheExpirySpinner->value());
 }
 
 
@@ -50,6 +50,9 @@ class ConfDlgGeneralTab : public ListBoxDialogPage
     private:
         QCheckBox*      m_autoLoginCheckbox;
         FileLineEdit*   m_datafileEdit;
+        QCheckBox*      m_atomicSaveCheckbox;
+        QSpinBox*       m_backupSpinner;
+        QComboBox*      m_formatCombo;
         QLineEdit*      m_miscEdit;
         QLineEdit*      m_usernameEdit;
         QLineEdit*      m_passwordEdit;
@@ -93,6 +96,7 @@ class ConfDlgPasswordTab : public ListBoxDialogPage
         QSlider*        m_strongSlider;
         QLCDNumber*     m_weakLabel;
         QLCDNumber*     m_strongLabel;
+        QComboBox*      m_checkerCombo;
         FileLineEdit*   m_dictionaryEdit;
         QPushButton*    m_sortButton;
 };
@@ -122,9 +126,15 @@ class ConfDlgSecurityTab : public ListBoxDialogPage
         // algorithm
         QComboBox*      m_algorithmCombo;
         QLabel*         m_algorithmLabel;
+        QSpinBox*       m_unlockTimeSpinner;
+        QLabel*         m_unlockTimeLabel;
         // logout
         QComboBox*      m_logoutCombo;
         QLabel*         m_logoutLabel;
+        // memory
+        QCheckBox*      m_lazyDecryptionCheckbox;
+        QSpinBox*       m_cacheSizeSpinner;
+        QSpinBox*       m_cacheExpirySpinner;
 };
 
 
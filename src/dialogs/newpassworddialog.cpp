@@ -18,6 +18,8 @@
 #include <Q3HBox>
 #include <QLabel>
 #include <QMessageBox>
+#include <QApplication>
+#include <QCursor>
 #include <QPushButton>
 #include <QDialogButtonBox>
 #include <QVBoxLayout>
@@ -28,6 +30,7 @@
 #include "newpassworddialog.h"
 #include "qpamatwindow.h"
 #include "security/masterpasswordchecker.h"
+#include "security/sessionkeystore.h"
 #include "settings.h"
 #include "qpamat.h"
 
@@ -37,8 +40,8 @@
  * @brief Password to enter a new password for new files.
  *
  * This dialog was made to enter a new password or to change the existing
- * password. The mode depends on the argument \p oldPassword of the
- * constructor. If it is QString::null, a new password can be made.
+ * password. The mode depends on the argument \p keys of the
+ * constructor. If it is 0, a new password can be made.
  *
  * This class uses not the dictionary-based checker but the
  * MasterPasswordChecker. This is because maybe the user has not setup a
@@ -54,12 +57,13 @@
  * @brief Creates a new instance of a NewPasswordDialog.
  *
  * @param parent      the parent widget
- * @param oldPassword the old password (the user has to enter it and it must be right)
- *                    or QString::null if a new password should be entered.
+ * @param keys        the key of the current session (the user has to enter the old
+ *                    password and it must be right) or 0 if a new password should be
+ *                    entered.
  */
-NewPasswordDialog::NewPasswordDialog(QWidget* parent, const QString& oldPassword)
+NewPasswordDialog::NewPasswordDialog(QWidget* parent, const SessionKeyStore* keys)
     : QDialog(parent)
-    , m_oldPassword(oldPassword)
+    , m_keys(keys)
 {
     setCaption("QPaMaT");
 
@@ -78,7 +82,7 @@ NewPasswordDialog::NewPasswordDialog(QWidget* parent, const QString& oldPassword
 
     QpamatWindow *win = Qpamat::instance()->getWindow();
     if (!win->set().readBoolEntry("Password/NoGrabbing")) {
-        if (!m_oldPassword.isNull()) {
+        if (m_keys) {
             connect(m_oldPasswordEdit, SIGNAL(gotFocus()), SLOT(grabOldPassword()));
             connect(m_oldPasswordEdit, SIGNAL(lostFocus()), SLOT(release()));
         }
@@ -96,7 +100,7 @@ NewPasswordDialog::NewPasswordDialog(QWidget* parent, const QString& oldPassword
 void NewPasswordDialog::createAndLayout()
 {
     // text fields
-    if (!m_oldPassword.isNull()) {
+    if (m_keys) {
         m_oldPasswordEdit = new FocusLineEdit(this);
         m_oldPasswordEdit->setEchoMode(QLineEdit::Password);
         m_oldPasswordEdit->setMinimumWidth(250);
@@ -119,9 +123,9 @@ void NewPasswordDialog::createAndLayout()
         "words are good!");
 
     // labels
-    QLabel* label = new QLabel((m_oldPassword.isNull() ? newText : changeText), this);
+    QLabel* label = new QLabel((!m_keys ? newText : changeText), this);
     QLabel* old = 0;
-    if (!m_oldPassword.isNull()) {
+    if (m_keys) {
         old = new QLabel(tr("&Old password:"), this);
         old->setBuddy(m_oldPasswordEdit);
     }
@@ -143,11 +147,11 @@ void NewPasswordDialog::createAndLayout()
 
     // create layouts
     QVBoxLayout* layout = new QVBoxLayout(this);
-    QGridLayout* textfields = new QGridLayout(0);//, 2, (m_oldPassword.isNull() ? 2 : 3), 0, 6);
+    QGridLayout* textfields = new QGridLayout(0);//, 2, (!m_keys ? 2 : 3), 0, 6);
 
 
     int i = 0;
-    if (!m_oldPassword.isNull()) {
+    if (m_keys) {
         textfields->addWidget(old, 0, 0);
         textfields->addWidget(m_oldPasswordEdit, 0, 1);
         ++i;
@@ -180,7 +184,11 @@ void NewPasswordDialog::accept()
         return;
     }
 
-    if (!m_oldPassword.isNull() && m_oldPassword != m_oldPasswordEdit->text()) {
+    qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
+    const bool oldCorrect = !m_keys || m_keys->isCorrectPassword(m_oldPasswordEdit->text());
+    qApp->restoreOverrideCursor();
+
+    if (!oldCorrect) {
         QMessageBox::warning(this, "QPaMaT",
                "<qt>"+tr("The old password was incorrect. Without the old password, "
                "the password cannot be changed.")+"</qt>",
@@ -20,12 +20,14 @@
 
 #include "widgets/focuslineedit.h"
 
+class SessionKeyStore;
+
 class NewPasswordDialog : public QDialog
 {
     Q_OBJECT
 
     public:
-        NewPasswordDialog(QWidget* parent, const QString& oldPassword = QString::null);
+        NewPasswordDialog(QWidget* parent, const SessionKeyStore* keys = 0);
         QString getPassword() const;
 
     protected slots:
@@ -42,12 +44,12 @@ class NewPasswordDialog : public QDialog
         void createAndLayout();
 
     private:
-        QString         m_oldPassword;
-        QPushButton*    m_okButton;
-        QPushButton*    m_cancelButton;
-        FocusLineEdit*  m_firstPasswordEdit;
-        FocusLineEdit*  m_secondPasswordEdit;
-        FocusLineEdit*  m_oldPasswordEdit;
+        const SessionKeyStore*  m_keys;
+        QPushButton*            m_okButton;
+        QPushButton*            m_cancelButton;
+        FocusLineEdit*          m_firstPasswordEdit;
+        FocusLineEdit*          m_secondPasswordEdit;
+        FocusLineEdit*          m_oldPasswordEdit;
 };
 
 #endif // NEWPASSWORDDIALOG_H
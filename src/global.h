@@ -19,6 +19,8 @@
 #include <QMap>
 #include <QString>
 
+#include "util/bytevector.h"
+
 /**
  * @file global.h
  * @ingroup gui
@@ -29,13 +31,6 @@
  */
 
 
-/**
- * @typedef QValueVector<unsigned char> ByteVector
- *
- * This is a unsigned char vector.
- */
-typedef Q3ValueVector<unsigned char> ByteVector;
-
 /**
  * @typedef QValueVector<QString> StringVector
  *
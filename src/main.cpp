@@ -38,12 +38,16 @@
 
 int main(int argc, char** argv)
 {
-    TimeoutApplication app(argc, argv);
-
     Qpamat *qpamat = Qpamat::instance();
     qpamat->parseCommandLine(argc, argv);
+
+    // the audit must also work without a display
+    TimeoutApplication app(argc, argv, !qpamat->isAudit());
     qpamat->installTranslations();
 
+    if (qpamat->isAudit())
+        return qpamat->audit();
+
     SingleApplication::init(QDir::homeDirPath(), "QPaMaT");
 
     try {
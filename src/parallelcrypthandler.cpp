@@ -0,0 +1,177 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include "parallelcrypthandler.h"
+
+/**
+ * @class ParallelCryptHandler
+ *
+ * @brief A DataHandler that encrypts or decrypts the passwords in parallel before passing
+ *        them to another handler.
+ *
+ * Encrypting or decrypting the passwords one by one while the file is read or written
+ * uses only one processor. This handler collects the calls and the passwords. If enough
+ * passwords are collected, they are processed by a ParallelCryptor and the collected calls
+ * are passed to the target handler in their original order, with the PASSWORD values
+ * replaced by the result.
+ *
+ * So the memory consumption is bounded by the batch size and not by the size of the data.
+ * The caller must call flush() after the last call, otherwise the target handler
+ * doesn't get the rest of the data.
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @enum ParallelCryptHandler::Operation
+ *
+ * Whether the passwords should be encrypted or decrypted.
+ */
+
+/**
+ * @brief The default number of passwords that are processed together.
+ */
+const int ParallelCryptHandler::DEFAULT_BATCH_SIZE = 4096;
+
+/**
+ * @brief Creates a new ParallelCryptHandler.
+ *
+ * @param target the handler that gets the data
+ * @param encryptor the encryptor that is cloned for each thread, must stay valid as long
+ *        as this object exists
+ * @param operation whether to encrypt or to decrypt the passwords
+ * @param batchSize the number of passwords that are collected before they are processed
+ */
+ParallelCryptHandler::ParallelCryptHandler(DataHandler& target,
+                                           const SymmetricEncryptor& encryptor,
+                                           Operation operation, int batchSize)
+    : m_target(target)
+    , m_cryptor(encryptor)
+    , m_operation(operation)
+    , m_batchSize(batchSize)
+{}
+
+
+/**
+ * @brief Processes the collected passwords and passes all collected data to the target.
+ *
+ * @exception std::invalid_argument if a password could not be decrypted
+ */
+void ParallelCryptHandler::flush()
+    throw (std::invalid_argument)
+{
+    const QStringList result = m_operation == Encrypt
+        ? m_cryptor.encryptStrings(m_passwords)
+        : m_cryptor.decryptStrings(m_passwords);
+    m_passwords.clear();
+
+    QStringList::const_iterator password = result.begin();
+    for (QVector<Event>::const_iterator it = m_events.begin(); it != m_events.end(); ++it) {
+        switch (it->type) {
+            case StartCategory:
+                m_target.startCategory(it->name, it->first, it->second);
+                break;
+
+            case EndCategory:
+                m_target.endCategory();
+                break;
+
+            case StartEntry:
+                m_target.startEntry(it->name, it->first);
+                break;
+
+            case EndEntry:
+                m_target.endEntry();
+                break;
+
+            case AppendProperty:
+                m_target.appendProperty(it->name,
+                    it->propertyType == Property::PASSWORD ? *password++ : it->value,
+                    it->propertyType, it->first, it->second);
+                break;
+        }
+    }
+    m_events.clear();
+}
+
+
+/**
+ * @copydoc DataHandler::startCategory(const QString&, bool, bool)
+ */
+void ParallelCryptHandler::startCategory(const QString& name, bool wasOpen, bool isSelected)
+{
+    addEvent(StartCategory, name, QString::null, Property::MISC, wasOpen, isSelected);
+}
+
+
+/**
+ * @copydoc DataHandler::endCategory()
+ */
+void ParallelCryptHandler::endCategory()
+{
+    addEvent(EndCategory);
+}
+
+
+/**
+ * @copydoc DataHandler::startEntry(const QString&, bool)
+ */
+void ParallelCryptHandler::startEntry(const QString& name, bool isSelected)
+{
+    addEvent(StartEntry, name, QString::null, Property::MISC, isSelected);
+}
+
+
+/**
+ * @copydoc DataHandler::endEntry()
+ */
+void ParallelCryptHandler::endEntry()
+{
+    addEvent(EndEntry);
+}
+
+
+/**
+ * @copydoc DataHandler::appendProperty(const QString&, const QString&, Property::Type, bool, bool)
+ */
+void ParallelCryptHandler::appendProperty(const QString& key, const QString& value,
+                                          Property::Type type, bool encrypted, bool hidden)
+{
+    if (type == Property::PASSWORD) {
+        addEvent(AppendProperty, key, QString::null, type, encrypted, hidden);
+        m_passwords.append(value);
+        if (m_passwords.size() >= m_batchSize)
+            flush();
+    } else
+        addEvent(AppendProperty, key, value, type, encrypted, hidden);
+}
+
+
+/**
+ * @brief Appends a call to the list of collected calls.
+ */
+void ParallelCryptHandler::addEvent(EventType type, const QString& name, const QString& value,
+                                    Property::Type propertyType, bool first, bool second)
+{
+    Event event;
+    event.type = type;
+    event.name = name;
+    event.value = value;
+    event.propertyType = propertyType;
+    event.first = first;
+    event.second = second;
+    m_events.append(event);
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
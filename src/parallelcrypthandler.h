@@ -0,0 +1,92 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef PARALLELCRYPTHANDLER_H
+#define PARALLELCRYPTHANDLER_H
+
+#include <stdexcept>
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "datahandler.h"
+#include "security/parallelcryptor.h"
+
+class ParallelCryptHandler : public DataHandler
+{
+    public:
+        enum Operation {
+            Encrypt,
+            Decrypt
+        };
+
+    public:
+        ParallelCryptHandler(DataHandler& target, const SymmetricEncryptor& encryptor,
+            Operation operation, int batchSize = DEFAULT_BATCH_SIZE);
+
+    public:
+        void flush()
+            throw (std::invalid_argument);
+
+        void startCategory(const QString& name, bool wasOpen, bool isSelected);
+        void endCategory();
+        void startEntry(const QString& name, bool isSelected);
+        void endEntry();
+        void appendProperty(const QString& key, const QString& value,
+            Property::Type type, bool encrypted, bool hidden);
+
+    public:
+        static const int DEFAULT_BATCH_SIZE;
+
+    private:
+        enum EventType {
+            StartCategory,
+            EndCategory,
+            StartEntry,
+            EndEntry,
+            AppendProperty
+        };
+
+        struct Event
+        {
+            EventType       type;
+            QString         name;
+            QString         value;
+            Property::Type  propertyType;
+            bool            first;
+            bool            second;
+        };
+
+    private:
+        void addEvent(EventType type, const QString& name = QString::null,
+            const QString& value = QString::null, Property::Type propertyType = Property::MISC,
+            bool first = false, bool second = false);
+
+    private:
+        ParallelCryptHandler(const ParallelCryptHandler&);
+        ParallelCryptHandler& operator=(const ParallelCryptHandler&);
+
+    private:
+        DataHandler&        m_target;
+        ParallelCryptor     m_cryptor;
+        const Operation     m_operation;
+        const int           m_batchSize;
+        QVector<Event>      m_events;
+        QStringList         m_passwords;
+};
+
+#endif // PARALLELCRYPTHANDLER_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
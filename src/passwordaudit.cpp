@@ -0,0 +1,250 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QTime>
+#include <QThreadPool>
+#include <QDebug>
+#include <QtConcurrentMap>
+
+#include "global.h"
+#include "passwordaudit.h"
+#include "passwordstrengthservice.h"
+
+#ifndef DOXYGEN
+
+/**
+ * @brief Checks one password of the audit, runs in the thread pool.
+ */
+class AuditCheck
+{
+    public:
+        typedef PasswordAudit::Result result_type;
+
+    public:
+        AuditCheck(PasswordStrengthService& service)
+            : m_service(service) {}
+
+        PasswordAudit::Result operator()(const PasswordAudit::Item& item)
+        {
+            PasswordAudit::Result result;
+            result.strength = Property::PUndefined;
+            result.daysToCrack = -1.0;
+            try {
+                result.daysToCrack = m_service.daysToCrack(item.password);
+                result.strength = m_service.strength(result.daysToCrack);
+            } catch (const PasswordCheckException& e) {
+                result.error = QString::fromLocal8Bit(e.what());
+            }
+            return result;
+        }
+
+    private:
+        PasswordStrengthService& m_service;
+};
+
+#endif // DOXYGEN
+
+/**
+ * @class PasswordAudit
+ *
+ * @brief Checks the strength of all passwords of a data file without the GUI.
+ *
+ * This is used for the <tt>--audit</tt> command line option. The audit is passed as
+ * DataHandler to DataReadWriter::readXML() and collects the passwords. report() checks
+ * them on all processors and writes one line per password to the output, separated by
+ * tabulators:
+ *
+ * @verbatim
+path    key    strength    days to crack
+@endverbatim
+ *
+ * The path consists of the categories and the name of the entry, separated by
+ * <tt>": "</tt> like TreeEntry::getFullName(). The strength is one of \c weak,
+ * \c acceptable, \c strong or \c error. The lines are written in the order of the
+ * data file while the following passwords are still checked.
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @brief Creates a new audit.
+ *
+ * @param service the service that computes the strength
+ */
+PasswordAudit::PasswordAudit(PasswordStrengthService& service)
+    : m_service(service)
+{}
+
+
+/**
+ * @copydoc DataHandler::startCategory()
+ */
+void PasswordAudit::startCategory(const QString& name, bool, bool)
+{
+    m_path.append(name);
+}
+
+
+/**
+ * @copydoc DataHandler::endCategory()
+ */
+void PasswordAudit::endCategory()
+{
+    m_path.removeLast();
+}
+
+
+/**
+ * @copydoc DataHandler::startEntry()
+ */
+void PasswordAudit::startEntry(const QString& name, bool)
+{
+    m_path.append(name);
+}
+
+
+/**
+ * @copydoc DataHandler::endEntry()
+ */
+void PasswordAudit::endEntry()
+{
+    m_path.removeLast();
+}
+
+
+/**
+ * @brief Collects the property if it's a password.
+ *
+ * @copydetails DataHandler::appendProperty()
+ */
+void PasswordAudit::appendProperty(const QString& key, const QString& value,
+                                   Property::Type type, bool, bool)
+{
+    if (type != Property::PASSWORD)
+        return;
+
+    Item item;
+    item.path = currentPath();
+    item.key = key;
+    item.password = value;
+    m_items.append(item);
+}
+
+
+/**
+ * @brief Returns the number of passwords that have been collected.
+ *
+ * @return the number
+ */
+int PasswordAudit::count() const
+{
+    return m_items.size();
+}
+
+
+/**
+ * @brief Checks all passwords and writes the report.
+ *
+ * The collected passwords are forgotten afterwards.
+ *
+ * @param out the stream for the report
+ * @param log the stream for the error messages and the statistics
+ * @return the number of passwords that could not be checked
+ */
+int PasswordAudit::report(QTextStream& out, QTextStream& log)
+{
+    QTime timer;
+    timer.start();
+
+    out << "# path\tkey\tstrength\tdays to crack\n";
+
+    // resultAt() blocks until the result is there, so the output is streamed in order
+    QFuture<Result> future = QtConcurrent::mapped(m_items, AuditCheck(m_service));
+    int errors = 0;
+    for (int i = 0; i < m_items.size(); ++i) {
+        const Item& item = m_items[i];
+        Result result = future.resultAt(i);
+
+        out << escape(item.path) << '\t' << escape(item.key) << '\t';
+        if (result.error.isNull())
+            out << strengthName(result.strength) << '\t' << result.daysToCrack << '\n';
+        else {
+            out << "error\t-1\n";
+            log << item.path << ": " << result.error << '\n';
+            errors++;
+        }
+        out.flush();
+    }
+    future.waitForFinished();
+
+    int elapsed = qMax(timer.elapsed(), 1);
+    log << "Checked " << m_items.size() << " passwords in " << elapsed << " ms ("
+        << (m_items.size() * 1000.0 / elapsed) << " passwords/s, "
+        << QThreadPool::globalInstance()->maxThreadCount() << " threads)\n";
+    log.flush();
+
+    m_items.clear();
+    return errors;
+}
+
+
+/**
+ * @brief Returns the name of a strength that is used in the report.
+ *
+ * @param strength the strength
+ * @return \c weak, \c acceptable, \c strong or \c undefined
+ */
+QString PasswordAudit::strengthName(Property::PasswordStrength strength)
+{
+    switch (strength) {
+        case Property::PWeak:
+            return "weak";
+
+        case Property::PAcceptable:
+            return "acceptable";
+
+        case Property::PStrong:
+            return "strong";
+
+        default:
+            return "undefined";
+    }
+}
+
+
+/**
+ * @brief Returns the path of the current entry.
+ */
+QString PasswordAudit::currentPath() const
+{
+    return m_path.join(": ");
+}
+
+
+/**
+ * @brief Replaces the characters that separate fields and lines by spaces.
+ *
+ * @param field the field
+ * @return the field that can be written to the report
+ */
+QString PasswordAudit::escape(const QString& field)
+{
+    QString result = field;
+    result.replace('\t', ' ');
+    result.replace('\n', ' ');
+    result.replace('\r', ' ');
+    return result;
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
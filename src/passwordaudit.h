@@ -0,0 +1,78 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef PASSWORDAUDIT_H
+#define PASSWORDAUDIT_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QTextStream>
+
+#include "datahandler.h"
+#include "property.h"
+
+class PasswordStrengthService;
+
+class PasswordAudit : public DataHandler
+{
+    public:
+        struct Item
+        {
+            QString path;
+            QString key;
+            QString password;
+        };
+
+        struct Result
+        {
+            Property::PasswordStrength  strength;
+            double                      daysToCrack;
+            QString                     error;
+        };
+
+    public:
+        PasswordAudit(PasswordStrengthService& service);
+
+    public:
+        void startCategory(const QString& name, bool wasOpen, bool isSelected);
+        void endCategory();
+        void startEntry(const QString& name, bool isSelected);
+        void endEntry();
+        void appendProperty(const QString& key, const QString& value,
+            Property::Type type, bool encrypted, bool hidden);
+
+        int count() const;
+        int report(QTextStream& out, QTextStream& log);
+
+    public:
+        static QString strengthName(Property::PasswordStrength strength);
+
+    private:
+        QString currentPath() const;
+        static QString escape(const QString& field);
+
+    private:
+        PasswordAudit(const PasswordAudit&);
+        PasswordAudit& operator=(const PasswordAudit&);
+
+    private:
+        PasswordStrengthService&    m_service;
+        QStringList                 m_path;
+        QList<Item>                 m_items;
+};
+
+#endif // PASSWORDAUDIT_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,241 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QDebug>
+
+#include "global.h"
+#include "passwordcache.h"
+
+/**
+ * @class DecryptionException
+ *
+ * @brief Exception that is thrown if a password that is kept encrypted in memory
+ *        cannot be decrypted.
+ *
+ * @ingroup gui
+ */
+
+/**
+ * @class PasswordCache
+ *
+ * @brief Decrypts passwords on demand and keeps a bounded number of them.
+ *
+ * If <tt>Security/LazyDecryption</tt> is enabled, the passwords are kept encrypted in
+ * memory after login (see PropertyValue::setCiphertext()). When a password is needed, it
+ * is decrypted by this cache and stored in a SecureString, so it's in locked memory. The
+ * cache holds at most setCapacity() passwords, the password that was not used for the
+ * longest time is removed first. Passwords that were not used for setExpiry() seconds are
+ * removed, too. Because of that, only few pages of locked memory are needed regardless
+ * of the size of the data file.
+ *
+ * The owner of a password is identified by an arbitrary pointer (the PropertyValue). An
+ * owner must call remove() when it is deleted.
+ *
+ * @ingroup gui
+ */
+
+/**
+ * @brief Creates a new, inactive PasswordCache.
+ *
+ * The default capacity is 32 passwords and the default expiry is 60 seconds.
+ *
+ * @param parent the parent object
+ */
+PasswordCache::PasswordCache(QObject* parent)
+    : QObject(parent)
+    , m_capacity(32)
+    , m_expiry(60)
+{
+    connect(&m_timer, SIGNAL(timeout()), SLOT(expire()));
+}
+
+
+/**
+ * @brief Deletes the cache and all passwords in it.
+ */
+PasswordCache::~PasswordCache()
+{
+    clear();
+}
+
+
+/**
+ * @brief Sets the encryptor that decrypts the passwords.
+ *
+ * @param enc the encryptor, the cache takes the ownership. If it's 0, the cache is
+ *        inactive.
+ */
+void PasswordCache::setEncryptor(StringEncryptor* enc)
+{
+    m_encryptor.reset(enc);
+}
+
+
+/**
+ * @brief Returns whether the cache has an encryptor.
+ *
+ * @return @c true if the passwords can be decrypted, @c false otherwise
+ */
+bool PasswordCache::isActive() const
+{
+    return !m_encryptor.isNull();
+}
+
+
+/**
+ * @brief Sets the maximum number of decrypted passwords.
+ *
+ * @param capacity the number of passwords, at least 1
+ */
+void PasswordCache::setCapacity(int capacity)
+{
+    m_capacity = qMax(capacity, 1);
+    while (m_order.size() > m_capacity)
+        evict(m_order.first());
+}
+
+
+/**
+ * @brief Sets the time after which an unused password is removed.
+ *
+ * @param seconds the time in seconds, 0 to keep the passwords until they are displaced
+ */
+void PasswordCache::setExpiry(int seconds)
+{
+    m_expiry = qMax(seconds, 0);
+    if (m_expiry > 0 && !m_entries.isEmpty())
+        m_timer.start(1000);
+    else
+        m_timer.stop();
+}
+
+
+/**
+ * @brief Returns the number of passwords that are currently decrypted.
+ *
+ * @return the number
+ */
+int PasswordCache::size() const
+{
+    return m_entries.size();
+}
+
+
+/**
+ * @brief Returns the decrypted password of @p owner.
+ *
+ * If the password is not in the cache, @p ciphertext is decrypted and stored.
+ *
+ * @param owner the owner of the password
+ * @param ciphertext the encrypted password as stored in the data file
+ * @return the password
+ * @exception DecryptionException if the cache is inactive or decryption failed. An empty
+ *            value must never be used instead, it would replace the password when the
+ *            data is saved.
+ */
+QString PasswordCache::decrypt(const void* owner, const QString& ciphertext)
+    throw (DecryptionException)
+{
+    QHash<const void*, CacheEntry>::iterator it = m_entries.find(owner);
+    if (it != m_entries.end()) {
+        it->lastUsed.start();
+        m_order.removeOne(owner);
+        m_order.append(owner);
+        return it->plaintext->qString();
+    }
+
+    if (!m_encryptor)
+        throw DecryptionException("The password cache has no key");
+
+    QString plaintext;
+    try {
+        plaintext = m_encryptor->decryptStrFromStr(ciphertext);
+    } catch (const std::exception& e) {
+        qDebug() << CURRENT_FUNCTION << "Decryption failed:" << e.what();
+        throw DecryptionException(std::string("The password could not be decrypted: ")
+            + e.what());
+    }
+
+    while (m_order.size() >= m_capacity)
+        evict(m_order.first());
+
+    CacheEntry entry;
+    entry.plaintext = new SecureString(plaintext);
+    entry.lastUsed.start();
+    m_entries.insert(owner, entry);
+    m_order.append(owner);
+
+    if (m_expiry > 0 && !m_timer.isActive())
+        m_timer.start(1000);
+
+    return plaintext;
+}
+
+
+/**
+ * @brief Removes the password of @p owner from the cache.
+ *
+ * Call this if the owner is deleted or gets a new value.
+ *
+ * @param owner the owner
+ */
+void PasswordCache::remove(const void* owner)
+{
+    if (m_entries.contains(owner))
+        evict(owner);
+}
+
+
+/**
+ * @brief Removes all passwords and the encryptor.
+ *
+ * After that the cache is inactive.
+ */
+void PasswordCache::clear()
+{
+    while (!m_order.isEmpty())
+        evict(m_order.first());
+    m_encryptor.reset();
+    m_timer.stop();
+}
+
+
+/**
+ * @brief Removes the passwords that have not been used for the expiry time.
+ */
+void PasswordCache::expire()
+{
+    // the first entry is the least recently used one
+    while (!m_order.isEmpty() && m_entries[m_order.first()].lastUsed.elapsed() >= m_expiry * 1000)
+        evict(m_order.first());
+
+    if (m_entries.isEmpty())
+        m_timer.stop();
+}
+
+
+/**
+ * @brief Removes one password, the SecureString overwrites the memory.
+ *
+ * @param owner the owner, must be in the cache
+ */
+void PasswordCache::evict(const void* owner)
+{
+    Q_ASSERT(m_entries.contains(owner));
+
+    delete m_entries.take(owner).plaintext;
+    m_order.removeOne(owner);
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,88 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef PASSWORDCACHE_H
+#define PASSWORDCACHE_H
+
+#include <stdexcept>
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QTime>
+#include <QTimer>
+#include <QScopedPointer>
+
+#include "util/securestring.h"
+#include "security/encryptor.h"
+
+class DecryptionException : public std::runtime_error
+{
+    public:
+        DecryptionException(const std::string& error) : std::runtime_error(error) { }
+};
+
+class PasswordCache : public QObject
+{
+    Q_OBJECT
+
+    public:
+        PasswordCache(QObject* parent = 0);
+        ~PasswordCache();
+
+    public:
+        void setEncryptor(StringEncryptor* enc);
+        bool isActive() const;
+
+        void setCapacity(int capacity);
+        void setExpiry(int seconds);
+        int size() const;
+
+        QString decrypt(const void* owner, const QString& ciphertext)
+            throw (DecryptionException);
+        void remove(const void* owner);
+
+    public slots:
+        void clear();
+
+    private slots:
+        void expire();
+
+    private:
+        void evict(const void* owner);
+
+    private:
+        PasswordCache(const PasswordCache&);
+        PasswordCache& operator=(const PasswordCache&);
+
+    private:
+        struct CacheEntry
+        {
+            SecureString*   plaintext;
+            QTime           lastUsed;
+        };
+
+    private:
+        QScopedPointer<StringEncryptor>     m_encryptor;
+        QHash<const void*, CacheEntry>      m_entries;
+        QList<const void*>                  m_order;
+        QTimer                              m_timer;
+        int                                 m_capacity;
+        int                                 m_expiry;
+};
+
+#endif // PASSWORDCACHE_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
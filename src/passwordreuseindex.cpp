@@ -0,0 +1,296 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <algorithm>
+#include <stdexcept>
+
+#include <QDebug>
+
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+
+#include "global.h"
+#include "passwordreuseindex.h"
+#include "property.h"
+#include "security/gcmauthenticator.h"
+
+/**
+ * @class PasswordReuseIndex
+ *
+ * @brief Finds passwords that are used in more than one property.
+ *
+ * The index groups the PASSWORD properties by an HMAC-SHA256 of their value. The key of the
+ * HMAC is created randomly for each session (see clear()), so the index contains no
+ * plaintext and the digests cannot be compared with other sessions. Properties that share
+ * a digest with another property are marked with Property::setReused().
+ *
+ * Properties are registered with add(). The index follows Property::propertyChanged() and
+ * the destruction of the properties, so only the changed property is hashed again and
+ * finding all reused passwords is O(n).
+ *
+ * The digests are only computed while the index is active, because that requires the
+ * decrypted value of every password (see setActive()).
+ *
+ * @ingroup gui
+ */
+
+/**
+ * @brief Creates a new inactive index.
+ *
+ * @param parent the parent object
+ */
+PasswordReuseIndex::PasswordReuseIndex(QObject* parent)
+    : QObject(parent)
+    , m_active(false)
+    , m_reusedCount(0)
+{
+    newKey();
+}
+
+
+/**
+ * @brief Registers a property.
+ *
+ * Registering a property twice has no effect. The property is removed automatically when
+ * it's deleted.
+ *
+ * @param property the property
+ */
+void PasswordReuseIndex::add(Property* property)
+{
+    if (m_properties.contains(property))
+        return;
+
+    m_properties.insert(property, property);
+    connect(property, SIGNAL(propertyChanged(Property*)), SLOT(update(Property*)));
+    connect(property, SIGNAL(destroyed(QObject*)), SLOT(remove(QObject*)));
+
+    if (m_active)
+        update(property);
+}
+
+
+/**
+ * @brief Checks if the digests are computed.
+ *
+ * @return @c true if reused passwords are detected
+ */
+bool PasswordReuseIndex::isActive() const
+{
+    return m_active;
+}
+
+
+/**
+ * @brief Returns the number of properties whose password is also used elsewhere.
+ *
+ * @return the number
+ */
+int PasswordReuseIndex::reusedCount() const
+{
+    return m_reusedCount;
+}
+
+
+/**
+ * @brief Starts or stops the detection of reused passwords.
+ *
+ * Activating computes the digests of all registered properties. Deactivating forgets
+ * the digests and resets the reuse state of the properties.
+ *
+ * @param active @c true if reused passwords should be detected
+ */
+void PasswordReuseIndex::setActive(bool active)
+{
+    if (active == m_active || (active && m_key.isEmpty()))
+        return;
+
+    m_active = active;
+    if (active) {
+        for (QHash<const QObject*, Property*>::const_iterator it = m_properties.begin();
+                it != m_properties.end(); ++it)
+            update(it.value());
+    } else {
+        QList<Property*> properties = m_properties.values();
+        for (QList<Property*>::const_iterator it = properties.begin();
+                it != properties.end(); ++it)
+            removeDigest(*it);
+        Q_ASSERT(m_groups.isEmpty() && m_reusedCount == 0);
+    }
+}
+
+
+/**
+ * @brief Forgets all properties and creates a new key.
+ *
+ * This should be called at the end of a session. The index stays active or inactive.
+ */
+void PasswordReuseIndex::clear()
+{
+    for (QHash<const QObject*, Property*>::const_iterator it = m_properties.begin();
+            it != m_properties.end(); ++it) {
+        it.value()->disconnect(this);
+        it.value()->setReused(false);
+    }
+
+    m_properties.clear();
+    m_digests.clear();
+    m_groups.clear();
+    m_reusedCount = 0;
+    newKey();
+}
+
+
+/**
+ * @brief Hashes the value of @p property again and moves it to the right group.
+ *
+ * @param property the property that has changed
+ */
+void PasswordReuseIndex::update(Property* property)
+{
+    if (!m_active)
+        return;
+
+    QByteArray newDigest = digest(property);
+    if (newDigest == m_digests.value(property))
+        return;
+
+    removeDigest(property);
+    if (!newDigest.isEmpty())
+        insertDigest(property, newDigest);
+}
+
+
+/**
+ * @brief Removes a property that is being deleted.
+ *
+ * @param object the property, must not be dereferenced
+ */
+void PasswordReuseIndex::remove(QObject* object)
+{
+    Property* property = m_properties.take(object);
+    if (property)
+        removeDigest(property);
+}
+
+
+/**
+ * @brief Returns the digest of the value of a password property.
+ *
+ * @param property the property
+ * @return the HMAC-SHA256 or an empty array if @p property is no password, if it's empty
+ *         or if it cannot be decrypted
+ */
+QByteArray PasswordReuseIndex::digest(const Property* property) const
+{
+    if (property->getType() != Property::PASSWORD)
+        return QByteArray();
+
+    QByteArray utf8;
+    try {
+        utf8 = property->getValue().toUtf8();
+    } catch (const DecryptionException& e) {
+        qDebug() << CURRENT_FUNCTION << e.what();
+        return QByteArray();
+    }
+    if (utf8.isEmpty())
+        return QByteArray();
+
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    HMAC(EVP_sha256(), m_key.constData(), m_key.size(),
+        reinterpret_cast<const unsigned char*>(utf8.constData()), utf8.size(), md, &length);
+    std::fill(utf8.begin(), utf8.end(), '\0');
+
+    return QByteArray(reinterpret_cast<const char*>(md), length);
+}
+
+
+/**
+ * @brief Adds @p property to the group of @p digest.
+ *
+ * @param property the property, must not be in a group
+ * @param digest the digest of its value
+ */
+void PasswordReuseIndex::insertDigest(Property* property, const QByteArray& digest)
+{
+    m_digests.insert(property, digest);
+    QList<Property*>& group = m_groups[digest];
+    group.append(property);
+
+    if (group.size() == 2) {
+        group.first()->setReused(true);
+        m_reusedCount++;
+    }
+    if (group.size() >= 2) {
+        property->setReused(true);
+        m_reusedCount++;
+    }
+}
+
+
+/**
+ * @brief Removes @p property from its group.
+ *
+ * The property may be in the destructor, so it's only dereferenced if it's still
+ * registered.
+ *
+ * @param property the property
+ */
+void PasswordReuseIndex::removeDigest(Property* property)
+{
+    QHash<const QObject*, QByteArray>::iterator digestIt = m_digests.find(property);
+    if (digestIt == m_digests.end())
+        return;
+
+    QHash<QByteArray, QList<Property*> >::iterator groupIt = m_groups.find(digestIt.value());
+    m_digests.erase(digestIt);
+    Q_ASSERT(groupIt != m_groups.end());
+
+    QList<Property*>& group = groupIt.value();
+    bool wasReused = group.size() >= 2;
+    group.removeOne(property);
+
+    if (wasReused) {
+        m_reusedCount--;
+        if (m_properties.contains(property))
+            property->setReused(false);
+    }
+    if (group.size() == 1) {
+        group.first()->setReused(false);
+        m_reusedCount--;
+    }
+    if (group.isEmpty())
+        m_groups.erase(groupIt);
+}
+
+
+/**
+ * @brief Creates a new random key for the HMAC.
+ *
+ * If no random numbers are available, the index cannot be activated.
+ */
+void PasswordReuseIndex::newKey()
+{
+    std::fill(m_key.begin(), m_key.end(), '\0');
+    try {
+        m_key = GcmAuthenticator::randomBytes(32);
+    } catch (const std::runtime_error& e) {
+        qDebug() << CURRENT_FUNCTION << e.what();
+        m_key.clear();
+        m_active = false;
+    }
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,66 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef PASSWORDREUSEINDEX_H
+#define PASSWORDREUSEINDEX_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+
+class Property;
+
+class PasswordReuseIndex : public QObject
+{
+    Q_OBJECT
+
+    public:
+        PasswordReuseIndex(QObject* parent = 0);
+
+    public:
+        void add(Property* property);
+        bool isActive() const;
+        int reusedCount() const;
+
+    public slots:
+        void setActive(bool active);
+        void clear();
+
+    private slots:
+        void update(Property* property);
+        void remove(QObject* object);
+
+    private:
+        QByteArray digest(const Property* property) const;
+        void insertDigest(Property* property, const QByteArray& digest);
+        void removeDigest(Property* property);
+        void newKey();
+
+    private:
+        PasswordReuseIndex(const PasswordReuseIndex&);
+        PasswordReuseIndex& operator=(const PasswordReuseIndex&);
+
+    private:
+        bool                                    m_active;
+        QByteArray                              m_key;
+        QHash<const QObject*, Property*>        m_properties;
+        QHash<const QObject*, QByteArray>       m_digests;
+        QHash<QByteArray, QList<Property*> >    m_groups;
+        int                                     m_reusedCount;
+};
+
+#endif // PASSWORDREUSEINDEX_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,244 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QDebug>
+#include <QtConcurrentMap>
+
+#include "global.h"
+#include "passwordstrengthjob.h"
+#include "passwordstrengthservice.h"
+
+#ifndef DOXYGEN
+
+/**
+ * @brief Computes the strength of one snapshot, runs in the thread pool.
+ */
+class ComputeStrength
+{
+    public:
+        typedef PasswordStrengthJob::Result result_type;
+
+    public:
+        ComputeStrength(PasswordStrengthService& service)
+            : m_service(service) {}
+
+        PasswordStrengthJob::Result operator()(const PasswordStrengthJob::Snapshot& snapshot)
+        {
+            PasswordStrengthJob::Result result;
+            result.property = snapshot.property;
+            result.strength = Property::PUndefined;
+            result.daysToCrack = -1.0;
+            // the plain copy only exists while this password is checked
+            QString password = snapshot.password.qString();
+            try {
+                result.daysToCrack = m_service.daysToCrack(password);
+                result.strength = m_service.strength(result.daysToCrack);
+            } catch (const PasswordCheckException& e) {
+                result.error = QString::fromLocal8Bit(e.what());
+            }
+            password.fill(QChar('\0'));
+            return result;
+        }
+
+    private:
+        PasswordStrengthService& m_service;
+};
+
+#endif // DOXYGEN
+
+/**
+ * @class PasswordStrengthJob
+ *
+ * @brief Computes the strength of many passwords in the background.
+ *
+ * The passwords are copied before (Snapshot) because the properties must only be accessed
+ * in the GUI thread. The copies are SecureString objects, so they are in locked memory and
+ * are wiped when the job is deleted. A worker converts a password to a QString only while
+ * it's checked and overwrites that string afterwards. The strength is computed on all processors with QtConcurrent. The
+ * results are passed back in batches (see QFutureWatcher::resultsReadyAt()) and are stored
+ * in the properties in the GUI thread, then resultsApplied() is emitted.
+ *
+ * The properties are marked with Property::setPasswordStrengthPending() while the job runs.
+ * Properties that are deleted in the meantime are skipped. A result is also skipped if the
+ * property is no longer pending because its value was changed.
+ *
+ * The job can be cancelled. It's also cancelled when it's deleted, the destructor waits
+ * until the running computations are finished.
+ *
+ * @ingroup gui
+ */
+
+/**
+ * @fn PasswordStrengthJob::resultsApplied(int, int)
+ *
+ * @brief Emitted in the GUI thread after a batch of results has been stored.
+ *
+ * @param done the number of results so far
+ * @param total the number of passwords
+ */
+
+/**
+ * @fn PasswordStrengthJob::failed(const QString&)
+ *
+ * @brief Emitted once if the strength of a password could not be computed.
+ *
+ * @param message the error message of the PasswordCheckException
+ */
+
+/**
+ * @fn PasswordStrengthJob::finished()
+ *
+ * @brief Emitted when all results have been stored or when the job was cancelled.
+ */
+
+/**
+ * @brief Creates a new job, start() starts it.
+ *
+ * @param service the service that computes the strength
+ * @param snapshots the properties and their passwords
+ * @param parent the parent object
+ */
+PasswordStrengthJob::PasswordStrengthJob(PasswordStrengthService& service,
+                                         const QList<Snapshot>& snapshots, QObject* parent)
+    : QObject(parent)
+    , m_service(service)
+    , m_snapshots(snapshots)
+    , m_done(0)
+    , m_failed(false)
+{
+    connect(&m_watcher, SIGNAL(resultsReadyAt(int, int)), SLOT(applyResults(int, int)));
+    connect(&m_watcher, SIGNAL(finished()), SLOT(handleFinished()));
+}
+
+
+/**
+ * @brief Cancels the job and waits until the worker threads have stopped.
+ */
+PasswordStrengthJob::~PasswordStrengthJob()
+{
+    m_watcher.disconnect(this);
+    m_watcher.cancel();
+    m_watcher.waitForFinished();
+    resetPending();
+}
+
+
+/**
+ * @brief Marks the properties as pending and starts the computation.
+ */
+void PasswordStrengthJob::start()
+{
+    for (QList<Snapshot>::const_iterator it = m_snapshots.begin(); it != m_snapshots.end(); ++it)
+        if (it->property)
+            it->property->setPasswordStrengthPending(true);
+
+    m_watcher.setFuture(QtConcurrent::mapped(m_snapshots, ComputeStrength(m_service)));
+}
+
+
+/**
+ * @brief Checks if the computation is still running.
+ *
+ * @return @c true if not all results have been stored
+ */
+bool PasswordStrengthJob::isRunning() const
+{
+    return m_watcher.isRunning();
+}
+
+
+/**
+ * @brief Returns the number of passwords.
+ *
+ * @return the number
+ */
+int PasswordStrengthJob::total() const
+{
+    return m_snapshots.size();
+}
+
+
+/**
+ * @brief Returns the number of results that have been stored.
+ *
+ * @return the number
+ */
+int PasswordStrengthJob::done() const
+{
+    return m_done;
+}
+
+
+/**
+ * @brief Stops the computation.
+ *
+ * The properties without a result are no longer pending, so their strength is computed
+ * when it's needed. finished() is emitted when the worker threads have stopped.
+ */
+void PasswordStrengthJob::cancel()
+{
+    m_watcher.cancel();
+    resetPending();
+}
+
+
+/**
+ * @brief Stores a batch of results in the properties.
+ *
+ * @param begin the index of the first result
+ * @param end the index after the last result
+ */
+void PasswordStrengthJob::applyResults(int begin, int end)
+{
+    if (m_watcher.isCanceled())
+        return;
+
+    for (int i = begin; i < end; ++i) {
+        Result result = m_watcher.resultAt(i);
+        if (!result.error.isNull()) {
+            if (!m_failed) {
+                m_failed = true;
+                emit failed(result.error);
+            }
+        } else if (result.property && result.property->isPasswordStrengthPending())
+            result.property->setPasswordStrength(result.strength, result.daysToCrack);
+    }
+
+    m_done += end - begin;
+    emit resultsApplied(m_done, total());
+}
+
+
+/**
+ * @brief Forgets the passwords and emits finished().
+ */
+void PasswordStrengthJob::handleFinished()
+{
+    resetPending();
+    m_snapshots.clear();
+    emit finished();
+}
+
+
+/**
+ * @brief Ends the pending state of the properties that have not got a result.
+ */
+void PasswordStrengthJob::resetPending()
+{
+    for (QList<Snapshot>::const_iterator it = m_snapshots.begin(); it != m_snapshots.end(); ++it)
+        if (it->property && it->property->isPasswordStrengthPending())
+            it->property->setPasswordStrengthPending(false);
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
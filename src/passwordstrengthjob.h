@@ -0,0 +1,88 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef PASSWORDSTRENGTHJOB_H
+#define PASSWORDSTRENGTHJOB_H
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <QFutureWatcher>
+
+#include "property.h"
+#include "util/securestring.h"
+
+class PasswordStrengthService;
+
+class PasswordStrengthJob : public QObject
+{
+    Q_OBJECT
+
+    public:
+        struct Snapshot
+        {
+            QPointer<Property>  property;
+            SecureString        password;
+        };
+
+        struct Result
+        {
+            QPointer<Property>          property;
+            Property::PasswordStrength  strength;
+            double                      daysToCrack;
+            QString                     error;
+        };
+
+    public:
+        PasswordStrengthJob(PasswordStrengthService& service, const QList<Snapshot>& snapshots,
+            QObject* parent = 0);
+        ~PasswordStrengthJob();
+
+    public:
+        void start();
+        bool isRunning() const;
+        int total() const;
+        int done() const;
+
+    public slots:
+        void cancel();
+
+    signals:
+        void resultsApplied(int done, int total);
+        void failed(const QString& message);
+        void finished();
+
+    private slots:
+        void applyResults(int begin, int end);
+        void handleFinished();
+
+    private:
+        void resetPending();
+
+    private:
+        PasswordStrengthJob(const PasswordStrengthJob&);
+        PasswordStrengthJob& operator=(const PasswordStrengthJob&);
+
+    private:
+        PasswordStrengthService&    m_service;
+        QList<Snapshot>             m_snapshots;
+        QFutureWatcher<Result>      m_watcher;
+        int                         m_done;
+        bool                        m_failed;
+};
+
+#endif // PASSWORDSTRENGTHJOB_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,239 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <algorithm>
+#include <stdexcept>
+
+#include <QDebug>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QMutexLocker>
+
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+
+#include "global.h"
+#include "passwordstrengthservice.h"
+#include "security/passwordcheckerfactory.h"
+#include "security/gcmauthenticator.h"
+
+/**
+ * @class PasswordStrengthService
+ *
+ * @brief Computes the strength of passwords with one checker for the whole application.
+ *
+ * Creating a PasswordChecker and reading the settings for each password is expensive
+ * if the strength of all passwords is computed. The service reads the settings once and
+ * creates the checker when it's needed first. invalidate() must be called if the settings
+ * have changed, QpamatWindow connects it to QpamatWindow::settingsChanged().
+ *
+ * The results are remembered. The key is an HMAC of the password with a random key that
+ * is created for each process, so the memo doesn't contain the passwords or hashes that
+ * could be looked up in a table. The memo is cleared when it has MAX_MEMO_SIZE entries.
+ * invalidate() increments a generation counter, a result that was computed with a checker
+ * of an older generation is not remembered.
+ *
+ * daysToCrack() and strength() may be called from any thread. invalidate() reads the
+ * settings and must be called in the GUI thread.
+ *
+ * @ingroup gui
+ */
+
+/**
+ * @brief The maximum number of results that are remembered.
+ */
+const int PasswordStrengthService::MAX_MEMO_SIZE = 8192;
+
+/**
+ * @brief Creates a new PasswordStrengthService.
+ *
+ * @param settings the settings of the application
+ * @param parent the parent object
+ */
+PasswordStrengthService::PasswordStrengthService(Settings& settings, QObject* parent)
+    : QObject(parent)
+    , m_settings(settings)
+    , m_weakLimit(0.0)
+    , m_strongLimit(0.0)
+    , m_memoGeneration(0)
+{
+    invalidate();
+
+    try {
+        m_memoSecret = GcmAuthenticator::randomBytes(32);
+    } catch (const std::runtime_error& e) {
+        // the memo is not used without a secret
+        qDebug() << CURRENT_FUNCTION << e.what();
+    }
+}
+
+
+/**
+ * @brief Deletes the checker.
+ */
+PasswordStrengthService::~PasswordStrengthService()
+{}
+
+
+/**
+ * @brief Creates the checker if that hasn't been done yet.
+ *
+ * Call this in the GUI thread before starting computations in other threads, so that an
+ * error in the configuration is reported before.
+ *
+ * @exception PasswordCheckException if the checker cannot be created
+ */
+void PasswordStrengthService::prepare()
+    throw (PasswordCheckException)
+{
+    QWriteLocker locker(&m_checkerLock);
+    if (!m_checker)
+        m_checker.reset(createChecker());
+}
+
+
+/**
+ * @brief Returns the days that a cracker needs to find @p password.
+ *
+ * @param password the password
+ * @return the number of days, see PasswordChecker::passwordQuality()
+ * @exception PasswordCheckException if the checker cannot be created, for example because
+ *            the dictionary does not exist
+ */
+double PasswordStrengthService::daysToCrack(const QString& password)
+    throw (PasswordCheckException)
+{
+    QByteArray key = memoKey(password);
+    unsigned int generation = 0;
+    if (!key.isEmpty()) {
+        QMutexLocker locker(&m_memoLock);
+        generation = m_memoGeneration;
+        QHash<QByteArray, double>::const_iterator it = m_memo.find(key);
+        if (it != m_memo.end())
+            return it.value();
+    }
+
+    double days;
+    {
+        QReadLocker locker(&m_checkerLock);
+        if (!m_checker) {
+            // create the checker, another thread may be faster
+            locker.unlock();
+            QWriteLocker writeLocker(&m_checkerLock);
+            if (!m_checker)
+                m_checker.reset(createChecker());
+            days = m_checker->passwordQuality(password);
+        } else
+            days = m_checker->passwordQuality(password);
+    }
+
+    if (!key.isEmpty()) {
+        QMutexLocker locker(&m_memoLock);
+        // invalidate() was called in the meantime, the result may be from the old checker
+        if (generation != m_memoGeneration)
+            return days;
+        if (m_memo.size() >= MAX_MEMO_SIZE)
+            m_memo.clear();
+        m_memo.insert(key, days);
+    }
+
+    return days;
+}
+
+
+/**
+ * @brief Maps the days returned by daysToCrack() to a strength category.
+ *
+ * The limits are taken from the settings.
+ *
+ * @param daysToCrack the days
+ * @return the category
+ */
+Property::PasswordStrength PasswordStrengthService::strength(double daysToCrack) const
+{
+    QMutexLocker locker(&m_memoLock);
+
+    if (daysToCrack < m_weakLimit)
+        return Property::PWeak;
+    else if (daysToCrack < m_strongLimit)
+        return Property::PAcceptable;
+    else
+        return Property::PStrong;
+}
+
+
+/**
+ * @brief Reads the settings again and forgets the checker and all results.
+ */
+void PasswordStrengthService::invalidate()
+{
+    qDebug() << CURRENT_FUNCTION;
+
+    {
+        QWriteLocker locker(&m_checkerLock);
+        m_checker.reset();
+        m_dictionaryFile = m_settings.readEntry("Security/DictionaryFile");
+        m_checkerType = m_settings.readEntry("Security/PasswordChecker");
+    }
+
+    QMutexLocker locker(&m_memoLock);
+    m_weakLimit = m_settings.readDoubleEntry("Security/WeakPasswordLimit");
+    m_strongLimit = m_settings.readDoubleEntry("Security/StrongPasswordLimit");
+    m_memo.clear();
+    m_memoGeneration++;
+}
+
+
+/**
+ * @brief Creates the checker that is selected in the settings.
+ *
+ * Must be called with a write lock on m_checkerLock.
+ *
+ * @return the new checker
+ * @exception PasswordCheckException if the type is invalid or if the checker cannot be
+ *            created
+ */
+PasswordChecker* PasswordStrengthService::createChecker() const
+    throw (PasswordCheckException)
+{
+    try {
+        return PasswordCheckerFactory::getChecker(m_checkerType, m_dictionaryFile);
+    } catch (const std::invalid_argument& e) {
+        throw PasswordCheckException(e.what());
+    }
+}
+
+
+/**
+ * @brief Returns the key of @p password in the memo.
+ *
+ * @param password the password
+ * @return the HMAC-SHA256 of the password or an empty array if the memo is not used
+ */
+QByteArray PasswordStrengthService::memoKey(const QString& password) const
+{
+    if (m_memoSecret.isEmpty())
+        return QByteArray();
+
+    QByteArray utf8 = password.toUtf8();
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    HMAC(EVP_sha256(), m_memoSecret.constData(), m_memoSecret.size(),
+        reinterpret_cast<const unsigned char*>(utf8.constData()), utf8.size(), md, &length);
+    std::fill(utf8.begin(), utf8.end(), '\0');
+
+    return QByteArray(reinterpret_cast<const char*>(md), length);
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,76 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef PASSWORDSTRENGTHSERVICE_H
+#define PASSWORDSTRENGTHSERVICE_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QScopedPointer>
+
+#include "settings.h"
+#include "property.h"
+#include "security/passwordchecker.h"
+
+class PasswordStrengthService : public QObject
+{
+    Q_OBJECT
+
+    public:
+        static const int MAX_MEMO_SIZE;
+
+    public:
+        PasswordStrengthService(Settings& settings, QObject* parent = 0);
+        ~PasswordStrengthService();
+
+    public:
+        void prepare()
+            throw (PasswordCheckException);
+        double daysToCrack(const QString& password)
+            throw (PasswordCheckException);
+        Property::PasswordStrength strength(double daysToCrack) const;
+
+    public slots:
+        void invalidate();
+
+    private:
+        PasswordChecker* createChecker() const
+            throw (PasswordCheckException);
+        QByteArray memoKey(const QString& password) const;
+
+    private:
+        PasswordStrengthService(const PasswordStrengthService&);
+        PasswordStrengthService& operator=(const PasswordStrengthService&);
+
+    private:
+        Settings&                       m_settings;
+        QReadWriteLock                  m_checkerLock;
+        QScopedPointer<PasswordChecker> m_checker;
+        QString                         m_dictionaryFile;
+        QString                         m_checkerType;
+        double                          m_weakLimit;
+        double                          m_strongLimit;
+        mutable QMutex                  m_memoLock;
+        QHash<QByteArray, double>       m_memo;
+        unsigned int                    m_memoGeneration;
+        QByteArray                      m_memoSecret;
+};
+
+#endif // PASSWORDSTRENGTHSERVICE_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
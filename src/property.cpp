@@ -17,21 +17,26 @@
 #include <Q3ListView>
 #include <QMessageBox>
 #include <QTextStream>
+#include <QDebug>
 
+#include "global.h"
 #include "qpamatwindow.h"
 #include "qpamat.h"
 #include "util/securestring.h"
-#include "security/hybridpasswordchecker.h"
 #include "property.h"
 #include "security/encodinghelper.h"
 #include "treeentry.h"
+#include "passwordcache.h"
+#include "passwordstrengthservice.h"
 
 /**
  * @class PropertyValue
  *
  * @brief Represents the value of a property.
  *
- * This is some kind of union class for a QString and a SecureString.
+ * This is some kind of union class for a QString and a SecureString. A password can also
+ * be stored encrypted, then it's decrypted by a PasswordCache each time it is needed (see
+ * setCiphertext()).
  *
  * @ingroup gui
  * @author Bernhard Walle
@@ -51,11 +56,24 @@ PropertyValue::PropertyValue(const QString &string, bool storeSecure)
     : m_string(QString::null)
     , m_secureString()
     , m_isSecureString(false)
+    , m_cache(0)
 {
     set(string, storeSecure);
 }
 
 
+/**
+ * @brief Destructor
+ *
+ * Removes the decrypted value from the PasswordCache.
+ */
+PropertyValue::~PropertyValue()
+{
+    if (m_cache)
+        m_cache->remove(this);
+}
+
+
 /**
  * @brief Sets a value to a PropertyValue
  *
@@ -67,10 +85,20 @@ PropertyValue::PropertyValue(const QString &string, bool storeSecure)
  */
 void PropertyValue::set(const QString &string, bool storeSecure)
 {
+    if (m_cache) {
+        m_cache->remove(this);
+        m_cache = 0;
+    }
+    m_ciphertext = QString::null;
+
+    // swap instead of assigning to avoid a second allocation, and don't keep an old
+    // secret in the unused member
     if (storeSecure) {
-        m_secureString = SecureString(string);
+        SecureString(string).swap(m_secureString);
+        m_string = QString::null;
         m_isSecureString = true;
     } else {
+        SecureString().swap(m_secureString);
         m_string = string;
         m_isSecureString = false;
     }
@@ -80,13 +108,19 @@ void PropertyValue::set(const QString &string, bool storeSecure)
 /**
  * @brief Returns the value
  *
- * Returns the value as QString.
+ * Returns the value as QString. If the value is stored encrypted, it's decrypted.
  *
  * @return the value
+ * @exception DecryptionException if the value is stored encrypted and cannot be decrypted
  */
 QString PropertyValue::get() const
+    throw (DecryptionException)
 {
-    if (m_isSecureString) {
+    if (!m_ciphertext.isNull()) {
+        if (!m_cache)
+            throw DecryptionException("No password cache to decrypt the value");
+        return m_cache->decrypt(this, m_ciphertext);
+    } else if (m_isSecureString) {
         return m_secureString.qString();
     } else {
         return m_string;
@@ -98,13 +132,16 @@ QString PropertyValue::get() const
  * @brief Returns the visible value
  *
  * The same as get(), but in case the string is stored secure, all characters are replaced
- * with stars <tt>(*)</tt>.
+ * with stars <tt>(*)</tt>. An encrypted value is not decrypted, it's always displayed
+ * as eight stars.
  *
  * @return the visible value as string
  */
 QString PropertyValue::getVisible() const
 {
-    if (m_isSecureString) {
+    if (!m_ciphertext.isNull()) {
+        return QString(8, '*');
+    } else if (m_isSecureString) {
         QString s;
         s.fill('*', m_secureString.length());
         return s;
@@ -114,6 +151,24 @@ QString PropertyValue::getVisible() const
 }
 
 
+/**
+ * @brief Sets an encrypted value
+ *
+ * The value is not decrypted now but each time get() is called. The decrypted value is
+ * kept in @p cache which limits the number of passwords that are in memory at the
+ * same time.
+ *
+ * @param[in] ciphertext the encrypted value as stored in the data file
+ * @param[in] cache the cache that decrypts the value
+ */
+void PropertyValue::setCiphertext(const QString &ciphertext, PasswordCache *cache)
+{
+    set(QString::null);
+    m_ciphertext = ciphertext.isNull() ? QString("") : ciphertext;
+    m_cache = cache;
+}
+
+
 /**
  * @class Property
  *
@@ -148,6 +203,14 @@ QString PropertyValue::getVisible() const
  * @param current the this pointer
  */
 
+/**
+ * @fn Property::passwordStrengthChanged(Property*)
+ *
+ * @brief This signal is emitted if the cached password strength or the reuse state changed.
+ *
+ * @param current the this pointer
+ */
+
 /**
  * @brief Creates a new Property.
  *
@@ -159,15 +222,15 @@ QString PropertyValue::getVisible() const
  */
 Property::Property(const QString& key, const QString& value, Type type, bool encrypted, bool hidden)
     : m_key(key)
-    , m_value(value)
+    , m_value(value, hidden)
     , m_type(type)
     , m_encrypted(encrypted)
     , m_hidden(hidden)
     , m_passwordStrength(PUndefined)
     , m_daysToCrack(-1.0)
-{
-    setValue(value);
-}
+    , m_strengthPending(false)
+    , m_reused(false)
+{}
 
 
 /**
@@ -197,8 +260,11 @@ void Property::setKey(const QString& key)
  * @brief Returns the value of the property.
  *
  * @return the value
+ * @exception DecryptionException if the value is kept encrypted (see setEncryptedValue())
+ *            and cannot be decrypted
  */
 QString Property::getValue() const
+    throw (DecryptionException)
 {
     return m_value.get();
 }
@@ -223,17 +289,35 @@ QString Property::getVisibleValue() const
 void Property::setValue(const QString& value)
 {
     m_value.set(value, m_hidden);
+    // a result that is computed in the background is for the old value
+    m_strengthPending = false;
     emit propertyChanged(this);
 }
 
 
+/**
+ * @brief Sets the value of the property in encrypted form.
+ *
+ * The value is decrypted with @p cache when getValue() is called. No signal is emitted,
+ * this is used while the data file is read.
+ *
+ * @param ciphertext the encrypted value
+ * @param cache the cache that decrypts the value
+ */
+void Property::setEncryptedValue(const QString& ciphertext, PasswordCache* cache)
+{
+    m_value.setCiphertext(ciphertext, cache);
+}
+
+
 /**
  * @brief This function only makes sense if the property represents a password.
  *
  * It returns the password strength. The value is cached. Recomputing takes
  * place the first time this function is called and any thimes the
  * updatePasswordStrength() function is called. There's no automatic
- * recomputation because of performance reasons.
+ * recomputation because of performance reasons. While the strength is computed in the
+ * background (see setPasswordStrengthPending()), the old value is returned.
  *
  * @return the password strength which is \c PUndefined if it is no password
  * @exception PasswordCheckException if the strength is updated and a PasswordCheckException
@@ -241,7 +325,7 @@ void Property::setValue(const QString& value)
  */
 Property::PasswordStrength Property::getPasswordStrength() throw (PasswordCheckException)
 {
-    if (m_passwordStrength == PUndefined)
+    if (m_passwordStrength == PUndefined && !m_strengthPending)
         updatePasswordStrength();
     return m_passwordStrength;
 }
@@ -268,29 +352,104 @@ double Property::daysToCrack() const
  * Because updating this information may be expensive, you sometimes manually
  * must call this function.
  *
+ * If the password cannot be decrypted, the strength is undefined.
+ *
  * @exception if the password checker threw a PasswordCheckException
  */
 void Property::updatePasswordStrength() throw (PasswordCheckException)
 {
     if (m_type == PASSWORD) {
-        QpamatWindow *win = Qpamat::instance()->getWindow();
-        QString ensured = win->set().readEntry("Security/EnsuredCharacters");
-        double days = -1.0;
-        HybridPasswordChecker checker(win->set().readEntry("Security/DictionaryFile"));
-        days = checker.passwordQuality(m_value.get()); // XXX
-        m_daysToCrack = days;
-        double weakLimit = win->set().readDoubleEntry("Security/WeakPasswordLimit");
-        double strongLimit = win->set().readDoubleEntry("Security/StrongPasswordLimit");
-        if (m_daysToCrack < weakLimit)
-            m_passwordStrength = PWeak;
-        else if (m_daysToCrack >= weakLimit && m_daysToCrack < strongLimit)
-            m_passwordStrength = PAcceptable;
-        else
-            m_passwordStrength = PStrong;
+        PasswordStrengthService& service = Qpamat::instance()->getWindow()->strengthService();
+        QString password;
+        try {
+            password = m_value.get();
+        } catch (const DecryptionException& e) {
+            qDebug() << CURRENT_FUNCTION << e.what();
+            setPasswordStrength(PUndefined, -1.0);
+            return;
+        }
+        double days = service.daysToCrack(password);
+        setPasswordStrength(service.strength(days), days);
     }
 }
 
 
+/**
+ * @brief Sets the password strength that has been computed elsewhere.
+ *
+ * This also ends the pending state, see setPasswordStrengthPending(). If the strength
+ * is different from the cached one, passwordStrengthChanged() is emitted.
+ *
+ * @param strength the strength
+ * @param daysToCrack the days, see daysToCrack()
+ */
+void Property::setPasswordStrength(PasswordStrength strength, double daysToCrack)
+{
+    bool changed = strength != m_passwordStrength;
+    m_passwordStrength = strength;
+    m_daysToCrack = daysToCrack;
+    m_strengthPending = false;
+    if (changed)
+        emit passwordStrengthChanged(this);
+}
+
+
+/**
+ * @brief Returns whether the same password is also used in another property.
+ *
+ * This is maintained by the PasswordReuseIndex.
+ *
+ * @return @c true if the password is reused
+ */
+bool Property::isReused() const
+{
+    return m_reused;
+}
+
+
+/**
+ * @brief Sets whether the same password is also used in another property.
+ *
+ * Emits passwordStrengthChanged() if the state changed.
+ *
+ * @param reused @c true if the password is reused
+ */
+void Property::setReused(bool reused)
+{
+    if (reused == m_reused)
+        return;
+
+    m_reused = reused;
+    emit passwordStrengthChanged(this);
+}
+
+
+/**
+ * @brief Marks that the password strength is being computed in the background.
+ *
+ * While the computation is pending, getPasswordStrength() does not compute the strength
+ * itself. The computation must call setPasswordStrength() or reset the state when it's
+ * cancelled.
+ *
+ * @param pending \c true if the computation has been started, \c false if it was cancelled
+ */
+void Property::setPasswordStrengthPending(bool pending)
+{
+    m_strengthPending = pending;
+}
+
+
+/**
+ * @brief Checks if the password strength is being computed in the background.
+ *
+ * @return \c true if a result of a background computation is expected
+ */
+bool Property::isPasswordStrengthPending() const
+{
+    return m_strengthPending;
+}
+
+
 /**
  * @brief Returns the type of the value.
  *
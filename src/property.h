@@ -19,26 +19,37 @@
 #include <QDomDocument>
 #include <QObject>
 #include <QTextStream>
+#include <QPointer>
 
 #include "util/securestring.h"
 #include "security/passwordchecker.h"
+#include "passwordcache.h"
 
 class TreeEntry;
+class PasswordCache;
 
 class PropertyValue
 {
     public:
         PropertyValue(const QString &string, bool storeSecure=false);
+        ~PropertyValue();
 
     public:
         void set(const QString &string, bool storeSecure=false);
-        QString get() const;
+        void setCiphertext(const QString &ciphertext, PasswordCache *cache);
+        QString get() const throw (DecryptionException);
         QString getVisible() const;
 
     private:
-        QString         m_string;
-        SecureString    m_secureString;
-        bool            m_isSecureString;
+        PropertyValue(const PropertyValue&);
+        PropertyValue& operator=(const PropertyValue&);
+
+    private:
+        QString                 m_string;
+        SecureString            m_secureString;
+        bool                    m_isSecureString;
+        QString                 m_ciphertext;
+        QPointer<PasswordCache> m_cache;
 };
 
 class Property : public QObject
@@ -69,13 +80,19 @@ class Property : public QObject
         QString getKey() const;
         void setKey(const QString& key);
 
-        QString getValue() const;
+        QString getValue() const throw (DecryptionException);
         void setValue(const QString& value);
+        void setEncryptedValue(const QString& ciphertext, PasswordCache* cache);
         QString getVisibleValue() const;
 
         PasswordStrength getPasswordStrength() throw (PasswordCheckException);
         void updatePasswordStrength() throw (PasswordCheckException);
+        void setPasswordStrength(PasswordStrength strength, double daysToCrack);
+        void setPasswordStrengthPending(bool pending);
+        bool isPasswordStrengthPending() const;
         double daysToCrack() const;
+        bool isReused() const;
+        void setReused(bool reused);
 
         Type getType() const;
         void setType(Property::Type type);
@@ -97,6 +114,7 @@ class Property : public QObject
 
     signals:
         void propertyChanged(Property* current);
+        void passwordStrengthChanged(Property* current);
 
     private:
         QString          m_key;
@@ -106,6 +124,8 @@ class Property : public QObject
         bool             m_hidden;
         PasswordStrength m_passwordStrength;
         double           m_daysToCrack;
+        bool             m_strengthPending;
+        bool             m_reused;
 };
 
 #endif // PROPERTY_H
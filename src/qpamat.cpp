@@ -20,12 +20,19 @@
 #include <QTextCodec>
 #include <QApplication>
 #include <QDir>
+#include <QFile>
+#include <QTime>
+#include <QTextStream>
 
 #include "util/platformhelpers.h"
 #include "qpamat.h"
 #include "qpamatwindow.h"
 #include "qpamatadaptor.h"
 #include "global.h"
+#include "settings.h"
+#include "datareadwriter.h"
+#include "passwordaudit.h"
+#include "passwordstrengthservice.h"
 
 /**
  * @class Qpamat
@@ -50,6 +57,8 @@ Qpamat *Qpamat::m_instance = NULL;
  */
 Qpamat::Qpamat()
     : m_qpamatWindow(NULL)
+    , m_readOnly(false)
+    , m_audit(false)
 {}
 
 /**
@@ -109,7 +118,9 @@ void Qpamat::registerDBus()
 /**
  * Parses the command line and calls the right functions.
  *
- * Call this function after creating a QApplication.
+ * This function is called before the TimeoutApplication is created because the options
+ * decide how it's created. So the options of Qt like <tt>-display</tt> are still in
+ * @p argv, unknown arguments are ignored.
  *
  * @param[in] argc the number of arguments
  * @param[in] argv an array of strings
@@ -124,6 +135,11 @@ void Qpamat::parseCommandLine(int argc, char **argv)
         } else if (string == "v" || string == "--version" || string == "-version") {
             printVersion();
             std::exit(0);
+        } else if (string == "-r" || string == "--read-only") {
+            m_readOnly = true;
+        } else if (string == "-a" || string == "--audit") {
+            m_audit = true;
+            m_readOnly = true;
         }
     }
 }
@@ -138,9 +154,109 @@ void Qpamat::printCommandlineOptions()
         << "This is QPaMaT " << VERSION_STRING << ", a password managing tool for Unix, MacOS X\n"
         << "and Windows using the Qt programming library from Trolltech.\n\n"
         << "Options: -h            prints this help\n"
+        << "         -r            opens the data file read-only\n"
+        << "         -a            checks the strength of all passwords without the GUI,\n"
+        << "                       the password is read from stdin\n"
         << std::endl;
 }
 
+/**
+ * @brief Returns whether the data file should be opened read-only.
+ *
+ * This is set with the <tt>--read-only</tt> command line option.
+ *
+ * @return @c true if the data must not be modified, @c false otherwise
+ */
+bool Qpamat::isReadOnly() const
+{
+    return m_readOnly;
+}
+
+/**
+ * @brief Returns whether the password strength audit should be run instead of the GUI.
+ *
+ * This is set with the <tt>--audit</tt> command line option, see audit().
+ *
+ * @return @c true if audit() should be called
+ */
+bool Qpamat::isAudit() const
+{
+    return m_audit;
+}
+
+/**
+ * @brief Checks the strength of all passwords in the data file.
+ *
+ * The password of the data file is read from standard input. The report is written to
+ * standard output (see PasswordAudit), the statistics and errors to standard error. The
+ * window is not created, so this works without a display if the application was created
+ * without the GUI. Data files that use a smartcard cannot be checked because reading the
+ * card needs dialogs.
+ *
+ * @return the exit code, 0 if all passwords have been checked, 1 otherwise
+ */
+int Qpamat::audit()
+{
+    QTextStream out(stdout, QIODevice::WriteOnly);
+    QTextStream log(stderr, QIODevice::WriteOnly);
+
+    const QString fileName = set().readEntry("General/Datafile");
+    if (!QFile::exists(fileName)) {
+        log << "The data file " << fileName << " does not exist." << endl;
+        return 1;
+    }
+
+    PasswordStrengthService service(set());
+    try {
+        service.prepare();
+    } catch (const PasswordCheckException& e) {
+        log << "Cannot create the password checker: " << e.what() << endl;
+        return 1;
+    }
+
+    const QString password = readPassword();
+
+    QTime timer;
+    timer.start();
+    PasswordAudit passwordAudit(service);
+    try {
+        DataReadWriter reader(0);
+        reader.readXML(password, passwordAudit);
+    } catch (const ReadWriteException& e) {
+        log << e.getMessage() << endl;
+        return 1;
+    }
+    log << "Read " << passwordAudit.count() << " passwords in " << timer.elapsed() << " ms"
+        << endl;
+
+    return passwordAudit.report(out, log) == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Reads the password of the data file from standard input.
+ *
+ * If standard input is a terminal, a prompt is printed and the input is not echoed.
+ *
+ * @return the password, without the line terminator
+ */
+QString Qpamat::readPassword()
+{
+    QTextStream in(stdin, QIODevice::ReadOnly);
+    bool terminal = PlatformHelpers::isTerminal(PlatformHelpers::FC_STDIN);
+
+    if (terminal) {
+        std::cerr << "Password: " << std::flush;
+        PlatformHelpers::setTerminalEcho(false);
+    }
+    QString password = in.readLine();
+    if (terminal) {
+        PlatformHelpers::setTerminalEcho(true);
+        std::cerr << std::endl;
+    }
+
+    return password;
+}
+
 /**
  * Prints the version of the program on stderr and exits the program.
  */
@@ -163,6 +279,22 @@ QpamatWindow *Qpamat::getWindow()
     return m_qpamatWindow.data();
 }
 
+/**
+ * @brief Returns the settings
+ *
+ * The settings don't need the window, so they can be used without the GUI.
+ *
+ * @return the settings object
+ */
+Settings& Qpamat::set()
+{
+    if (!m_settings) {
+        m_settings.reset(new Settings());
+    }
+
+    return *m_settings;
+}
+
 /**
  * @brief Returns the base path
  *
@@ -19,6 +19,7 @@
 #include <QString>
 
 class QpamatWindow;
+class Settings;
 
 class Qpamat
 {
@@ -29,14 +30,19 @@ class Qpamat
         void registerDBus();
         void parseCommandLine(int argc, char **argv);
         void printCommandlineOptions();
+        bool isReadOnly() const;
+        bool isAudit() const;
+        int audit();
 
         QpamatWindow *getWindow();
+        Settings& set();
 
     public:
         static QString basePath();
 
     protected:
         void printVersion();
+        QString readPassword();
 
     private:
         Qpamat();
@@ -47,6 +53,9 @@ class Qpamat
     private:
         Q_DISABLE_COPY(Qpamat);
         QScopedPointer<QpamatWindow> m_qpamatWindow;
+        QScopedPointer<Settings> m_settings;
+        bool m_readOnly;
+        bool m_audit;
 };
 
 #endif // QPAMAT_H
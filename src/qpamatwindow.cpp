@@ -37,14 +37,17 @@
 #include <QFont>
 #include <QEventLoop>
 #include <QCursor>
+#include <QThreadPool>
 #include <QFileDialog>
 #include <QCloseEvent>
 #include <QScopedPointer>
 
 #include "qpamatwindow.h"
+#include "qpamat.h"
 
 #include "settings.h"
 #include "datareadwriter.h"
+#include "readonlydatafile.h"
 #include "timerstatusmessage.h"
 #include "dialogs/passworddialog.h"
 #include "dialogs/newpassworddialog.h"
@@ -115,6 +118,7 @@ QpamatWindow::QpamatWindow()
     , m_tree(0)
     , m_treeContextMenu(0)
     , m_message(0)
+    , m_strengthService(Qpamat::instance()->set())
     , m_rightPanel(0)
     , m_searchCombo(0)
     , m_randomPassword(0)
@@ -125,7 +129,7 @@ QpamatWindow::QpamatWindow()
 
     // Title and Icon
     setIcon(QPixmap(":/images/qpamat_48.png"));
-    setCaption("QPaMaT");
+    setCaption(Qpamat::instance()->isReadOnly() ? tr("QPaMaT (read-only)") : QString("QPaMaT"));
 
     setIconSize(QSize(24, 24));
 
@@ -154,6 +158,7 @@ QpamatWindow::QpamatWindow()
     initActions();
     initMenubar();
     initToolbar();
+    m_actions.newAction->setEnabled(!Qpamat::instance()->isReadOnly());
 
     // display statusbar
     statusBar();
@@ -223,17 +228,47 @@ QpamatWindow::QpamatWindow()
  * @brief Deletes the application.
  */
 QpamatWindow::~QpamatWindow()
-{}
+{
+    // the password strength is computed in the thread pool with m_strengthService
+    m_tree->cancelPasswordStrength();
+    QThreadPool::globalInstance()->waitForDone();
+}
 
 
 /**
  * @brief Returns the settings object.
  *
+ * This is the same as Qpamat::set().
+ *
  * @return a reference to the object
  */
 Settings& QpamatWindow::set()
 {
-    return m_settings;
+    return Qpamat::instance()->set();
+}
+
+
+/**
+ * @brief Returns the service that computes the strength of the passwords.
+ *
+ * @return a reference to the service
+ */
+PasswordStrengthService& QpamatWindow::strengthService()
+{
+    return m_strengthService;
+}
+
+
+/**
+ * @brief Returns the index that detects reused passwords.
+ *
+ * It's active while the password strength is displayed.
+ *
+ * @return a reference to the index
+ */
+PasswordReuseIndex& QpamatWindow::reuseIndex()
+{
+    return m_reuseIndex;
 }
 
 
@@ -392,8 +427,9 @@ void QpamatWindow::closeEvent(QCloseEvent* e)
  */
 void QpamatWindow::setModified(bool modified)
 {
-    m_modified = modified;
-    m_actions.saveAction->setEnabled(modified);
+    // read-only data is never saved
+    m_modified = modified && !Qpamat::instance()->isReadOnly();
+    m_actions.saveAction->setEnabled(m_modified);
 }
 
 /**
@@ -438,21 +474,36 @@ void QpamatWindow::login()
     qDebug() << CURRENT_FUNCTION << "Calling login()";
 
     QScopedPointer<PasswordDialog> dlg(new PasswordDialog(this));
-    QDomDocument doc;
     bool ok = false;
 
     while (!ok) {
+        QString password;
         if (dlg->exec() == QDialog::Accepted)
-            m_password = dlg->getPassword();
+            password = dlg->getPassword();
         else
             return;
 
         DataReadWriter reader(this);
         while (!ok) {
             try {
-                doc = reader.readXML(m_password);
+                bool lazy = set().readBoolEntry("Security/LazyDecryption");
+                m_passwordCache.setCapacity(set().readNumEntry("Security/PlaintextCacheSize"));
+                m_passwordCache.setExpiry(set().readNumEntry("Security/PlaintextCacheExpiry"));
+
+                TreeBuilder builder(m_tree, lazy ? &m_passwordCache : 0);
+                if (Qpamat::instance()->isReadOnly())
+                    m_readOnlyFile.reset(reader.openReadOnly(password, builder));
+                if (!m_readOnlyFile)
+                    reader.readXML(password, builder, lazy ? &m_passwordCache : 0, &m_keys);
                 ok = true;
             } catch (const ReadWriteException& e) {
+                // the tree may contain a part of the data
+                m_tree->cancelPasswordStrength();
+                m_tree->clear();
+                m_readOnlyFile.reset();
+                m_passwordCache.clear();
+                m_keys.clear();
+
                 // type of the message
                 QMessageBox::Icon icon = e.getSeverity() == ReadWriteException::WARNING
                     ? QMessageBox::Warning
@@ -483,8 +534,6 @@ void QpamatWindow::login()
         }
     }
 
-    m_tree->readFromXML(doc.documentElement().namedItem("passwords").toElement());
-
     setLogin(true);
 }
 
@@ -530,9 +579,24 @@ void QpamatWindow::setLogin(bool loggedIn)
         );
     } else {
         m_actions.passwordStrengthAction->setOn(false);
+        m_tree->cancelPasswordStrength();
         m_tree->clear();
+        m_reuseIndex.clear();
         m_rightPanel->clear();
         this->setFocus();
+
+        // the entries of the tree refer to the data file and to the cache
+        m_readOnlyFile.reset();
+        m_passwordCache.clear();
+
+        // also called for the automatic logout
+        m_keys.clear();
+    }
+
+    if (loggedIn && Qpamat::instance()->isReadOnly()) {
+        m_actions.changePasswordAction->setEnabled(false);
+        m_actions.addItemAction->setEnabled(false);
+        m_actions.removeItemAction->setEnabled(false);
     }
 
     m_tree->setEnabled(loggedIn);
@@ -563,12 +627,10 @@ void QpamatWindow::save()
 bool QpamatWindow::exportOrSave()
 {
     DataReadWriter writer(this);
-    QDomDocument doc = writer.createSkeletonDocument();
-    m_tree->appendXML(doc);
     bool success = false;
     while (!success) {
         try {
-            writer.writeXML(doc, m_password);
+            writer.writeXML(*m_tree, m_keys, &m_passwordCache);
             success = true;
         } catch (const ReadWriteException& e) {
             QMessageBox::Icon icon = e.getSeverity() == ReadWriteException::WARNING
@@ -625,10 +687,22 @@ void QpamatWindow::exportData()
         set().writeEntry("General/Datafile", oldFilename);
         set().writeEntry("Smartcard/UseCard", oldCard);
     } else {
+        // nothing must be written if a password cannot be decrypted
+        QString text;
+        try {
+            QTextStream buffer(&text);
+            m_tree->appendTextForExport(buffer);
+        } catch (const DecryptionException& e) {
+            QMessageBox::warning(this, tr("QPaMaT"), tr("A password could not be decrypted, "
+                "the data is not exported:\n%1").arg(e.what()),
+                QMessageBox::Ok | QMessageBox::Default, QMessageBox::NoButton);
+            return;
+        }
+
         QFile file(fileName);
         if (file.open(QIODevice::WriteOnly)) {
             QTextStream stream(&file);
-            m_tree->appendTextForExport(stream);
+            stream << text;
             file.close();
             message(tr("Wrote data successfully."));
         } else
@@ -688,7 +762,8 @@ void QpamatWindow::newFile()
         if (m_loggedIn)
             logout();
 
-        m_password = dialog->getPassword();
+        if (!createKey(dialog->getPassword()))
+            return;
         setLogin(true);
         setModified();
     }
@@ -700,11 +775,33 @@ void QpamatWindow::newFile()
  */
 void QpamatWindow::changePassword()
 {
-    QScopedPointer<NewPasswordDialog> dlg(new NewPasswordDialog(this, m_password));
-    if (dlg->exec() == QDialog::Accepted) {
-        m_password = dlg->getPassword();
+    QScopedPointer<NewPasswordDialog> dlg(new NewPasswordDialog(this, &m_keys));
+    if (dlg->exec() == QDialog::Accepted && createKey(dlg->getPassword()))
         setModified();
+}
+
+
+/**
+ * @brief Derives the key for a new password and stores it in the session.
+ *
+ * Displays an error message if that fails, the old key is kept then.
+ *
+ * @param password the new password
+ * @return \c true on success, \c false otherwise
+ */
+bool QpamatWindow::createKey(const QString& password)
+{
+    qApp->setOverrideCursor( QCursor( Qt::WaitCursor ) );
+    try {
+        DataReadWriter::createKey(password, m_keys);
+    } catch (const ReadWriteException& e) {
+        qApp->restoreOverrideCursor();
+        QMessageBox::critical(this, "QPaMaT", e.getMessage(),
+            QMessageBox::Ok | QMessageBox::Default, QMessageBox::NoButton);
+        return false;
     }
+    qApp->restoreOverrideCursor();
+    return true;
 }
 
 
@@ -741,11 +838,14 @@ void QpamatWindow::search()
 void QpamatWindow::passwordStrengthHandler(bool enabled)
 {
     m_tree->setShowPasswordStrength(enabled);
+    m_reuseIndex.setActive(enabled);
     bool error = false;
     if (enabled) {
         m_tree->recomputePasswordStrength(&error);
         if (error)
             m_actions.passwordStrengthAction->setOn(false);
+    } else {
+        m_tree->cancelPasswordStrength();
     }
 
     if (!error) {
@@ -761,6 +861,16 @@ void QpamatWindow::passwordStrengthHandler(bool enabled)
  */
 void QpamatWindow::print()
 {
+    QString html;
+    try {
+        html = m_tree->toRichTextForPrint();
+    } catch (const DecryptionException& e) {
+        QMessageBox::warning(this, tr("QPaMaT"), tr("A password could not be decrypted, "
+            "the data is not printed:\n%1").arg(e.what()),
+            QMessageBox::Ok | QMessageBox::Default, QMessageBox::NoButton);
+        return;
+    }
+
     QPrinter printer(QPrinter::HighResolution);
     printer.setFullPage( TRUE );
     if ( printer.setup( this ) ) {
@@ -784,7 +894,7 @@ void QpamatWindow::print()
         QRectF body(margin, margin, p.device()->width() - 2*margin, p.device()->height() - 2*margin);
 
         QTextDocument* doc = new QTextDocument();
-        doc->setHtml(m_tree->toRichTextForPrint());
+        doc->setHtml(html);
         doc->setDefaultFont(serifFont);
         QAbstractTextDocumentLayout* layout = doc->documentLayout();
         layout->setPaintDevice(&printer);
@@ -883,8 +993,11 @@ void QpamatWindow::connectSignalsAndSlots()
 
     // password strength
     connect(m_actions.passwordStrengthAction, SIGNAL(toggled(bool)), SLOT(passwordStrengthHandler(bool)));
+    // the service must be invalidated before the strength is recomputed
+    connect(this, SIGNAL(settingsChanged()), &m_strengthService, SLOT(invalidate()));
     connect(this, SIGNAL(settingsChanged()), m_tree, SLOT(recomputePasswordStrength()));
-    connect(m_rightPanel, SIGNAL(passwordStrengthUpdated()), m_tree, SLOT(updatePasswordStrengthView()));
+    connect(m_rightPanel, SIGNAL(passwordStrengthUpdated()), m_tree,
+        SLOT(updateChangedPasswordStrengthView()));
 
     // edit toolbar
     connect(m_actions.addItemAction, SIGNAL(activated()), m_tree, SLOT(insertAtCurrentPos()));
@@ -29,11 +29,16 @@
 #include "settings.h"
 #include "randompassword.h"
 #include "help.h"
+#include "passwordcache.h"
+#include "passwordstrengthservice.h"
+#include "passwordreuseindex.h"
+#include "security/sessionkeystore.h"
 
 // forward declarations
 class Tree;
 class RightPanel;
 class TimerStatusmessage;
+class ReadOnlyDataFile;
 
 class QpamatWindow : public QMainWindow
 {
@@ -46,6 +51,8 @@ class QpamatWindow : public QMainWindow
         ~QpamatWindow();
 
         Settings& set();
+        PasswordStrengthService& strengthService();
+        PasswordReuseIndex& reuseIndex();
 
     public:
         static QIcon createIcon(const QString &qpamatName, const QString &freedesktopName = QString::null);
@@ -83,6 +90,7 @@ class QpamatWindow : public QMainWindow
         void initActions();
         void connectSignalsAndSlots();
         void setLogin(bool login);
+        bool createKey(const QString& password);
 
     private:
         struct Actions
@@ -112,12 +120,15 @@ class QpamatWindow : public QMainWindow
 
     private:
         QLabel*                            m_searchLabel;
-        Settings                           m_settings;
         Tree*                              m_tree;
-        QString                            m_password;
+        SessionKeyStore                    m_keys;
         Help                               m_help;
         Q3PopupMenu*                       m_treeContextMenu;
         QScopedPointer<TimerStatusmessage> m_message;
+        QScopedPointer<ReadOnlyDataFile>   m_readOnlyFile;
+        PasswordCache                      m_passwordCache;
+        PasswordStrengthService            m_strengthService;
+        PasswordReuseIndex                 m_reuseIndex;
         RightPanel*                        m_rightPanel;
         QComboBox*                         m_searchCombo;
         RandomPassword*                    m_randomPassword;
@@ -25,7 +25,7 @@
 #include "dialogs/showpassworddialog.h"
 #include "randompassword.h"
 #include "security/passwordgeneratorfactory.h"
-#include "security/hybridpasswordchecker.h"
+#include "security/passwordcheckerfactory.h"
 
 
 /**
@@ -86,7 +86,10 @@ void RandomPassword::requestPassword()
     QString allowed = win->set().readEntry("Security/AllowedCharacters");
     PasswordChecker* checker = 0;
     try {
-        checker = new HybridPasswordChecker(win->set().readEntry("Security/DictionaryFile"));
+        checker = PasswordCheckerFactory::getChecker(
+            win->set().readEntry("Security/PasswordChecker"),
+            win->set().readEntry("Security/DictionaryFile")
+        );
         passwordgen = PasswordGeneratorFactory::getGenerator(
             win->set().readEntry( "Security/PasswordGenerator" ),
             win->set().readEntry( "Security/PasswordGenAdditional" )
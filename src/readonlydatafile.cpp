@@ -0,0 +1,175 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QApplication>
+#include <QFile>
+#include <QDebug>
+
+#include "global.h"
+#include "readonlydatafile.h"
+#include "tree.h"
+
+// -------------------------------------------------------------------------------------------------
+#ifndef DOXYGEN
+
+/**
+ * @class IndexBuilder
+ *
+ * @brief DataHandler that passes the index to a TreeBuilder and tells each entry where
+ *        its properties are.
+ */
+class IndexBuilder : public DataHandler
+{
+    public:
+        IndexBuilder(TreeBuilder& builder, const BinaryDataReader& reader, PropertyLoader* loader)
+            : m_builder(builder), m_reader(reader), m_loader(loader) { }
+
+        void startCategory(const QString& name, bool wasOpen, bool isSelected)
+            { m_builder.startCategory(name, wasOpen, isSelected); }
+
+        void endCategory()
+            { m_builder.endCategory(); }
+
+        void startEntry(const QString& name, bool isSelected)
+        {
+            m_builder.startEntry(name, isSelected);
+            m_builder.setPropertyLoader(m_loader, m_reader.position());
+        }
+
+        void endEntry()
+            { m_builder.endEntry(); }
+
+        void appendProperty(const QString&, const QString&, Property::Type, bool, bool)
+            { Q_ASSERT(false); }
+
+    private:
+        TreeBuilder&            m_builder;
+        const BinaryDataReader& m_reader;
+        PropertyLoader*         m_loader;
+};
+
+#endif // DOXYGEN
+// -------------------------------------------------------------------------------------------------
+
+/**
+ * @class ReadOnlyDataFile
+ *
+ * @brief A data file in the binary format that is kept in memory for read-only access.
+ *
+ * Instead of creating all properties, only the categories and entries are put into the
+ * tree. The properties of an entry are read from memory and decrypted when the entry is
+ * used the first time, so decrypted passwords only exist for the entries that have been
+ * viewed.
+ *
+ * The file is read into private memory once and not mapped with QFile::map(). Another
+ * program could change a shared mapping after the authentication tag has been checked,
+ * then unauthenticated data would be read, and truncating the file would crash QPaMaT
+ * with SIGBUS. The copy contains only encrypted data.
+ *
+ * The authentication tag is checked over the whole file before the tree is built. So
+ * opening the file still takes time proportional to its size, only creating and
+ * decrypting the properties is saved.
+ *
+ * Smartcard files are not supported because the passwords are not in the file.
+ *
+ * The object must exist as long as the entries of the tree exist.
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @brief Reads the file into memory.
+ *
+ * @param fileName the name of the data file, it must be in the binary format
+ * @exception ReadWriteException if the file could not be opened or read
+ */
+ReadOnlyDataFile::ReadOnlyDataFile(const QString& fileName)
+    throw (ReadWriteException)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        throw ReadWriteException(QObject::tr("The file %1 could not be opened:\n%2.").
+            arg(fileName).arg(qApp->translate("QFile", file.errorString())),
+            ReadWriteException::CIOError);
+
+    // the tag is checked over this copy, so later changes of the file don't matter
+    const qint64 size = file.size();
+    QByteArray data = file.readAll();
+    if (data.size() != size)
+        throw ReadWriteException(QObject::tr("The file %1 could not be read:\n%2.").
+            arg(fileName).arg(qApp->translate("QFile", file.errorString())),
+            ReadWriteException::CIOError);
+
+    m_reader.reset(new BinaryDataReader(data, fileName));
+}
+
+
+/**
+ * @brief Frees the data.
+ */
+ReadOnlyDataFile::~ReadOnlyDataFile()
+{}
+
+
+/**
+ * @brief Reads the application data.
+ *
+ * @return the application data
+ * @exception ReadWriteException if the file is no valid binary file
+ */
+AppData ReadOnlyDataFile::readAppData()
+    throw (ReadWriteException)
+{
+    m_appData = m_reader->readAppData();
+    return m_appData;
+}
+
+
+/**
+ * @brief Checks the file and builds the tree without properties.
+ *
+ * readAppData() must be called before. The password must have been checked while
+ * creating @p encryptor.
+ *
+ * @param builder the builder for the tree
+ * @param encryptor the encryptor for the passwords, this object takes the ownership
+ * @param key the derived key, see BinaryDataReader::authenticate()
+ * @exception ReadWriteException if the file was modified or is invalid
+ */
+void ReadOnlyDataFile::readIndex(TreeBuilder& builder, SymmetricEncryptor* encryptor,
+                               const ByteSpan& key)
+    throw (ReadWriteException)
+{
+    Q_ASSERT(!m_appData.useCard);
+
+    m_encryptor.reset(encryptor);
+    m_reader->authenticate(key);
+
+    IndexBuilder indexBuilder(builder, *m_reader, this);
+    m_reader->readIndex(indexBuilder);
+}
+
+
+/**
+ * @copydoc PropertyLoader::loadProperties(quint32, DataHandler&)
+ */
+void ReadOnlyDataFile::loadProperties(quint32 offset, DataHandler& handler)
+    throw (ReadWriteException)
+{
+    Q_ASSERT(m_encryptor);
+
+    m_reader->readProperties(offset, handler, m_encryptor.data());
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
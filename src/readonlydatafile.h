@@ -0,0 +1,57 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef READONLYDATAFILE_H
+#define READONLYDATAFILE_H
+
+#include <QString>
+#include <QScopedPointer>
+
+#include "datahandler.h"
+#include "datareadwriter.h"
+#include "propertyloader.h"
+#include "binarydatareader.h"
+#include "security/symmetricencryptor.h"
+
+class TreeBuilder;
+
+class ReadOnlyDataFile : public PropertyLoader
+{
+    public:
+        ReadOnlyDataFile(const QString& fileName)
+            throw (ReadWriteException);
+        ~ReadOnlyDataFile();
+
+    public:
+        AppData readAppData()
+            throw (ReadWriteException);
+        void readIndex(TreeBuilder& builder, SymmetricEncryptor* encryptor, const ByteSpan& key)
+            throw (ReadWriteException);
+
+        void loadProperties(quint32 offset, DataHandler& handler)
+            throw (ReadWriteException);
+
+    private:
+        ReadOnlyDataFile(const ReadOnlyDataFile&);
+        ReadOnlyDataFile& operator=(const ReadOnlyDataFile&);
+
+    private:
+        QScopedPointer<BinaryDataReader>    m_reader;
+        QScopedPointer<SymmetricEncryptor>  m_encryptor;
+        AppData                             m_appData;
+};
+
+#endif // READONLYDATAFILE_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
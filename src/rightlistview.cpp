@@ -24,6 +24,7 @@
 #include <QKeyEvent>
 #include <QTextStream>
 #include <Q3PopupMenu>
+#include <QMessageBox>
 
 #include "qpamatwindow.h"
 #include "qpamat.h"
@@ -166,8 +167,11 @@ void RightListView::showContextMenu(Q3ListViewItem* item, const QPoint& point)
             break;
 
         case M_SHOW_PW:
+            QString value;
+            if (!readValue(m_currentItem->getProperty(item->text(2).toInt(0)), value))
+                break;
             ShowPasswordDialog* dlg = new ShowPasswordDialog(this, ShowPasswordDialog::TNormalPasswordDlg);
-            dlg->setPassword(m_currentItem->getProperty(item->text(2).toInt(0))->getValue());
+            dlg->setPassword(value);
             dlg->exec();
             delete dlg;
     };
@@ -221,11 +225,35 @@ void RightListView::copyItem(Q3ListViewItem* item)
 {
     if (item != 0) {
         Property* property = m_currentItem->getProperty(item->text(2).toInt(0));
+        QString value;
+        if (!readValue(property, value))
+            return;
+
         QClipboard* clip = QApplication::clipboard();
-        clip->setText(property->getValue(), QClipboard::Clipboard);
+        clip->setText(value, QClipboard::Clipboard);
 
         if (clip->supportsSelection())
-            clip->setText(property->getValue(), QClipboard::Selection);
+            clip->setText(value, QClipboard::Selection);
+    }
+}
+
+
+/**
+ * @brief Reads the value of a property and shows a warning if that's not possible.
+ *
+ * @param property the property
+ * @param value receives the value
+ * @return \c true on success, \c false if the password could not be decrypted
+ */
+bool RightListView::readValue(const Property* property, QString& value)
+{
+    try {
+        value = property->getValue();
+        return true;
+    } catch (const DecryptionException& e) {
+        QMessageBox::warning(this, "QPaMaT", tr("The password could not be decrypted:\n%1")
+            .arg(e.what()), QMessageBox::Ok, QMessageBox::NoButton);
+        return false;
     }
 }
 
@@ -239,16 +267,19 @@ void RightListView::doubleClickHandler(Q3ListViewItem* item)
 {
     if (item != 0) {
         Property* property = m_currentItem->getProperty(item->text(2).toInt(0));
-        if (property->getType() == Property::URL)
-            Help::openURL(this, property->getValue());
-        else if (property->getType() == Property::PASSWORD) {
+        QString value;
+        if (property->getType() != Property::URL && property->getType() != Property::PASSWORD) {
+            QpamatWindow *win = Qpamat::instance()->getWindow();
+            win->message(tr("Double click only supported with passwords and URLs!"));
+        } else if (!readValue(property, value))
+            return;
+        else if (property->getType() == Property::URL)
+            Help::openURL(this, value);
+        else {
             ShowPasswordDialog* dlg = new ShowPasswordDialog(this, ShowPasswordDialog::TNormalPasswordDlg);
-            dlg->setPassword(m_currentItem->getProperty(item->text(2).toInt(0))->getValue());
+            dlg->setPassword(value);
             dlg->exec();
             delete dlg;
-        } else {
-            QpamatWindow *win = Qpamat::instance()->getWindow();
-            win->message(tr("Double click only supported with passwords and URLs!"));
         }
     }
 }
@@ -306,7 +337,6 @@ void RightListView::updateSelected(Property* property)
 
     if (item != 0) {
         item->setText(0, property->getKey());
-        QString value = property->getValue();
         item->setText(1, property->getVisibleValue());
     }
 }
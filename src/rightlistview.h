@@ -73,6 +73,7 @@ class RightListView : public Q3ListView
 
     private:
         void initContextMenu();
+        bool readValue(const Property* property, QString& value);
 
     private:
         TreeEntry*  m_currentItem;
@@ -14,7 +14,6 @@
  */
 #include <QString>
 #include <QStringList>
-#include <Q3CString>
 
 #include "global.h"
 #include "abstractencryptor.h"
@@ -38,12 +37,9 @@
  */
 ByteVector AbstractEncryptor::encryptStrToBytes(const QString& string)
 {
-    Q3CString utf8CString = string.utf8();
-    unsigned int utf8Length = utf8CString.length();
-    ByteVector vector(utf8Length);
-    const unsigned char* utf8 = (const unsigned char*)utf8CString.data();
-    qCopy(utf8, utf8 + utf8Length, vector.begin());
-    return encrypt(vector);
+    const QByteArray utf8 = string.toUtf8();
+    return encrypt(ByteSpan(reinterpret_cast<const unsigned char*>(utf8.constData()),
+                            utf8.size()));
 }
 
 
@@ -59,18 +55,11 @@ QString AbstractEncryptor::encryptStrToStr(const QString& string)
 /**
  * @copydoc Encryptor::decryptStrFromBytes
  */
-QString AbstractEncryptor::decryptStrFromBytes(const ByteVector& vector)
+QString AbstractEncryptor::decryptStrFromBytes(const ByteSpan& vector)
 {
-    QString result;
-    ByteVector decrypted = decrypt(vector);
-    unsigned int size = decrypted.size();
-    char* decryptedBytes = new char[size + 1];
-    decryptedBytes[size] = 0;
-    qCopy(decrypted.begin(), decrypted.end(), decryptedBytes);
-
-    QString returnString = QString::fromUtf8(decryptedBytes);
-    delete[] decryptedBytes;
-    return returnString;
+    const ByteVector decrypted = decrypt(vector);
+    return QString::fromUtf8(reinterpret_cast<const char*>(decrypted.constData()),
+                             decrypted.size());
 }
 
 
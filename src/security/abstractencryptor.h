@@ -27,7 +27,7 @@ class AbstractEncryptor : public Encryptor
         ByteVector encryptStrToBytes(const QString& string);
         QString encryptStrToStr(const QString& string);
 
-        QString decryptStrFromBytes(const ByteVector& vector);
+        QString decryptStrFromBytes(const ByteSpan& vector);
         QString decryptStrFromStr(const QString& string);
 };
 
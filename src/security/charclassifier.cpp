@@ -0,0 +1,218 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <cstring>
+
+#include "global.h"
+#include "charclassifier.h"
+
+/**
+ * @class CharClassifier
+ *
+ * @brief Classifies characters for the password checkers with a lookup table.
+ *
+ * The classes for the characters 0 to 255 are stored in a table that is filled when the
+ * program starts, so checking a character is one memory access instead of a chain of
+ * comparisons and QChar::category() calls. Other characters are classified with the
+ * Unicode tables of Qt (classifyUnicode()).
+ *
+ * Two classifications are combined in each value:
+ *
+ *  - The classes Digit, Lowercase, Uppercase, Special, Umlaut, Other and NonLatin1
+ *    are used by the HybridPasswordChecker. Exactly one of them is set.
+ *  - LetterUppercase, LetterLowercase and NonLetter correspond to QChar::category()
+ *    and QChar::isLetter() and are used by the MasterPasswordChecker.
+ *
+ * @ingroup security
+ */
+
+/**
+ * @enum CharClassifier::Class
+ *
+ * @brief The classes, the values are bit masks.
+ */
+
+/**
+ * @var CharClassifier::Digit
+ * The digits and the space.
+ */
+
+/**
+ * @var CharClassifier::Lowercase
+ * The letters <tt>a</tt> to <tt>z</tt>.
+ */
+
+/**
+ * @var CharClassifier::Uppercase
+ * The letters <tt>A</tt> to <tt>Z</tt>.
+ */
+
+/**
+ * @var CharClassifier::Special
+ * The punctuation characters of a keyboard.
+ */
+
+/**
+ * @var CharClassifier::Umlaut
+ * The Latin-1 characters 0xC0 to 0xFF without 0xD7.
+ */
+
+/**
+ * @var CharClassifier::Other
+ * All other Latin-1 characters.
+ */
+
+/**
+ * @var CharClassifier::NonLatin1
+ * The characters that are not in Latin-1 and the null character.
+ */
+
+/**
+ * @var CharClassifier::LetterUppercase
+ * QChar::Letter_Uppercase
+ */
+
+/**
+ * @var CharClassifier::LetterLowercase
+ * QChar::Letter_Lowercase
+ */
+
+/**
+ * @var CharClassifier::NonLetter
+ * QChar::isLetter() is \c false.
+ */
+
+/**
+ * @fn CharClassifier::classify(QChar)
+ *
+ * @brief Returns the classes of a character.
+ *
+ * @param c the character
+ * @return the combination of the Class values
+ */
+
+unsigned short CharClassifier::s_latin1[0x100];
+
+#ifndef DOXYGEN
+
+/**
+ * @brief Fills CharClassifier::s_latin1 when the program starts.
+ */
+class CharClassifierInit
+{
+    public:
+        CharClassifierInit();
+};
+
+CharClassifierInit::CharClassifierInit()
+{
+    static const char special[] = ",.-;:_=()*+?\"$@#%&/\\{}[]!^'`~";
+
+    for (int i = 0; i < 0x100; ++i) {
+        unsigned short value;
+        if (i == 0)
+            value = CharClassifier::NonLatin1;
+        else if ((i >= '0' && i <= '9') || i == ' ')
+            value = CharClassifier::Digit;
+        else if (i >= 'a' && i <= 'z')
+            value = CharClassifier::Lowercase;
+        else if (i >= 'A' && i <= 'Z')
+            value = CharClassifier::Uppercase;
+        else if (std::strchr(special, i))
+            value = CharClassifier::Special;
+        else if ((i >= 0xC0 && i <= 0xD6) || (i >= 0xD8 && i <= 0xFF))
+            value = CharClassifier::Umlaut;
+        else
+            value = CharClassifier::Other;
+
+        CharClassifier::s_latin1[i] = value | (CharClassifier::classifyUnicode(QChar(i)) & ~0xff);
+    }
+}
+
+static CharClassifierInit charClassifierInit;
+
+#endif // DOXYGEN
+
+
+/**
+ * @brief Classifies a character with the Unicode tables.
+ *
+ * This is used for the characters outside of Latin-1, the result for these characters
+ * contains NonLatin1.
+ *
+ * @param c the character
+ * @return the combination of the Class values
+ */
+unsigned int CharClassifier::classifyUnicode(QChar c)
+{
+    unsigned int value = NonLatin1;
+
+    QChar::Category category = c.category();
+    if (category == QChar::Letter_Uppercase)
+        value |= LetterUppercase;
+    else if (category == QChar::Letter_Lowercase)
+        value |= LetterLowercase;
+    else if (!c.isLetter())
+        value |= NonLetter;
+
+    return value;
+}
+
+
+/**
+ * @brief Returns the size of the character set that the characters of @p chars are from.
+ *
+ * This is the estimation of HybridPasswordChecker: digits (and the space) count 11,
+ * lowercase and uppercase letters 26 each, umlauts 13, special characters 30 and other
+ * characters 118. If @p chars contains characters that are not in Latin-1, 255 is
+ * returned.
+ *
+ * A class that occurs a second time is counted as "other". That's what the former
+ * implementation in HybridPasswordChecker did and the strength of existing passwords
+ * must not change.
+ *
+ * @param chars the characters
+ * @return the size of the character set
+ */
+int CharClassifier::charsetSize(const QString& chars)
+{
+    const QChar* data = chars.unicode();
+    const int length = chars.length();
+    unsigned int seen = 0;
+
+    for (int i = 0; i < length; ++i) {
+        unsigned int cls = classify(data[i]);
+        if (cls & NonLatin1)
+            return 255;
+        seen |= (cls & seen) ? unsigned(Other) : (cls & 0xff);
+    }
+
+    int ret = 0;
+    if (seen & Digit)
+        ret += 11;
+    if (seen & Lowercase)
+        ret += 26;
+    if (seen & Uppercase)
+        ret += 26;
+    if (seen & Umlaut)
+        ret += 13;
+    if (seen & Special)
+        ret += 30;
+    if (seen & Other)
+        ret += 118;
+
+    return ret;
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,56 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef CHARCLASSIFIER_H
+#define CHARCLASSIFIER_H
+
+#include <QChar>
+#include <QString>
+
+class CharClassifier
+{
+    friend class CharClassifierInit;
+
+    public:
+        enum Class {
+            Digit               = 0x0001,
+            Lowercase           = 0x0002,
+            Uppercase           = 0x0004,
+            Special             = 0x0008,
+            Umlaut              = 0x0010,
+            Other               = 0x0020,
+            NonLatin1           = 0x0040,
+
+            LetterUppercase     = 0x0100,
+            LetterLowercase     = 0x0200,
+            NonLetter           = 0x0400
+        };
+
+    public:
+        static inline unsigned int classify(QChar c)
+        {
+            const ushort u = c.unicode();
+            return u < 0x100 ? s_latin1[u] : classifyUnicode(c);
+        }
+
+        static unsigned int classifyUnicode(QChar c);
+        static int charsetSize(const QString& chars);
+
+    private:
+        static unsigned short s_latin1[0x100];
+};
+
+#endif // CHARCLASSIFIER_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -17,6 +17,7 @@
 
 #include "global.h"
 #include "collectencryptor.h"
+#include "encodinghelper.h"
 
 /**
  * @class CollectEncryptor
@@ -30,26 +31,39 @@
  *
  * In encrypt mode the CollectEncryptor takes a string, encrypts it and appends the
  * encrypted value in the byte vector. At the beginning, the vector is empty. The return
- * value of the CollectEncryptor::encryptString() method is a string like following: \c
- * SMARTCARD:0:27.  The first number after the colon indicates the offset in which the
- * encrypted bytes are stored in the byte array. The first string gets the offset \c 0, of
- * course. The second number is the length, i.e. the number of bytes. This means that the
- * byte vector now has a length of \c 27 bytes.
+ * value of the CollectEncryptor::encryptStrToStr() method is a reference to the encrypted
+ * bytes: the offset in the byte vector and the length, both as 16 bit big endian number,
+ * encoded in Base 64. The first string gets the offset \c 0, of course. Call reserve()
+ * before to avoid that the vector is reallocated while the passwords are encrypted.
  *
- * In decrypt mode the CollectEncryptor does the opposite. It gets a string of the form \c
- * SMARTCARD:o:l, takes the bytes according to this specification from the byte array
- * (which must be set previously!) and tries to decrypt the value.
+ * Older versions returned a string like \c SMARTCARD:0:27 instead, where the first number
+ * is the offset and the second number is the length. Such references are still accepted
+ * when decrypting.
+ *
+ * In decrypt mode the CollectEncryptor does the opposite. It gets a reference, takes the
+ * bytes according to this specification from the byte array (which must be set
+ * previously!) and tries to decrypt the value. The bytes are not copied for that.
  *
  * @ingroup security
  * @author Bernhard Walle
  */
 
+/**
+ * @brief Number of bytes of a reference before it is encoded.
+ */
+const int CollectEncryptor::REFERENCE_SIZE = 4;
+
+/**
+ * @brief Prefix of the references that were written by older versions.
+ */
+const char CollectEncryptor::LEGACY_PREFIX[] = "SMARTCARD:";
+
 /**
  * @brief Creates a new instance of a CollectEncryptor object.
  *
  * @param encryptor the real encrytor used for encrypting
  */
-CollectEncryptor::CollectEncryptor(Encryptor& encryptor)
+CollectEncryptor::CollectEncryptor(SymmetricEncryptor& encryptor)
     : m_realEncryptor(encryptor)
 {}
 
@@ -59,12 +73,11 @@ CollectEncryptor::CollectEncryptor(Encryptor& encryptor)
  */
 QString CollectEncryptor::encryptStrToStr(const QString& string)
 {
-    ByteVector vec = m_realEncryptor.encryptStrToBytes(string);
-
-    int oldSize = m_bytes.size();
-    m_bytes.resize(oldSize + vec.size());
-    qCopy(vec.begin(), vec.end(), m_bytes.begin() + oldSize);
-    return QString("SMARTCARD:%1:%2").arg(QString::number(oldSize), QString::number(vec.size()));
+    const QByteArray utf8 = string.toUtf8();
+    const int offset = m_bytes.size();
+    m_realEncryptor.appendEncrypted(ByteSpan(reinterpret_cast<const unsigned char*>(
+        utf8.constData()), utf8.size()), m_bytes);
+    return createReference(offset, m_bytes.size() - offset);
 }
 
 
@@ -77,59 +90,133 @@ QString CollectEncryptor::encryptStrToStr(const QString& string)
 QString CollectEncryptor::decryptStrFromStr(const QString& string)
         throw (std::invalid_argument, std::range_error)
 {
-    QStringList list = QStringList::split(":", string);
-    if (list.size() != 3) {
-        throw std::invalid_argument("CollectEncryptor::decryptStrFromStr: string does not contain "
-            "3 fields separated with \":\"");
-    }
-    if (list[0] != "SMARTCARD") {
-        throw std::invalid_argument("CollectEncryptor::decryptStrFromStr: list[0] != "
-            "\"SMARTCARD\"");
-    }
-
-    bool ok;
-    int offset = list[1].toUInt(&ok);
-    if (!ok) {
-        throw std::invalid_argument("CollectEncryptor::decryptStrFromStr: list[1] is not a "
-            "positive integer");
-    }
-
-    int length = list[2].toUInt(&ok);
-    if (!ok) {
-        throw std::invalid_argument("CollectEncryptor::decryptStrFromStr: list[1] is not a "
-            "positive integer");
-    }
+    int offset, length;
+    parseReference(string, offset, length);
 
     if (m_bytes.size() < offset + length) {
         throw std::invalid_argument(QString("CollectEncryptor::decryptStrFromStr: m_bytes is too "
-            "small for the requested bytes: offset = %1, length = %d\n").arg(offset, length)
+            "small for the requested bytes: offset = %1, length = %2\n").arg(offset).arg(length)
             .latin1());
     }
 
-    ByteVector vec(length);
-    ByteVector::iterator beg = m_bytes.begin() + offset;
-    qCopy(beg, beg + length, vec.begin());
-    return m_realEncryptor.decryptStrFromBytes(vec);
+    return m_realEncryptor.decryptStrFromBytes(m_bytes.mid(offset, length));
 }
 
 
 /**
- * Sets the stored bytes.
+ * @brief Reserves space for @p size encrypted bytes.
+ *
+ * Use SymmetricEncryptor::maximumEncryptedSize() to get the size for each password.
+ *
+ * @param size the number of bytes
+ */
+void CollectEncryptor::reserve(int size)
+{
+    m_bytes.reserve(size);
+}
+
+
+/**
+ * Exchanges the stored bytes with @p vector.
+ *
+ * This is used to hand the bytes over to the smartcard and back without copying them.
  *
  * \param vector the bytes
  */
-void CollectEncryptor::setBytes(const ByteVector& vector)
+void CollectEncryptor::swapBytes(ByteVector& vector)
 {
-    m_bytes = vector;
+    m_bytes.swap(vector);
 }
 
 
 /**
  * Gets the stored bytes.
  */
-ByteVector CollectEncryptor::getBytes()
+const ByteVector& CollectEncryptor::getBytes() const
 {
     return m_bytes;
 }
 
+
+/**
+ * @brief Creates the reference for the bytes at @p offset.
+ *
+ * The card stores the number of bytes in 16 bit, so the legacy form is only used if the
+ * numbers don't fit in that.
+ *
+ * @param offset the offset in the byte vector
+ * @param length the number of bytes
+ * @return the reference
+ */
+QString CollectEncryptor::createReference(int offset, int length)
+{
+    if (offset > 0xFFFF || length > 0xFFFF)
+        return QString(LEGACY_PREFIX + QString("%1:%2")).arg(offset).arg(length);
+
+    const unsigned char bytes[REFERENCE_SIZE] = {
+        (unsigned char)(offset >> 8), (unsigned char)(offset & 0xFF),
+        (unsigned char)(length >> 8), (unsigned char)(length & 0xFF)
+    };
+    return EncodingHelper::toBase64(ByteSpan(bytes, REFERENCE_SIZE));
+}
+
+
+/**
+ * @brief Gets offset and length from a reference that was created by createReference().
+ *
+ * @param string the reference, either Base 64 or the legacy form
+ * @param offset the offset in the byte vector
+ * @param length the number of bytes
+ * @exception std::invalid_argument if the argument is not of the specified form
+ */
+void CollectEncryptor::parseReference(const QString& string, int& offset, int& length)
+        throw (std::invalid_argument)
+{
+    // four bytes are six Base 64 characters and two padding characters
+    if (string.length() == 8 && string[6] == QLatin1Char('=') && string[7] == QLatin1Char('=')) {
+        const QChar* in = string.unicode();
+        quint64 bits = 0;
+        for (int i = 0; i < 6; ++i) {
+            const ushort u = in[i].unicode();
+            const int value = u < 0x100 ? EncodingHelper::reverseBase64Alphabet[u] : -1;
+            if (value < 0) {
+                throw std::invalid_argument("CollectEncryptor::decryptStrFromStr: "
+                    "invalid character in the reference");
+            }
+            bits = (bits << 6) | value;
+        }
+        if (bits & 0xF) {
+            throw std::invalid_argument("CollectEncryptor::decryptStrFromStr: "
+                "reference is not in canonical form");
+        }
+
+        offset = int(bits >> 20);
+        length = int((bits >> 4) & 0xFFFF);
+        return;
+    }
+
+    QStringList list = QStringList::split(":", string);
+    if (list.size() != 3) {
+        throw std::invalid_argument("CollectEncryptor::decryptStrFromStr: string does not contain "
+            "3 fields separated with \":\"");
+    }
+    if (list[0] != "SMARTCARD") {
+        throw std::invalid_argument("CollectEncryptor::decryptStrFromStr: list[0] != "
+            "\"SMARTCARD\"");
+    }
+
+    bool ok;
+    offset = list[1].toUInt(&ok);
+    if (!ok) {
+        throw std::invalid_argument("CollectEncryptor::decryptStrFromStr: list[1] is not a "
+            "positive integer");
+    }
+
+    length = list[2].toUInt(&ok);
+    if (!ok) {
+        throw std::invalid_argument("CollectEncryptor::decryptStrFromStr: list[2] is not a "
+            "positive integer");
+    }
+}
+
 // vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -21,23 +21,33 @@
 #include <QStringList>
 
 #include "global.h"
-#include "encryptor.h"
+#include "symmetricencryptor.h"
 
 class CollectEncryptor : public StringEncryptor
 {
     public:
-        CollectEncryptor(Encryptor& encryptor);
+        static const int REFERENCE_SIZE;
+        static const char LEGACY_PREFIX[];
+
+    public:
+        CollectEncryptor(SymmetricEncryptor& encryptor);
 
         QString encryptStrToStr(const QString& string);
         QString decryptStrFromStr(const QString& string)
             throw (std::invalid_argument, std::range_error);
 
-        void setBytes(const ByteVector& vector);
-        ByteVector getBytes();
+        void reserve(int size);
+        void swapBytes(ByteVector& vector);
+        const ByteVector& getBytes() const;
+
+    private:
+        static QString createReference(int offset, int length);
+        static void parseReference(const QString& string, int& offset, int& length)
+            throw (std::invalid_argument);
 
     private:
-        Encryptor&  m_realEncryptor;
-        ByteVector  m_bytes;
+        SymmetricEncryptor& m_realEncryptor;
+        ByteVector          m_bytes;
 };
 
 #endif // COLLECTENCRYPTOR_H
@@ -0,0 +1,267 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QDebug>
+#include <QtEndian>
+
+#include "global.h"
+#include "dictionaryindex.h"
+
+/**
+ * @class DictionaryIndex
+ *
+ * @brief A precompiled dictionary that is mapped into memory.
+ *
+ * Reading a dictionary text file creates one QString per word. The index contains the words
+ * in a form that can be used directly from a mapping of the file, so opening a dictionary
+ * costs almost nothing and the pages are shared between all processes that use it.
+ *
+ * The index is created with <tt>util/build_dictindex.pl</tt> from a dictionary text file
+ * in ISO-8859-1, the same encoding that HybridPasswordChecker uses to read the text file.
+ * It's stored next to the text file with the additional suffix <tt>.idx</tt>, see
+ * indexFileName(). All numbers are 32 bit little-endian integers:
+ *
+ *   - the header: MAGIC (8 bytes), VERSION, the number of words @e n, the length of the
+ *     longest word @e m and the number of UTF-16 code units in the string pool
+ *   - @e m + 1 length buckets: the index of the first word with the given length or
+ *     <tt>0xffffffff</tt> if there is no such word
+ *   - @e n + 1 offsets of the words in the string pool, in code units
+ *   - the string pool, the case-folded words in UTF-16LE
+ *
+ * The words are sorted by descending length like the dictionary text files, words with
+ * only one character are left out.
+ *
+ * The index is only used on little-endian machines. On other machines, open() fails
+ * and the text file is read.
+ *
+ * @ingroup security
+ */
+
+/**
+ * @brief The first eight bytes of an index file.
+ */
+const char DictionaryIndex::MAGIC[] = "QPAMATDX";
+
+/**
+ * @brief The version of the index format.
+ */
+const quint32 DictionaryIndex::VERSION = 1;
+
+namespace {
+
+const int HEADER_FIELDS = 6; // MAGIC counts as two
+
+} // end anonymous namespace
+
+/**
+ * @brief Creates a DictionaryIndex that is not open.
+ */
+DictionaryIndex::DictionaryIndex()
+    : m_map(0)
+    , m_wordCount(0)
+    , m_maxLength(0)
+    , m_buckets(0)
+    , m_offsets(0)
+    , m_pool(0)
+{}
+
+
+/**
+ * @brief Removes the mapping.
+ */
+DictionaryIndex::~DictionaryIndex()
+{
+    close();
+}
+
+
+/**
+ * @brief Maps and checks an index file.
+ *
+ * @param fileName the name of the index file
+ * @return @c true on success, @c false if the file cannot be mapped or is not a valid
+ *         index. Then the index is closed.
+ */
+bool DictionaryIndex::open(const QString& fileName)
+{
+    close();
+
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian)
+        return false;
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    qint64 size = m_file.size();
+    if (size < qint64(HEADER_FIELDS * sizeof(quint32)) || size > 0x7fffffff) {
+        close();
+        return false;
+    }
+
+    m_map = m_file.map(0, size);
+    if (!m_map || qstrncmp(reinterpret_cast<const char*>(m_map), MAGIC, 8) != 0) {
+        close();
+        return false;
+    }
+
+    const quint32* header = reinterpret_cast<const quint32*>(m_map);
+    quint32 version = qFromLittleEndian(header[2]);
+    m_wordCount = qFromLittleEndian(header[3]);
+    m_maxLength = qFromLittleEndian(header[4]);
+    quint32 poolSize = qFromLittleEndian(header[5]);
+
+    // all sizes in 32 bit words, computed in 64 bit so that nothing can overflow
+    quint64 expected = quint64(HEADER_FIELDS) + m_maxLength + 1 + m_wordCount + 1;
+    expected = expected * sizeof(quint32) + quint64(poolSize) * sizeof(QChar);
+    if (version != VERSION || expected != quint64(size)) {
+        qDebug() << CURRENT_FUNCTION << "Invalid dictionary index" << fileName;
+        close();
+        return false;
+    }
+
+    m_buckets = header + HEADER_FIELDS;
+    m_offsets = m_buckets + m_maxLength + 1;
+    m_pool = reinterpret_cast<const QChar*>(m_offsets + m_wordCount + 1);
+
+    // the offsets must be ascending and inside the pool
+    quint32 last = 0;
+    for (quint32 i = 0; i <= m_wordCount; ++i) {
+        if (m_offsets[i] < last || m_offsets[i] > poolSize) {
+            qDebug() << CURRENT_FUNCTION << "Invalid offsets in" << fileName;
+            close();
+            return false;
+        }
+        last = m_offsets[i];
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Removes the mapping and closes the file.
+ */
+void DictionaryIndex::close()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+    m_file.close();
+
+    m_map = 0;
+    m_wordCount = 0;
+    m_maxLength = 0;
+    m_buckets = 0;
+    m_offsets = 0;
+    m_pool = 0;
+}
+
+
+/**
+ * @brief Checks if an index is mapped.
+ *
+ * @return @c true if open() was successful
+ */
+bool DictionaryIndex::isOpen() const
+{
+    return m_map != 0;
+}
+
+
+/**
+ * @brief Returns the number of words.
+ *
+ * @return the number of words, 0 if the index is not open
+ */
+int DictionaryIndex::wordCount() const
+{
+    return m_wordCount;
+}
+
+
+/**
+ * @brief Returns the length of the longest word.
+ *
+ * @return the length in UTF-16 code units
+ */
+int DictionaryIndex::maxLength() const
+{
+    return m_maxLength;
+}
+
+
+/**
+ * @brief Returns the index of the first word with @p length characters.
+ *
+ * @param length the length
+ * @return the index or -1 if there's no such word
+ */
+int DictionaryIndex::lengthBegin(int length) const
+{
+    if (length < 0 || length > int(m_maxLength) || m_buckets[length] == 0xffffffff)
+        return -1;
+    return m_buckets[length];
+}
+
+
+/**
+ * @brief Returns the length of a word.
+ *
+ * @param index the index of the word, must be less than wordCount()
+ * @return the length in UTF-16 code units
+ */
+int DictionaryIndex::wordLength(int index) const
+{
+    return m_offsets[index + 1] - m_offsets[index];
+}
+
+
+/**
+ * @brief Returns the characters of a word.
+ *
+ * The data points into the mapping and is not null-terminated.
+ *
+ * @param index the index of the word, must be less than wordCount()
+ * @return the first character
+ */
+const QChar* DictionaryIndex::wordData(int index) const
+{
+    return m_pool + m_offsets[index];
+}
+
+
+/**
+ * @brief Returns a copy of a word.
+ *
+ * @param index the index of the word, must be less than wordCount()
+ * @return the word
+ */
+QString DictionaryIndex::word(int index) const
+{
+    return QString(wordData(index), wordLength(index));
+}
+
+
+/**
+ * @brief Returns the name of the index that belongs to a dictionary text file.
+ *
+ * @param dictFileName the name of the text file
+ * @return the file name with the suffix <tt>.idx</tt>
+ */
+QString DictionaryIndex::indexFileName(const QString& dictFileName)
+{
+    return dictFileName + ".idx";
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,63 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef DICTIONARYINDEX_H
+#define DICTIONARYINDEX_H
+
+#include <QFile>
+#include <QString>
+
+class DictionaryIndex
+{
+    public:
+        static const char MAGIC[];
+        static const quint32 VERSION;
+
+    public:
+        DictionaryIndex();
+        ~DictionaryIndex();
+
+    public:
+        bool open(const QString& fileName);
+        void close();
+        bool isOpen() const;
+
+        int wordCount() const;
+        int maxLength() const;
+        int lengthBegin(int length) const;
+
+        int wordLength(int index) const;
+        const QChar* wordData(int index) const;
+        QString word(int index) const;
+
+    public:
+        static QString indexFileName(const QString& dictFileName);
+
+    private:
+        DictionaryIndex(const DictionaryIndex&);
+        DictionaryIndex& operator=(const DictionaryIndex&);
+
+    private:
+        QFile           m_file;
+        uchar*          m_map;
+        quint32         m_wordCount;
+        quint32         m_maxLength;
+        const quint32*  m_buckets;
+        const quint32*  m_offsets;
+        const QChar*    m_pool;
+};
+
+#endif // DICTIONARYINDEX_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,354 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QQueue>
+
+#include "dictionarymatcher.h"
+#include "dictionaryindex.h"
+
+/**
+ * @class DictionaryMatcher
+ *
+ * @brief Finds the longest dictionary word in a string.
+ *
+ * The words are compiled into an Aho-Corasick automaton. Then all words that occur in a
+ * string are found in one pass over the string, no matter how large the dictionary is.
+ * The comparison is case-insensitive like <tt>QString::contains(word, false)</tt>. The words
+ * are case-folded once while the automaton is built.
+ *
+ * If several words have the maximum length, the one with the lowest index wins. This is
+ * the first word found by a linear scan over a dictionary that is sorted by length.
+ *
+ * findAllWords() reports every word that occurs, that's what the PatternPasswordChecker
+ * needs.
+ *
+ * @ingroup security
+ */
+
+/**
+ * @brief Creates an empty matcher that finds nothing.
+ */
+DictionaryMatcher::DictionaryMatcher()
+{
+    clear();
+}
+
+
+/**
+ * @brief Builds the automaton from @p words.
+ *
+ * The old contents is replaced.
+ *
+ * @param words the dictionary words, findLongestWord() returns indexes in this vector
+ * @param minLength words that are shorter are ignored
+ */
+void DictionaryMatcher::build(const StringVector& words, int minLength)
+{
+    clear();
+    m_lengths.resize(words.size());
+
+    for (int i = 0; i < int(words.size()); ++i) {
+        const QString& word = words[i];
+        m_lengths[i] = word.length();
+        if (word.length() >= minLength)
+            addWord(i, word.unicode(), word.length());
+    }
+
+    link();
+    countLengths();
+}
+
+
+/**
+ * @brief Builds the automaton from a mapped DictionaryIndex.
+ *
+ * No QString is created for the words.
+ *
+ * @param index the index, findLongestWord() returns indexes of its words
+ * @param minLength words that are shorter are ignored
+ */
+void DictionaryMatcher::build(const DictionaryIndex& index, int minLength)
+{
+    clear();
+    m_lengths.resize(index.wordCount());
+
+    for (int i = 0; i < index.wordCount(); ++i) {
+        m_lengths[i] = index.wordLength(i);
+        if (m_lengths[i] >= minLength)
+            addWord(i, index.wordData(i), m_lengths[i]);
+    }
+
+    link();
+    countLengths();
+}
+
+
+/**
+ * @brief Removes all words.
+ */
+void DictionaryMatcher::clear()
+{
+    m_nodes.clear();
+    m_lengths.clear();
+    m_lengthCounts.clear();
+
+    Node root;
+    root.firstChild = -1;
+    root.nextSibling = -1;
+    root.fail = 0;
+    root.word = -1;
+    root.own = -1;
+    root.output = -1;
+    root.c = 0;
+    m_nodes.append(root);
+}
+
+
+/**
+ * @brief Checks if the matcher contains any word.
+ *
+ * @return @c true if build() was not called or the dictionary was empty
+ */
+bool DictionaryMatcher::isEmpty() const
+{
+    return m_nodes.size() <= 1;
+}
+
+
+/**
+ * @brief Finds the longest word that occurs in @p text.
+ *
+ * @param text the text, normally a password
+ * @return the index of the word in the vector passed to build() or -1 if no word occurs
+ */
+int DictionaryMatcher::findLongestWord(const QString& text) const
+{
+    int best = -1;
+    int node = 0;
+
+    for (int i = 0; i < text.length(); ++i) {
+        ushort c = text[i].toCaseFolded().unicode();
+
+        int next = child(node, c);
+        while (next < 0 && node != 0) {
+            node = m_nodes[node].fail;
+            next = child(node, c);
+        }
+        node = next >= 0 ? next : 0;
+
+        if (isBetter(m_nodes[node].word, best))
+            best = m_nodes[node].word;
+    }
+
+    return best;
+}
+
+
+/**
+ * @brief Finds all words that occur in @p text.
+ *
+ * Unlike findLongestWord() this also reports words that overlap or that are contained in
+ * a longer word, so the caller can decide which of them explain the text best. The
+ * matches are ordered by their end position. Of duplicate words only the first one is
+ * reported.
+ *
+ * @param text the text, normally a password
+ * @param matches the matches are appended here
+ */
+void DictionaryMatcher::findAllWords(const QString& text, QVector<Match>& matches) const
+{
+    int node = 0;
+
+    for (int i = 0; i < text.length(); ++i) {
+        ushort c = text[i].toCaseFolded().unicode();
+
+        int next = child(node, c);
+        while (next < 0 && node != 0) {
+            node = m_nodes[node].fail;
+            next = child(node, c);
+        }
+        node = next >= 0 ? next : 0;
+
+        int out = m_nodes[node].own >= 0 ? node : m_nodes[node].output;
+        while (out > 0) {
+            Match match;
+            match.word = m_nodes[out].own;
+            match.length = m_lengths[match.word];
+            match.begin = i + 1 - match.length;
+            matches.append(match);
+            out = m_nodes[out].output;
+        }
+    }
+}
+
+
+/**
+ * @brief Returns the number of words with @p length characters.
+ *
+ * Words that were ignored because of the minimum length in build() are counted, too.
+ *
+ * @param length the length
+ * @return the number of words
+ */
+int DictionaryMatcher::wordsOfLength(int length) const
+{
+    if (length < 0 || length >= m_lengthCounts.size())
+        return 0;
+    return m_lengthCounts[length];
+}
+
+
+/**
+ * @brief Adds a word to the trie.
+ *
+ * @param index the index of the word
+ * @param word the characters, they are case-folded here
+ * @param length the number of characters
+ */
+void DictionaryMatcher::addWord(int index, const QChar* word, int length)
+{
+    if (length == 0)
+        return;
+
+    int node = 0;
+    for (int j = 0; j < length; ++j) {
+        ushort c = word[j].toCaseFolded().unicode();
+        int next = child(node, c);
+        node = next >= 0 ? next : addChild(node, c);
+    }
+
+    // duplicates: keep the first word
+    if (m_nodes[node].word < 0) {
+        m_nodes[node].word = index;
+        m_nodes[node].own = index;
+    }
+}
+
+
+/**
+ * @brief Computes the failure links after all words have been added.
+ */
+void DictionaryMatcher::link()
+{
+    // breadth-first so that the fail node of each node is complete
+    QQueue<int> queue;
+    for (int c = m_nodes[0].firstChild; c >= 0; c = m_nodes[c].nextSibling) {
+        m_nodes[c].fail = 0;
+        queue.enqueue(c);
+    }
+
+    while (!queue.isEmpty()) {
+        int node = queue.dequeue();
+
+        for (int c = m_nodes[node].firstChild; c >= 0; c = m_nodes[c].nextSibling) {
+            ushort ch = m_nodes[c].c;
+
+            int fail = m_nodes[node].fail;
+            int next = child(fail, ch);
+            while (next < 0 && fail != 0) {
+                fail = m_nodes[fail].fail;
+                next = child(fail, ch);
+            }
+            m_nodes[c].fail = next >= 0 ? next : 0;
+
+            const Node& failNode = m_nodes[m_nodes[c].fail];
+            m_nodes[c].output = failNode.own >= 0 ? m_nodes[c].fail : failNode.output;
+
+            // a word that ends at the fail node also ends here
+            int failWord = m_nodes[m_nodes[c].fail].word;
+            if (isBetter(failWord, m_nodes[c].word))
+                m_nodes[c].word = failWord;
+
+            queue.enqueue(c);
+        }
+    }
+
+    m_nodes.squeeze();
+}
+
+
+/**
+ * @brief Counts the words per length for wordsOfLength().
+ */
+void DictionaryMatcher::countLengths()
+{
+    int maxLength = 0;
+    for (int i = 0; i < m_lengths.size(); ++i)
+        maxLength = qMax(maxLength, m_lengths[i]);
+
+    m_lengthCounts.fill(0, maxLength + 1);
+    for (int i = 0; i < m_lengths.size(); ++i)
+        ++m_lengthCounts[m_lengths[i]];
+}
+
+
+/**
+ * @brief Returns the child of @p node for the character @p c.
+ *
+ * @param node the node
+ * @param c the case-folded character
+ * @return the child or -1 if there's none
+ */
+int DictionaryMatcher::child(int node, ushort c) const
+{
+    for (int n = m_nodes[node].firstChild; n >= 0; n = m_nodes[n].nextSibling)
+        if (m_nodes[n].c == c)
+            return n;
+    return -1;
+}
+
+
+/**
+ * @brief Appends a new child to @p node.
+ *
+ * @param node the parent
+ * @param c the case-folded character
+ * @return the new node
+ */
+int DictionaryMatcher::addChild(int node, ushort c)
+{
+    Node n;
+    n.firstChild = -1;
+    n.nextSibling = m_nodes[node].firstChild;
+    n.fail = 0;
+    n.word = -1;
+    n.own = -1;
+    n.output = -1;
+    n.c = c;
+    m_nodes.append(n);
+
+    int index = m_nodes.size() - 1;
+    m_nodes[node].firstChild = index;
+    return index;
+}
+
+
+/**
+ * @brief Checks whether @p word is a better match than @p other.
+ *
+ * @param word the index of a word or -1
+ * @param other the index of a word or -1
+ * @return @c true if @p word is longer or has the same length and a lower index
+ */
+bool DictionaryMatcher::isBetter(int word, int other) const
+{
+    if (word < 0)
+        return false;
+    if (other < 0)
+        return true;
+    return m_lengths[word] > m_lengths[other]
+        || (m_lengths[word] == m_lengths[other] && word < other);
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,76 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef DICTIONARYMATCHER_H
+#define DICTIONARYMATCHER_H
+
+#include <QString>
+#include <QVector>
+
+#include "global.h"
+
+class DictionaryIndex;
+
+class DictionaryMatcher
+{
+    public:
+        struct Match
+        {
+            int     begin;
+            int     length;
+            int     word;
+        };
+
+    public:
+        DictionaryMatcher();
+
+    public:
+        void build(const StringVector& words, int minLength = 1);
+        void build(const DictionaryIndex& index, int minLength = 1);
+        void clear();
+        bool isEmpty() const;
+
+        int findLongestWord(const QString& text) const;
+        void findAllWords(const QString& text, QVector<Match>& matches) const;
+        int wordsOfLength(int length) const;
+
+    private:
+        void addWord(int index, const QChar* word, int length);
+        void link();
+        void countLengths();
+        int child(int node, ushort c) const;
+        int addChild(int node, ushort c);
+        bool isBetter(int word, int other) const;
+
+    private:
+        struct Node
+        {
+            int     firstChild;
+            int     nextSibling;
+            int     fail;
+            int     word;       // the best word that ends here (also via fail links)
+            int     own;        // the word that is spelled by the path to this node
+            int     output;     // the next node on the fail chain where a word ends
+            ushort  c;
+        };
+
+    private:
+        QVector<Node>       m_nodes;
+        QVector<int>        m_lengths;
+        QVector<int>        m_lengthCounts;
+};
+
+#endif // DICTIONARYMATCHER_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -16,10 +16,6 @@
 
 #include <QString>
 
-#include <openssl/bio.h>
-#include <openssl/evp.h>
-#include <openssl/buffer.h>
-
 #include "encodinghelper.h"
 
 // -------------------------------------------------------------------------------------------------
@@ -43,17 +39,26 @@ const char EncodingHelper::base64Alphabet[] = {
 
 /**
  * The reverse Base 64 alphabet, i.e. the index is the character and the result is
- * the corresponding number.
+ * the corresponding number. Characters that are not in the alphabet are -1, the
+ * padding character <tt>=</tt> is -2.
  */
-const char EncodingHelper::reverseBase64Alphabet[] = {
-     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
-     52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -2, -1, -1,
-     -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
-     15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
-     -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
-     41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51                       };
+const signed char EncodingHelper::reverseBase64Alphabet[256] = {
+     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,     // 0x00
+     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,     // 0x10
+     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,     // 0x20
+     52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -2, -1, -1,     // 0x30
+     -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,     // 0x40
+     15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,     // 0x50
+     -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,     // 0x60
+     41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,     // 0x70
+     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,     // 0x80
+     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,     // 0x90
+     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,     // 0xA0
+     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,     // 0xB0
+     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,     // 0xC0
+     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,     // 0xD0
+     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,     // 0xE0
+     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1  };  // 0xF0
 
 
 /**
@@ -61,6 +66,9 @@ const char EncodingHelper::reverseBase64Alphabet[] = {
  *
  * @brief Helper class for dealing with encodings.
  *
+ * The Base 64 functions are called for each encrypted password when a file is loaded or
+ * saved. They compute the size of the result first and write into it directly.
+ *
  * @ingroup security
  * @author Bernhard Walle
  */
@@ -71,22 +79,34 @@ const char EncodingHelper::reverseBase64Alphabet[] = {
  * @param vector the vector with the bytes
  * @return the string
  */
-QString EncodingHelper::toBase64(const ByteVector& vector)
+QString EncodingHelper::toBase64(const ByteSpan& vector)
 {
+    const int length = vector.size();
+    const unsigned char* in = vector.data();
+
     QString result;
-    unsigned char a, b, c;
-    int lenMod3;
-
-    for (int i = 0; i < vector.size(); i += 3) {
-        lenMod3 = ((i+3) > vector.size()) ? (vector.size() % 3) : 3;
-        a = vector[i];
-        b = lenMod3 > 1 ? vector[i+1] : 0;
-        c = lenMod3 > 2 ? vector[i+2] : 0;
-        result += base64Alphabet[a >> 2];
-        result += base64Alphabet[((a << 4) & 0x30) | (b >> 4)];
-        result += (lenMod3 > 1) ? base64Alphabet[((b << 2) & 0x3C) | ((c >> 6) & 0x03)] : '=';
-        result += (lenMod3 > 2) ? base64Alphabet[c & 0x3F] : '=';
+    result.resize((length + 2) / 3 * 4);
+    QChar* out = result.data();
+
+    int i = 0;
+    for (; i + 3 <= length; i += 3) {
+        const unsigned int bits = (in[i] << 16) | (in[i+1] << 8) | in[i+2];
+        out[0] = QLatin1Char(base64Alphabet[bits >> 18]);
+        out[1] = QLatin1Char(base64Alphabet[(bits >> 12) & 0x3F]);
+        out[2] = QLatin1Char(base64Alphabet[(bits >> 6) & 0x3F]);
+        out[3] = QLatin1Char(base64Alphabet[bits & 0x3F]);
+        out += 4;
+    }
+
+    if (i < length) {
+        const bool two = i + 1 < length;
+        const unsigned int bits = (in[i] << 16) | (two ? in[i+1] << 8 : 0);
+        out[0] = QLatin1Char(base64Alphabet[bits >> 18]);
+        out[1] = QLatin1Char(base64Alphabet[(bits >> 12) & 0x3F]);
+        out[2] = two ? QLatin1Char(base64Alphabet[(bits >> 6) & 0x3F]) : QLatin1Char('=');
+        out[3] = QLatin1Char('=');
     }
+
     return result;
 }
 
@@ -98,34 +118,56 @@ QString EncodingHelper::toBase64(const ByteVector& vector)
  *
  * @param string the encoded string
  * @return the decoded bytes
- * @exception std::invalid_argument if the length is incorrect
+ * @exception std::invalid_argument if the length is incorrect or if the string contains
+ *            a character that is not in the alphabet or padding that is not at the end
  */
 ByteVector EncodingHelper::fromBase64(const QString& string)
 {
-    int stringLength = string.length();
+    const int stringLength = string.length();
     if (stringLength % 4 != 0)
         throw std::invalid_argument("In EncodingHelper::fromBase64: string % 4 != 0");
-
-    const char* stringAscii = string.ascii();
-    Q3ValueVector<unsigned char> vector;
-    char a, b, c, d;
-    for (int i = 0; i < stringLength; i += 4) {
-        a = reverseBase64Alphabet[ (int)stringAscii[i] ];
-        b = reverseBase64Alphabet[ (int)stringAscii[i+1] ];
-        c = reverseBase64Alphabet[ (int)stringAscii[i+2] ];
-        d = reverseBase64Alphabet[ (int)stringAscii[i+3] ];
-
-        vector.push_back(((a << 2) | (b >> 4)));
-        vector.push_back(((b & 0x0F) << 4) | (c >> 2));
-        vector.push_back((((c & 0x03) << 6) | d));
-
-        if (d == -2) {
-            vector.pop_back();
-            if (c == -2)
-                vector.pop_back();
-        }
+    if (stringLength == 0)
+        return ByteVector();
+
+    const QChar* in = string.unicode();
+    int padding = 0;
+    if (in[stringLength - 1] == QLatin1Char('='))
+        padding = in[stringLength - 2] == QLatin1Char('=') ? 2 : 1;
+
+    ByteVector vector(stringLength / 4 * 3 - padding);
+    unsigned char* out = vector.data();
+
+    // the last group is decoded separately because of the padding
+    const int lastGroup = stringLength - 4;
+    for (int i = 0; i < lastGroup; i += 4) {
+        const int a = decodeBase64(in[i]);
+        const int b = decodeBase64(in[i+1]);
+        const int c = decodeBase64(in[i+2]);
+        const int d = decodeBase64(in[i+3]);
+        if ((a | b | c | d) < 0)
+            throw std::invalid_argument("In EncodingHelper::fromBase64: invalid character");
+
+        const unsigned int bits = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = bits >> 16;
+        out[1] = bits >> 8;
+        out[2] = bits;
+        out += 3;
     }
 
+    const int a = decodeBase64(in[lastGroup]);
+    const int b = decodeBase64(in[lastGroup+1]);
+    const int c = padding > 1 ? 0 : decodeBase64(in[lastGroup+2]);
+    const int d = padding > 0 ? 0 : decodeBase64(in[lastGroup+3]);
+    if ((a | b | c | d) < 0)
+        throw std::invalid_argument("In EncodingHelper::fromBase64: invalid character");
+
+    const unsigned int bits = (a << 18) | (b << 12) | (c << 6) | d;
+    out[0] = bits >> 16;
+    if (padding < 2)
+        out[1] = bits >> 8;
+    if (padding < 1)
+        out[2] = bits;
+
     return vector;
 }
 
@@ -26,15 +26,21 @@
 class EncodingHelper
 {
     public:
-        static QString toBase64(const ByteVector& vector);
+        static QString toBase64(const ByteSpan& vector);
         static ByteVector fromBase64(const QString& string);
 
         static const char base64Alphabet[];
-        static const char reverseBase64Alphabet[];
+        static const signed char reverseBase64Alphabet[256];
 
     private:
         EncodingHelper() {}
 
+        static inline int decodeBase64(QChar c)
+        {
+            const ushort u = c.unicode();
+            return u < 0x100 ? reverseBase64Alphabet[u] : -1;
+        }
+
 };
 
 #endif // ENCODINGHELPER_H
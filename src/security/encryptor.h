@@ -43,11 +43,11 @@ class Encryptor : public StringEncryptor
     public:
         virtual ~Encryptor() {};
 
-        virtual ByteVector encrypt(const ByteVector& vector) = 0;
+        virtual ByteVector encrypt(const ByteSpan& vector) = 0;
         virtual ByteVector encryptStrToBytes(const QString& string) = 0;
 
-        virtual ByteVector decrypt(const ByteVector& vector) = 0;
-        virtual QString decryptStrFromBytes(const ByteVector& vector) = 0;
+        virtual ByteVector decrypt(const ByteSpan& vector) = 0;
+        virtual QString decryptStrFromBytes(const ByteSpan& vector) = 0;
 };
 
 #endif // ENCRYPTOR_H
@@ -0,0 +1,195 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+
+#include <QDebug>
+
+#include "global.h"
+#include "gcmauthenticator.h"
+
+// -------------------------------------------------------------------------------------------------
+//                                     Static members
+// -------------------------------------------------------------------------------------------------
+
+const int GcmAuthenticator::KEY_LENGTH = 32;
+const int GcmAuthenticator::NONCE_LENGTH = 12;
+const int GcmAuthenticator::TAG_LENGTH = 16;
+
+/**
+ * @class GcmAuthenticator
+ *
+ * @brief Computes an authentication tag over a stream of bytes with AES-256-GCM.
+ *
+ * All bytes are passed as additional authenticated data, so GCM is used as GMAC: nothing
+ * is encrypted, but every modification of the data is detected. The key is computed with
+ * HMAC-SHA256 from the key of the KeyDerivation and a fixed label, so it differs from
+ * the key of the cipher and checking a tag is not cheaper than deriving the key. A nonce
+ * must never be used twice with the same key, so create a new nonce with randomBytes()
+ * for each file that is written.
+ *
+ * An object can compute one tag. After tag() or verify() was called, it must not be used
+ * any more.
+ *
+ * @ingroup security
+ */
+
+/**
+ * @brief Creates a new GcmAuthenticator for the key of a KeyDerivation.
+ *
+ * @param masterKey the key from KeyDerivation::deriveKey()
+ * @param nonce the nonce, must have NONCE_LENGTH bytes
+ * @exception NoSuchAlgorithmException if OpenSSL has no AES-GCM or no SHA-256
+ */
+GcmAuthenticator::GcmAuthenticator(const ByteSpan& masterKey, const QByteArray& nonce)
+    throw (NoSuchAlgorithmException)
+    : m_context(EVP_CIPHER_CTX_new())
+    , m_finished(false)
+{
+    static const char label[] = "QPaMaT authentication key";
+
+    unsigned char key[EVP_MAX_MD_SIZE];
+    unsigned int keyLength = 0;
+    if (!HMAC(EVP_sha256(), masterKey.data(), masterKey.size(),
+            reinterpret_cast<const unsigned char*>(label), sizeof(label) - 1,
+            key, &keyLength) || int(keyLength) < KEY_LENGTH) {
+        OPENSSL_cleanse(key, sizeof(key));
+        EVP_CIPHER_CTX_free(m_context);
+        throw NoSuchAlgorithmException("HMAC-SHA256 failed");
+    }
+
+    init(key, nonce);
+    OPENSSL_cleanse(key, sizeof(key));
+}
+
+
+/**
+ * @brief Sets up the context for AES-256-GCM.
+ *
+ * Frees the context if that fails, so the constructor can just pass the exception.
+ *
+ * @param key the key with KEY_LENGTH bytes
+ * @param nonce the nonce, must have NONCE_LENGTH bytes
+ * @exception NoSuchAlgorithmException if OpenSSL has no AES-GCM
+ */
+void GcmAuthenticator::init(const unsigned char* key, const QByteArray& nonce)
+    throw (NoSuchAlgorithmException)
+{
+    Q_ASSERT(nonce.size() == NONCE_LENGTH);
+
+    bool ok = EVP_EncryptInit_ex(m_context, EVP_aes_256_gcm(), 0, 0, 0)
+        && EVP_CIPHER_CTX_ctrl(m_context, EVP_CTRL_GCM_SET_IVLEN, NONCE_LENGTH, 0)
+        && EVP_EncryptInit_ex(m_context, 0, 0, key,
+               reinterpret_cast<const unsigned char*>(nonce.constData()));
+
+    if (!ok) {
+        EVP_CIPHER_CTX_free(m_context);
+        m_context = 0;
+        throw NoSuchAlgorithmException("AES-256-GCM is not supported");
+    }
+}
+
+
+/**
+ * @brief Deletes the object.
+ *
+ * EVP_CIPHER_CTX_free() also removes the key from memory.
+ */
+GcmAuthenticator::~GcmAuthenticator()
+{
+    EVP_CIPHER_CTX_free(m_context);
+}
+
+
+/**
+ * @brief Adds bytes to the authenticated data.
+ *
+ * @param data the bytes
+ * @param length the number of bytes
+ */
+void GcmAuthenticator::update(const char* data, int length)
+{
+    Q_ASSERT(!m_finished);
+
+    int outLength;
+    if (length > 0)
+        EVP_EncryptUpdate(m_context, 0, &outLength,
+            reinterpret_cast<const unsigned char*>(data), length);
+}
+
+
+/**
+ * @brief Finishes the computation and returns the tag.
+ *
+ * @return the tag with TAG_LENGTH bytes
+ */
+QByteArray GcmAuthenticator::tag()
+{
+    Q_ASSERT(!m_finished);
+    m_finished = true;
+
+    // nothing is encrypted, so there's no output
+    unsigned char dummy[EVP_MAX_BLOCK_LENGTH];
+    int outLength;
+    EVP_EncryptFinal_ex(m_context, dummy, &outLength);
+
+    QByteArray result(TAG_LENGTH, '\0');
+    EVP_CIPHER_CTX_ctrl(m_context, EVP_CTRL_GCM_GET_TAG, TAG_LENGTH, result.data());
+    return result;
+}
+
+
+/**
+ * @brief Finishes the computation and compares the result with @p tag.
+ *
+ * The comparison takes the same time regardless where the tags differ.
+ *
+ * @param tag the tag that was stored with the data
+ * @return @c true if the data is unmodified, @c false otherwise
+ */
+bool GcmAuthenticator::verify(const QByteArray& tag)
+{
+    const QByteArray computed = this->tag();
+    if (tag.size() != computed.size())
+        return false;
+
+    unsigned char difference = 0;
+    for (int i = 0; i < computed.size(); ++i)
+        difference |= computed[i] ^ tag[i];
+    return difference == 0;
+}
+
+
+/**
+ * @brief Returns random bytes that are suitable as salt or nonce.
+ *
+ * @param count the number of bytes
+ * @return the bytes
+ * @exception std::runtime_error if the random number generator of OpenSSL is not seeded
+ */
+QByteArray GcmAuthenticator::randomBytes(int count)
+    throw (std::runtime_error)
+{
+    QByteArray result(count, '\0');
+    if (RAND_bytes(reinterpret_cast<unsigned char*>(result.data()), count) != 1) {
+        qDebug() << CURRENT_FUNCTION << "RAND_bytes failed";
+        throw std::runtime_error("The random number generator is not seeded");
+    }
+    return result;
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
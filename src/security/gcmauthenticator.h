@@ -0,0 +1,61 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef GCMAUTHENTICATOR_H
+#define GCMAUTHENTICATOR_H
+
+#include <stdexcept>
+
+#include <QByteArray>
+
+#include <openssl/evp.h>
+
+#include "encryptor.h"
+
+class GcmAuthenticator
+{
+    public:
+        static const int KEY_LENGTH;
+        static const int NONCE_LENGTH;
+        static const int TAG_LENGTH;
+
+    public:
+        GcmAuthenticator(const ByteSpan& masterKey, const QByteArray& nonce)
+            throw (NoSuchAlgorithmException);
+        ~GcmAuthenticator();
+
+    public:
+        void update(const char* data, int length);
+        QByteArray tag();
+        bool verify(const QByteArray& tag);
+
+        static QByteArray randomBytes(int count)
+            throw (std::runtime_error);
+
+    private:
+        void init(const unsigned char* key, const QByteArray& nonce)
+            throw (NoSuchAlgorithmException);
+
+    private:
+        GcmAuthenticator(const GcmAuthenticator&);
+        GcmAuthenticator& operator=(const GcmAuthenticator&);
+
+    private:
+        EVP_CIPHER_CTX*     m_context;
+        bool                m_finished;
+};
+
+#endif // GCMAUTHENTICATOR_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
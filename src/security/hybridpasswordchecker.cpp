@@ -22,19 +22,19 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QTextStream>
+#include <QMutexLocker>
 
 #include "global.h"
 #include "hybridpasswordchecker.h"
+#include "charclassifier.h"
 
 
 // -------------------------------------------------------------------------------------------------
 //                                     Static data
 // -------------------------------------------------------------------------------------------------
 
-StringVector    HybridPasswordChecker::m_words;
-QFile::Offset   HybridPasswordChecker::m_fileSize = 0;
-QString         HybridPasswordChecker::m_fileName;
-QMap<int, int>  HybridPasswordChecker::m_lengthBeginMap;
+HybridPasswordChecker::DictionaryPointer HybridPasswordChecker::m_cachedDictionary;
+QMutex HybridPasswordChecker::m_cacheLock;
 
 
 
@@ -48,7 +48,12 @@ QMap<int, int>  HybridPasswordChecker::m_lengthBeginMap;
  *
  * The dictionary file consists of single word in each line. It needs to be \b sorted
  * according to the length of the words. The first word must be the longest word and the
- * last word must be the shortest word.
+ * last word must be the shortest word. The file is encoded in ISO-8859-1 regardless of
+ * the locale, like the DictionaryIndex that is built from it.
+ *
+ * The loaded dictionary is never modified. Each checker keeps a reference to the dictionary
+ * that was current when it was created, so checkers may be created and used in different
+ * threads at the same time.
  *
  * @ingroup security
  * @author Bernhard Walle
@@ -58,11 +63,13 @@ QMap<int, int>  HybridPasswordChecker::m_lengthBeginMap;
 /**
  * @brief Creates a new instance of a HybridPasswordChecker.
  *
- * Caching is performed, i.e. only the first creation of the object reads the file.
- * Following instantiations check the modification time (see \p checkModtime) and if it is
- * still the same, the cached data is used. This increases performance dramatically but
- * needs more memory. Since modern computers have much memory this is better than having a
- * slow program.
+ * Caching is performed, i.e. only the first creation of the object reads the file. If
+ * there's an up-to-date DictionaryIndex next to the file, it's mapped instead of reading
+ * the text file.
+ * Following instantiations with the same file name use the cached data. This increases
+ * performance dramatically but needs more memory. Since modern computers have much memory
+ * this is better than having a slow program. If the file name changes, a new dictionary
+ * is loaded, the old one is freed when the last checker that uses it is deleted.
  *
  * @param dictFileName the name of the dictionary.
  * @exception PasswordCheckException if the file does not exist or if the file cannot be
@@ -76,44 +83,115 @@ HybridPasswordChecker::HybridPasswordChecker(const QString& dictFileName)
             dictFileName).latin1());
     }
 
+    QMutexLocker locker(&m_cacheLock);
+
     // do we need to re-read
-    if (m_words.isEmpty() || (m_fileName != dictFileName)) {
+    if (!m_cachedDictionary || m_cachedDictionary->fileName != dictFileName ||
+            (m_cachedDictionary->words.isEmpty() && !m_cachedDictionary->index.isOpen())) {
         qDebug() << CURRENT_FUNCTION << "!!!! Re-reading the file !!!!!";
+        m_cachedDictionary = loadDictionary(dictFileName);
+    }
+    m_dictionary = m_cachedDictionary;
+}
+
+
+/**
+ * @brief Loads the dictionary from the index or from the text file.
+ *
+ * @param dictFileName the name of the dictionary text file
+ * @return the new dictionary
+ * @exception PasswordCheckException if the file cannot be opened
+ */
+HybridPasswordChecker::DictionaryPointer HybridPasswordChecker::loadDictionary(
+        const QString& dictFileName)
+    throw (PasswordCheckException)
+{
+    QSharedPointer<Dictionary> dictionary(new Dictionary);
+    if (!readIndex(dictFileName, *dictionary))
+        readTextFile(dictFileName, *dictionary);
+    dictionary->fileName = dictFileName;
+
+    return dictionary;
+}
+
 
-        QFile file(dictFileName);
-        if (!file.open(QIODevice::ReadOnly))
-            throw PasswordCheckException( QString("Could not open the file %1.").arg(
-                dictFileName).latin1() );
-
-        // read in memory
-        QByteArray bytes = file.readAll();
-        file.close();
-        m_fileName = dictFileName;
-
-        // check the number of lines to increase speed
-        unsigned int numberOfLines = 0;
-        for (int i = 0; i < bytes.size(); ++i)
-            if (bytes[i] == '\n')
-                ++numberOfLines;
-
-        m_words.reserve(numberOfLines+5);
-        QTextStream fileStream(bytes, QIODevice::ReadOnly);
-        int oldLength = 0;
-        int length = 0;
-        int index = 0;
-        while (!fileStream.atEnd()) {
-            QString text = fileStream.readLine();
-            length = text.length();
-            if (length != oldLength) {
-                if (length == 1)
-                    break;
-                m_lengthBeginMap.insert(length, index);
-                oldLength = length;
-            }
-            m_words.append(text);
-            ++index;
+/**
+ * @brief Maps the precompiled index of the dictionary.
+ *
+ * The index is only used if it's not older than the text file.
+ *
+ * @param dictFileName the name of the dictionary text file
+ * @param dictionary the dictionary that is filled
+ * @return @c true if the index was mapped, @c false if the text file must be read
+ */
+bool HybridPasswordChecker::readIndex(const QString& dictFileName, Dictionary& dictionary)
+{
+    QFileInfo textInfo(dictFileName);
+    QFileInfo indexInfo(DictionaryIndex::indexFileName(dictFileName));
+    if (!indexInfo.exists() || indexInfo.lastModified() < textInfo.lastModified())
+        return false;
+
+    DictionaryIndex& index = dictionary.index;
+    if (!index.open(indexInfo.filePath()))
+        return false;
+
+    for (int length = index.maxLength(); length >= 0; --length) {
+        int begin = index.lengthBegin(length);
+        if (begin >= 0)
+            dictionary.lengthBeginMap.insert(length, begin);
+    }
+    dictionary.matcher.build(index);
+
+    return true;
+}
+
+
+/**
+ * @brief Reads the dictionary text file.
+ *
+ * @param dictFileName the name of the dictionary text file
+ * @param dictionary the dictionary that is filled
+ * @exception PasswordCheckException if the file cannot be opened
+ */
+void HybridPasswordChecker::readTextFile(const QString& dictFileName, Dictionary& dictionary)
+    throw (PasswordCheckException)
+{
+    QFile file(dictFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        throw PasswordCheckException( QString("Could not open the file %1.").arg(
+            dictFileName).latin1() );
+
+    // read in memory
+    QByteArray bytes = file.readAll();
+    file.close();
+
+    // check the number of lines to increase speed
+    unsigned int numberOfLines = 0;
+    for (int i = 0; i < bytes.size(); ++i)
+        if (bytes[i] == '\n')
+            ++numberOfLines;
+
+    StringVector& words = dictionary.words;
+    words.reserve(numberOfLines+5);
+    QTextStream fileStream(bytes, QIODevice::ReadOnly);
+    fileStream.setCodec("ISO-8859-1");
+    int oldLength = 0;
+    int length = 0;
+    int index = 0;
+    while (!fileStream.atEnd()) {
+        QString text = fileStream.readLine();
+        length = text.length();
+        if (length != oldLength) {
+            if (length == 1)
+                break;
+            dictionary.lengthBeginMap.insert(length, index);
+            oldLength = length;
         }
+        words.append(text);
+        ++index;
     }
+
+    dictionary.matcher.build(words);
 }
 
 
@@ -141,29 +219,38 @@ double HybridPasswordChecker::passwordQuality(const QString& password) throw ()
 }
 
 
+/**
+ * @brief Returns the compiled dictionary.
+ *
+ * It's shared with all instances that were created for the same dictionary file. Other
+ * checkers use it so that the dictionary is only loaded once. It's valid as long as this
+ * checker exists.
+ *
+ * @return the matcher
+ */
+const DictionaryMatcher& HybridPasswordChecker::matcher() const
+{
+    return m_dictionary->matcher;
+}
+
+
 /**
  * @brief Finds the longest word that occures in \p password and is in the dictionary.
  *
+ * The dictionary is compiled into a DictionaryMatcher, so this takes one pass over the
+ * password instead of one search per dictionary word.
+ *
  * @param password the password
  * @return the longest word
  */
 QString HybridPasswordChecker::findLongestWord(const QString& password) const
 {
-    int initialPosition = 0;
-    int pwLength = password.length();
-    while (!m_lengthBeginMap.contains(pwLength) && pwLength >= 0)
-        --pwLength;
-
-    if (pwLength < 0)
+    int index = m_dictionary->matcher.findLongestWord(password);
+    if (index < 0)
         return "";
-    initialPosition = m_lengthBeginMap[pwLength];
-
-    for (StringVector::iterator it = m_words.begin() + initialPosition; it != m_words.end(); ++it) {
-        if (password.contains(*it, false))
-            return *it;
-    }
-
-    return "";
+    return m_dictionary->index.isOpen()
+        ? m_dictionary->index.word(index)
+        : m_dictionary->words[index];
 }
 
 /**
@@ -175,8 +262,9 @@ QString HybridPasswordChecker::findLongestWord(const QString& password) const
  */
 int HybridPasswordChecker::getNumberOfWordsWithSameOrShorterLength(const QString& word) const
 {
+    const QMap<int, int>& lengthBeginMap = m_dictionary->lengthBeginMap;
     int len = word.length();
-    while (!m_lengthBeginMap.contains(len) && len >= 0) {
+    while (!lengthBeginMap.contains(len) && len >= 0) {
         --len;
     }
 
@@ -184,7 +272,7 @@ int HybridPasswordChecker::getNumberOfWordsWithSameOrShorterLength(const QString
         return 0;
     }
 
-    return m_lengthBeginMap[len];
+    return lengthBeginMap[len];
 }
 
 
@@ -201,55 +289,7 @@ int HybridPasswordChecker::getNumberOfWordsWithSameOrShorterLength(const QString
  */
 int HybridPasswordChecker::findNumerOfCharsInClass(const QString& chars) const
 {
-    int ret = 0;
-    bool hasDigits = false, hasLowercase = false, hasUppercase = false, hasUmlauts = false;
-    bool hasSpecial = false, hasOther = false;
-
-    for (int i = 0; i < chars.length(); ++i) {
-        QChar c = chars[i];
-        int l1 = c.latin1() & 0xff;
-
-        if (c.latin1() == 0) {
-            return 255;
-        } else if (!hasDigits && ((c >= '0' && c <= '9') || c == ' ')) {
-            hasDigits = true;
-        } else if (!hasLowercase && c >= 'a' && c <= 'z') {
-            hasLowercase = true;
-        } else if (!hasUppercase && c >= 'A' && c <= 'Z') {
-            hasUppercase = true;
-        } else if (!hasSpecial && (c == ',' || c == '.' || c == '-' || c == ';' || c == ':'
-                || c == '_' || c == '=' || c == '(' || c == ')' || c == '*' || c == '+' || c == '?'
-                || c == '"' || c == '$' || c == '@' ||c == '#' || c == '%' || c == '&' || c == '/'
-                || c == '\\' || c == '{' || c == '}' || c == '[' || c == ']' || c == '!' || c == '^'
-                || c == '?' || c == '\'' || c == '?' || c == '`' || c == '~')) {
-            hasSpecial = true;
-        } else if (!hasUmlauts && ((l1 >= 0xC0 && l1 <= 0xD6) || (l1 >= 0xD8 && l1 <= 0xFF))) {
-            hasUmlauts = true;
-        } else {
-            hasOther = true;
-        }
-    }
-
-    if (hasDigits) {
-        ret += 11;
-    }
-    if (hasLowercase) {
-        ret += 26;
-    }
-    if (hasUppercase) {
-        ret += 26;
-    }
-    if (hasUmlauts) {
-        ret += 13;
-    }
-    if (hasSpecial) {
-        ret += 30;
-    }
-    if (hasOther) {
-        ret += 118;
-    }
-
-    return ret;
+    return CharClassifier::charsetSize(chars);
 }
 
 // -------------------------------------------------------------------------------------------------
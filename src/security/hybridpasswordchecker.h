@@ -23,9 +23,13 @@
 #include <Q3ValueVector>
 #include <QFile>
 #include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
 
 #include "global.h"
 #include "passwordchecker.h"
+#include "dictionarymatcher.h"
+#include "dictionaryindex.h"
 
 class HybridPasswordChecker : public PasswordChecker
 {
@@ -35,16 +39,34 @@ class HybridPasswordChecker : public PasswordChecker
 
         double passwordQuality(const QString& password) throw ();
 
+        const DictionaryMatcher& matcher() const;
+
     private:
+        struct Dictionary
+        {
+            QString             fileName;
+            StringVector        words;
+            QMap<int, int>      lengthBeginMap;
+            DictionaryMatcher   matcher;
+            DictionaryIndex     index;
+        };
+        typedef QSharedPointer<const Dictionary> DictionaryPointer;
+
+        static DictionaryPointer loadDictionary(const QString& dictFileName)
+            throw (PasswordCheckException);
+        static bool readIndex(const QString& dictFileName, Dictionary& dictionary);
+        static void readTextFile(const QString& dictFileName, Dictionary& dictionary)
+            throw (PasswordCheckException);
+
         QString findLongestWord(const QString& password) const;
         int getNumberOfWordsWithSameOrShorterLength(const QString& password) const;
         int findNumerOfCharsInClass(const QString& chars) const;
 
     private:
-        static StringVector         m_words;
-        static QFile::Offset        m_fileSize;
-        static QString              m_fileName;
-        static QMap<int, int>       m_lengthBeginMap;
+        DictionaryPointer           m_dictionary;
+
+        static DictionaryPointer    m_cachedDictionary;
+        static QMutex               m_cacheLock;
 };
 
 bool string_length_less(const QString& a, const QString& b);
@@ -0,0 +1,182 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <limits>
+
+#include <QDebug>
+#include <QTime>
+
+#include <openssl/evp.h>
+
+#include "global.h"
+#include "keyderivation.h"
+#include "gcmauthenticator.h"
+
+// -------------------------------------------------------------------------------------------------
+//                                     Static members
+// -------------------------------------------------------------------------------------------------
+
+const char KeyDerivation::PBKDF2_SHA256[] = "PBKDF2-SHA256";
+const int KeyDerivation::KEY_LENGTH = 32;
+const int KeyDerivation::SALT_LENGTH = 16;
+const int KeyDerivation::MIN_ITERATIONS = 10000;
+
+/**
+ * @class KeyDerivation
+ *
+ * @brief Derives the key for the SymmetricEncryptor from the password of the user.
+ *
+ * Older versions used EVP_BytesToKey() with one iteration and without salt, so a
+ * password could be guessed with very little effort. Now PBKDF2-HMAC-SHA256 is used
+ * with a random salt and an iteration count that is chosen with calibrate() so that
+ * deriving the key takes a given time on the current computer. The parameters are
+ * stored in the <tt>\<kdf\></tt> element of the data file (see AppData). A data file
+ * without that element was written by an older version and gets a new salt and the
+ * new key derivation when it is saved.
+ *
+ * @ingroup security
+ */
+
+/**
+ * @brief Creates a new KeyDerivation object.
+ *
+ * @param algorithm the name of the algorithm, currently only PBKDF2_SHA256
+ * @param iterations the number of iterations
+ * @param salt the salt
+ * @exception NoSuchAlgorithmException if the algorithm is unknown
+ */
+KeyDerivation::KeyDerivation(const QString& algorithm, int iterations, const QByteArray& salt)
+    throw (NoSuchAlgorithmException)
+    : m_algorithm(algorithm)
+    , m_iterations(iterations)
+    , m_salt(salt)
+{
+    if (algorithm != PBKDF2_SHA256)
+        throw NoSuchAlgorithmException(("Key derivation " + algorithm + " not supported")
+            .latin1());
+}
+
+
+/**
+ * @brief Creates a KeyDerivation with a new random salt.
+ *
+ * @param iterations the number of iterations, at least MIN_ITERATIONS are used
+ * @return the new object
+ * @exception std::runtime_error if the random number generator of OpenSSL is not seeded
+ */
+KeyDerivation KeyDerivation::create(int iterations)
+    throw (std::runtime_error)
+{
+    return KeyDerivation(PBKDF2_SHA256, qMax(iterations, MIN_ITERATIONS),
+        GcmAuthenticator::randomBytes(SALT_LENGTH));
+}
+
+
+/**
+ * @brief Returns the number of iterations for which deriveKey() takes @p milliseconds.
+ *
+ * The number of iterations is doubled until one derivation takes long enough to be
+ * measured, then the result is scaled to @p milliseconds. The result is never less than
+ * MIN_ITERATIONS.
+ *
+ * @param milliseconds the time that unlocking the data file may take
+ * @return the number of iterations
+ */
+int KeyDerivation::calibrate(int milliseconds)
+{
+    const int minimumElapsed = 50;
+    const KeyDerivation probe = create(MIN_ITERATIONS);
+
+    int iterations = 1000;
+    int elapsed = 0;
+    for (;;) {
+        QTime timer;
+        timer.start();
+        KeyDerivation(PBKDF2_SHA256, iterations, probe.m_salt).deriveKey("calibration");
+        elapsed = timer.elapsed();
+
+        if (elapsed >= minimumElapsed || iterations > std::numeric_limits<int>::max() / 2)
+            break;
+        iterations *= 2;
+    }
+
+    const double result = double(iterations) * milliseconds / qMax(elapsed, 1);
+    qDebug() << CURRENT_FUNCTION << iterations << "iterations took" << elapsed << "ms, using"
+        << result << "for" << milliseconds << "ms";
+
+    return int(qBound(double(MIN_ITERATIONS), result,
+        double(std::numeric_limits<int>::max())));
+}
+
+
+/**
+ * @brief Returns the name of the algorithm.
+ *
+ * @return the name as stored in the data file
+ */
+QString KeyDerivation::getAlgorithm() const
+{
+    return m_algorithm;
+}
+
+
+/**
+ * @brief Returns the number of iterations.
+ *
+ * @return the iterations
+ */
+int KeyDerivation::getIterations() const
+{
+    return m_iterations;
+}
+
+
+/**
+ * @brief Returns the salt.
+ *
+ * @return the salt
+ */
+QByteArray KeyDerivation::getSalt() const
+{
+    return m_salt;
+}
+
+
+/**
+ * @brief Derives the key from @p password.
+ *
+ * This takes the time that was chosen with the number of iterations.
+ *
+ * @param password the password of the user
+ * @return the key with KEY_LENGTH bytes
+ * @exception NoSuchAlgorithmException if OpenSSL has no SHA-256 or the number of
+ *            iterations is invalid
+ */
+ByteVector KeyDerivation::deriveKey(const QString& password) const
+    throw (NoSuchAlgorithmException)
+{
+    QByteArray utf8 = password.toUtf8();
+    ByteVector key(KEY_LENGTH);
+
+    const bool ok = m_iterations > 0 && PKCS5_PBKDF2_HMAC(utf8.constData(), utf8.size(),
+        reinterpret_cast<const unsigned char*>(m_salt.constData()), m_salt.size(),
+        m_iterations, EVP_sha256(), KEY_LENGTH, key.data());
+    utf8.fill('\0');
+
+    if (!ok)
+        throw NoSuchAlgorithmException("PBKDF2-HMAC-SHA256 failed");
+    return key;
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
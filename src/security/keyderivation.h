@@ -0,0 +1,58 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef KEYDERIVATION_H
+#define KEYDERIVATION_H
+
+#include <stdexcept>
+
+#include <QString>
+#include <QByteArray>
+
+#include "global.h"
+#include "encryptor.h"
+
+class KeyDerivation
+{
+    public:
+        static const char PBKDF2_SHA256[];
+        static const int KEY_LENGTH;
+        static const int SALT_LENGTH;
+        static const int MIN_ITERATIONS;
+
+    public:
+        KeyDerivation(const QString& algorithm, int iterations, const QByteArray& salt)
+            throw (NoSuchAlgorithmException);
+
+        static KeyDerivation create(int iterations)
+            throw (std::runtime_error);
+        static int calibrate(int milliseconds);
+
+    public:
+        QString getAlgorithm() const;
+        int getIterations() const;
+        QByteArray getSalt() const;
+
+        ByteVector deriveKey(const QString& password) const
+            throw (NoSuchAlgorithmException);
+
+    private:
+        QString     m_algorithm;
+        int         m_iterations;
+        QByteArray  m_salt;
+};
+
+#endif // KEYDERIVATION_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
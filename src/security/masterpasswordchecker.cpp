@@ -18,6 +18,7 @@
 
 #include "global.h"
 #include "masterpasswordchecker.h"
+#include "charclassifier.h"
 
 
 /**
@@ -49,19 +50,17 @@ double MasterPasswordChecker::passwordQuality(const QString& password) throw ()
         return false;
     }
 
-    bool uppercase = false;
-    bool lowercase = false;
-    bool nonLetter = false;
-    for (int i = 0; i < password.length(); ++i) {
-        const QChar character = password[i];
-        QChar::Category cat = character.category();
-        if (cat == QChar::Letter_Uppercase)
-            uppercase = true;
-        else if (cat == QChar::Letter_Lowercase)
-            lowercase = true;
-        else if (! character.isLetter())
-            nonLetter = true;
-    }
+    const unsigned int all = CharClassifier::LetterUppercase | CharClassifier::LetterLowercase
+                           | CharClassifier::NonLetter;
+    const QChar* data = password.unicode();
+    const int length = password.length();
+    unsigned int seen = 0;
+    for (int i = 0; i < length && (seen & all) != all; ++i)
+        seen |= CharClassifier::classify(data[i]);
+
+    bool uppercase = seen & CharClassifier::LetterUppercase;
+    bool lowercase = seen & CharClassifier::LetterLowercase;
+    bool nonLetter = seen & CharClassifier::NonLetter;
 
     return uppercase && lowercase && nonLetter ? std::numeric_limits<double>::max() : 0.0;
 }
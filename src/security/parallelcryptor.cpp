@@ -0,0 +1,161 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <string>
+
+#include <QVector>
+#include <QThreadPool>
+#include <QScopedPointer>
+#include <QtConcurrentMap>
+
+#include "parallelcryptor.h"
+
+/**
+ * @class ParallelCryptor
+ *
+ * @brief Encrypts or decrypts many strings on all processors.
+ *
+ * The passwords are encrypted independently of each other with the same key, so that
+ * can be done in parallel. The strings are divided into chunks which are processed by
+ * the threads of the global QThreadPool. Each chunk gets its own clone of the
+ * SymmetricEncryptor. The result has always the same order as the input.
+ *
+ * If there are only a few strings, everything is done in the calling thread.
+ *
+ * @ingroup security
+ */
+
+#ifndef DOXYGEN
+
+namespace {
+
+struct CryptChunk
+{
+    const SymmetricEncryptor*   prototype;
+    const QString*              input;
+    QString*                    output;
+    int                         count;
+    bool                        encrypt;
+    std::string                 error;
+};
+
+void cryptChunk(CryptChunk& chunk)
+{
+    QScopedPointer<SymmetricEncryptor> enc(chunk.prototype->clone());
+
+    try {
+        for (int i = 0; i < chunk.count; ++i)
+            chunk.output[i] = chunk.encrypt
+                ? enc->encryptStrToStr(chunk.input[i])
+                : enc->decryptStrFromStr(chunk.input[i]);
+    } catch (const std::exception& e) {
+        // exceptions must not leave the worker thread
+        chunk.error = e.what();
+    }
+}
+
+} // end anonymous namespace
+
+#endif // DOXYGEN
+
+/**
+ * @brief Minimum number of strings for one thread.
+ */
+const int ParallelCryptor::MIN_CHUNK_SIZE = 64;
+
+/**
+ * @brief Creates a new ParallelCryptor.
+ *
+ * @param encryptor the encryptor which is cloned for each chunk, must stay valid as long
+ *        as this object exists
+ */
+ParallelCryptor::ParallelCryptor(const SymmetricEncryptor& encryptor)
+    : m_encryptor(encryptor)
+{}
+
+
+/**
+ * @brief Encrypts all strings.
+ *
+ * @param strings the strings to encrypt
+ * @return the results of StringEncryptor::encryptStrToStr(), in the same order as @p strings
+ * @exception std::invalid_argument if the encryption failed
+ */
+QStringList ParallelCryptor::encryptStrings(const QStringList& strings) const
+    throw (std::invalid_argument)
+{
+    return crypt(strings, true);
+}
+
+
+/**
+ * @brief Decrypts all strings.
+ *
+ * @param strings the Base 64 encoded strings to decrypt
+ * @return the results of StringEncryptor::decryptStrFromStr(), in the same order as
+ *         @p strings
+ * @exception std::invalid_argument if one of the strings is invalid
+ */
+QStringList ParallelCryptor::decryptStrings(const QStringList& strings) const
+    throw (std::invalid_argument)
+{
+    return crypt(strings, false);
+}
+
+
+/**
+ * @brief Does the work for encryptStrings() and decryptStrings().
+ *
+ * @param strings the input
+ * @param encrypt @c true for encryption, @c false for decryption
+ * @return the result
+ * @exception std::invalid_argument if the operation failed
+ */
+QStringList ParallelCryptor::crypt(const QStringList& strings, bool encrypt) const
+    throw (std::invalid_argument)
+{
+    const int size = strings.size();
+    const QVector<QString> input = strings.toVector();
+    QVector<QString> output(size);
+
+    int chunkCount = qMin(QThreadPool::globalInstance()->maxThreadCount() * 4,
+        (size + MIN_CHUNK_SIZE - 1) / MIN_CHUNK_SIZE);
+    chunkCount = qMax(chunkCount, 1);
+
+    QVector<CryptChunk> chunks(chunkCount);
+    const int chunkSize = (size + chunkCount - 1) / chunkCount;
+    for (int i = 0; i < chunkCount; ++i) {
+        CryptChunk& chunk = chunks[i];
+        const int begin = qMin(i * chunkSize, size);
+
+        chunk.prototype = &m_encryptor;
+        chunk.input = input.constData() + begin;
+        chunk.output = output.data() + begin;
+        chunk.count = qMin(chunkSize, size - begin);
+        chunk.encrypt = encrypt;
+    }
+
+    if (chunkCount == 1)
+        cryptChunk(chunks[0]);
+    else
+        QtConcurrent::blockingMap(chunks, cryptChunk);
+
+    for (int i = 0; i < chunkCount; ++i)
+        if (!chunks[i].error.empty())
+            throw std::invalid_argument(chunks[i].error);
+
+    return output.toList();
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,163 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QString>
+
+#include "passwordchecker.h"
+#include "passwordcheckerfactory.h"
+#include "hybridpasswordchecker.h"
+#include "patternpasswordchecker.h"
+
+// -------------------------------------------------------------------------------------------------
+//                                     Static data
+// -------------------------------------------------------------------------------------------------
+
+/**
+ * The default password checker
+ */
+const PasswordCheckerFactory::PasswordCheckerType PasswordCheckerFactory::DEFAULT_CHECKER
+    = THybridPasswordChecker;
+
+/**
+ * The default password checker as string.
+ */
+const QString PasswordCheckerFactory::DEFAULT_CHECKER_STRING = "HYBRID";
+
+
+/**
+ * @class PasswordCheckerFactory
+ *
+ * @brief Factory for creating password checkers.
+ *
+ * This class contains a static method which is used to create instances of a
+ * PasswordChecker. QPaMaT provides different password checkers:
+ *
+ *   - @c HYBRID: HybridPasswordChecker
+ *   - @c PATTERN: PatternPasswordChecker
+ *
+ * Both checkers get the name of the dictionary file.
+ *
+ * @ingroup security
+ */
+
+/**
+ * @enum PasswordCheckerFactory::PasswordCheckerType
+ *
+ * @brief Enumeration type for the password checker.
+ */
+
+/**
+ * @var PasswordCheckerFactory::THybridPasswordChecker
+ *
+ * @brief Represents the HybridPasswordChecker
+ */
+
+/**
+ * @var PasswordCheckerFactory::TPatternPasswordChecker
+ *
+ * @brief Represents the PatternPasswordChecker
+ */
+
+/**
+ * @brief Creates a new instance of a PasswordChecker class.
+ *
+ * @param type the type of the password checker
+ * @param dictFileName the dictionary file
+ * @return a pointer to the created PasswordChecker object. This object must be deleted by
+ *         the caller.
+ * @exception std::invalid_argument if the type is out of range
+ * @exception PasswordCheckException if the dictionary cannot be read
+ */
+PasswordChecker* PasswordCheckerFactory::getChecker(PasswordCheckerType type,
+    const QString& dictFileName) throw (std::invalid_argument, PasswordCheckException)
+{
+    switch (type) {
+        case THybridPasswordChecker:
+            return new HybridPasswordChecker(dictFileName);
+
+        case TPatternPasswordChecker:
+            return new PatternPasswordChecker(dictFileName);
+
+        default:
+            throw std::invalid_argument("PasswordCheckerFactory::getChecker: "
+                "type is out of range");
+    }
+}
+
+
+/**
+ * @brief This method is provided for convenience.
+ *
+ * It behaves exactly like the above function. It just calls fromString to get the type
+ * reperesentation of the string.
+ *
+ * @param type the type of the password checker
+ * @param dictFileName the dictionary file
+ * @return a pointer to the created PasswordChecker object. This object must be deleted by
+ *         the caller.
+ * @exception std::invalid_argument if a wrong \p type is specified
+ * @exception PasswordCheckException if the dictionary cannot be read
+ */
+PasswordChecker* PasswordCheckerFactory::getChecker(const QString& type,
+    const QString& dictFileName) throw (std::invalid_argument, PasswordCheckException)
+{
+    return getChecker(fromString(type), dictFileName);
+}
+
+
+/**
+ * @brief Converts the string representation which is one of \c HYBRID or \c PATTERN to a
+ *        PasswordCheckerType.
+ *
+ * @param type the string representation
+ * @return the enumeration type representation
+ * @exception std::invalid_argument if the string reperesentation is invalid
+ */
+PasswordCheckerFactory::PasswordCheckerType PasswordCheckerFactory::fromString(QString type)
+             throw (std::invalid_argument)
+{
+    type = type.upper();
+    if (type == "HYBRID")
+        return THybridPasswordChecker;
+    else if (type == "PATTERN")
+        return TPatternPasswordChecker;
+    else
+        throw std::invalid_argument(QString("PasswordCheckerFactory::fromString: Type '%1' "
+            "is not valid.").arg(type).latin1());
+}
+
+
+/**
+ * @brief Converts the PasswordCheckerType to a string representation.
+ *
+ * @param type the password checker type
+ * @return the string representation, one of \c HYBRID or \c PATTERN
+ * @exception std::invalid_argument if the type is not a valid PasswordCheckerType
+ */
+QString PasswordCheckerFactory::toString(PasswordCheckerType type)
+            throw (std::invalid_argument)
+{
+    switch (type) {
+        case THybridPasswordChecker:
+            return "HYBRID";
+
+        case TPatternPasswordChecker:
+            return "PATTERN";
+
+        default:
+            throw std::invalid_argument("PasswordCheckerFactory::toString: type is out of range");
+    }
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,49 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef PASSWORDCHECKERFACTORY_H
+#define PASSWORDCHECKERFACTORY_H
+
+#include <stdexcept>
+
+#include <QString>
+
+#include "passwordchecker.h"
+
+class PasswordCheckerFactory
+{
+    public:
+
+        enum PasswordCheckerType {
+            THybridPasswordChecker,
+            TPatternPasswordChecker
+        };
+
+        static const PasswordCheckerType DEFAULT_CHECKER;
+        static const QString DEFAULT_CHECKER_STRING;
+
+    public:
+        static PasswordChecker* getChecker(PasswordCheckerType type, const QString& dictFileName)
+            throw (std::invalid_argument, PasswordCheckException);
+
+        static PasswordChecker* getChecker(const QString& type, const QString& dictFileName)
+            throw (std::invalid_argument, PasswordCheckException);
+
+        static PasswordCheckerType fromString(QString type) throw (std::invalid_argument);
+        static QString toString(PasswordCheckerType type) throw (std::invalid_argument);
+};
+
+#endif // PASSWORDCHECKERFACTORY_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
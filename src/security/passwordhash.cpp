@@ -15,7 +15,6 @@
 #include <cstdlib>
 #include <algorithm>
 #include <limits>
-#include <iterator>
 
 #include <QDebug>
 #include <QString>
@@ -94,15 +93,19 @@ bool PasswordHash::isCorrect(QString password, const ByteVector& hash)
 {
     ByteVector output;
 
-    Q_ASSERT(hash.size() > numberOfRandomBytes);
+    if (hash.size() <= numberOfRandomBytes)
+        return false;
 
     // attach the random bytes
-    ByteVector passwordBytes(numberOfRandomBytes);
-    std::copy(hash.begin(), hash.begin() + numberOfRandomBytes, passwordBytes.begin());
+    QByteArray passwordCString = password.toUtf8();
+    ByteVector passwordBytes;
+    passwordBytes.reserve(numberOfRandomBytes + passwordCString.size());
+    passwordBytes.append(hash.mid(0, numberOfRandomBytes));
 
     // convert the password to a byte vector
-    QByteArray passwordCString = password.toUtf8();
-    std::copy(passwordCString.begin(), passwordCString.end(), std::back_inserter(passwordBytes));
+    passwordBytes.append(ByteSpan(reinterpret_cast<const unsigned char*>(passwordCString.constData()),
+                                  passwordCString.size()));
+    passwordCString.fill('\0');
 
     attachHashWithoutSalt(output, passwordBytes);
 
@@ -121,15 +124,19 @@ ByteVector PasswordHash::generateHash(QString password)
 {
     StdRandomNumberGenerator<unsigned char> rand;
     ByteVector output(numberOfRandomBytes);
+    output.reserve(MAX_HASH_LENGTH);
 
     // generate the random bytes and copy them to the output, too
-    ByteVector passwordBytes(numberOfRandomBytes);
+    QByteArray passwordCString = password.toUtf8();
+    ByteVector passwordBytes;
+    passwordBytes.reserve(numberOfRandomBytes + passwordCString.size());
     std::generate(output.begin(), output.end(), rand);
-    std::copy(output.begin(), output.end(), passwordBytes.begin());
+    passwordBytes.append(output);
 
     // attach the password
-    QByteArray passwordCString = password.toUtf8();
-    std::copy(passwordCString.begin(), passwordCString.end(), std::back_inserter(passwordBytes));
+    passwordBytes.append(ByteSpan(reinterpret_cast<const unsigned char*>(passwordCString.constData()),
+                                  passwordCString.size()));
+    passwordCString.fill('\0');
 
     attachHashWithoutSalt(output, passwordBytes);
 
@@ -159,22 +166,102 @@ QString PasswordHash::generateHashString(const QString& password)
  * @param passwordBytes the password including the "salt" attached
  * @todo Find out what the function really does
  */
-void PasswordHash::attachHashWithoutSalt(ByteVector& output, const ByteVector& passwordBytes)
+void PasswordHash::attachHashWithoutSalt(ByteVector& output, const ByteSpan& passwordBytes)
 {
     EVP_MD_CTX mdctx;
     unsigned char md_value[EVP_MAX_MD_SIZE];
     unsigned int md_len;
 
-    int len = passwordBytes.size();
-    unsigned char* password = new unsigned char[len];
-    std::copy(passwordBytes.begin(), passwordBytes.end(), password);
-
     EVP_DigestInit(&mdctx, HASH_ALGORITHM);
-    EVP_DigestUpdate(&mdctx, password, len);
+    EVP_DigestUpdate(&mdctx, passwordBytes.data(), passwordBytes.size());
     EVP_DigestFinal(&mdctx, md_value, &md_len);
-    delete[] password;
 
-    std::copy(md_value, md_value + md_len, std::back_inserter(output));
+    output.append(ByteSpan(md_value, md_len));
+}
+
+
+
+/**
+ * @brief Checks if @p key was derived from the password that belongs to @p hash.
+ *
+ * This is used instead of isCorrect() if the key is derived with KeyDerivation, so
+ * checking a password is as expensive as deriving the key. The comparison takes the same
+ * time regardless where the hashes differ.
+ *
+ * @param key the key from KeyDerivation::deriveKey()
+ * @param hash the string that was returned by generateKeyHashString()
+ * @return \c true if the password is correct, \c false otherwise
+ */
+bool PasswordHash::isCorrectKey(const ByteSpan& key, const QString& hash)
+{
+    const QString computed = generateKeyHashString(key);
+    if (computed.length() != hash.length())
+        return false;
+
+    ushort difference = 0;
+    for (int i = 0; i < computed.length(); ++i)
+        difference |= computed[i].unicode() ^ hash[i].unicode();
+    return difference == 0;
+}
+
+
+/**
+ * @brief Checks if @p key was derived from the password that belongs to @p hash.
+ *
+ * This is used for the hash on the smartcard.
+ *
+ * @param key the key from KeyDerivation::deriveKey()
+ * @param hash the bytes that were returned by generateKeyHash()
+ * @return \c true if the password is correct, \c false otherwise
+ */
+bool PasswordHash::isCorrectKey(const ByteSpan& key, const ByteSpan& hash)
+{
+    const ByteVector computed = generateKeyHash(key);
+    if (computed.size() != hash.size())
+        return false;
+
+    unsigned char difference = 0;
+    for (int i = 0; i < computed.size(); ++i)
+        difference |= computed[i] ^ hash[i];
+    return difference == 0;
+}
+
+
+/**
+ * @brief Generates the hash for a key that was derived from the password.
+ *
+ * @param key the key from KeyDerivation::deriveKey()
+ * @return the Base 64 encoded hash
+ */
+QString PasswordHash::generateKeyHashString(const ByteSpan& key)
+{
+    return EncodingHelper::toBase64(generateKeyHash(key));
+}
+
+
+/**
+ * @brief Hashes the key with SHA-256.
+ *
+ * A prefix makes sure that the result differs from the key of the cipher which
+ * SymmetricEncryptor computes from the same key.
+ *
+ * @param key the key from KeyDerivation::deriveKey()
+ * @return the hash, not longer than MAX_HASH_LENGTH
+ */
+ByteVector PasswordHash::generateKeyHash(const ByteSpan& key)
+{
+    static const char prefix[] = "QPaMaT key hash";
+    unsigned char md_value[EVP_MAX_MD_SIZE];
+    unsigned int md_len;
+
+    EVP_MD_CTX* mdctx = EVP_MD_CTX_create();
+    EVP_DigestInit_ex(mdctx, EVP_sha256(), 0);
+    EVP_DigestUpdate(mdctx, prefix, sizeof(prefix) - 1);
+    EVP_DigestUpdate(mdctx, key.data(), key.size());
+    EVP_DigestFinal_ex(mdctx, md_value, &md_len);
+    EVP_MD_CTX_destroy(mdctx);
+
+    return ByteVector(md_value, md_len);
 }
 
 // vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
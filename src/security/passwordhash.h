@@ -31,8 +31,14 @@ class PasswordHash
         static ByteVector generateHash(QString password);
         static QString generateHashString(const QString& password);
 
+        static bool isCorrectKey(const ByteSpan& key, const QString& hash);
+        static bool isCorrectKey(const ByteSpan& key, const ByteSpan& hash);
+
+        static ByteVector generateKeyHash(const ByteSpan& key);
+        static QString generateKeyHashString(const ByteSpan& key);
+
     private:
-        static void attachHashWithoutSalt(ByteVector& output, const ByteVector& passwordBytes);
+        static void attachHashWithoutSalt(ByteVector& output, const ByteSpan& passwordBytes);
 
     private:
         static const int numberOfRandomBytes;
@@ -0,0 +1,757 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <QString>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include "global.h"
+#include "patternpasswordchecker.h"
+#include "charclassifier.h"
+#include "dictionarymatcher.h"
+
+/**
+ * @class PatternPasswordChecker
+ *
+ * @brief Password checker that knows the patterns that people use in passwords.
+ *
+ * The HybridPasswordChecker only looks for the longest dictionary word and treats the
+ * rest as random characters. So <tt>P4ssw0rd</tt>, <tt>qwertz123</tt> or
+ * <tt>12.03.1985</tt> are rated as strong although a cracker tries them early.
+ *
+ * This checker first collects all parts of the password that match a pattern:
+ *
+ *  - words of the dictionary, also with changed case and l33t substitutions like
+ *    <tt>4</tt> for <tt>a</tt> or <tt>$</tt> for <tt>s</tt>,
+ *  - walks on a QWERTY or QWERTZ keyboard like <tt>asdf</tt> or <tt>1qay</tt>,
+ *  - sequences like <tt>abc</tt> or <tt>987</tt>,
+ *  - repeated characters or blocks like <tt>aaa</tt> or <tt>abcabc</tt>,
+ *  - dates like <tt>1985</tt>, <tt>120385</tt> or <tt>12.03.1985</tt>.
+ *
+ * Each match gets the entropy in bits that a cracker who knows the pattern needs to guess
+ * it. Characters that are not part of a match are guessed by brute force. Then a
+ * dynamic program over the positions of the password finds the combination of matches
+ * with the minimum total entropy, that's the entropy of the password.
+ *
+ * All matchers are precompiled: the dictionary is the DictionaryMatcher of the
+ * HybridPasswordChecker and the keyboard layouts are tables that are built when the
+ * program starts. So checking a password takes one pass per pattern.
+ *
+ * @ingroup security
+ */
+
+#ifndef DOXYGEN
+
+/**
+ * @brief A keyboard layout for finding keyboard walks.
+ *
+ * Each row of keys is given as the unshifted and the shifted characters in ISO-8859-1.
+ * The position of a key is stored in half key widths because the rows are staggered.
+ */
+class KeyboardLayout
+{
+    public:
+        KeyboardLayout(const char* const rows[][2], const int offsets[], int numberOfRows);
+
+        int direction(QChar from, QChar to) const;
+        bool isShifted(QChar c) const;
+        double numberOfKeys() const;
+        double averageNeighbours() const;
+
+    private:
+        bool contains(ushort c) const;
+
+    private:
+        signed char m_row[0x100];
+        signed char m_x[0x100];
+        bool        m_shifted[0x100];
+        int         m_keys;
+        double      m_neighbours;
+};
+
+/**
+ * @brief Creates the tables.
+ *
+ * @param rows the rows, the unshifted and the shifted characters must have the same length
+ * @param offsets the position of the first key of each row in half key widths
+ * @param numberOfRows the number of rows
+ */
+KeyboardLayout::KeyboardLayout(const char* const rows[][2], const int offsets[],
+                               int numberOfRows)
+    : m_keys(0), m_neighbours(0.0)
+{
+    std::memset(m_row, -1, sizeof(m_row));
+    std::memset(m_x, 0, sizeof(m_x));
+    std::memset(m_shifted, 0, sizeof(m_shifted));
+
+    for (int row = 0; row < numberOfRows; ++row) {
+        for (int shift = 0; shift < 2; ++shift) {
+            const char* keys = rows[row][shift];
+            for (int col = 0; keys[col] != '\0'; ++col) {
+                unsigned char c = keys[col];
+                m_row[c] = row;
+                m_x[c] = offsets[row] + 2 * col;
+                m_shifted[c] = shift;
+            }
+        }
+        m_keys += int(std::strlen(rows[row][0]));
+    }
+
+    int neighbours = 0;
+    for (int from = 0; from < 0x100; ++from)
+        for (int to = 0; to < 0x100; ++to)
+            if (!m_shifted[from] && !m_shifted[to] && direction(from, to) >= 0)
+                ++neighbours;
+    m_neighbours = double(neighbours) / m_keys;
+}
+
+/**
+ * @brief Returns the direction from one key to the next.
+ *
+ * @param from the first character
+ * @param to the second character
+ * @return a number that identifies the direction or -1 if the keys are not neighbours
+ */
+int KeyboardLayout::direction(QChar from, QChar to) const
+{
+    const ushort a = from.unicode();
+    const ushort b = to.unicode();
+    if (!contains(a) || !contains(b))
+        return -1;
+
+    const int dy = m_row[b] - m_row[a];
+    const int dx = m_x[b] - m_x[a];
+    if ((dy == 0 && std::abs(dx) == 2) || (std::abs(dy) == 1 && std::abs(dx) == 1))
+        return (dy + 1) * 8 + dx + 2;
+    return -1;
+}
+
+/**
+ * @brief Checks if shift must be pressed for @p c.
+ */
+bool KeyboardLayout::isShifted(QChar c) const
+{
+    return contains(c.unicode()) && m_shifted[c.unicode()];
+}
+
+/**
+ * @brief Returns the number of keys, i.e. the number of possible first keys of a walk.
+ */
+double KeyboardLayout::numberOfKeys() const
+{
+    return m_keys;
+}
+
+/**
+ * @brief Returns the average number of neighbours of a key.
+ */
+double KeyboardLayout::averageNeighbours() const
+{
+    return m_neighbours;
+}
+
+/**
+ * @brief Checks if the character @p c is on the keyboard.
+ */
+bool KeyboardLayout::contains(ushort c) const
+{
+    return c < 0x100 && m_row[c] >= 0;
+}
+
+namespace {
+
+const char* const QWERTY_ROWS[][2] = {
+    { "`1234567890-=",  "~!@#$%^&*()_+" },
+    { "qwertyuiop[]\\", "QWERTYUIOP{}|" },
+    { "asdfghjkl;'",    "ASDFGHJKL:\"" },
+    { "zxcvbnm,./",     "ZXCVBNM<>?" }
+};
+const int QWERTY_OFFSETS[] = { 0, 3, 4, 5 };
+
+const char* const QWERTZ_ROWS[][2] = {
+    { "^1234567890\xdf\xb4", "\xb0!\"\xa7$%&/()=?`" },
+    { "qwertzuiop\xfc+",     "QWERTZUIOP\xdc*" },
+    { "asdfghjkl\xf6\xe4#",  "ASDFGHJKL\xd6\xc4'" },
+    { "<yxcvbnm,.-",         ">YXCVBNM;:_" }
+};
+const int QWERTZ_OFFSETS[] = { 0, 3, 4, 3 };
+
+const KeyboardLayout QWERTY(QWERTY_ROWS, QWERTY_OFFSETS, 4);
+const KeyboardLayout QWERTZ(QWERTZ_ROWS, QWERTZ_OFFSETS, 4);
+
+struct LeetSubstitution
+{
+    char    symbol;
+    char    letter;
+    char    alternative;
+};
+
+const LeetSubstitution LEET_SUBSTITUTIONS[] = {
+    { '4', 'a', 0 },   { '@', 'a', 0 },   { '8', 'b', 0 },   { '(', 'c', 0 },
+    { '{', 'c', 0 },   { '[', 'c', 0 },   { '<', 'c', 0 },   { '3', 'e', 0 },
+    { '6', 'g', 0 },   { '9', 'g', 0 },   { '!', 'i', 0 },   { '1', 'i', 'l' },
+    { '|', 'i', 'l' }, { '0', 'o', 0 },   { '$', 's', 0 },   { '5', 's', 0 },
+    { '7', 't', 'l' }, { '+', 't', 0 },   { '%', 'x', 0 },   { '2', 'z', 0 }
+};
+const int NUMBER_OF_LEET_SUBSTITUTIONS =
+    sizeof(LEET_SUBSTITUTIONS) / sizeof(LEET_SUBSTITUTIONS[0]);
+
+// the years that are tried for dates
+const int MIN_YEAR = 1900;
+const int MAX_YEAR = 2049;
+
+// the longest block that is checked for repeats
+const int MAX_REPEAT_PERIOD = 8;
+
+/**
+ * Returns the number of bits for @p possibilities.
+ */
+inline double bits(double possibilities)
+{
+    return possibilities > 1.0 ? std::log(possibilities) / std::log(2.0) : 0.0;
+}
+
+/**
+ * Returns the number of bits for choosing 1 to @p k of @p n positions.
+ */
+double combinationBits(int n, int k)
+{
+    double binomial = 1.0;
+    double sum = 0.0;
+    for (int i = 1; i <= k; ++i) {
+        binomial = binomial * (n - i + 1) / i;
+        sum += binomial;
+    }
+    return bits(sum);
+}
+
+/**
+ * Returns the number of characters that a brute force attack on @p password must try.
+ */
+int bruteForceCardinality(const QString& password)
+{
+    unsigned int seen = 0;
+    for (int i = 0; i < password.length(); ++i)
+        seen |= CharClassifier::classify(password[i]);
+
+    int ret = 0;
+    if (seen & CharClassifier::Digit)
+        ret += 11;
+    if (seen & CharClassifier::Lowercase)
+        ret += 26;
+    if (seen & CharClassifier::Uppercase)
+        ret += 26;
+    if (seen & CharClassifier::Umlaut)
+        ret += 13;
+    if (seen & CharClassifier::Special)
+        ret += 30;
+    if (seen & CharClassifier::Other)
+        ret += 118;
+    if (seen & CharClassifier::NonLatin1)
+        ret += 255;
+    return ret;
+}
+
+/**
+ * Returns the bits for the case of the letters in a match. Only the first or all letters
+ * in uppercase is what most people do.
+ */
+double uppercaseBits(const QString& password, int begin, int length)
+{
+    int upper = 0;
+    int lower = 0;
+    for (int i = begin; i < begin + length; ++i) {
+        unsigned int cls = CharClassifier::classify(password[i]);
+        if (cls & CharClassifier::LetterUppercase)
+            ++upper;
+        else if (cls & CharClassifier::LetterLowercase)
+            ++lower;
+    }
+
+    if (upper == 0)
+        return 0.0;
+
+    const bool first = password[begin].isUpper();
+    const bool last = password[begin + length - 1].isUpper();
+    if (lower == 0 || (upper == 1 && (first || last)))
+        return 1.0;
+
+    return combinationBits(upper + lower, qMin(upper, lower));
+}
+
+/**
+ * Replaces the l33t characters in @p password by letters. If @p alternative is @c true,
+ * the second letter of ambiguous characters is used.
+ */
+QString unleet(const QString& password, bool alternative)
+{
+    QString ret = password;
+    for (int i = 0; i < ret.length(); ++i) {
+        const ushort c = ret[i].unicode();
+        for (int j = 0; j < NUMBER_OF_LEET_SUBSTITUTIONS; ++j) {
+            const LeetSubstitution& subst = LEET_SUBSTITUTIONS[j];
+            if (c == uchar(subst.symbol)) {
+                ret[i] = alternative && subst.alternative ? subst.alternative : subst.letter;
+                break;
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * Returns the bits for the l33t substitutions in a match. @p variant is the password
+ * with letters instead of the l33t characters.
+ */
+double leetBits(const QString& password, const QString& variant, int begin, int length)
+{
+    bool substituted[26];
+    std::memset(substituted, 0, sizeof(substituted));
+
+    int subst = 0;
+    for (int i = begin; i < begin + length; ++i) {
+        if (variant[i] != password[i]) {
+            substituted[variant[i].unicode() - 'a'] = true;
+            ++subst;
+        }
+    }
+    if (subst == 0)
+        return 0.0;
+
+    int unsubst = 0;
+    for (int i = begin; i < begin + length; ++i) {
+        const ushort c = password[i].toLower().unicode();
+        if (variant[i] == password[i] && c >= 'a' && c <= 'z' && substituted[c - 'a'])
+            ++unsubst;
+    }
+
+    if (unsubst == 0)
+        return 1.0;
+    return combinationBits(subst + unsubst, qMin(subst, unsubst));
+}
+
+/**
+ * Checks if @p day, @p month and @p year form a date. Years with two digits are always
+ * valid.
+ */
+bool isDate(int day, int month, int year, int yearDigits)
+{
+    if (day < 1 || day > 31 || month < 1 || month > 12)
+        return false;
+    return yearDigits != 4 || (year >= MIN_YEAR && year <= MAX_YEAR);
+}
+
+/**
+ * Returns the bits of a date with the year in @p yearDigits digits.
+ */
+double dateBits(int yearDigits)
+{
+    return bits(31.0 * 12 * (yearDigits == 4 ? MAX_YEAR - MIN_YEAR + 1 : 100));
+}
+
+/**
+ * Checks if the three numbers are a date in one of the orders day-month-year,
+ * month-day-year or year-month-day.
+ */
+bool isDate(int first, int firstDigits, int second, int third, int thirdDigits)
+{
+    if (firstDigits == 4)
+        return thirdDigits <= 2 && isDate(third, second, first, 4);
+    if (thirdDigits != 2 && thirdDigits != 4)
+        return false;
+
+    return isDate(first, second, third, thirdDigits)
+        || isDate(second, first, third, thirdDigits)
+        || (firstDigits == 2 && thirdDigits == 2 && isDate(third, second, first, 2));
+}
+
+/**
+ * Reads up to @p maxDigits digits at @p pos. Returns the number of digits that were read.
+ */
+int readNumber(const QString& password, int pos, int maxDigits, int* value)
+{
+    int digits = 0;
+    *value = 0;
+    while (digits < maxDigits && pos + digits < password.length()
+            && password[pos + digits].isDigit() && password[pos + digits].unicode() < 0x80) {
+        *value = *value * 10 + password[pos + digits].unicode() - '0';
+        ++digits;
+    }
+    return digits;
+}
+
+/**
+ * Returns the class of @p c for sequences, 0 if @p c cannot be part of a sequence.
+ */
+unsigned int sequenceClass(QChar c)
+{
+    return CharClassifier::classify(c) &
+        (CharClassifier::Lowercase | CharClassifier::Uppercase | CharClassifier::Digit);
+}
+
+} // end anonymous namespace
+
+#endif // DOXYGEN
+
+
+/**
+ * @brief Creates a new instance of a PatternPasswordChecker.
+ *
+ * The dictionary is loaded and cached by the HybridPasswordChecker, see there.
+ *
+ * @param dictFileName the name of the dictionary.
+ * @param guessesPerSecond the number of guesses that a cracker can try in one second
+ * @exception PasswordCheckException if the file does not exist or if the file cannot be
+ *                                   opened
+ */
+PatternPasswordChecker::PatternPasswordChecker(const QString& dictFileName,
+                                               double guessesPerSecond)
+            throw (PasswordCheckException)
+    : m_dictionary(dictFileName), m_guessesPerSecond(guessesPerSecond)
+{}
+
+
+/**
+ * @brief Checks the password.
+ *
+ * @param password the password to check
+ * @return the number of days that a cracker needs to crack according to the password
+ *         checker
+ */
+double PatternPasswordChecker::passwordQuality(const QString& password) throw ()
+{
+    return std::pow(2.0, entropy(password)) / m_guessesPerSecond / 86400;
+}
+
+
+/**
+ * @brief Computes the entropy of @p password.
+ *
+ * @param password the password
+ * @return the minimum number of bits that explain the password, see the class
+ *         documentation
+ */
+double PatternPasswordChecker::entropy(const QString& password) const
+{
+    const int length = password.length();
+    if (length == 0)
+        return 0.0;
+
+    CandidateVector candidates;
+    findDictionaryWords(password, candidates);
+    findKeyboardWalks(password, QWERTY, candidates);
+    findKeyboardWalks(password, QWERTZ, candidates);
+    findSequences(password, candidates);
+    findRepeats(password, candidates);
+    findDates(password, candidates);
+    qSort(candidates.begin(), candidates.end(), endsBefore);
+
+    // best[i] is the minimum entropy of the first i characters
+    const double charBits = bits(bruteForceCardinality(password));
+    QVector<double> best(length + 1);
+    best[0] = 0.0;
+
+    int c = 0;
+    for (int end = 1; end <= length; ++end) {
+        best[end] = best[end - 1] + charBits;
+        for (; c < candidates.size() && candidates[c].begin + candidates[c].length == end; ++c)
+            best[end] = qMin(best[end], best[candidates[c].begin] + candidates[c].bits);
+    }
+
+    return best[length];
+}
+
+
+/**
+ * @brief Orders the candidates by their end position.
+ */
+bool PatternPasswordChecker::endsBefore(const Candidate& a, const Candidate& b)
+{
+    return a.begin + a.length < b.begin + b.length;
+}
+
+
+/**
+ * @brief Finds the words of the dictionary, also with l33t substitutions.
+ *
+ * The entropy of a word is the number of words with the same length plus the bits for
+ * the case and the substitutions.
+ *
+ * @param password the password
+ * @param candidates the matches are appended here
+ */
+void PatternPasswordChecker::findDictionaryWords(const QString& password,
+                                                 CandidateVector& candidates) const
+{
+    const DictionaryMatcher& matcher = m_dictionary.matcher();
+
+    QString variants[3];
+    variants[0] = password;
+    variants[1] = unleet(password, false);
+    variants[2] = unleet(password, true);
+
+    QVector<DictionaryMatcher::Match> matches;
+    for (int v = 0; v < 3; ++v) {
+        const QString& variant = variants[v];
+        if (v > 0 && variant == variants[v - 1])
+            continue;
+
+        matches.clear();
+        matcher.findAllWords(variant, matches);
+
+        for (int i = 0; i < matches.size(); ++i) {
+            const DictionaryMatcher::Match& match = matches[i];
+            double leet = leetBits(password, variant, match.begin, match.length);
+
+            // found without substitutions before
+            if (v > 0 && leet == 0.0)
+                continue;
+
+            Candidate candidate;
+            candidate.begin = match.begin;
+            candidate.length = match.length;
+            candidate.bits = bits(matcher.wordsOfLength(match.length))
+                + uppercaseBits(password, match.begin, match.length) + leet;
+            candidates.append(candidate);
+        }
+    }
+}
+
+
+/**
+ * @brief Finds characters or blocks of up to 8 characters that are repeated.
+ *
+ * The entropy is the entropy of the block plus the bits for the number of repeats.
+ *
+ * @param password the password
+ * @param candidates the matches are appended here
+ */
+void PatternPasswordChecker::findRepeats(const QString& password,
+                                         CandidateVector& candidates) const
+{
+    const int length = password.length();
+
+    for (int period = 1; period <= MAX_REPEAT_PERIOD && 2 * period <= length; ++period) {
+        int i = period;
+        while (i < length) {
+            if (password[i] != password[i - period]) {
+                ++i;
+                continue;
+            }
+
+            int end = i;
+            while (end < length && password[end] == password[end - period])
+                ++end;
+
+            const int begin = i - period;
+            const int repeats = (end - begin) / period;
+            if (repeats >= 2 && repeats * period >= 3) {
+                Candidate candidate;
+                candidate.begin = begin;
+                candidate.length = repeats * period;
+                candidate.bits = entropy(password.mid(begin, period)) + bits(repeats);
+                candidates.append(candidate);
+            }
+            i = end;
+        }
+    }
+}
+
+
+/**
+ * @brief Finds walks of at least three keys on @p layout.
+ *
+ * The entropy is the number of first keys, the length and the number of turns of the
+ * walk plus the bits for the shifted keys.
+ *
+ * @param password the password
+ * @param layout the keyboard layout
+ * @param candidates the matches are appended here
+ */
+void PatternPasswordChecker::findKeyboardWalks(const QString& password,
+                                               const KeyboardLayout& layout,
+                                               CandidateVector& candidates)
+{
+    const int length = password.length();
+
+    int i = 0;
+    while (i < length) {
+        int end = i + 1;
+        int turns = 0;
+        int lastDirection = -1;
+        while (end < length) {
+            int direction = layout.direction(password[end - 1], password[end]);
+            if (direction < 0)
+                break;
+            if (lastDirection >= 0 && direction != lastDirection)
+                ++turns;
+            lastDirection = direction;
+            ++end;
+        }
+
+        if (end - i >= 3) {
+            int shifted = 0;
+            for (int j = i; j < end; ++j)
+                if (layout.isShifted(password[j]))
+                    ++shifted;
+            const int unshifted = end - i - shifted;
+
+            Candidate candidate;
+            candidate.begin = i;
+            candidate.length = end - i;
+            candidate.bits = bits(layout.numberOfKeys()) + bits(end - i)
+                + turns * bits(layout.averageNeighbours());
+            if (shifted > 0)
+                candidate.bits += unshifted == 0
+                    ? 1.0 : combinationBits(end - i, qMin(shifted, unshifted));
+            candidates.append(candidate);
+        }
+
+        i = end - i >= 2 ? end - 1 : end;
+    }
+}
+
+
+/**
+ * @brief Finds ascending or descending sequences of at least three letters or digits.
+ *
+ * @param password the password
+ * @param candidates the matches are appended here
+ */
+void PatternPasswordChecker::findSequences(const QString& password,
+                                           CandidateVector& candidates)
+{
+    const int length = password.length();
+
+    int i = 0;
+    while (i + 2 < length) {
+        const unsigned int cls = sequenceClass(password[i]);
+        const int delta = password[i + 1].unicode() - password[i].unicode();
+        if (cls == 0 || (delta != 1 && delta != -1) || sequenceClass(password[i + 1]) != cls) {
+            ++i;
+            continue;
+        }
+
+        int end = i + 2;
+        while (end < length && sequenceClass(password[end]) == cls
+                && password[end].unicode() - password[end - 1].unicode() == delta)
+            ++end;
+
+        if (end - i >= 3) {
+            const char first = password[i].toLatin1();
+            double base;
+            if (std::strchr("aAzZ019", first))
+                base = 1.0;
+            else if (cls == CharClassifier::Digit)
+                base = bits(10);
+            else
+                base = bits(26) + (cls == CharClassifier::Uppercase ? 1.0 : 0.0);
+
+            Candidate candidate;
+            candidate.begin = i;
+            candidate.length = end - i;
+            candidate.bits = base + bits(end - i) + (delta < 0 ? 1.0 : 0.0);
+            candidates.append(candidate);
+        }
+
+        i = end - 1;
+    }
+}
+
+
+/**
+ * @brief Finds years and dates with and without separators.
+ *
+ * Dates without separators have 4, 6 or 8 digits (<tt>1985</tt>, <tt>1203</tt>,
+ * <tt>120385</tt>, <tt>19850312</tt>). Dates with separators use the same character
+ * <tt>.</tt>, <tt>/</tt>, <tt>-</tt> or space twice (<tt>12.3.85</tt>,
+ * <tt>1985-03-12</tt>).
+ *
+ * @param password the password
+ * @param candidates the matches are appended here
+ */
+void PatternPasswordChecker::findDates(const QString& password, CandidateVector& candidates)
+{
+    const int length = password.length();
+
+    for (int i = 0; i < length; ++i) {
+        int value;
+        const int digits = readNumber(password, i, 8, &value);
+        if (digits == 0)
+            continue;
+
+        // without separators
+        for (int len = 4; len <= digits; len += 2) {
+            int number;
+            readNumber(password, i, len, &number);
+
+            double best = -1.0;
+            if (len == 4) {
+                if (number >= MIN_YEAR && number <= MAX_YEAR)
+                    best = bits(MAX_YEAR - MIN_YEAR + 1);
+                else if (isDate(number / 100, 2, number % 100, 0, 2))
+                    best = bits(31.0 * 12);
+            } else if (len == 6) {
+                if (isDate(number / 10000, 2, number / 100 % 100, number % 100, 2))
+                    best = dateBits(2);
+            } else if (len == 8) {
+                if (isDate(number / 1000000, 2, number / 10000 % 100, number % 10000, 4)
+                        || isDate(number / 10000, 4, number / 100 % 100, number % 100, 2))
+                    best = dateBits(4);
+            }
+
+            if (best >= 0.0) {
+                Candidate candidate;
+                candidate.begin = i;
+                candidate.length = len;
+                candidate.bits = best;
+                candidates.append(candidate);
+            }
+        }
+
+        // with separators
+        int first, second, third;
+        const int firstDigits = readNumber(password, i, 4, &first);
+        if (firstDigits == 3)
+            continue;
+
+        int pos = i + firstDigits;
+        const char sep = pos < length ? password[pos].toLatin1() : '\0';
+        if (sep == '\0' || !std::strchr("./- ", sep))
+            continue;
+        const QChar separator = password[pos++];
+
+        const int secondDigits = readNumber(password, pos, 2, &second);
+        pos += secondDigits;
+        if (secondDigits == 0 || pos >= length || password[pos] != separator)
+            continue;
+        ++pos;
+
+        const int thirdDigits = readNumber(password, pos, firstDigits == 4 ? 2 : 4, &third);
+        if (thirdDigits == 0 || !isDate(first, firstDigits, second, third, thirdDigits))
+            continue;
+
+        Candidate candidate;
+        candidate.begin = i;
+        candidate.length = pos + thirdDigits - i;
+        candidate.bits = dateBits(firstDigits == 4 ? 4 : thirdDigits) + 2.0;
+        candidates.append(candidate);
+    }
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,62 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef PATTERNPASSWORDCHECKER_H
+#define PATTERNPASSWORDCHECKER_H
+
+#include <QString>
+#include <QVector>
+
+#include "global.h"
+#include "passwordchecker.h"
+#include "hybridpasswordchecker.h"
+
+class KeyboardLayout;
+
+class PatternPasswordChecker : public PasswordChecker
+{
+    public:
+        PatternPasswordChecker(const QString& dictFileName,
+                               double guessesPerSecond = CRACKS_PER_SECOND)
+            throw (PasswordCheckException);
+
+        double passwordQuality(const QString& password) throw ();
+        double entropy(const QString& password) const;
+
+    private:
+        struct Candidate
+        {
+            int     begin;
+            int     length;
+            double  bits;
+        };
+        typedef QVector<Candidate> CandidateVector;
+
+        static bool endsBefore(const Candidate& a, const Candidate& b);
+
+        void findDictionaryWords(const QString& password, CandidateVector& candidates) const;
+        void findRepeats(const QString& password, CandidateVector& candidates) const;
+        static void findKeyboardWalks(const QString& password, const KeyboardLayout& layout,
+                                      CandidateVector& candidates);
+        static void findSequences(const QString& password, CandidateVector& candidates);
+        static void findDates(const QString& password, CandidateVector& candidates);
+
+    private:
+        HybridPasswordChecker   m_dictionary;
+        double                  m_guessesPerSecond;
+};
+
+#endif // PATTERNPASSWORDCHECKER_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,162 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QDebug>
+
+#include <openssl/crypto.h>
+
+#include "global.h"
+#include "sessionkeystore.h"
+
+/**
+ * @class SessionKeyStore
+ *
+ * @brief Keeps the derived key of the current session.
+ *
+ * Deriving the key with the KeyDerivation takes the configured unlock time, so the key is
+ * derived once when the file is opened or the password is set and then used for all
+ * saves. Only the master key is stored, the key and the IV of the cipher and the key of
+ * the authentication tag are computed from it at no noticeable cost.
+ *
+ * The password itself is not stored. The key is held in locked memory that is wiped
+ * in clear(), which is called when the user logs out (also after a timeout) and in the
+ * destructor.
+ *
+ * @ingroup security
+ */
+
+/**
+ * @brief Creates an empty key store.
+ */
+SessionKeyStore::SessionKeyStore()
+{}
+
+
+/**
+ * @brief Deletes the key store and wipes its contents.
+ */
+SessionKeyStore::~SessionKeyStore()
+{
+    clear();
+}
+
+
+/**
+ * @brief Derives a new key from @p password with a new salt and stores it.
+ *
+ * The stored key is only replaced if that succeeds.
+ *
+ * @param password the password of the user
+ * @param iterations the number of iterations, see KeyDerivation::create()
+ * @exception NoSuchAlgorithmException if the key derivation is not available
+ * @exception std::runtime_error if the random number generator is not seeded
+ */
+void SessionKeyStore::deriveKey(const QString& password, int iterations)
+    throw (std::runtime_error)
+{
+    const KeyDerivation kdf = KeyDerivation::create(iterations);
+    const ByteVector key = kdf.deriveKey(password);
+    setKey(kdf, key);
+}
+
+
+/**
+ * @brief Checks if the stored key was derived from @p password.
+ *
+ * This takes as long as deriving the key. The comparison takes the same time regardless
+ * where the keys differ.
+ *
+ * @param password the password to check
+ * @return \c true if the password is correct, \c false otherwise or if no key is stored
+ */
+bool SessionKeyStore::isCorrectPassword(const QString& password) const
+{
+    if (!hasKey())
+        return false;
+
+    try {
+        const ByteVector key = m_kdf->deriveKey(password);
+        return key.size() == m_key.size()
+            && CRYPTO_memcmp(key.data(), m_key.data(), key.size()) == 0;
+    } catch (const NoSuchAlgorithmException& e) {
+        qDebug() << CURRENT_FUNCTION << e.what();
+        return false;
+    }
+}
+
+
+/**
+ * @brief Stores the key that was derived from the password.
+ *
+ * @param kdf the parameters that were used to derive @p key
+ * @param key the derived key
+ */
+void SessionKeyStore::setKey(const KeyDerivation& kdf, const ByteSpan& key)
+{
+    ByteVector copy(key);
+    m_key.swap(copy);
+    m_kdf.reset(new KeyDerivation(kdf));
+}
+
+
+/**
+ * @brief Checks if a key is stored.
+ *
+ * @return \c true if getKeyDerivation() and getKey() may be called
+ */
+bool SessionKeyStore::hasKey() const
+{
+    return !m_kdf.isNull();
+}
+
+
+/**
+ * @brief Returns the parameters of the stored key.
+ *
+ * Must only be called if hasKey() returns \c true.
+ *
+ * @return the key derivation
+ */
+const KeyDerivation& SessionKeyStore::getKeyDerivation() const
+{
+    Q_ASSERT(m_kdf);
+    return *m_kdf;
+}
+
+
+/**
+ * @brief Returns the stored key.
+ *
+ * The returned span is only valid until the key store is modified.
+ *
+ * @return the key, empty if hasKey() returns \c false
+ */
+ByteSpan SessionKeyStore::getKey() const
+{
+    return m_key;
+}
+
+
+/**
+ * @brief Wipes the key.
+ */
+void SessionKeyStore::clear()
+{
+    qDebug() << CURRENT_FUNCTION;
+
+    m_kdf.reset();
+    m_key.clear();
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,55 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef SESSIONKEYSTORE_H
+#define SESSIONKEYSTORE_H
+
+#include <stdexcept>
+
+#include <QString>
+#include <QScopedPointer>
+
+#include "util/bytevector.h"
+#include "keyderivation.h"
+
+class SessionKeyStore
+{
+    public:
+        SessionKeyStore();
+        ~SessionKeyStore();
+
+    public:
+        void deriveKey(const QString& password, int iterations)
+            throw (std::runtime_error);
+        bool isCorrectPassword(const QString& password) const;
+
+        void setKey(const KeyDerivation& kdf, const ByteSpan& key);
+        bool hasKey() const;
+        const KeyDerivation& getKeyDerivation() const;
+        ByteSpan getKey() const;
+
+        void clear();
+
+    private:
+        SessionKeyStore(const SessionKeyStore&);
+        SessionKeyStore& operator=(const SessionKeyStore&);
+
+    private:
+        QScopedPointer<KeyDerivation>   m_kdf;
+        ByteVector                      m_key;
+};
+
+#endif // SESSIONKEYSTORE_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -20,15 +20,12 @@
 
 #include <openssl/evp.h>
 #include <openssl/ssl.h>
+#include <openssl/crypto.h>
 
 #include "symmetricencryptor.h"
 #include "constants.h"
 #include "encodinghelper.h"
 
-#ifndef BUFLEN
-#define BUFLEN 512
-#endif
-
 // -------------------------------------------------------------------------------------------------
 //                                     Static members
 // -------------------------------------------------------------------------------------------------
@@ -41,6 +38,11 @@ StringMap SymmetricEncryptor::m_algorithms = initAlgorithmsMap();
  *
  * @brief A object which encrypts bytes.
  *
+ * The object keeps one OpenSSL cipher context for encryption and one for decryption. They
+ * are set up with the key once and only the IV is reset for each field, so the key schedule
+ * is not computed again for every password. Because of that, an object must not be used by
+ * more than one thread at the same time.
+ *
  * @ingroup security
  * @author Bernhard Walle
  */
@@ -60,22 +62,93 @@ StringMap SymmetricEncryptor::m_algorithms = initAlgorithmsMap();
  * runtime. You cat a list of available algorithms using the getAlgorithms() function in
  * this class.
  *
+ * The key is derived from the password like in older versions. That is only needed to
+ * read such files, use the other constructor with a key from KeyDerivation otherwise.
+ *
  * @param algorithm the algorithm as string
  * @param password The password for encryption and decryption.
  * @exception NoSuchAlgorithmException if the algorithm is not supported
  */
 SymmetricEncryptor::SymmetricEncryptor(const QString& algorithm, const QString& password)
             throw (NoSuchAlgorithmException)
+    : m_encryptContext(0)
+    , m_decryptContext(0)
 {
-    // set the right cipher algorithm
-    if (m_algorithms.contains(algorithm.upper()))
-        m_cipher_algorithm = EVP_get_cipherbyname(m_algorithms[algorithm.upper()]);
-    else
-        throw NoSuchAlgorithmException(("Algorithm "+algorithm+" not supported").latin1());
+    initCipher(algorithm);
 
     // set the password
     setPassword(password);
-    m_currentAlgorithm = algorithm;
+}
+
+
+/**
+ * @brief Creates an instance of a new Encryptor for the given algorithm and key.
+ *
+ * The key and the IV of the cipher are computed from @p key with one round of SHA-256,
+ * which is enough because @p key is the result of KeyDerivation::deriveKey().
+ *
+ * @param algorithm the algorithm as string, see the other constructor
+ * @param key the key from KeyDerivation::deriveKey()
+ * @exception NoSuchAlgorithmException if the algorithm is not supported
+ */
+SymmetricEncryptor::SymmetricEncryptor(const QString& algorithm, const ByteSpan& key)
+            throw (NoSuchAlgorithmException)
+    : m_encryptContext(0)
+    , m_decryptContext(0)
+{
+    initCipher(algorithm);
+    setKey(key);
+}
+
+
+/**
+ * @brief Creates a copy of @p other with own cipher contexts.
+ *
+ * Use clone() to call it.
+ *
+ * @param other the encryptor to copy
+ */
+SymmetricEncryptor::SymmetricEncryptor(const SymmetricEncryptor& other)
+    : AbstractEncryptor()
+    , m_cipher_algorithm(other.m_cipher_algorithm)
+    , m_currentAlgorithm(other.m_currentAlgorithm)
+    , m_encryptContext(EVP_CIPHER_CTX_new())
+    , m_decryptContext(EVP_CIPHER_CTX_new())
+{
+    qCopy(other.m_key, other.m_key + EVP_MAX_KEY_LENGTH, m_key);
+    qCopy(other.m_iv, other.m_iv + EVP_MAX_IV_LENGTH, m_iv);
+    initContexts();
+}
+
+
+/**
+ * @brief Returns a new encryptor with the same algorithm and the same key.
+ *
+ * Since one encryptor must not be used by more than one thread, each thread
+ * needs its own clone. Cloning only reads this object, so several threads may
+ * clone the same encryptor at the same time.
+ *
+ * @return the new encryptor, the caller has to delete it
+ */
+SymmetricEncryptor* SymmetricEncryptor::clone() const
+{
+    return new SymmetricEncryptor(*this);
+}
+
+
+/**
+ * @brief Deletes the object.
+ *
+ * The key is removed from memory.
+ */
+SymmetricEncryptor::~SymmetricEncryptor()
+{
+    // EVP_CIPHER_CTX_free() also cleans the key schedule
+    EVP_CIPHER_CTX_free(m_encryptContext);
+    EVP_CIPHER_CTX_free(m_decryptContext);
+
+    OPENSSL_cleanse(m_key, sizeof(m_key));
+    OPENSSL_cleanse(m_iv, sizeof(m_iv));
 }
 
 
@@ -153,7 +226,7 @@ StringMap SymmetricEncryptor::initAlgorithmsMap()
 /**
  * @copydoc Encryptor::encrypt
  */
-ByteVector SymmetricEncryptor::encrypt(const ByteVector& vector)
+ByteVector SymmetricEncryptor::encrypt(const ByteSpan& vector)
 {
     return crypt(vector, ENCRYPT);
 }
@@ -162,7 +235,7 @@ ByteVector SymmetricEncryptor::encrypt(const ByteVector& vector)
 /**
  * @copydoc Encryptor::decrypt
  */
-ByteVector SymmetricEncryptor::decrypt(const ByteVector& vector)
+ByteVector SymmetricEncryptor::decrypt(const ByteSpan& vector)
 {
     return crypt(vector, DECRYPT);
 }
@@ -175,41 +248,167 @@ ByteVector SymmetricEncryptor::decrypt(const ByteVector& vector)
  * decrypted (\c DECRYPT).
  */
 
+/**
+ * @brief Encrypts a number of byte vectors.
+ *
+ * The result is the same as calling encrypt() for each element, but the output
+ * vectors are reused if they have already the right capacity.
+ *
+ * @param input array of @p count vectors that should be encrypted
+ * @param output array of @p count vectors that receive the result, may be the same as @p input
+ * @param count the number of elements in both arrays
+ */
+void SymmetricEncryptor::encryptMany(const ByteVector* input, ByteVector* output,
+                                     unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+        crypt(input[i], output[i], 0, ENCRYPT);
+}
+
+
+/**
+ * @brief Decrypts a number of byte vectors.
+ *
+ * The result is the same as calling decrypt() for each element, but the output
+ * vectors are reused if they have already the right capacity.
+ *
+ * @param input array of @p count vectors that should be decrypted
+ * @param output array of @p count vectors that receive the result, may be the same as @p input
+ * @param count the number of elements in both arrays
+ */
+void SymmetricEncryptor::decryptMany(const ByteVector* input, ByteVector* output,
+                                     unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+        crypt(input[i], output[i], 0, DECRYPT);
+}
+
+
+/**
+ * @brief Encrypts @p input and appends the result to @p output.
+ *
+ * The result is the same as appending encrypt(), but no temporary vector is needed.
+ * If the capacity of @p output is at least maximumEncryptedSize() bytes larger than
+ * its size, nothing is allocated.
+ *
+ * @param input the bytes that should be encrypted
+ * @param output the vector that receives the encrypted bytes
+ */
+void SymmetricEncryptor::appendEncrypted(const ByteSpan& input, ByteVector& output)
+{
+    crypt(input, output, output.size(), ENCRYPT);
+}
+
+
+/**
+ * @brief Returns the maximum number of bytes encrypt() returns for @p size bytes.
+ *
+ * @param size the number of plain bytes
+ * @return the upper bound for the encrypted size
+ */
+int SymmetricEncryptor::maximumEncryptedSize(int size) const
+{
+    return size + EVP_CIPHER_block_size(m_cipher_algorithm);
+}
+
+
 /**
  * Does the real encryption/decryption according to the operation type.
  */
-ByteVector SymmetricEncryptor::crypt(const ByteVector& vector, OperationType operation) const
+ByteVector SymmetricEncryptor::crypt(const ByteSpan& vector, OperationType operation) const
 {
-    unsigned char buf[BUFLEN];
-    unsigned char ebuf[BUFLEN + 8];
     ByteVector output;
-    EVP_CIPHER_CTX ectx;
-    int ebuflen;
-    ByteVector::ConstIterator beginOfVector = vector.begin();
-    unsigned int sizeOfVector = vector.size();
-    EVP_CipherInit(&ectx, m_cipher_algorithm, m_key, m_iv, operation);
-
-    for (unsigned int i = 0; i < sizeOfVector; i += BUFLEN) {
-        int readLen = (i + BUFLEN >= sizeOfVector)
-            ? sizeOfVector - i
-            : BUFLEN;
-        qCopy(beginOfVector + i, beginOfVector + i + readLen, buf);
-        EVP_CipherUpdate(&ectx, ebuf, &ebuflen, buf, readLen);
-
-        int oldSize = output.size();
-        output.resize(oldSize + ebuflen);
-        qCopy( ebuf, ebuf + ebuflen, output.begin() + oldSize);
+    crypt(vector, output, 0, operation);
+    return output;
+}
+
+
+/**
+ * @brief Does the real encryption/decryption according to the operation type.
+ *
+ * OpenSSL writes directly into @p output which is resized to the maximum size before
+ * and shrinked to the real size after the operation. Nothing is allocated if the capacity
+ * of @p output is large enough.
+ *
+ * @param input the input bytes
+ * @param output the result, @p input may be the whole contents of it
+ * @param offset the position in @p output where the result starts, the bytes before
+ *        are kept
+ * @param operation whether to encrypt or to decrypt
+ */
+void SymmetricEncryptor::crypt(const ByteSpan& input, ByteVector& output, int offset,
+                               OperationType operation) const
+{
+    EVP_CIPHER_CTX* ctx = operation == ENCRYPT ? m_encryptContext : m_decryptContext;
+    const int inputLength = input.size();
+    const int maxLength = inputLength + EVP_CIPHER_block_size(m_cipher_algorithm);
+    int updateLength = 0;
+    int finalLength = 0;
+
+    // keep the key schedule, only reset the IV and the state
+    EVP_CipherInit_ex(ctx, 0, 0, 0, m_iv, operation);
+
+    // OpenSSL can work in place, but not on buffers that overlap otherwise
+    const bool inPlace = offset == 0 && inputLength > 0 && input.data() == output.constData();
+    ByteVector copy;
+    ByteSpan source = input;
+    if (!inPlace && output.overlaps(input)) {
+        copy.append(input);
+        source = copy;
     }
 
-    EVP_CipherFinal(&ectx, ebuf, &ebuflen);
+    output.reserve(offset + maxLength);
+    if (inPlace)
+        source = ByteSpan(output.constData(), inputLength);
 
-    int oldSize = output.size();
-    output.resize(oldSize + ebuflen);
-    qCopy(ebuf, ebuf + ebuflen, output.begin() + oldSize);
+    output.resize(offset + maxLength);
+    unsigned char* target = output.data() + offset;
+    EVP_CipherUpdate(ctx, target, &updateLength, source.data(), inputLength);
+    EVP_CipherFinal_ex(ctx, target + updateLength, &finalLength);
+    output.resize(offset + updateLength + finalLength);
+}
 
-    EVP_CIPHER_CTX_cleanup(&ectx);
 
-    return output;
+/**
+ * @brief Looks up the cipher and creates the contexts.
+ *
+ * @param algorithm the algorithm as string
+ * @exception NoSuchAlgorithmException if the algorithm is not supported
+ */
+void SymmetricEncryptor::initCipher(const QString& algorithm)
+    throw (NoSuchAlgorithmException)
+{
+    // set the right cipher algorithm
+    if (m_algorithms.contains(algorithm.upper()))
+        m_cipher_algorithm = EVP_get_cipherbyname(m_algorithms[algorithm.upper()]);
+    else
+        throw NoSuchAlgorithmException(("Algorithm "+algorithm+" not supported").latin1());
+
+    m_encryptContext = EVP_CIPHER_CTX_new();
+    m_decryptContext = EVP_CIPHER_CTX_new();
+    m_currentAlgorithm = algorithm;
+}
+
+
+/**
+ * @brief Computes key and IV of the cipher from a derived key.
+ *
+ * @param key the key from KeyDerivation::deriveKey()
+ */
+void SymmetricEncryptor::setKey(const ByteSpan& key)
+{
+    EVP_BytesToKey(m_cipher_algorithm, EVP_sha256(), 0, key.data(), key.size(), 1, m_key, m_iv);
+    initContexts();
+}
+
+
+/**
+ * @brief Sets up both cipher contexts with the current key.
+ */
+void SymmetricEncryptor::initContexts()
+{
+    EVP_CipherInit_ex(m_encryptContext, m_cipher_algorithm, 0, m_key, m_iv, ENCRYPT);
+    EVP_CipherInit_ex(m_decryptContext, m_cipher_algorithm, 0, m_key, m_iv, DECRYPT);
 }
 
 
@@ -223,6 +422,7 @@ void SymmetricEncryptor::setPassword(const QString& password)
     Q3CString pwUtf8 = password.utf8();
     EVP_BytesToKey(m_cipher_algorithm, HASH_ALGORITHM, 0,
         (unsigned char *)pwUtf8.operator const char*(), pwUtf8.length(), 1, m_key, m_iv);
+    initContexts();
 }
 
 
@@ -28,12 +28,23 @@ class SymmetricEncryptor : public AbstractEncryptor
     public:
         SymmetricEncryptor(const QString& algorithm, const QString& password)
             throw (NoSuchAlgorithmException);
+        SymmetricEncryptor(const QString& algorithm, const ByteSpan& key)
+            throw (NoSuchAlgorithmException);
+        virtual ~SymmetricEncryptor();
+
+        SymmetricEncryptor* clone() const;
 
         virtual QString getCurrentAlgorithm() const;
         static QStringList getAlgorithms();
 
-        ByteVector encrypt(const ByteVector& vector);
-        ByteVector decrypt(const ByteVector& vector);
+        ByteVector encrypt(const ByteSpan& vector);
+        ByteVector decrypt(const ByteSpan& vector);
+
+        void encryptMany(const ByteVector* input, ByteVector* output, unsigned int count);
+        void decryptMany(const ByteVector* input, ByteVector* output, unsigned int count);
+
+        void appendEncrypted(const ByteSpan& input, ByteVector& output);
+        int maximumEncryptedSize(int size) const;
 
         virtual void setPassword(const QString& password);
         static QString getSuggestedAlgorithm();
@@ -44,13 +55,27 @@ class SymmetricEncryptor : public AbstractEncryptor
         };
 
     protected:
-        virtual ByteVector crypt(const ByteVector& vector, OperationType operation) const;
+        virtual ByteVector crypt(const ByteSpan& vector, OperationType operation) const;
+        void crypt(const ByteSpan& input, ByteVector& output, int offset,
+                   OperationType operation) const;
+
+    private:
+        void initCipher(const QString& algorithm)
+            throw (NoSuchAlgorithmException);
+        void setKey(const ByteSpan& key);
+        void initContexts();
+
+    private:
+        SymmetricEncryptor(const SymmetricEncryptor& other);
+        SymmetricEncryptor& operator=(const SymmetricEncryptor&);
 
     private:
         const EVP_CIPHER*     m_cipher_algorithm;
         mutable unsigned char m_key[EVP_MAX_KEY_LENGTH];
         mutable unsigned char m_iv[EVP_MAX_IV_LENGTH];
         QString               m_currentAlgorithm;
+        EVP_CIPHER_CTX*       m_encryptContext;
+        EVP_CIPHER_CTX*       m_decryptContext;
 
     private:
         static StringMap initAlgorithmsMap();
@@ -20,6 +20,7 @@
 #include "qpamat.h"
 #include "security/symmetricencryptor.h"
 #include "security/passwordgeneratorfactory.h"
+#include "security/passwordcheckerfactory.h"
 #include "settings.h"
 #include "security/encryptor.h"
 
@@ -52,20 +53,30 @@ Settings::Settings()
     DEF_STRING("Main Window/Layout",             "");
     DEF_STRING("General/Datafile",               QDir::homeDirPath() + "/.qpamat");
     DEF_BOOLEA("General/AutoLogin",              true);
+    DEF_BOOLEA("General/AtomicSave",             true);
+    DEF_INTEGE("General/Backups",                2);
+    DEF_STRING("General/FileFormat",             "XML");
     DEF_STRING("AutoText/Misc",                  "");
     DEF_STRING("AutoText/Username",              "Username");
     DEF_STRING("AutoText/Password",              "Password");
     DEF_STRING("AutoText/URL",                   "URL");
     DEF_STRING("Security/CipherAlgorithm",       SymmetricEncryptor::getSuggestedAlgorithm());
+    DEF_INTEGE("Security/UnlockTime",            500);
+    DEF_INTEGE("Security/KdfIterations",         0);
     DEF_INTEGE("Security/Length",                8);
     DEF_STRING("Security/AllowedCharacters",     "a-zA-Z0-9@$#");
     DEF_DOUBLE("Security/WeakPasswordLimit",     3.0);
     DEF_DOUBLE("Security/StrongPasswordLimit",   15.0);
     DEF_STRING("Security/DictionaryFile",        QDir(Qpamat::basePath() + "/share/qpamat/dicts")
                                                     .canonicalPath() + "/default.txt");
+    DEF_STRING("Security/PasswordChecker",       PasswordCheckerFactory::DEFAULT_CHECKER_STRING);
     DEF_STRING("Security/PasswordGenerator",     PasswordGeneratorFactory::DEFAULT_GENERATOR_STRING);
     DEF_STRING("Security/PasswordGenAdditional", "");
     DEF_INTEGE("Security/AutoLogout",            0);
+    DEF_BOOLEA("Security/LazyDecryption",        false);
+    DEF_INTEGE("Security/PlaintextCacheSize",    32);
+    DEF_INTEGE("Security/PlaintextCacheExpiry",  60);
+    DEF_INTEGE("Security/StrengthLatencyReport", 0);
     DEF_BOOLEA("Smartcard/Library",              false);
     DEF_INTEGE("Smartcard/Port",                 1);
     DEF_STRING("Smartcard/Library",              "");
@@ -25,19 +25,50 @@
 #include <QPixmap>
 #include <QHBoxLayout>
 #include <QDebug>
+#include <QtConcurrentRun>
 
 #include "qpamatwindow.h"
 #include "qpamat.h"
 #include "southpanel.h"
 #include "settings.h"
 #include "util/stringdisplay.h"
+#include "passwordstrengthservice.h"
 
+#ifndef DOXYGEN
+
+/**
+ * @brief Computes the strength of the password in the value field, runs in the thread pool.
+ */
+static SouthPanel::StrengthResult computeStrength(PasswordStrengthService* service,
+                                                  QString password, int generation)
+{
+    SouthPanel::StrengthResult result;
+    result.generation = generation;
+    result.strength = Property::PUndefined;
+    result.daysToCrack = -1.0;
+    try {
+        result.daysToCrack = service->daysToCrack(password);
+        result.strength = service->strength(result.daysToCrack);
+    } catch (const PasswordCheckException& e) {
+        result.error = QString::fromLocal8Bit(e.what());
+    }
+    return result;
+}
+
+#endif // DOXYGEN
 
 /**
  * @class SouthPanel
  *
  * @brief Represents the south panel.
  *
+ * The strength of a password is computed in the background while it's typed. Each change
+ * increments a generation counter, the result of an older generation is discarded and at
+ * most one computation is queued behind the running one. The time from the last change
+ * to the update of the indicator is recorded, see LatencyRecorder. The setting
+ * <tt>Security/StrengthLatencyReport</tt> is the number of updates between two reports of
+ * that time, it's 0 (no reports) by default.
+ *
  * @ingroup gui
  * @author Bernhard Walle
  */
@@ -69,6 +100,12 @@
  * If something was modified, need to determine if saving is necessary.
  */
 
+/**
+ * @class SouthPanel::StrengthResult
+ *
+ * @brief The result of a password strength computation in the background.
+ */
+
 /**
  * @fn SouthPanel::passwordStrengthUpdated()
  *
@@ -83,7 +120,12 @@
  */
 SouthPanel::SouthPanel(QWidget* parent)
     : Q3Frame(parent)
+    , m_currentProperty(0)
     , m_lastStrength(Property::PUndefined)
+    , m_strengthGeneration(0)
+    , m_strengthQueued(false)
+    , m_indicatorLatency("strength indicator", 256,
+                         Qpamat::instance()->set().readNumEntry("Security/StrengthLatencyReport"))
 {
     QHBoxLayout* hLayout = new QHBoxLayout(this, 0, 10, "SouthPanel-QHBoxLayout");
     Q3GroupBox* group = new Q3GroupBox(2, Qt::Horizontal, tr("&Properties"), this, "SouthPanel-GroupBox");
@@ -155,17 +197,36 @@ SouthPanel::SouthPanel(QWidget* parent)
     connect(m_typeCombo, SIGNAL(activated(int)), SIGNAL(stateModified()));
     connect(m_keyLineEdit, SIGNAL(textChanged(const QString&)), SIGNAL(stateModified()));
     connect(m_valueLineEdit, SIGNAL(textChanged(const QString&)), SIGNAL(stateModified()));
-    connect(m_updatePasswordQualityTimer, SIGNAL(timeout()), SLOT(updateIndicatorLabel()));
+    connect(m_updatePasswordQualityTimer, SIGNAL(timeout()), SLOT(startStrengthComputation()));
+    connect(&m_strengthWatcher, SIGNAL(finished()), SLOT(strengthComputed()));
     connect(this, SIGNAL(stateModified()), SIGNAL(passwordStrengthUpdated()));
 }
 
 
+/**
+ * Waits for the password strength computation that is still running.
+ */
+SouthPanel::~SouthPanel()
+{
+    m_strengthWatcher.disconnect(this);
+    m_strengthWatcher.waitForFinished();
+}
+
+
 /**
  * Clears the south panel.
  */
 void SouthPanel::clear()
 {
+    // a result for the old item would be discarded
+    if (m_currentProperty && (m_updatePasswordQualityTimer->isActive() ||
+            m_strengthWatcher.isRunning()))
+        m_currentProperty->setPasswordStrengthPending(false);
+    m_updatePasswordQualityTimer->stop();
+
     m_currentProperty = 0;
+    m_strengthGeneration++;
+    m_strengthQueued = false;
     m_lastStrength = Property::PUndefined;
     m_indicatorLabel->setPixmap(QPixmap());
     m_indicatorLabel->repaint(true);
@@ -182,16 +243,28 @@ void SouthPanel::clear()
 
 
 /**
- * Sets item with the property.
+ * Sets item with the property. If the value cannot be decrypted, the panel stays disabled
+ * because editing the item would replace the value.
  */
 void SouthPanel::setItem (Property* property)
 {
     clear();
 
+    QString value;
+    if (property != 0) {
+        try {
+            value = property->getValue();
+        } catch (const DecryptionException& e) {
+            QMessageBox::warning(this, "QPaMaT", tr("The password could not be decrypted:\n%1")
+                .arg(e.what()), QMessageBox::Ok, QMessageBox::NoButton);
+            property = 0;
+        }
+    }
+
     if (property != 0) {
         blockSignals(true);
         m_typeCombo->setCurrentItem(property->getType());
-        m_valueLineEdit->setText(property->getValue());
+        m_valueLineEdit->setText(value);
         m_keyLineEdit->setText(property->getKey());
         blockSignals(false);
         m_oldComboValue = property->getType();
@@ -264,6 +337,67 @@ void SouthPanel::updateIndicatorLabel(bool recompute)
 }
 
 
+/**
+ * Starts the computation of the password strength in the background.
+ *
+ * If a computation is running, a new one is started when it has finished.
+ */
+void SouthPanel::startStrengthComputation()
+{
+    if (!m_currentProperty || m_currentProperty->getType() != Property::PASSWORD) {
+        updateIndicatorLabel(false);
+        return;
+    }
+
+    if (m_strengthWatcher.isRunning()) {
+        m_strengthQueued = true;
+        return;
+    }
+
+    m_strengthQueued = false;
+    QString password;
+    try {
+        password = m_currentProperty->getValue();
+    } catch (const DecryptionException& e) {
+        qDebug() << CURRENT_FUNCTION << e.what();
+        updateIndicatorLabel(false);
+        return;
+    }
+
+    PasswordStrengthService* service = &Qpamat::instance()->getWindow()->strengthService();
+    m_strengthWatcher.setFuture(QtConcurrent::run(computeStrength, service,
+        password, m_strengthGeneration));
+}
+
+
+/**
+ * Applies the result of the background computation if it is for the current value.
+ */
+void SouthPanel::strengthComputed()
+{
+    StrengthResult result = m_strengthWatcher.result();
+
+    if (m_strengthQueued)
+        startStrengthComputation();
+
+    // the value or the item has changed in the meantime
+    if (result.generation != m_strengthGeneration || !m_currentProperty)
+        return;
+
+    if (!result.error.isNull()) {
+        m_currentProperty->setPasswordStrengthPending(false);
+        QMessageBox::warning(this, "QPaMaT", tr("<qt><nobr>Failed to calculate the password "
+            "strength. The error message</nobr> was:<p>%1<p>Check your configuration!</qt>")
+            .arg(result.error), QMessageBox::Ok, QMessageBox::NoButton);
+        return;
+    }
+
+    m_currentProperty->setPasswordStrength(result.strength, result.daysToCrack);
+    updateIndicatorLabel(false);
+    m_indicatorLatency.add(m_keypressTime.elapsed());
+}
+
+
 /**
  * Updates the data.
  */
@@ -274,7 +408,13 @@ void SouthPanel::updateData()
         m_currentProperty->setHidden(m_typeCombo->currentItem() == Property::PASSWORD);
         m_currentProperty->setEncrypted(m_typeCombo->currentItem() == Property::PASSWORD);
         m_currentProperty->setValue(m_valueLineEdit->text());
-        m_updatePasswordQualityTimer->start(200, true);
+        if (m_currentProperty->getType() == Property::PASSWORD) {
+            // the tree must not compute the strength synchronously while typing
+            m_currentProperty->setPasswordStrengthPending(true);
+            m_strengthGeneration++;
+            m_keypressTime.start();
+            m_updatePasswordQualityTimer->start(200, true);
+        }
         m_currentProperty->setKey(m_keyLineEdit->text());
         m_valueLineEdit->setEchoMode(
             m_currentProperty->isHidden()
@@ -22,16 +22,30 @@
 #include <QEvent>
 #include <QToolButton>
 #include <QTimer>
+#include <QTime>
+#include <QPointer>
+#include <QFutureWatcher>
 
 #include "widgets/focuslineedit.h"
 #include "property.h"
+#include "util/latencyrecorder.h"
 
 class SouthPanel : public Q3Frame
 {
     Q_OBJECT
 
+    public:
+        struct StrengthResult
+        {
+            int                         generation;
+            Property::PasswordStrength  strength;
+            double                      daysToCrack;
+            QString                     error;
+        };
+
     public:
         SouthPanel(QWidget* parent);
+        ~SouthPanel();
         bool isFocusInside() const;
 
     public slots:
@@ -56,9 +70,11 @@ class SouthPanel : public Q3Frame
         void focusInValueHandler();
         void focusOutValueHandler();
         void updateIndicatorLabel(bool recompute = true);
+        void startStrengthComputation();
+        void strengthComputed();
 
     private:
-        Property*                   m_currentProperty;
+        QPointer<Property>          m_currentProperty;
         QLineEdit*                  m_keyLineEdit;
         FocusLineEdit*              m_valueLineEdit;
         QComboBox*                  m_typeCombo;
@@ -68,6 +84,11 @@ class SouthPanel : public Q3Frame
         Property::PasswordStrength  m_lastStrength;
         int                         m_oldComboValue;
         QTimer*                     m_updatePasswordQualityTimer;
+        QFutureWatcher<StrengthResult> m_strengthWatcher;
+        int                         m_strengthGeneration;
+        bool                        m_strengthQueued;
+        QTime                       m_keypressTime;
+        LatencyRecorder             m_indicatorLatency;
 };
 
 #endif // SOUTHPANEL_H
@@ -0,0 +1,218 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <stdexcept>
+
+#include <QObject>
+#include <QByteArray>
+#include <QtTest/QtTest>
+
+#include <security/encodinghelper.h>
+#include <tests/base64bench.h>
+
+/**
+ * @class Base64Bench
+ *
+ * @brief Tests and benchmarks for the Base 64 functions of the EncodingHelper
+ *
+ * The encoder is compared with QByteArray::toBase64() for random data and the old
+ * implementation that appended each character to the string is benchmarked, too.
+ *
+ * @ingroup unittest
+ */
+
+namespace {
+
+const int NUMBER_OF_FIELDS = 5000;
+const int NUMBER_OF_RANDOM_TESTS = 20000;
+
+// the implementation of EncodingHelper::toBase64() before the size was computed
+QString legacyToBase64(const ByteVector& vector)
+{
+    QString result;
+    unsigned char a, b, c;
+    int lenMod3;
+
+    for (int i = 0; i < vector.size(); i += 3) {
+        lenMod3 = ((i+3) > vector.size()) ? (vector.size() % 3) : 3;
+        a = vector[i];
+        b = lenMod3 > 1 ? vector[i+1] : 0;
+        c = lenMod3 > 2 ? vector[i+2] : 0;
+        result += EncodingHelper::base64Alphabet[a >> 2];
+        result += EncodingHelper::base64Alphabet[((a << 4) & 0x30) | (b >> 4)];
+        result += (lenMod3 > 1)
+            ? EncodingHelper::base64Alphabet[((b << 2) & 0x3C) | ((c >> 6) & 0x03)] : '=';
+        result += (lenMod3 > 2) ? EncodingHelper::base64Alphabet[c & 0x3F] : '=';
+    }
+    return result;
+}
+
+// the implementation of EncodingHelper::fromBase64() before the table had 256 entries
+ByteVector legacyFromBase64(const QString& string)
+{
+    int stringLength = string.length();
+    QByteArray ascii = string.toAscii();
+    const char* stringAscii = ascii.constData();
+    Q3ValueVector<unsigned char> vector;
+    char a, b, c, d;
+    for (int i = 0; i < stringLength; i += 4) {
+        a = EncodingHelper::reverseBase64Alphabet[ (int)stringAscii[i] ];
+        b = EncodingHelper::reverseBase64Alphabet[ (int)stringAscii[i+1] ];
+        c = EncodingHelper::reverseBase64Alphabet[ (int)stringAscii[i+2] ];
+        d = EncodingHelper::reverseBase64Alphabet[ (int)stringAscii[i+3] ];
+
+        vector.push_back(((a << 2) | (b >> 4)));
+        vector.push_back(((b & 0x0F) << 4) | (c >> 2));
+        vector.push_back((((c & 0x03) << 6) | d));
+
+        if (d == -2) {
+            vector.pop_back();
+            if (c == -2)
+                vector.pop_back();
+        }
+    }
+
+    return vector;
+}
+
+ByteVector randomBytes(int length)
+{
+    ByteVector bytes(length);
+    for (int i = 0; i < length; ++i)
+        bytes[i] = qrand() & 0xff;
+    return bytes;
+}
+
+} // end anonymous namespace
+
+
+/**
+ * @brief Creates the test data.
+ *
+ * The fields have the size of encrypted passwords, between 8 and 40 bytes.
+ */
+void Base64Bench::initTestCase()
+{
+    qsrand(4711);
+
+    for (int i = 0; i < NUMBER_OF_FIELDS; ++i) {
+        m_bytes.append(randomBytes(8 + (i * 7) % 33));
+        m_strings.append(legacyToBase64(m_bytes.last()));
+    }
+}
+
+
+/**
+ * @brief Encodes and decodes random data of all lengths up to 100 bytes.
+ */
+void Base64Bench::testRoundTrip()
+{
+    QVERIFY(EncodingHelper::toBase64(ByteVector()).isEmpty());
+    QVERIFY(EncodingHelper::fromBase64(QString()).empty());
+
+    for (int i = 0; i < NUMBER_OF_RANDOM_TESTS; ++i) {
+        ByteVector bytes = randomBytes(i % 101);
+        QString encoded = EncodingHelper::toBase64(bytes);
+
+        QByteArray expected = QByteArray(reinterpret_cast<const char*>(bytes.constData()),
+            bytes.size()).toBase64();
+        QCOMPARE(encoded, QString::fromLatin1(expected));
+        QVERIFY(EncodingHelper::fromBase64(encoded) == bytes);
+    }
+
+    for (int i = 0; i < NUMBER_OF_FIELDS; ++i)
+        QVERIFY(EncodingHelper::fromBase64(m_strings[i]) == legacyFromBase64(m_strings[i]));
+}
+
+
+void Base64Bench::testInvalid_data()
+{
+    QTest::addColumn<QString>("string");
+
+    QTest::newRow("length") << QString("QUJD=");
+    QTest::newRow("too much padding") << QString("QQ==QUJD");
+    QTest::newRow("padding in the middle") << QString("QU=D");
+    QTest::newRow("three padding characters") << QString("Q===");
+    QTest::newRow("space") << QString("QU D");
+    QTest::newRow("latin1") << QString::fromLatin1("QUJ\xe4");
+    QTest::newRow("unicode") << (QString("QUJ") + QChar(0x0141));
+}
+
+/**
+ * @brief Checks that strings that are not Base 64 are rejected.
+ */
+void Base64Bench::testInvalid()
+{
+    QFETCH(QString, string);
+
+    bool thrown = false;
+    try {
+        EncodingHelper::fromBase64(string);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    QVERIFY(thrown);
+}
+
+
+/**
+ * @brief Benchmarks the old encoder.
+ */
+void Base64Bench::benchmarkLegacyToBase64()
+{
+    QBENCHMARK {
+        for (int i = 0; i < NUMBER_OF_FIELDS; ++i)
+            legacyToBase64(m_bytes[i]);
+    }
+}
+
+
+/**
+ * @brief Benchmarks EncodingHelper::toBase64().
+ */
+void Base64Bench::benchmarkToBase64()
+{
+    QBENCHMARK {
+        for (int i = 0; i < NUMBER_OF_FIELDS; ++i)
+            EncodingHelper::toBase64(m_bytes[i]);
+    }
+}
+
+
+/**
+ * @brief Benchmarks the old decoder.
+ */
+void Base64Bench::benchmarkLegacyFromBase64()
+{
+    QBENCHMARK {
+        for (int i = 0; i < NUMBER_OF_FIELDS; ++i)
+            legacyFromBase64(m_strings[i]);
+    }
+}
+
+
+/**
+ * @brief Benchmarks EncodingHelper::fromBase64().
+ */
+void Base64Bench::benchmarkFromBase64()
+{
+    QBENCHMARK {
+        for (int i = 0; i < NUMBER_OF_FIELDS; ++i)
+            EncodingHelper::fromBase64(m_strings[i]);
+    }
+}
+
+QTEST_MAIN(Base64Bench)
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
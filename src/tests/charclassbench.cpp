@@ -0,0 +1,237 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <limits>
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include <security/charclassifier.h>
+#include <security/masterpasswordchecker.h>
+#include <tests/charclassbench.h>
+
+/**
+ * @class CharClassBench
+ *
+ * @brief Tests and benchmarks for the CharClassifier
+ *
+ * Compares the table-driven classification with the comparisons that
+ * HybridPasswordChecker::findNumerOfCharsInClass() and MasterPasswordChecker::passwordQuality()
+ * did before.
+ *
+ * @ingroup unittest
+ */
+
+namespace {
+
+const int NUMBER_OF_PASSWORDS = 2000;
+
+// the implementation of HybridPasswordChecker::findNumerOfCharsInClass() before the table
+int legacyCharsetSize(const QString& chars)
+{
+    int ret = 0;
+    bool hasDigits = false, hasLowercase = false, hasUppercase = false, hasUmlauts = false;
+    bool hasSpecial = false, hasOther = false;
+
+    for (int i = 0; i < chars.length(); ++i) {
+        QChar c = chars[i];
+        int l1 = c.latin1() & 0xff;
+
+        if (c.latin1() == 0) {
+            return 255;
+        } else if (!hasDigits && ((c >= '0' && c <= '9') || c == ' ')) {
+            hasDigits = true;
+        } else if (!hasLowercase && c >= 'a' && c <= 'z') {
+            hasLowercase = true;
+        } else if (!hasUppercase && c >= 'A' && c <= 'Z') {
+            hasUppercase = true;
+        } else if (!hasSpecial && (c == ',' || c == '.' || c == '-' || c == ';' || c == ':'
+                || c == '_' || c == '=' || c == '(' || c == ')' || c == '*' || c == '+' || c == '?'
+                || c == '"' || c == '$' || c == '@' ||c == '#' || c == '%' || c == '&' || c == '/'
+                || c == '\\' || c == '{' || c == '}' || c == '[' || c == ']' || c == '!' || c == '^'
+                || c == '?' || c == '\'' || c == '?' || c == '`' || c == '~')) {
+            hasSpecial = true;
+        } else if (!hasUmlauts && ((l1 >= 0xC0 && l1 <= 0xD6) || (l1 >= 0xD8 && l1 <= 0xFF))) {
+            hasUmlauts = true;
+        } else {
+            hasOther = true;
+        }
+    }
+
+    if (hasDigits)
+        ret += 11;
+    if (hasLowercase)
+        ret += 26;
+    if (hasUppercase)
+        ret += 26;
+    if (hasUmlauts)
+        ret += 13;
+    if (hasSpecial)
+        ret += 30;
+    if (hasOther)
+        ret += 118;
+
+    return ret;
+}
+
+// the implementation of MasterPasswordChecker::passwordQuality() before the table
+double legacyMasterQuality(const QString& password)
+{
+    if (password.length() < 8)
+        return false;
+
+    bool uppercase = false;
+    bool lowercase = false;
+    bool nonLetter = false;
+    for (int i = 0; i < password.length(); ++i) {
+        const QChar character = password[i];
+        QChar::Category cat = character.category();
+        if (cat == QChar::Letter_Uppercase)
+            uppercase = true;
+        else if (cat == QChar::Letter_Lowercase)
+            lowercase = true;
+        else if (! character.isLetter())
+            nonLetter = true;
+    }
+
+    return uppercase && lowercase && nonLetter ? std::numeric_limits<double>::max() : 0.0;
+}
+
+} // end anonymous namespace
+
+
+/**
+ * @brief Creates the passwords.
+ *
+ * There are short ASCII passwords, Latin-1 passwords, long passphrases and some
+ * passwords with characters outside of Latin-1.
+ */
+void CharClassBench::initTestCase()
+{
+    for (int i = 0; i < NUMBER_OF_PASSWORDS; ++i) {
+        QString password;
+        int length = (i % 10 == 0) ? 64 + i % 64 : 6 + i % 14;
+        for (int j = 0; j < length; ++j) {
+            unsigned int r = (i * 2654435761U + j * 40503U) >> 7;
+            switch (i % 5) {
+                case 0:
+                case 1:
+                    password += QChar(' ' + r % 95);
+                    break;
+                case 2:
+                    password += QChar('a' + r % 26);
+                    break;
+                case 3:
+                    password += QChar(1 + r % 0xff);
+                    break;
+                default:
+                    password += QChar(r % 8 == 0 ? 0x100 + r % 0x500 : ' ' + r % 95);
+                    break;
+            }
+        }
+        m_passwords.append(password);
+    }
+}
+
+
+/**
+ * @brief Checks the character set size for all single characters and for the passwords.
+ */
+void CharClassBench::testCharsetSize()
+{
+    for (int i = 0; i < 0x600; ++i) {
+        QString c(QChar(i));
+        QCOMPARE(CharClassifier::charsetSize(c), legacyCharsetSize(c));
+        QCOMPARE(CharClassifier::charsetSize(c + c), legacyCharsetSize(c + c));
+    }
+
+    foreach (const QString& password, m_passwords)
+        QCOMPARE(CharClassifier::charsetSize(password), legacyCharsetSize(password));
+}
+
+
+/**
+ * @brief Checks the MasterPasswordChecker for all characters in a password and for the
+ *        passwords.
+ */
+void CharClassBench::testMasterChecker()
+{
+    MasterPasswordChecker checker;
+
+    for (int i = 0; i < 0x600; ++i) {
+        QString password = QString("aB1aB1a") + QChar(i);
+        QCOMPARE(checker.passwordQuality(password), legacyMasterQuality(password));
+        password = QString("abcdefg") + QChar(i);
+        QCOMPARE(checker.passwordQuality(password), legacyMasterQuality(password));
+        password = QString("ABCDEF1") + QChar(i);
+        QCOMPARE(checker.passwordQuality(password), legacyMasterQuality(password));
+    }
+
+    foreach (const QString& password, m_passwords)
+        QCOMPARE(checker.passwordQuality(password), legacyMasterQuality(password));
+}
+
+
+/**
+ * @brief Benchmarks the former character set size computation.
+ */
+void CharClassBench::benchmarkLegacyCharsetSize()
+{
+    QBENCHMARK {
+        foreach (const QString& password, m_passwords)
+            legacyCharsetSize(password);
+    }
+}
+
+
+/**
+ * @brief Benchmarks CharClassifier::charsetSize().
+ */
+void CharClassBench::benchmarkCharsetSize()
+{
+    QBENCHMARK {
+        foreach (const QString& password, m_passwords)
+            CharClassifier::charsetSize(password);
+    }
+}
+
+
+/**
+ * @brief Benchmarks the former MasterPasswordChecker.
+ */
+void CharClassBench::benchmarkLegacyMasterChecker()
+{
+    QBENCHMARK {
+        foreach (const QString& password, m_passwords)
+            legacyMasterQuality(password);
+    }
+}
+
+
+/**
+ * @brief Benchmarks the MasterPasswordChecker.
+ */
+void CharClassBench::benchmarkMasterChecker()
+{
+    MasterPasswordChecker checker;
+
+    QBENCHMARK {
+        foreach (const QString& password, m_passwords)
+            checker.passwordQuality(password);
+    }
+}
+
+QTEST_MAIN(CharClassBench)
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,328 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QObject>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QtTest/QtTest>
+
+#include <security/dictionarymatcher.h>
+#include <security/dictionaryindex.h>
+#include <security/patternpasswordchecker.h>
+#include <tests/checkerbench.h>
+
+/**
+ * @class CheckerBench
+ *
+ * @brief Tests and benchmarks for the DictionaryMatcher and the PatternPasswordChecker
+ *
+ * Compares the Aho-Corasick matcher with the linear scan over the dictionary that
+ * HybridPasswordChecker::findLongestWord() did before. All dictionaries in
+ * <tt>share/dicts</tt> are used.
+ *
+ * @ingroup unittest
+ */
+
+namespace {
+
+const int NUMBER_OF_PASSWORDS = 500;
+
+// the implementation of HybridPasswordChecker::findLongestWord() before the matcher was used
+int legacyFindLongestWord(const StringVector& words, const QMap<int, int>& lengthBeginMap,
+                          const QString& password)
+{
+    int pwLength = password.length();
+    while (!lengthBeginMap.contains(pwLength) && pwLength >= 0)
+        --pwLength;
+
+    if (pwLength < 0)
+        return -1;
+
+    for (int i = lengthBeginMap[pwLength]; i < int(words.size()); ++i) {
+        if (password.contains(words[i], false))
+            return i;
+    }
+
+    return -1;
+}
+
+QMap<int, int> lengthBeginMap(const StringVector& words)
+{
+    QMap<int, int> map;
+    int oldLength = 0;
+    for (int i = 0; i < int(words.size()); ++i) {
+        if (words[i].length() != oldLength) {
+            oldLength = words[i].length();
+            map.insert(oldLength, i);
+        }
+    }
+    return map;
+}
+
+} // end anonymous namespace
+
+
+/**
+ * @brief Finds the dictionaries and creates the passwords.
+ *
+ * The passwords are words of the default dictionary with a changed case and some digits
+ * and special characters around them, and some random strings.
+ */
+void CheckerBench::initTestCase()
+{
+    QDir dir(DICTS_DIR);
+    QStringList files = dir.entryList(QStringList("*.txt"), QDir::Files, QDir::Name);
+    foreach (const QString& file, files)
+        m_dictionaries.append(dir.filePath(file));
+    if (m_dictionaries.isEmpty())
+        QSKIP("No dictionaries found in " DICTS_DIR, SkipAll);
+
+    StringVector words = readDictionary(dir.filePath("default.txt"));
+    QVERIFY(!words.isEmpty());
+
+    for (int i = 0; i < NUMBER_OF_PASSWORDS; ++i) {
+        QString password;
+        switch (i % 4) {
+            case 0:
+                password = words[(i * 7919) % words.size()].toUpper() + QString::number(i);
+                break;
+            case 1:
+                password = "#" + words[(i * 104729) % words.size()] + "!x"
+                    + words[(i * 31) % words.size()].left(3);
+                break;
+            case 2:
+                for (int j = 0; j < 12; ++j)
+                    password += QChar('!' + (i * 31 + j * 17) % 90);
+                break;
+            default:
+                password = QString::number(i * 2654435761U, 36) + words[i % words.size()];
+                break;
+        }
+        m_passwords.append(password);
+    }
+}
+
+
+/**
+ * @brief Adds one row per dictionary.
+ */
+void CheckerBench::addDictionaries()
+{
+    QTest::addColumn<QString>("dictionary");
+    foreach (const QString& dict, m_dictionaries)
+        QTest::newRow(QFileInfo(dict).fileName().toLatin1().constData()) << dict;
+}
+
+
+/**
+ * @brief Reads a dictionary like the HybridPasswordChecker does.
+ *
+ * @param fileName the dictionary file
+ * @return the words, without the words of length 1
+ */
+StringVector CheckerBench::readDictionary(const QString& fileName)
+{
+    StringVector words;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return words;
+
+    // the dictionaries in share/dicts are ISO-8859-1 like the index assumes
+    QTextStream stream(&file);
+    stream.setCodec("ISO-8859-1");
+    while (!stream.atEnd()) {
+        QString text = stream.readLine();
+        if (text.length() == 1)
+            break;
+        words.append(text);
+    }
+
+    return words;
+}
+
+
+void CheckerBench::testSameResult_data()
+{
+    addDictionaries();
+}
+
+/**
+ * @brief Checks that the matcher finds the same word as the linear scan.
+ */
+void CheckerBench::testSameResult()
+{
+    QFETCH(QString, dictionary);
+
+    StringVector words = readDictionary(dictionary);
+    QMap<int, int> map = lengthBeginMap(words);
+    DictionaryMatcher matcher;
+    matcher.build(words);
+
+    foreach (const QString& password, m_passwords) {
+        int expected = legacyFindLongestWord(words, map, password);
+        int found = matcher.findLongestWord(password);
+
+        // the same word may be in the dictionary twice, the text is what counts
+        QCOMPARE(found >= 0 ? words[found] : QString(),
+                 expected >= 0 ? words[expected] : QString());
+    }
+}
+
+
+/**
+ * @brief Checks that the index built by <tt>util/build_dictindex.pl</tt> finds the same
+ *        words as the text file.
+ */
+void CheckerBench::testIndex()
+{
+    DictionaryIndex index;
+    if (!index.open(QString(DICTINDEX_DIR) + "/default.txt.idx"))
+        QSKIP("The dictionary index has not been built", SkipSingle);
+
+    StringVector words = readDictionary(QString(DICTS_DIR) + "/default.txt");
+    QCOMPARE(index.wordCount(), int(words.size()));
+    QCOMPARE(index.maxLength(), words.first().length());
+
+    DictionaryMatcher fromText;
+    fromText.build(words);
+    DictionaryMatcher fromIndex;
+    fromIndex.build(index);
+
+    foreach (const QString& password, m_passwords) {
+        int expected = fromText.findLongestWord(password);
+        int found = fromIndex.findLongestWord(password);
+        QCOMPARE(found >= 0 ? index.word(found) : QString(),
+                 expected >= 0 ? words[expected].toLower() : QString());
+    }
+}
+
+
+void CheckerBench::testAllWords_data()
+{
+    addDictionaries();
+}
+
+/**
+ * @brief Checks that DictionaryMatcher::findAllWords() contains the longest word.
+ */
+void CheckerBench::testAllWords()
+{
+    QFETCH(QString, dictionary);
+
+    StringVector words = readDictionary(dictionary);
+    DictionaryMatcher matcher;
+    matcher.build(words);
+
+    QVector<DictionaryMatcher::Match> matches;
+    foreach (const QString& password, m_passwords) {
+        matches.clear();
+        matcher.findAllWords(password, matches);
+
+        int longest = -1;
+        for (int i = 0; i < matches.size(); ++i) {
+            const DictionaryMatcher::Match& match = matches[i];
+            QVERIFY(password.mid(match.begin, match.length).toLower()
+                    == words[match.word].toLower());
+            if (longest < 0 || match.length > matches[longest].length
+                    || (match.length == matches[longest].length
+                        && match.word < matches[longest].word))
+                longest = i;
+        }
+
+        QCOMPARE(longest >= 0 ? matches[longest].word : -1, matcher.findLongestWord(password));
+    }
+}
+
+
+/**
+ * @brief Checks that the PatternPasswordChecker rates common patterns lower than random
+ *        characters of the same length.
+ */
+void CheckerBench::testPatternChecker()
+{
+    PatternPasswordChecker checker(QString(DICTS_DIR) + "/default.txt");
+
+    const double random8 = checker.entropy("x7#Lq9!v");
+    QVERIFY(checker.entropy("P4ssw0rd") < random8 / 2);
+    QVERIFY(checker.entropy("qwertz12") < random8 / 2);
+    QVERIFY(checker.entropy("12.03.85") < random8 / 2);
+    QVERIFY(checker.entropy("aaaaaaaa") < random8 / 2);
+    QVERIFY(checker.entropy("abcdefgh") < random8 / 2);
+    QVERIFY(checker.entropy("x7#Lq9!vRz2@") > random8);
+}
+
+
+void CheckerBench::benchmarkLinearScan_data()
+{
+    addDictionaries();
+}
+
+/**
+ * @brief Benchmarks the linear scan over the dictionary.
+ */
+void CheckerBench::benchmarkLinearScan()
+{
+    QFETCH(QString, dictionary);
+
+    StringVector words = readDictionary(dictionary);
+    QMap<int, int> map = lengthBeginMap(words);
+
+    QBENCHMARK {
+        foreach (const QString& password, m_passwords)
+            legacyFindLongestWord(words, map, password);
+    }
+}
+
+
+void CheckerBench::benchmarkMatcher_data()
+{
+    addDictionaries();
+}
+
+/**
+ * @brief Benchmarks the DictionaryMatcher, the build time is not included.
+ */
+void CheckerBench::benchmarkMatcher()
+{
+    QFETCH(QString, dictionary);
+
+    DictionaryMatcher matcher;
+    matcher.build(readDictionary(dictionary));
+
+    QBENCHMARK {
+        foreach (const QString& password, m_passwords)
+            matcher.findLongestWord(password);
+    }
+}
+
+
+/**
+ * @brief Benchmarks the PatternPasswordChecker with the default dictionary.
+ */
+void CheckerBench::benchmarkPatternChecker()
+{
+    PatternPasswordChecker checker(QString(DICTS_DIR) + "/default.txt");
+
+    QBENCHMARK {
+        foreach (const QString& password, m_passwords)
+            checker.entropy(password);
+    }
+}
+
+QTEST_MAIN(CheckerBench)
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
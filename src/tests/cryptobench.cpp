@@ -0,0 +1,363 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <stdexcept>
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include <openssl/evp.h>
+
+#include <security/symmetricencryptor.h>
+#include <security/parallelcryptor.h>
+#include <security/encodinghelper.h>
+#include <security/collectencryptor.h>
+#include <util/securearena.h>
+#include <tests/cryptobench.h>
+
+/**
+ * @class CryptoBench
+ *
+ * @brief Tests and benchmarks for the SymmetricEncryptor
+ *
+ * Compares the encryption of many small fields (that's what happens with the
+ * passwords when loading or saving) with the old implementation that set up a
+ * new cipher context for each field.
+ *
+ * @ingroup unittest
+ */
+
+namespace {
+
+const char          PASSWORD[]      = "benchmark";
+const unsigned int  NUMBER_OF_FIELDS = 5000;
+
+// the implementation of SymmetricEncryptor::crypt() before the contexts were kept
+ByteVector legacyCrypt(const EVP_CIPHER* cipher, unsigned char* key, unsigned char* iv,
+                       const ByteVector& vector, int operation)
+{
+    const int BUFLEN = 512;
+    unsigned char buf[BUFLEN];
+    unsigned char ebuf[BUFLEN + 8];
+    ByteVector output;
+    EVP_CIPHER_CTX ectx;
+    int ebuflen;
+    ByteVector::ConstIterator beginOfVector = vector.begin();
+    unsigned int sizeOfVector = vector.size();
+    EVP_CipherInit(&ectx, cipher, key, iv, operation);
+
+    for (unsigned int i = 0; i < sizeOfVector; i += BUFLEN) {
+        int readLen = (i + BUFLEN >= sizeOfVector)
+            ? sizeOfVector - i
+            : BUFLEN;
+        qCopy(beginOfVector + i, beginOfVector + i + readLen, buf);
+        EVP_CipherUpdate(&ectx, ebuf, &ebuflen, buf, readLen);
+
+        int oldSize = output.size();
+        output.resize(oldSize + ebuflen);
+        qCopy( ebuf, ebuf + ebuflen, output.begin() + oldSize);
+    }
+
+    EVP_CipherFinal(&ectx, ebuf, &ebuflen);
+
+    int oldSize = output.size();
+    output.resize(oldSize + ebuflen);
+    qCopy(ebuf, ebuf + ebuflen, output.begin() + oldSize);
+
+    EVP_CIPHER_CTX_cleanup(&ectx);
+
+    return output;
+}
+
+} // end anonymous namespace
+
+
+/**
+ * @brief Creates the test data.
+ */
+void CryptoBench::initTestCase()
+{
+    if (!SymmetricEncryptor::getAlgorithms().contains("BLOWFISH"))
+        QSKIP("Blowfish is not available", SkipAll);
+
+    m_cipher = EVP_get_cipherbyname("bf");
+    QVERIFY(m_cipher != 0);
+    EVP_BytesToKey(m_cipher, EVP_ripemd160(), 0, (const unsigned char*)PASSWORD,
+        sizeof(PASSWORD) - 1, 1, m_key, m_iv);
+
+    // passwords with a length between 6 and 30 bytes
+    m_plain.resize(NUMBER_OF_FIELDS);
+    m_encrypted.resize(NUMBER_OF_FIELDS);
+    for (unsigned int i = 0; i < NUMBER_OF_FIELDS; ++i) {
+        ByteVector& field = m_plain[i];
+        field.resize(6 + (i * 7) % 25);
+        for (int j = 0; j < field.size(); ++j)
+            field[j] = (unsigned char)('!' + (i * 31 + j * 17) % 90);
+        m_encrypted[i] = legacyCrypt(m_cipher, m_key, m_iv, field, 1);
+
+        m_plainStrings.append(QString::fromLatin1((const char*)field.begin(), field.size()));
+        m_encryptedStrings.append(EncodingHelper::toBase64(m_encrypted[i]));
+    }
+}
+
+
+/**
+ * @brief Checks that the result is the same as with the old implementation.
+ */
+void CryptoBench::testSameResult() const
+{
+    SymmetricEncryptor enc("BLOWFISH", PASSWORD);
+
+    for (unsigned int i = 0; i < NUMBER_OF_FIELDS; ++i) {
+        QVERIFY(enc.encrypt(m_plain[i]) == m_encrypted[i]);
+        QVERIFY(enc.decrypt(m_encrypted[i]) == m_plain[i]);
+    }
+
+    QVERIFY(enc.decrypt(enc.encrypt(ByteVector())) == ByteVector());
+}
+
+
+/**
+ * @brief Checks encryptMany() and decryptMany(), also if input and output are the same.
+ */
+void CryptoBench::testMany()
+{
+    SymmetricEncryptor enc("BLOWFISH", PASSWORD);
+    QVector<ByteVector> result(NUMBER_OF_FIELDS);
+
+    enc.encryptMany(m_plain.constData(), result.data(), NUMBER_OF_FIELDS);
+    QVERIFY(result == m_encrypted);
+
+    enc.decryptMany(result.constData(), result.data(), NUMBER_OF_FIELDS);
+    QVERIFY(result == m_plain);
+}
+
+
+/**
+ * @brief Checks that the ParallelCryptor keeps the order.
+ */
+void CryptoBench::testParallel()
+{
+    SymmetricEncryptor enc("BLOWFISH", PASSWORD);
+    ParallelCryptor cryptor(enc);
+
+    QCOMPARE(cryptor.encryptStrings(m_plainStrings), m_encryptedStrings);
+    QCOMPARE(cryptor.decryptStrings(m_encryptedStrings), m_plainStrings);
+    QCOMPARE(cryptor.decryptStrings(QStringList()), QStringList());
+
+    bool thrown = false;
+    try {
+        cryptor.decryptStrings(QStringList() << "abc");
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    QVERIFY(thrown);
+}
+
+
+/**
+ * @brief Checks that encryptMany() and decryptMany() reuse the memory of the output.
+ */
+void CryptoBench::testAllocations()
+{
+    SymmetricEncryptor enc("BLOWFISH", PASSWORD);
+    SecureArena& arena = SecureArena::instance();
+    QVector<ByteVector> result(NUMBER_OF_FIELDS);
+
+    // one allocation for each field that was empty
+    arena.resetCounters();
+    enc.encryptMany(m_plain.constData(), result.data(), NUMBER_OF_FIELDS);
+    QCOMPARE(arena.allocationCount(), int(NUMBER_OF_FIELDS));
+
+    arena.resetCounters();
+    enc.encryptMany(m_plain.constData(), result.data(), NUMBER_OF_FIELDS);
+    QCOMPARE(arena.allocationCount(), 0);
+
+    // decrypting in place needs one block more than encrypting, so the first
+    // round may grow the buffers, but a second round must not
+    enc.decryptMany(result.constData(), result.data(), NUMBER_OF_FIELDS);
+    enc.encryptMany(result.constData(), result.data(), NUMBER_OF_FIELDS);
+    arena.resetCounters();
+    enc.decryptMany(result.constData(), result.data(), NUMBER_OF_FIELDS);
+    enc.encryptMany(result.constData(), result.data(), NUMBER_OF_FIELDS);
+    enc.decryptMany(result.constData(), result.data(), NUMBER_OF_FIELDS);
+    QCOMPARE(arena.allocationCount(), 0);
+    QVERIFY(result == m_plain);
+}
+
+
+/**
+ * @brief Checks the references of the CollectEncryptor, also the legacy ones.
+ */
+void CryptoBench::testCollect()
+{
+    SymmetricEncryptor enc("BLOWFISH", PASSWORD);
+    CollectEncryptor collector(enc);
+    SecureArena& arena = SecureArena::instance();
+
+    int size = 0;
+    for (unsigned int i = 0; i < NUMBER_OF_FIELDS; ++i)
+        size += enc.maximumEncryptedSize(m_plainStrings[i].toUtf8().size());
+    collector.reserve(size);
+
+    // the card image must not be reallocated
+    QStringList references;
+    arena.resetCounters();
+    for (unsigned int i = 0; i < NUMBER_OF_FIELDS; ++i)
+        references.append(collector.encryptStrToStr(m_plainStrings[i]));
+    QCOMPARE(arena.allocationCount(), 0);
+
+    int offset = 0;
+    for (unsigned int i = 0; i < NUMBER_OF_FIELDS; ++i) {
+        QCOMPARE(references[i].length(), 8);
+        QCOMPARE(collector.decryptStrFromStr(references[i]), m_plainStrings[i]);
+
+        const QString legacy = QString("SMARTCARD:%1:%2").arg(offset).arg(m_encrypted[i].size());
+        QCOMPARE(collector.decryptStrFromStr(legacy), m_plainStrings[i]);
+        offset += m_encrypted[i].size();
+    }
+    QCOMPARE(collector.getBytes().size(), offset);
+
+    const char* invalid[] = { "AAAAAB==", "AA*AAA==", "SMARTCARD:1", "SMARTCARD:0:-1" };
+    for (unsigned int i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        bool thrown = false;
+        try {
+            collector.decryptStrFromStr(invalid[i]);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        QVERIFY(thrown);
+    }
+}
+
+
+/**
+ * @brief Encryption with a new context for each field.
+ */
+void CryptoBench::benchmarkLegacyEncrypt() const
+{
+    unsigned char key[EVP_MAX_KEY_LENGTH];
+    unsigned char iv[EVP_MAX_IV_LENGTH];
+    qCopy(m_key, m_key + EVP_MAX_KEY_LENGTH, key);
+    qCopy(m_iv, m_iv + EVP_MAX_IV_LENGTH, iv);
+
+    QBENCHMARK {
+        for (unsigned int i = 0; i < NUMBER_OF_FIELDS; ++i)
+            legacyCrypt(m_cipher, key, iv, m_plain[i], 1);
+    }
+}
+
+
+/**
+ * @brief Encryption with SymmetricEncryptor::encrypt().
+ */
+void CryptoBench::benchmarkEncrypt()
+{
+    SymmetricEncryptor enc("BLOWFISH", PASSWORD);
+
+    QBENCHMARK {
+        for (unsigned int i = 0; i < NUMBER_OF_FIELDS; ++i)
+            enc.encrypt(m_plain[i]);
+    }
+}
+
+
+/**
+ * @brief Encryption with SymmetricEncryptor::encryptMany().
+ */
+void CryptoBench::benchmarkEncryptMany()
+{
+    SymmetricEncryptor enc("BLOWFISH", PASSWORD);
+    QVector<ByteVector> result(NUMBER_OF_FIELDS);
+
+    QBENCHMARK {
+        enc.encryptMany(m_plain.constData(), result.data(), NUMBER_OF_FIELDS);
+    }
+}
+
+
+/**
+ * @brief Decryption with a new context for each field.
+ */
+void CryptoBench::benchmarkLegacyDecrypt() const
+{
+    unsigned char key[EVP_MAX_KEY_LENGTH];
+    unsigned char iv[EVP_MAX_IV_LENGTH];
+    qCopy(m_key, m_key + EVP_MAX_KEY_LENGTH, key);
+    qCopy(m_iv, m_iv + EVP_MAX_IV_LENGTH, iv);
+
+    QBENCHMARK {
+        for (unsigned int i = 0; i < NUMBER_OF_FIELDS; ++i)
+            legacyCrypt(m_cipher, key, iv, m_encrypted[i], 0);
+    }
+}
+
+
+/**
+ * @brief Decryption with SymmetricEncryptor::decrypt().
+ */
+void CryptoBench::benchmarkDecrypt()
+{
+    SymmetricEncryptor enc("BLOWFISH", PASSWORD);
+
+    QBENCHMARK {
+        for (unsigned int i = 0; i < NUMBER_OF_FIELDS; ++i)
+            enc.decrypt(m_encrypted[i]);
+    }
+}
+
+
+/**
+ * @brief Decryption with SymmetricEncryptor::decryptMany().
+ */
+void CryptoBench::benchmarkDecryptMany()
+{
+    SymmetricEncryptor enc("BLOWFISH", PASSWORD);
+    QVector<ByteVector> result(NUMBER_OF_FIELDS);
+
+    QBENCHMARK {
+        enc.decryptMany(m_encrypted.constData(), result.data(), NUMBER_OF_FIELDS);
+    }
+}
+
+/**
+ * @brief Decryption of Base 64 strings in one thread.
+ */
+void CryptoBench::benchmarkSerialDecryptStrings()
+{
+    SymmetricEncryptor enc("BLOWFISH", PASSWORD);
+
+    QBENCHMARK {
+        for (unsigned int i = 0; i < NUMBER_OF_FIELDS; ++i)
+            enc.decryptStrFromStr(m_encryptedStrings[i]);
+    }
+}
+
+
+/**
+ * @brief Decryption of Base 64 strings with the ParallelCryptor.
+ */
+void CryptoBench::benchmarkParallelDecryptStrings()
+{
+    SymmetricEncryptor enc("BLOWFISH", PASSWORD);
+    ParallelCryptor cryptor(enc);
+
+    QBENCHMARK {
+        cryptor.decryptStrings(m_encryptedStrings);
+    }
+}
+
+QTEST_MAIN(CryptoBench)
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
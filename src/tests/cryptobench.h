@@ -0,0 +1,55 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QObject>
+#include <QVector>
+#include <QStringList>
+#include <QtTest/QtTest>
+
+#include <openssl/evp.h>
+
+#include "global.h"
+
+class CryptoBench : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void initTestCase();
+        void testSameResult() const;
+        void testMany();
+        void testParallel();
+        void testAllocations();
+        void testCollect();
+
+        void benchmarkLegacyEncrypt() const;
+        void benchmarkEncrypt();
+        void benchmarkEncryptMany();
+        void benchmarkLegacyDecrypt() const;
+        void benchmarkDecrypt();
+        void benchmarkDecryptMany();
+        void benchmarkSerialDecryptStrings();
+        void benchmarkParallelDecryptStrings();
+
+    private:
+        const EVP_CIPHER*   m_cipher;
+        unsigned char       m_key[EVP_MAX_KEY_LENGTH];
+        unsigned char       m_iv[EVP_MAX_IV_LENGTH];
+        QVector<ByteVector> m_plain;
+        QVector<ByteVector> m_encrypted;
+        QStringList         m_plainStrings;
+        QStringList         m_encryptedStrings;
+};
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
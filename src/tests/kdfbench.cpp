@@ -0,0 +1,169 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QObject>
+#include <QByteArray>
+#include <QTime>
+#include <QtTest/QtTest>
+
+#include <security/keyderivation.h>
+#include <security/passwordhash.h>
+#include <security/symmetricencryptor.h>
+#include <tests/kdfbench.h>
+
+/**
+ * @class KdfBench
+ *
+ * @brief Tests and benchmarks for the KeyDerivation.
+ *
+ * The benchmarks report the time to unlock a data file, i.e. deriving the key, checking
+ * the password and setting up the encryptor, for several numbers of iterations and for
+ * files of older versions.
+ *
+ * @ingroup unittest
+ */
+
+namespace {
+
+const char PASSWORD[]   = "benchmark";
+const char ALGORITHM[]  = "AES";
+
+}
+
+/**
+ * @brief Test vectors for PBKDF2-HMAC-SHA256.
+ */
+void KdfBench::testVectors_data()
+{
+    QTest::addColumn<QString>("password");
+    QTest::addColumn<QByteArray>("salt");
+    QTest::addColumn<int>("iterations");
+    QTest::addColumn<QByteArray>("key");
+
+    // RFC 7914, section 11, and the same vector with more iterations
+    QTest::newRow("rfc 7914") << "passwd" << QByteArray("salt") << 1
+        << QByteArray::fromHex("55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc");
+    QTest::newRow("80000") << "Password" << QByteArray("NaCl") << 80000
+        << QByteArray::fromHex("4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56");
+}
+
+
+/**
+ * @brief Checks KeyDerivation::deriveKey() with known results.
+ */
+void KdfBench::testVectors()
+{
+    QFETCH(QString, password);
+    QFETCH(QByteArray, salt);
+    QFETCH(int, iterations);
+    QFETCH(QByteArray, key);
+
+    const KeyDerivation kdf(KeyDerivation::PBKDF2_SHA256, iterations, salt);
+    const ByteVector derived = kdf.deriveKey(password);
+    QCOMPARE(QByteArray(reinterpret_cast<const char*>(derived.constData()), derived.size()), key);
+}
+
+
+/**
+ * @brief Checks that only the right key matches the hash and that new salts differ.
+ */
+void KdfBench::testKeyHash()
+{
+    const KeyDerivation kdf = KeyDerivation::create(KeyDerivation::MIN_ITERATIONS);
+    QCOMPARE(kdf.getIterations(), KeyDerivation::MIN_ITERATIONS);
+    QCOMPARE(kdf.getSalt().size(), KeyDerivation::SALT_LENGTH);
+    QVERIFY(kdf.getSalt() != KeyDerivation::create(1).getSalt());
+
+    const ByteVector key = kdf.deriveKey(PASSWORD);
+    const QString hash = PasswordHash::generateKeyHashString(key);
+    QVERIFY(PasswordHash::isCorrectKey(key, hash));
+    QVERIFY(!PasswordHash::isCorrectKey(kdf.deriveKey("wrong"), hash));
+    QVERIFY(!PasswordHash::isCorrectKey(key, hash.left(hash.length() - 4)));
+
+    bool thrown = false;
+    try {
+        KeyDerivation("EVP_BytesToKey", 1, QByteArray());
+    } catch (const NoSuchAlgorithmException&) {
+        thrown = true;
+    }
+    QVERIFY(thrown);
+}
+
+
+/**
+ * @brief Reports the calibrated iterations and the time they really take.
+ */
+void KdfBench::testCalibrate()
+{
+    const int milliseconds = 200;
+    const int iterations = KeyDerivation::calibrate(milliseconds);
+    QVERIFY(iterations >= KeyDerivation::MIN_ITERATIONS);
+
+    QTime timer;
+    timer.start();
+    KeyDerivation::create(iterations).deriveKey(PASSWORD);
+    qDebug() << "Calibrated" << iterations << "iterations for" << milliseconds << "ms, took"
+        << timer.elapsed() << "ms";
+}
+
+
+/**
+ * @brief Unlocking a file without key derivation.
+ */
+void KdfBench::benchmarkLegacyUnlock()
+{
+    const QString hash = PasswordHash::generateHashString(PASSWORD);
+
+    QBENCHMARK {
+        QVERIFY(PasswordHash::isCorrect(PASSWORD, hash));
+        SymmetricEncryptor enc(ALGORITHM, PASSWORD);
+    }
+}
+
+
+/**
+ * @brief The number of iterations for benchmarkUnlock().
+ */
+void KdfBench::benchmarkUnlock_data()
+{
+    QTest::addColumn<int>("iterations");
+
+    QTest::newRow("10000") << 10000;
+    QTest::newRow("50000") << 50000;
+    QTest::newRow("100000") << 100000;
+    QTest::newRow("200000") << 200000;
+    QTest::newRow("500000") << 500000;
+}
+
+
+/**
+ * @brief Unlocking a file with key derivation.
+ */
+void KdfBench::benchmarkUnlock()
+{
+    QFETCH(int, iterations);
+
+    const KeyDerivation kdf = KeyDerivation::create(iterations);
+    const QString hash = PasswordHash::generateKeyHashString(kdf.deriveKey(PASSWORD));
+
+    QBENCHMARK {
+        const ByteVector key = kdf.deriveKey(PASSWORD);
+        QVERIFY(PasswordHash::isCorrectKey(key, hash));
+        SymmetricEncryptor enc(ALGORITHM, key);
+    }
+}
+
+QTEST_MAIN(KdfBench)
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
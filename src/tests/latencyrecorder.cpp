@@ -0,0 +1,109 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QObject>
+#include <QtTest/QtTest>
+
+#include <util/latencyrecorder.h>
+#include <tests/latencyrecorder.h>
+
+/**
+ * @class TestLatencyRecorder
+ *
+ * @brief Tests for the LatencyRecorder class
+ *
+ * @ingroup unittest
+ */
+
+
+/**
+ * @brief Tests the percentiles without samples.
+ */
+void TestLatencyRecorder::testEmpty() const
+{
+    LatencyRecorder recorder("test");
+    QCOMPARE(recorder.count(), 0);
+    QCOMPARE(recorder.percentile(0), -1);
+    QCOMPARE(recorder.percentile(50), -1);
+    QCOMPARE(recorder.percentile(100), -1);
+
+    recorder.add(10);
+    recorder.clear();
+    QCOMPARE(recorder.count(), 0);
+    QCOMPARE(recorder.percentile(50), -1);
+}
+
+
+/**
+ * @brief Tests that each percentile of a single sample is that sample.
+ */
+void TestLatencyRecorder::testSingleSample() const
+{
+    LatencyRecorder recorder("test");
+    recorder.add(42);
+    QCOMPARE(recorder.count(), 1);
+    QCOMPARE(recorder.percentile(0), 42);
+    QCOMPARE(recorder.percentile(1), 42);
+    QCOMPARE(recorder.percentile(50), 42);
+    QCOMPARE(recorder.percentile(99), 42);
+    QCOMPARE(recorder.percentile(100), 42);
+}
+
+
+/**
+ * @brief Tests percentiles that fall between two samples.
+ *
+ * With the nearest-rank method, they are rounded up to the next sample.
+ */
+void TestLatencyRecorder::testBetweenSamples() const
+{
+    LatencyRecorder recorder("test");
+    recorder.add(40);
+    recorder.add(10);
+    recorder.add(30);
+    recorder.add(20);
+
+    QCOMPARE(recorder.percentile(0), 10);
+    QCOMPARE(recorder.percentile(25), 10);
+    QCOMPARE(recorder.percentile(26), 20);
+    QCOMPARE(recorder.percentile(50), 20);
+    QCOMPARE(recorder.percentile(60), 30);
+    QCOMPARE(recorder.percentile(99), 40);
+    QCOMPARE(recorder.percentile(100), 40);
+
+    // out of range
+    QCOMPARE(recorder.percentile(-5), 10);
+    QCOMPARE(recorder.percentile(200), 40);
+}
+
+
+/**
+ * @brief Tests that only the last samples are used.
+ */
+void TestLatencyRecorder::testWindow() const
+{
+    LatencyRecorder recorder("test", 3);
+    recorder.add(100);
+    recorder.add(1);
+    recorder.add(2);
+    recorder.add(3);
+
+    QCOMPARE(recorder.count(), 4);
+    QCOMPARE(recorder.percentile(100), 3);
+    QCOMPARE(recorder.percentile(0), 1);
+}
+
+QTEST_MAIN(TestLatencyRecorder)
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
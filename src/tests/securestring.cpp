@@ -12,10 +12,13 @@
  *
  * -------------------------------------------------------------------------------------------------
  */
+#include <utility>
+
 #include <QObject>
 #include <QtTest/QtTest>
 
 #include <util/securestring.h>
+#include <util/securearena.h>
 #include <tests/securestring.h>
 
 /**
@@ -123,6 +126,131 @@ void TestSecureString::testSize() const
     QVERIFY(s.size() == 5);
 }
 
+/**
+ * @brief Checks that the memory of a string is overwritten when the string is destroyed.
+ *
+ * The arena keeps the memory, so it can still be read after the string is gone.
+ */
+void TestSecureString::testZeroing() const
+{
+    const char secret[] = "topSecret";
+    const char *memory;
+    {
+        SecureString s(secret);
+        memory = s.utf8();
+        QVERIFY(strcmp(memory, secret) == 0);
+    }
+
+    for (size_t i = 0; i < sizeof(secret); i++)
+        QCOMPARE(memory[i], '\0');
+
+    // the new value is in another size class, so the released block is not reused
+    SecureString a("first");
+    memory = a.utf8();
+    a = SecureString("a second value that is much longer than the first one");
+    QVERIFY(a.utf8() != memory);
+    for (size_t i = 0; i < sizeof("first"); i++)
+        QCOMPARE(memory[i], '\0');
+}
+
+/**
+ * @brief Checks that released blocks are reused and that no memory is locked per string.
+ */
+void TestSecureString::testArenaReuse() const
+{
+    SecureArena &arena = SecureArena::instance();
+    int blocks = arena.blocksInUse();
+    size_t inUse = arena.bytesInUse();
+
+    const char *memory;
+    {
+        SecureString s("reuse");
+        memory = s.utf8();
+        QCOMPARE(arena.blocksInUse(), blocks + 1);
+    }
+    QCOMPARE(arena.blocksInUse(), blocks);
+    QCOMPARE(arena.bytesInUse(), inUse);
+
+    // same size class
+    SecureString t("again");
+    QVERIFY(t.utf8() == memory);
+
+    // many strings fit into one chunk
+    size_t reserved = arena.reservedBytes();
+    QList<SecureString> strings;
+    for (int i = 0; i < 100; i++)
+        strings.append(SecureString(QString::number(i)));
+    QVERIFY(arena.reservedBytes() <= reserved + SecureArena::CHUNK_SIZE);
+    if (SecureString::platformSupportsLocking() && strings.first().isLocked())
+        QVERIFY(arena.lockedBytes() <= arena.reservedBytes());
+}
+
+/**
+ * @brief Checks that large blocks get whole pages, so unlocking them doesn't affect other
+ *        memory.
+ */
+void TestSecureString::testArenaPages() const
+{
+    SecureArena &arena = SecureArena::instance();
+    size_t reserved = arena.reservedBytes();
+
+    // 4096 divides all page sizes
+    bool locked;
+    const size_t size = SecureArena::MAX_BLOCK_SIZE + 1;
+    char *block = arena.allocate(size, locked);
+    QVERIFY((arena.reservedBytes() - reserved) % 4096 == 0);
+    QVERIFY(arena.reservedBytes() - reserved >= size);
+#if defined(Q_WS_X11) || defined(Q_WS_MAC)
+    QVERIFY(reinterpret_cast<quintptr>(block) % 4096 == 0);
+#endif
+
+    arena.release(block, size);
+    QCOMPARE(arena.reservedBytes(), reserved);
+}
+
+/**
+ * @brief Checks that swap() exchanges the contents without allocating memory.
+ */
+void TestSecureString::testSwap() const
+{
+    SecureString a("alpha");
+    SecureString b("beta");
+    const char *memoryA = a.utf8();
+
+    SecureArena::instance().resetCounters();
+    a.swap(b);
+    QCOMPARE(SecureArena::instance().allocationCount(), 0);
+    QCOMPARE(SecureArena::instance().lockCount(), 0);
+
+    QVERIFY(a == "beta");
+    QVERIFY(b == "alpha");
+    QVERIFY(b.utf8() == memoryA);
+}
+
+/**
+ * @brief Checks that moving a SecureString takes over the memory.
+ */
+void TestSecureString::testMove() const
+{
+#ifdef Q_COMPILER_RVALUE_REFS
+    SecureString a("moveMe");
+    const char *memory = a.utf8();
+
+    SecureArena::instance().resetCounters();
+    SecureString b(std::move(a));
+    QVERIFY(b.utf8() == memory);
+    QVERIFY(a.utf8() == 0);
+
+    SecureString c;
+    c = std::move(b);
+    QVERIFY(c.utf8() == memory);
+    QVERIFY(c == "moveMe");
+    QCOMPARE(SecureArena::instance().allocationCount(), 0);
+#else
+    QSKIP("The compiler does not support rvalue references", SkipAll);
+#endif
+}
+
 QTEST_MAIN(TestSecureString)
 
 // vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
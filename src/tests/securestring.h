@@ -16,6 +16,7 @@
 #include <QtTest/QtTest>
 
 #include <util/securestring.h>
+#include <util/securearena.h>
 
 class TestSecureString : public QObject
 {
@@ -29,6 +30,11 @@ class TestSecureString : public QObject
         void testCopyCtor() const;
         void testLocking() const;
         void testSize() const;
+        void testZeroing() const;
+        void testArenaReuse() const;
+        void testArenaPages() const;
+        void testSwap() const;
+        void testMove() const;
 };
 
 // vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,425 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <cstdlib>
+#include <iostream>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <QFile>
+#include <QList>
+#include <QStack>
+#include <QString>
+#include <QTime>
+#include <QDateTime>
+#include <QDomDocument>
+#include <QThreadPool>
+#include <QScopedPointer>
+
+#include "datahandler.h"
+#include "xmldatareader.h"
+#include "xmldatawriter.h"
+#include "binarydatareader.h"
+#include "binarydatawriter.h"
+#include "parallelcrypthandler.h"
+#include "security/symmetricencryptor.h"
+#include "security/keyderivation.h"
+
+/**
+ * @file vaultbench.cpp
+ *
+ * @brief Benchmark for loading a big data file.
+ *
+ * Compares the old way of loading (QDomDocument, decryption of the DOM, building the
+ * tree from the DOM) with the XmlDataReader that does everything in one pass. The
+ * objects that are built are the same in both modes, so the difference is only
+ * the cost of the loader. The time until the first entry is created is printed
+ * since that's when the tree could be painted the first time.
+ *
+ * The @c parallel mode uses the XmlDataReader together with a ParallelCryptHandler like
+ * DataReadWriter does. The number of threads can be given to check how it scales.
+ *
+ * The @c stream and @c parallel modes also read the binary format (see BinaryFormat).
+ * The @c convert mode converts a file from XML to binary or vice versa without decrypting
+ * the passwords, so the sizes and load times of both formats can be compared. Converting
+ * back must result in the same passwords.
+ *
+ * Each mode must run in a process of its own, otherwise the peak RSS is meaningless:
+ *
+ * @verbatim
+   vaultbench generate vault.xml 50000
+   vaultbench dom vault.xml
+   vaultbench stream vault.xml
+   vaultbench parallel vault.xml 4
+   vaultbench convert vault.xml vault.bin
+   vaultbench stream vault.bin
+   @endverbatim
+ *
+ * @ingroup unittest
+ */
+
+namespace {
+
+const char BENCH_PASSWORD[]         = "benchmark";
+const int  DEFAULT_ENTRIES          = 50000;
+const int  ENTRIES_PER_CATEGORY     = 100;
+
+struct BenchProperty
+{
+    QString         key;
+    QString         value;
+    Property::Type  type;
+    bool            encrypted;
+    bool            hidden;
+};
+
+struct BenchEntry
+{
+    BenchEntry(const QString& entryName)
+        : name(entryName) {}
+    ~BenchEntry()
+        { qDeleteAll(children); }
+
+    QString                 name;
+    QList<BenchEntry*>      children;
+    QList<BenchProperty>    properties;
+};
+
+class BenchTreeBuilder : public DataHandler
+{
+    public:
+        BenchTreeBuilder(const QTime& start)
+            : m_root(QString()), m_start(start), m_entries(0), m_firstEntryMs(-1)
+            { m_parents.push(&m_root); }
+
+        void startCategory(const QString& name, bool, bool)
+        {
+            BenchEntry* category = new BenchEntry(name);
+            m_parents.top()->children.append(category);
+            m_parents.push(category);
+        }
+
+        void endCategory()
+            { m_parents.pop(); }
+
+        void startEntry(const QString& name, bool)
+        {
+            if (m_firstEntryMs < 0)
+                m_firstEntryMs = m_start.elapsed();
+            BenchEntry* entry = new BenchEntry(name);
+            m_parents.top()->children.append(entry);
+            m_parents.push(entry);
+            m_entries++;
+        }
+
+        void endEntry()
+            { m_parents.pop(); }
+
+        void appendProperty(const QString& key, const QString& value,
+                            Property::Type type, bool encrypted, bool hidden)
+        {
+            BenchProperty property;
+            property.key = key;
+            property.value = value;
+            property.type = type;
+            property.encrypted = encrypted;
+            property.hidden = hidden;
+            m_parents.top()->properties.append(property);
+        }
+
+        int entries() const
+            { return m_entries; }
+
+        int firstEntryMs() const
+            { return m_firstEntryMs; }
+
+    private:
+        BenchEntry          m_root;
+        QStack<BenchEntry*> m_parents;
+        const QTime&        m_start;
+        int                 m_entries;
+        int                 m_firstEntryMs;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+long peakRss()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+    return usage.ru_maxrss;
+}
+
+int generate(const QString& fileName, int entries)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        std::cerr << "Cannot open " << qPrintable(fileName) << ": "
+                  << qPrintable(file.errorString()) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    AppData appData;
+    appData.version = VERSION_STRING;
+    appData.date = QDateTime::currentDateTime(Qt::UTC).toString(Qt::ISODate);
+    appData.cryptAlgorithm = SymmetricEncryptor::getSuggestedAlgorithm();
+
+    SymmetricEncryptor enc(appData.cryptAlgorithm, BENCH_PASSWORD);
+    try {
+        XmlDataWriter writer(&file, &enc);
+        writer.writeAppData(appData);
+        for (int i = 0; i < entries; ++i) {
+            if (i % ENTRIES_PER_CATEGORY == 0) {
+                if (i != 0)
+                    writer.endCategory();
+                writer.startCategory(QString("Category %1").arg(i / ENTRIES_PER_CATEGORY),
+                    false, false);
+            }
+
+            writer.startEntry(QString("Entry %1").arg(i), false);
+            writer.appendProperty("Username", QString("user%1").arg(i), Property::USERNAME,
+                false, false);
+            writer.appendProperty("Password", QString("pw%1-%2").arg(i).arg(i * 7919 % 100003),
+                Property::PASSWORD, true, false);
+            writer.appendProperty("URL", QString("https://host%1.example.org/login").arg(i),
+                Property::URL, false, false);
+            writer.endEntry();
+        }
+        if (entries > 0)
+            writer.endCategory();
+        writer.finish();
+    } catch (const ReadWriteException& e) {
+        std::cerr << qPrintable(e.getMessage()) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+DataReader* createReader(QFile* file)
+{
+    if (BinaryDataReader::isBinary(file))
+        return new BinaryDataReader(file);
+    else
+        return new XmlDataReader(file);
+}
+
+// the tag of a binary file needs a KeyDerivation, the passwords stay encrypted with the
+// key of the generated file
+void addKeyDerivation(AppData& appData)
+{
+    if (appData.kdfAlgorithm.isEmpty()) {
+        appData.kdfAlgorithm = KeyDerivation::PBKDF2_SHA256;
+        appData.kdfIterations = KeyDerivation::MIN_ITERATIONS;
+        appData.kdfSalt = QByteArray(KeyDerivation::SALT_LENGTH, 's');
+    }
+}
+
+ByteVector deriveKey(const AppData& appData)
+{
+    if (appData.kdfAlgorithm.isEmpty())
+        return ByteVector();
+    return KeyDerivation(appData.kdfAlgorithm, appData.kdfIterations, appData.kdfSalt)
+        .deriveKey(BENCH_PASSWORD);
+}
+
+void authenticate(DataReader* reader, const AppData& appData)
+{
+    BinaryDataReader* binaryReader = dynamic_cast<BinaryDataReader*>(reader);
+    if (binaryReader)
+        binaryReader->authenticate(deriveKey(appData));
+}
+
+int convert(const QString& inputName, const QString& outputName)
+{
+    QTime start;
+    start.start();
+
+    QFile input(inputName);
+    QFile output(outputName);
+    if (!input.open(QIODevice::ReadOnly) || !output.open(QIODevice::WriteOnly)) {
+        std::cerr << "Cannot open the files" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    bool toBinary = !BinaryDataReader::isBinary(&input);
+    try {
+        QScopedPointer<DataReader> reader(createReader(&input));
+        AppData appData = reader->readAppData();
+        authenticate(reader.data(), appData);
+
+        QScopedPointer<DataWriter> writer;
+        ByteVector key;
+        if (toBinary) {
+            addKeyDerivation(appData);
+            key = deriveKey(appData);
+            writer.reset(new BinaryDataWriter(&output, 0, key));
+        } else
+            writer.reset(new XmlDataWriter(&output, 0));
+
+        // the passwords stay encrypted
+        writer->writeAppData(appData);
+        reader->readPasswords(*writer, 0);
+        writer->finish();
+    } catch (const ReadWriteException& e) {
+        std::cerr << qPrintable(e.getMessage()) << std::endl;
+        return EXIT_FAILURE;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    output.close();
+
+    std::cout << "Converted to:        " << (toBinary ? "binary" : "XML") << std::endl;
+    std::cout << "Input size:          " << input.size() << " bytes" << std::endl;
+    std::cout << "Output size:         " << output.size() << " bytes" << std::endl;
+    std::cout << "Time:                " << start.elapsed() << " ms" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+// the old DataReadWriter::crypt()
+void decryptDom(QDomElement& element, StringEncryptor& enc)
+{
+    for (QDomElement child = element.firstChildElement(); !child.isNull();
+            child = child.nextSiblingElement()) {
+        if (child.tagName() == "property") {
+            if (child.attribute("type") == "PASSWORD" && child.hasAttribute("value"))
+                child.setAttribute("value", enc.decryptStrFromStr(child.attribute("value")));
+        } else
+            decryptDom(child, enc);
+    }
+}
+
+// the old Tree::readFromXML() and TreeEntry::appendFromXML()
+void walkDom(const QDomElement& element, DataHandler& handler)
+{
+    for (QDomElement child = element.firstChildElement(); !child.isNull();
+            child = child.nextSiblingElement()) {
+        const QString name = child.attribute("name");
+        const bool isSelected = child.attribute("isSelected") == "1";
+
+        if (child.tagName() == "category") {
+            handler.startCategory(name, child.attribute("wasOpen") == "1", isSelected);
+            walkDom(child, handler);
+            handler.endCategory();
+        } else if (child.tagName() == "entry") {
+            handler.startEntry(name, isSelected);
+            for (QDomElement prop = child.firstChildElement("property"); !prop.isNull();
+                    prop = prop.nextSiblingElement("property")) {
+                const QString typeString = prop.attribute("type");
+                Property::Type type = Property::MISC;
+                if (typeString == "USERNAME")
+                    type = Property::USERNAME;
+                else if (typeString == "PASSWORD")
+                    type = Property::PASSWORD;
+                else if (typeString == "URL")
+                    type = Property::URL;
+
+                handler.appendProperty(prop.attribute("key"), prop.attribute("value"), type,
+                    prop.attribute("encrypted") == "1", prop.attribute("hidden") == "1");
+            }
+            handler.endEntry();
+        }
+    }
+}
+
+int load(const QString& mode, const QString& fileName)
+{
+    QTime start;
+    start.start();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::cerr << "Cannot open " << qPrintable(fileName) << ": "
+                  << qPrintable(file.errorString()) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    BenchTreeBuilder builder(start);
+    if (mode == "dom") {
+        QDomDocument doc;
+        if (!doc.setContent(&file)) {
+            std::cerr << "Invalid XML file" << std::endl;
+            return EXIT_FAILURE;
+        }
+        QDomElement root = doc.documentElement();
+        SymmetricEncryptor enc(root.namedItem("app-data").namedItem("crypt-algorithm")
+            .toElement().text(), BENCH_PASSWORD);
+        QDomElement passwords = root.namedItem("passwords").toElement();
+        decryptDom(passwords, enc);
+        walkDom(passwords, builder);
+    } else {
+        try {
+            QScopedPointer<DataReader> reader(createReader(&file));
+            AppData appData = reader->readAppData();
+            authenticate(reader.data(), appData);
+            SymmetricEncryptor enc(appData.cryptAlgorithm, BENCH_PASSWORD);
+            if (mode == "parallel") {
+                ParallelCryptHandler decryptor(builder, enc, ParallelCryptHandler::Decrypt);
+                reader->readPasswords(decryptor, 0);
+                decryptor.flush();
+            } else
+                reader->readPasswords(builder, &enc);
+        } catch (const ReadWriteException& e) {
+            std::cerr << qPrintable(e.getMessage()) << std::endl;
+            return EXIT_FAILURE;
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    const int total = start.elapsed();
+
+    std::cout << "Mode:                " << qPrintable(mode) << std::endl;
+    if (mode == "parallel")
+        std::cout << "Threads:             " << QThreadPool::globalInstance()->maxThreadCount()
+                  << std::endl;
+    std::cout << "File size:           " << file.size() << " bytes" << std::endl;
+    std::cout << "Entries:             " << builder.entries() << std::endl;
+    std::cout << "Time to first entry: " << builder.firstEntryMs() << " ms" << std::endl;
+    std::cout << "Total load time:     " << total << " ms" << std::endl;
+    std::cout << "Peak RSS:            " << peakRss() << " kB" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    const QString mode = argc > 1 ? argv[1] : "";
+    if (argc < 3 || (mode != "generate" && mode != "dom" && mode != "stream"
+            && mode != "parallel" && mode != "convert") || (mode == "convert" && argc < 4)) {
+        std::cerr << "Usage: " << argv[0] << " generate <file> [entries]" << std::endl;
+        std::cerr << "       " << argv[0] << " dom|stream <file>" << std::endl;
+        std::cerr << "       " << argv[0] << " parallel <file> [threads]" << std::endl;
+        std::cerr << "       " << argv[0] << " convert <input> <output>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (mode == "parallel" && argc > 3)
+        QThreadPool::globalInstance()->setMaxThreadCount(std::atoi(argv[3]));
+
+    if (mode == "generate")
+        return generate(argv[2], argc > 3 ? std::atoi(argv[3]) : DEFAULT_ENTRIES);
+    else if (mode == "convert")
+        return convert(argv[2], argv[3]);
+    else
+        return load(mode, argv[2]);
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -29,6 +29,7 @@
 #include <QFileInfo>
 #include <Q3ProgressDialog>
 #include <QPixmap>
+#include <QPainter>
 #include <QTextStream>
 #include <QKeyEvent>
 #include <QDropEvent>
@@ -47,6 +48,9 @@
 #include "dialogs/waitdialog.h"
 #include "smartcard/memorycard.h"
 #include "settings.h"
+#include "passwordcache.h"
+#include "passwordstrengthjob.h"
+#include "passwordstrengthservice.h"
 
 
 /**
@@ -111,6 +115,11 @@ Tree::Tree(QWidget* parent)
     connect(this, SIGNAL(currentChanged(Q3ListViewItem*)),
         this, SLOT(currentChangedHandler(Q3ListViewItem*)));
     connect(this, SIGNAL(dropped(QDropEvent*)), SLOT(droppedHandler(QDropEvent*)));
+
+    // repaint the strength icons at most every 200 ms while they are computed
+    m_strengthViewTimer.setSingleShot(true);
+    m_strengthViewTimer.setInterval(200);
+    connect(&m_strengthViewTimer, SIGNAL(timeout()), SLOT(updateChangedPasswordStrengthView()));
 }
 
 
@@ -155,50 +164,19 @@ void Tree::keyPressEvent(QKeyEvent* evt)
 
 
 /**
- * @brief Reads and updates the tree from the given XML file.
- *
- * @param rootElement the XML element which represents the <tt>\<qpamat\></tt> tag
- */
-void Tree::readFromXML(const QDomElement& rootElement)
-{
-    // delete the old tree
-    if (childCount() > 0)
-        clear();
-
-    QDomNode n = rootElement.firstChild();
-    while (!n.isNull()) {
-        QDomElement e = n.toElement(); // try to convert the node to an element.
-        if (!e.isNull())
-            TreeEntry::appendFromXML(this, e);
-        n = n.nextSibling();
-    }
-
-    // qpamat->message(tr("Reading of data finished successfully."), false);
-}
-
-
-/**
- * @brief Appends the tree data to the specified QDomDocument.
+ * @brief Passes the whole tree to the specified DataHandler.
  *
- * The document must contain a <tt>\<qpamat\></tt> document element which must contain a <tt>\<passwords\></tt> child.
+ * The top-level items are passed in the order of the view. This is used for writing the tree
+ * to the data file.
  *
- * @param doc the QDomDocument to which the tree is appended. If the tree is empty,
- *            nothing is appended
- * @exception std::invalid_argument if the given document does not met the described requirements
-*/
-void Tree::appendXML(QDomDocument& doc) const throw (std::invalid_argument)
+ * @param handler the handler
+ * @exception DecryptionException if a password cannot be decrypted, see Property::getValue()
+ */
+void Tree::writeData(DataHandler& handler) const
 {
-    QDomElement docElem = doc.documentElement();
-    QDomNode passwords = docElem.namedItem("passwords");
-    if (passwords.isNull())
-        throw std::invalid_argument("The QDomDocument must have a passwords tag as child of the "
-            "qpamat document element.");
-
-    // we have one child that contains all children. The root child is not appended to
-    // XML so we have to find the children of the child
     TreeEntry* currentItem = dynamic_cast<TreeEntry*>(firstChild());
     while (currentItem) {
-        currentItem->appendXML(doc, passwords);
+        currentItem->writeData(handler);
         currentItem = dynamic_cast<TreeEntry*>(currentItem->nextSibling());
     }
 }
@@ -214,7 +192,14 @@ Q3DragObject* Tree::dragObject()
     Q3ListViewItem* current = currentItem();
     emit stateModified();
     if (current) {
-        QString xml = dynamic_cast<TreeEntry*>(current)->toXML();
+        QString xml;
+        try {
+            xml = dynamic_cast<TreeEntry*>(current)->toXML();
+        } catch (const DecryptionException& e) {
+            QMessageBox::warning(this, "QPaMaT", tr("A password could not be decrypted:\n%1")
+                .arg(e.what()), QMessageBox::Ok, QMessageBox::NoButton);
+            return 0;
+        }
         Q3StoredDrag* drag = new Q3StoredDrag("application/x-qpamat", this);
         drag->setEncodedData(xml.utf8());
         return drag;
@@ -492,7 +477,7 @@ void Tree::droppedHandler(QDropEvent* evt)
         Q3ListViewItem* appended = TreeEntry::appendFromXML(this, elem);
         setSelected(appended, true);
         delete src;
-        updatePasswordStrengthView();
+        updateChangedPasswordStrengthView();
     }
 }
 
@@ -502,9 +487,12 @@ void Tree::droppedHandler(QDropEvent* evt)
  *
  * This function should be called before showing the password strength in the
  * tree and it must be called after changing the configuration related to
- * password strength. It shows a progress dialog.
+ * password strength. The strength is computed in the background by a
+ * PasswordStrengthJob, the icons are updated while the results arrive. A computation
+ * that is still running is cancelled.
  *
- * @param error is set to \c true if an error occured and if \p error is not \c NULL
+ * @param error is set to \c true if the password checker could not be created and if
+ *              \p error is not \c NULL
  */
 void Tree::recomputePasswordStrength(bool* error)
 {
@@ -516,64 +504,116 @@ void Tree::recomputePasswordStrength(bool* error)
         *error = true;
     }
 
-    QApplication::setOverrideCursor( QCursor(Qt::WaitCursor) );
-    int num = 0;
-
-    {
-        Q3ListViewItemIterator it(this);
-        while (it.current()) {
-            TreeEntry* current = dynamic_cast<TreeEntry*>(it.current());
-            TreeEntry::PropertyIterator propIt = current->propertyIterator();
-            while (propIt.current()) {
-                if (propIt.current()->getType() == Property::PASSWORD)
-                    ++num;
-                ++propIt;
-            }
-            ++it;
-        }
-    }
+    cancelPasswordStrength();
 
+    // report configuration errors now and not from the worker threads
+    PasswordStrengthService& service = Qpamat::instance()->getWindow()->strengthService();
     try {
-        Q3ProgressDialog progress( tr("Updating password strength..."), 0, num, this, "progress",
-                false);
-        progress.setMinimumDuration(200);
-        progress.setCaption("QPaMaT");
-        int progr = 0;
+        service.prepare();
+    } catch (const PasswordCheckException& e) {
+        QMessageBox::warning(this, "QPaMaT", tr("<qt><nobr>Failed to calculate the password "
+                "strength. The error message</nobr> was:<p>%1<p>Check your configuration!</qt>")
+                .arg(e.what()), QMessageBox::Ok, QMessageBox::NoButton);
+        return;
+    }
 
-        Q3ListViewItemIterator it(this);
-        while (it.current()) {
-            TreeEntry* current = dynamic_cast<TreeEntry*>(it.current());
-            TreeEntry::PropertyIterator propIt = current->propertyIterator();
-            while (propIt.current()) {
-                if (propIt.current()->getType() == Property::PASSWORD) {
-                    propIt.current()->updatePasswordStrength();
-                    progress.setProgress(progr++);
-                    qDebug() << CURRENT_FUNCTION << "progr =" << progr;
-                    qApp->processEvents();
+    // the properties must not be accessed from the worker threads, the passwords are kept
+    // in locked memory until the job is deleted
+    QList<PasswordStrengthJob::Snapshot> snapshots;
+    Q3ListViewItemIterator it(this);
+    while (it.current()) {
+        TreeEntry* current = dynamic_cast<TreeEntry*>(it.current());
+        TreeEntry::PropertyIterator propIt = current->propertyIterator();
+        while (propIt.current()) {
+            if (propIt.current()->getType() == Property::PASSWORD) {
+                PasswordStrengthJob::Snapshot snapshot;
+                snapshot.property = propIt.current();
+                try {
+                    QString value = propIt.current()->getValue();
+                    snapshot.password = value;
+                    value.fill(QChar('\0'));
+                    snapshots.append(snapshot);
+                } catch (const DecryptionException& e) {
+                    // the strength of that password stays undefined
+                    qDebug() << CURRENT_FUNCTION << e.what();
                 }
-                ++propIt;
             }
-            ++it;
+            ++propIt;
         }
+        ++it;
+    }
 
-        progress.setProgress(num);
-        qApp->processEvents();
-        QApplication::restoreOverrideCursor();
+    m_strengthJob = new PasswordStrengthJob(service, snapshots, this);
+    connect(m_strengthJob, SIGNAL(resultsApplied(int, int)),
+        SLOT(passwordStrengthProgress(int, int)));
+    connect(m_strengthJob, SIGNAL(failed(const QString&)),
+        SLOT(passwordStrengthFailed(const QString&)));
+    connect(m_strengthJob, SIGNAL(finished()), SLOT(passwordStrengthFinished()));
+    m_strengthJob->start();
 
-        updatePasswordStrengthView();
+    if (error)
+        *error = false;
+}
 
-        if (error)
-            *error = false;
 
-    } catch (const PasswordCheckException& e) {
-        QApplication::restoreOverrideCursor();
-        QMessageBox::warning(this, "QPaMaT", tr("<qt><nobr>Failed to calculate the password "
-                "strength. The error message</nobr> was:<p>%1<p>Check your configuration!</qt>")
-                .arg(e.what()), QMessageBox::Ok, QMessageBox::NoButton);
+/**
+ * @brief Cancels the background computation of the password strength.
+ *
+ * The passwords that have no result yet are computed when they are displayed.
+ */
+void Tree::cancelPasswordStrength()
+{
+    m_strengthViewTimer.stop();
+    if (m_strengthJob) {
+        // the destructor waits for the worker threads
+        delete m_strengthJob;
+        m_strengthJob = 0;
     }
 }
 
 
+/**
+ * @brief Called when a batch of password strengths has been computed.
+ *
+ * @param done the number of passwords that are finished
+ * @param total the number of all passwords
+ */
+void Tree::passwordStrengthProgress(int done, int total)
+{
+    Qpamat::instance()->getWindow()->message(tr("Updating password strength... %1 of %2")
+        .arg(done).arg(total), false);
+    if (!m_strengthViewTimer.isActive())
+        m_strengthViewTimer.start();
+}
+
+
+/**
+ * @brief Called when the strength of a password could not be computed.
+ *
+ * @param message the error message
+ */
+void Tree::passwordStrengthFailed(const QString& message)
+{
+    QMessageBox::warning(this, "QPaMaT", tr("<qt><nobr>Failed to calculate the password "
+            "strength. The error message</nobr> was:<p>%1<p>Check your configuration!</qt>")
+            .arg(message), QMessageBox::Ok, QMessageBox::NoButton);
+}
+
+
+/**
+ * @brief Called when the background computation of the password strength has finished.
+ */
+void Tree::passwordStrengthFinished()
+{
+    if (m_strengthJob)
+        m_strengthJob->deleteLater();
+    m_strengthJob = 0;
+
+    m_strengthViewTimer.stop();
+    updateChangedPasswordStrengthView();
+}
+
+
 /**
  * @brief Shows the icons that indicate weak passwords on the left.
  *
@@ -591,42 +631,14 @@ void Tree::setShowPasswordStrength(bool enabled)
 void Tree::updatePasswordStrengthView()
 {
     try {
-        if (m_showPasswordStrength) {
-            Q3ListViewItemIterator it(this);
-            while (it.current()) {
-                Property::PasswordStrength strength =
-                    dynamic_cast<TreeEntry*>(it.current())->weakestChildrenPassword();
-
-                switch (strength) {
-                    case Property::PWeak:
-                        it.current()->setPixmap(0, QPixmap(":/images/traffic_red_16.png"));
-                        break;
-
-                    case Property::PAcceptable:
-                        it.current()->setPixmap(0, QPixmap(":/images/traffic_yellow_16.png"));
-                        break;
-
-                    case Property::PStrong:
-                        it.current()->setPixmap(0, QPixmap(":/images/traffic_green_16.png"));
-                        break;
-
-                    case Property::PUndefined:
-                        it.current()->setPixmap(0, QPixmap(":/images/traffic_gray_16.png"));
-                        break;
-
-                    default:
-                        qDebug() << CURRENT_FUNCTION << "Value out of range:" << strength;
-                        break;
-                }
-                ++it;
-            }
-        } else {
-            Q3ListViewItemIterator it(this);
-            while (it.current()) {
-                it.current()->setPixmap(0, QPixmap());
-                ++it;
-            }
+        Q3ListViewItemIterator it(this);
+        while (it.current()) {
+            TreeEntry* entry = dynamic_cast<TreeEntry*>(it.current());
+            entry->takeStrengthMarkerDirty();
+            updateStrengthMarker(entry);
+            ++it;
         }
+        m_dirtyStrengthEntries.clear();
     } catch (const PasswordCheckException& e) {
         QMessageBox::warning(this, "QPaMaT", tr("<qt><nobr>Failed to calculate the password "
             "strength. The error message</nobr> was:<p>%1<p>Check your configuration!</qt>")
@@ -634,4 +646,226 @@ void Tree::updatePasswordStrengthView()
     }
 }
 
+
+/**
+ * @brief Updates the icons of the entries whose password strength changed.
+ *
+ * Only the entries that were registered with markPasswordStrengthDirty() since the
+ * last update are processed, i.e. the entries on the path of a change.
+ */
+void Tree::updateChangedPasswordStrengthView()
+{
+    try {
+        while (!m_dirtyStrengthEntries.isEmpty()) {
+            TreeEntry* entry = m_dirtyStrengthEntries.takeFirst();
+            if (entry && entry->takeStrengthMarkerDirty())
+                updateStrengthMarker(entry);
+        }
+    } catch (const PasswordCheckException& e) {
+        QMessageBox::warning(this, "QPaMaT", tr("<qt><nobr>Failed to calculate the password "
+            "strength. The error message</nobr> was:<p>%1<p>Check your configuration!</qt>")
+            .arg(e.what()), QMessageBox::Ok, QMessageBox::NoButton);
+    }
+}
+
+
+/**
+ * @brief Registers an entry whose password strength icon must be updated.
+ *
+ * This is called by TreeEntry, the icon is updated by the next call of
+ * updateChangedPasswordStrengthView(). While no icons are shown, nothing is registered
+ * because updatePasswordStrengthView() updates all icons when they are shown again.
+ *
+ * @param entry the entry
+ */
+void Tree::markPasswordStrengthDirty(TreeEntry* entry)
+{
+    if (m_showPasswordStrength)
+        m_dirtyStrengthEntries.append(entry);
+}
+
+
+/**
+ * @brief Sets the password strength icon of one entry.
+ *
+ * If a password of the entry is reused (see PasswordReuseIndex), a second icon is
+ * displayed next to it.
+ *
+ * @param entry the entry
+ * @exception PasswordCheckException if the strength must be computed and that failed
+ */
+void Tree::updateStrengthMarker(TreeEntry* entry)
+{
+    if (!m_showPasswordStrength) {
+        entry->setPixmap(0, QPixmap());
+        return;
+    }
+
+    Property::PasswordStrength strength = entry->weakestChildrenPassword();
+    QString name;
+    switch (strength) {
+        case Property::PWeak:
+            name = ":/images/traffic_red_16.png";
+            break;
+
+        case Property::PAcceptable:
+            name = ":/images/traffic_yellow_16.png";
+            break;
+
+        case Property::PStrong:
+            name = ":/images/traffic_green_16.png";
+            break;
+
+        case Property::PUndefined:
+            name = ":/images/traffic_gray_16.png";
+            break;
+
+        default:
+            qDebug() << CURRENT_FUNCTION << "Value out of range:" << strength;
+            return;
+    }
+
+    QPixmap pixmap(name);
+    if (entry->hasReusedPassword()) {
+        // a password is used more than once, show the marker next to the traffic light
+        QPixmap reused(":/images/stock_copy_16.png");
+        QPixmap combined(pixmap.width() + 2 + reused.width(),
+                         qMax(pixmap.height(), reused.height()));
+        combined.fill(Qt::transparent);
+        QPainter painter(&combined);
+        painter.drawPixmap(0, 0, pixmap);
+        painter.drawPixmap(pixmap.width() + 2, 0, reused);
+        painter.end();
+        pixmap = combined;
+    }
+    entry->setPixmap(0, pixmap);
+}
+
+// -------------------------------------------------------------------------------------------------
+
+/**
+ * @class TreeBuilder
+ *
+ * @brief A DataHandler that creates the TreeEntry and Property objects of a Tree.
+ *
+ * This is used to read the data file into the Tree without building an intermediate
+ * representation of the whole file.
+ *
+ * @ingroup gui
+ */
+
+/**
+ * @brief Creates a new TreeBuilder.
+ *
+ * The old contents of the tree is deleted.
+ *
+ * @param tree the tree which gets filled
+ * @param cache if not 0 and active while reading, the passwords are passed encrypted and
+ *        are stored encrypted in the properties, see Property::setEncryptedValue()
+ */
+TreeBuilder::TreeBuilder(Tree* tree, PasswordCache* cache)
+    : m_tree(tree)
+    , m_cache(cache)
+    , m_currentEntry(0)
+{
+    if (m_tree->childCount() > 0)
+        m_tree->clear();
+}
+
+
+/**
+ * @copydoc DataHandler::startCategory(const QString&, bool, bool)
+ */
+void TreeBuilder::startCategory(const QString& name, bool wasOpen, bool isSelected)
+{
+    UNUSED(isSelected);
+
+    m_categories.push(createEntry(name, true));
+    m_wasOpen.push(wasOpen);
+}
+
+
+/**
+ * @copydoc DataHandler::endCategory()
+ */
+void TreeBuilder::endCategory()
+{
+    Q_ASSERT(!m_categories.isEmpty());
+
+    // set the state after the children have been appended because a closed
+    // category without children cannot be opened
+    TreeEntry* category = m_categories.pop();
+    category->setOpen(m_wasOpen.pop());
+}
+
+
+/**
+ * @copydoc DataHandler::startEntry(const QString&, bool)
+ */
+void TreeBuilder::startEntry(const QString& name, bool isSelected)
+{
+    UNUSED(isSelected);
+
+    m_currentEntry = createEntry(name, false);
+}
+
+
+/**
+ * @copydoc DataHandler::endEntry()
+ */
+void TreeBuilder::endEntry()
+{
+    m_currentEntry = 0;
+}
+
+
+/**
+ * @copydoc DataHandler::appendProperty(const QString&, const QString&, Property::Type, bool, bool)
+ */
+void TreeBuilder::appendProperty(const QString& key, const QString& value,
+                                 Property::Type type, bool encrypted, bool hidden)
+{
+    Q_ASSERT(m_currentEntry);
+
+    // the cache is only active if the reader passes the passwords encrypted
+    if (m_cache && m_cache->isActive() && type == Property::PASSWORD) {
+        Property* property = new Property(key, QString::null, type, encrypted, hidden);
+        property->setEncryptedValue(value, m_cache);
+        m_currentEntry->appendProperty(property);
+    } else
+        m_currentEntry->appendProperty(new Property(key, value, type, encrypted, hidden));
+}
+
+
+/**
+ * @brief Lets the current entry load its properties later.
+ *
+ * Must be called between startEntry() and endEntry() instead of appendProperty().
+ *
+ * @param loader the loader, see TreeEntry::setPropertyLoader()
+ * @param offset the offset of the properties
+ */
+void TreeBuilder::setPropertyLoader(PropertyLoader* loader, quint32 offset)
+{
+    Q_ASSERT(m_currentEntry);
+
+    m_currentEntry->setPropertyLoader(loader, offset);
+}
+
+
+/**
+ * @brief Creates a new entry below the current category.
+ *
+ * @param name the name of the entry
+ * @param isCategory whether the new entry is a category
+ * @return the new entry
+ */
+TreeEntry* TreeBuilder::createEntry(const QString& name, bool isCategory)
+{
+    if (m_categories.isEmpty())
+        return new TreeEntry(m_tree, name, isCategory);
+    else
+        return new TreeEntry(m_categories.top(), name, isCategory);
+}
+
 // vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -24,10 +24,17 @@
 #include <QTextStream>
 #include <QKeyEvent>
 #include <QDropEvent>
+#include <QStack>
+#include <QPointer>
+#include <QTimer>
 
 #include "treeentry.h"
+#include "datahandler.h"
 #include "security/encryptor.h"
 
+class PasswordCache;
+class PasswordStrengthJob;
+
 class Tree : public Q3ListView
 {
     Q_OBJECT
@@ -43,20 +50,22 @@ class Tree : public Q3ListView
     public:
         Tree(QWidget* parent);
 
-        void readFromXML(const QDomElement& document);
-        void appendXML(QDomDocument& doc) const
-            throw (std::invalid_argument);
+        void writeData(DataHandler& handler) const;
 
         QString toRichTextForPrint();
         void appendTextForExport(QTextStream& stream);
 
+        void markPasswordStrengthDirty(TreeEntry* entry);
+
     public slots:
         void searchFor(const QString& word);
         void deleteCurrent();
         void insertAtCurrentPos();
         void setShowPasswordStrength(bool show );
         void updatePasswordStrengthView();
+        void updateChangedPasswordStrengthView();
         void recomputePasswordStrength(bool* error = 0);
+        void cancelPasswordStrength();
 
     signals:
         void selectionCleared();
@@ -71,15 +80,50 @@ class Tree : public Q3ListView
         void insertItem(TreeEntry* item, bool category = false);
         void currentChangedHandler(Q3ListViewItem* item);
         void droppedHandler(QDropEvent* e);
+        void passwordStrengthProgress(int done, int total);
+        void passwordStrengthFailed(const QString& message);
+        void passwordStrengthFinished();
 
     private:
         void initTreeContextMenu();
         void showReadErrorMessage(const QString& message);
         bool writeOrReadSmartcard(ByteVector& bytes, bool write, unsigned char& randomNumber);
+        void updateStrengthMarker(TreeEntry* entry);
 
     private:
         Q3PopupMenu*  m_contextMenu;
         bool         m_showPasswordStrength;
+        QPointer<PasswordStrengthJob> m_strengthJob;
+        QTimer       m_strengthViewTimer;
+        QList<QPointer<TreeEntry> > m_dirtyStrengthEntries;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+class TreeBuilder : public DataHandler
+{
+    public:
+        TreeBuilder(Tree* tree, PasswordCache* cache = 0);
+
+    public:
+        void startCategory(const QString& name, bool wasOpen, bool isSelected);
+        void endCategory();
+        void startEntry(const QString& name, bool isSelected);
+        void endEntry();
+        void appendProperty(const QString& key, const QString& value,
+            Property::Type type, bool encrypted, bool hidden);
+
+        void setPropertyLoader(PropertyLoader* loader, quint32 offset);
+
+    private:
+        TreeEntry* createEntry(const QString& name, bool isCategory);
+
+    private:
+        Tree*               m_tree;
+        PasswordCache*      m_cache;
+        QStack<TreeEntry*>  m_categories;
+        QStack<bool>        m_wasOpen;
+        TreeEntry*          m_currentEntry;
 };
 
 
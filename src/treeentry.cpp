@@ -16,7 +16,9 @@
 #include <QDomDocument>
 #include <QTextStream>
 #include <QDropEvent>
+#include <QDebug>
 
+#include "global.h"
 #include "qpamatwindow.h"
 #include "qpamat.h"
 
@@ -24,6 +26,40 @@
 #include "settings.h"
 #include "tree.h"
 
+// -------------------------------------------------------------------------------------------------
+#ifndef DOXYGEN
+
+/**
+ * @class PropertyCollector
+ *
+ * @brief DataHandler that appends the properties delivered by a PropertyLoader to a list.
+ *
+ * The list is filled directly, so TreeEntry::propertyAppended() is not emitted.
+ */
+class PropertyCollector : public DataHandler
+{
+    public:
+        PropertyCollector(PropertyPtrList& properties)
+            : m_properties(properties) { }
+
+        void startCategory(const QString&, bool, bool) { }
+        void endCategory() { }
+        void startEntry(const QString&, bool) { }
+        void endEntry() { }
+
+        void appendProperty(const QString& key, const QString& value, Property::Type type,
+                            bool encrypted, bool hidden)
+        {
+            m_properties.append(new Property(key, value, type, encrypted, hidden));
+        }
+
+    private:
+        PropertyPtrList&    m_properties;
+};
+
+#endif // DOXYGEN
+// -------------------------------------------------------------------------------------------------
+
 
 /**
  * @class TreeEntry
@@ -52,47 +88,174 @@
  * All password strength should be computed because of speed issues (in other
  * words, no wait cursor or something else is displayed in this function).
  *
+ * The result is cached in each entry and aggregated from the cached values of the
+ * children, so only the entries on the path of a change are computed again. The cache
+ * is invalidated by invalidatePasswordStrength(), which is called automatically when
+ * a property, a child entry or the strength of a password changes.
+ *
  * @return the password strength, Property::PUndefined should be never returned
  * @exception PasswordCheckException if recomputing is necessary and the PasswordChecker
  *            threw a PasswordCheckException
  */
 Property::PasswordStrength TreeEntry::weakestChildrenPassword() const throw (PasswordCheckException)
 {
+    if (m_weakestValid)
+        return m_weakest;
+
     Property::PasswordStrength lowest = Property::PUndefined;
+    bool reused = false;
 
+    // no early exit, a valid entry requires valid children (see invalidatePasswordStrength())
+    // and the reuse state needs all passwords
     if (m_isCategory) {
         TreeEntry* item = dynamic_cast<TreeEntry*>(firstChild());
         while (item) {
             Property::PasswordStrength strength = item->weakestChildrenPassword();
-            if (strength < lowest) {
+            if (strength < lowest)
                 lowest = strength;
-                if (lowest == Property::PWeak)
-                    break;
-            }
+            reused = reused || item->m_hasReused;
             item = dynamic_cast<TreeEntry*>(item->nextSibling());
         }
     } else {
-        bool hadPasswords = false;
         PropertyIterator it = propertyIterator();
         Property* current;
         while ( (current = it.current()) != 0 ) {
             ++it;
             if (current->getType() == Property::PASSWORD) {
-                hadPasswords = true;
                 Property::PasswordStrength strength = current->getPasswordStrength();
-                if (strength < lowest) {
+                if (strength < lowest)
                     lowest = strength;
-                    if (lowest == Property::PWeak)
-                        break;
-                }
+                reused = reused || current->isReused();
             }
         }
     }
 
+    m_hasReused = reused;
+    m_weakest = lowest;
+    m_weakestValid = true;
     return lowest;
 }
 
 
+/**
+ * @brief Returns whether any password of the item or its children is also used elsewhere.
+ *
+ * The result is cached together with weakestChildrenPassword(), see PasswordReuseIndex.
+ *
+ * @return @c true if a reused password was found
+ * @exception PasswordCheckException if weakestChildrenPassword() must be computed and the
+ *            PasswordChecker threw a PasswordCheckException
+ */
+bool TreeEntry::hasReusedPassword() const throw (PasswordCheckException)
+{
+    weakestChildrenPassword();
+    return m_hasReused;
+}
+
+
+/**
+ * @brief Invalidates the cached result of weakestChildrenPassword().
+ *
+ * The cache of this entry and of all parent categories is invalidated and the strength
+ * markers of these entries are registered for the next Tree::updateChangedPasswordStrengthView().
+ * Because a valid entry always has valid children, the walk stops at the first entry
+ * that is already invalid.
+ */
+void TreeEntry::invalidatePasswordStrength()
+{
+    TreeEntry* entry = this;
+    while (entry && entry->m_weakestValid) {
+        entry->m_weakestValid = false;
+        entry->markStrengthMarkerDirty();
+        entry = dynamic_cast<TreeEntry*>(entry->parent());
+    }
+}
+
+
+/**
+ * @brief Registers the strength marker of this entry at the tree for an update.
+ */
+void TreeEntry::markStrengthMarkerDirty()
+{
+    if (m_strengthMarkerDirty)
+        return;
+
+    Tree* tree = dynamic_cast<Tree*>(listView());
+    if (tree) {
+        m_strengthMarkerDirty = true;
+        tree->markPasswordStrengthDirty(this);
+    }
+}
+
+
+/**
+ * @brief Returns whether the strength marker must be updated and resets that state.
+ *
+ * @return \c true if the marker was registered by markStrengthMarkerDirty()
+ */
+bool TreeEntry::takeStrengthMarkerDirty()
+{
+    bool dirty = m_strengthMarkerDirty;
+    m_strengthMarkerDirty = false;
+    return dirty;
+}
+
+
+/**
+ * @brief Called if a property of this entry or its password strength changed.
+ */
+void TreeEntry::propertyStrengthChanged()
+{
+    invalidatePasswordStrength();
+}
+
+
+/**
+ * @brief Connects the signals of @p property that affect the password strength.
+ *
+ * The property is also registered at the PasswordReuseIndex.
+ *
+ * @param property the property which belongs to this entry
+ */
+void TreeEntry::watchProperty(Property* property) const
+{
+    Qpamat::instance()->getWindow()->reuseIndex().add(property);
+    connect(property, SIGNAL(propertyChanged(Property*)), SLOT(propertyStrengthChanged()));
+    connect(property, SIGNAL(passwordStrengthChanged(Property*)), SLOT(propertyStrengthChanged()));
+}
+
+
+/**
+ * @brief Inserts a child entry.
+ *
+ * Overwritten to invalidate the cached password strength.
+ *
+ * @param newChild the new child
+ * @sa Q3ListViewItem::insertItem()
+ */
+void TreeEntry::insertItem(Q3ListViewItem* newChild)
+{
+    Q3ListViewItem::insertItem(newChild);
+    invalidatePasswordStrength();
+}
+
+
+/**
+ * @brief Removes a child entry.
+ *
+ * Overwritten to invalidate the cached password strength. This is also called if a
+ * child is deleted.
+ *
+ * @param item the child
+ * @sa Q3ListViewItem::takeItem()
+ */
+void TreeEntry::takeItem(Q3ListViewItem* item)
+{
+    Q3ListViewItem::takeItem(item);
+    invalidatePasswordStrength();
+}
+
+
 /**
  * @brief Returns the name of the entry.
  */
@@ -118,6 +281,7 @@ bool TreeEntry::isCategory() const
  */
 Property* TreeEntry::getProperty(unsigned int index)
 {
+    loadProperties();
     Q_ASSERT(index < m_properties.count());
     return m_properties.at(index);
 }
@@ -164,6 +328,7 @@ void TreeEntry::setText(int column, const QString& text)
  */
 void TreeEntry::movePropertyOneUp(unsigned int index)
 {
+    loadProperties();
     Q_ASSERT( index < m_properties.count() - 1);
 
     m_properties.setAutoDelete(false);
@@ -181,6 +346,7 @@ void TreeEntry::movePropertyOneUp(unsigned int index)
  */
 void TreeEntry::movePropertyOneDown(unsigned int index)
 {
+    loadProperties();
     Q_ASSERT( index > 0 && index < m_properties.count() );
 
     m_properties.setAutoDelete(false);
@@ -198,8 +364,10 @@ void TreeEntry::movePropertyOneDown(unsigned int index)
  */
 void TreeEntry::deleteProperty(unsigned int index)
 {
+    loadProperties();
     Q_ASSERT( index < m_properties.count() );
     m_properties.remove(index);
+    invalidatePasswordStrength();
 }
 
 
@@ -208,7 +376,9 @@ void TreeEntry::deleteProperty(unsigned int index)
  */
 void TreeEntry::deleteAllProperties()
 {
+    m_loader = 0;
     m_properties.clear();
+    invalidatePasswordStrength();
 }
 
 
@@ -219,7 +389,10 @@ void TreeEntry::deleteAllProperties()
  */
 void TreeEntry::appendProperty(Property* property)
 {
+    loadProperties();
     m_properties.append(property);
+    watchProperty(property);
+    invalidatePasswordStrength();
     emit propertyAppended();
 }
 
@@ -229,10 +402,57 @@ void TreeEntry::appendProperty(Property* property)
  */
 TreeEntry::PropertyIterator TreeEntry::propertyIterator() const
 {
+    loadProperties();
     return PropertyIterator(m_properties);
 }
 
 
+/**
+ * @brief Defers the creation of the properties until they are needed.
+ *
+ * The entry must not have properties yet. The first time the properties are accessed,
+ * they are requested from @p loader, so decrypted passwords only exist for the entries
+ * that are actually used.
+ *
+ * @param loader the loader, must be valid as long as this entry exists
+ * @param offset the offset that is passed to PropertyLoader::loadProperties()
+ */
+void TreeEntry::setPropertyLoader(PropertyLoader* loader, quint32 offset)
+{
+    Q_ASSERT(m_properties.isEmpty());
+    m_loader = loader;
+    m_loaderOffset = offset;
+}
+
+
+/**
+ * @brief Requests the properties from the PropertyLoader if that was not done yet.
+ *
+ * If loading fails, the entry stays empty and a message is displayed in the status bar.
+ */
+void TreeEntry::loadProperties() const
+{
+    if (!m_loader)
+        return;
+
+    // reset first, the loader is only asked once
+    PropertyLoader* loader = m_loader;
+    m_loader = 0;
+
+    PropertyCollector collector(const_cast<TreeEntry*>(this)->m_properties);
+    try {
+        loader->loadProperties(m_loaderOffset, collector);
+    } catch (const ReadWriteException& e) {
+        qDebug() << CURRENT_FUNCTION << e.getMessage();
+        Qpamat::instance()->getWindow()->message(e.getMessage());
+    }
+
+    PropertyIterator it(m_properties);
+    for (Property* current; (current = it.current()) != 0; ++it)
+        watchProperty(current);
+}
+
+
 /**
  * @brief Returns the full name including the category.
  *
@@ -337,7 +557,7 @@ void TreeEntry::appendXML(QDomDocument& document, QDomNode& parent) const
     } else {
         newElement = document.createElement("entry");
 
-        PropertyIterator it(m_properties);
+        PropertyIterator it = propertyIterator();
         Property* property;
         while ( (property = it.current()) != 0 ) {
             ++it;
@@ -350,6 +570,40 @@ void TreeEntry::appendXML(QDomDocument& document, QDomNode& parent) const
 }
 
 
+/**
+ * @brief Passes the treeentry and all children to a DataHandler.
+ *
+ * @param handler the handler
+ * @exception DecryptionException if a password cannot be decrypted, see Property::getValue()
+ */
+void TreeEntry::writeData(DataHandler& handler) const
+{
+    if (m_isCategory) {
+        handler.startCategory(m_name, isOpen(), isSelected());
+
+        TreeEntry* child = dynamic_cast<TreeEntry*>(firstChild());
+        while (child) {
+            child->writeData(handler);
+            child = dynamic_cast<TreeEntry*>(child->nextSibling());
+        }
+
+        handler.endCategory();
+    } else {
+        handler.startEntry(m_name, isSelected());
+
+        PropertyIterator it = propertyIterator();
+        Property* property;
+        while ( (property = it.current()) != 0 ) {
+            ++it;
+            handler.appendProperty(property->getKey(), property->getValue(),
+                property->getType(), property->isEncrypted(), property->isHidden());
+        }
+
+        handler.endEntry();
+    }
+}
+
+
 /**
  * @brief Converts this TreeEntry to XML.
  *
@@ -419,8 +673,8 @@ void TreeEntry::dropped(QDropEvent *evt)
             setOpen(true);
 
         listView()->setSelected(appended, true);
-        dynamic_cast<Tree*>(listView())->updatePasswordStrengthView();
         delete src;
+        dynamic_cast<Tree*>(listView())->updateChangedPasswordStrengthView();
     }
 }
 
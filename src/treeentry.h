@@ -24,6 +24,8 @@
 #include <Q3ValueList>
 
 #include "property.h"
+#include "datahandler.h"
+#include "propertyloader.h"
 
 typedef Q3PtrList<Property> PropertyPtrList;
 
@@ -46,10 +48,18 @@ class TreeEntry : public QObject, public Q3ListViewItem
         Property* getProperty(unsigned int index);
         void appendProperty(Property* property);
         PropertyIterator propertyIterator() const;
+        void setPropertyLoader(PropertyLoader* loader, quint32 offset);
 
         Property::PasswordStrength weakestChildrenPassword() const throw (PasswordCheckException);
+        bool hasReusedPassword() const throw (PasswordCheckException);
+        void invalidatePasswordStrength();
+        bool takeStrengthMarkerDirty();
+
+        void insertItem(Q3ListViewItem* newChild);
+        void takeItem(Q3ListViewItem* item);
 
         void appendXML(QDomDocument& document, QDomNode& parent) const;
+        void writeData(DataHandler& handler) const;
 
         QString text(int column) const;
         void setText(int column, const QString& text);
@@ -71,6 +81,9 @@ class TreeEntry : public QObject, public Q3ListViewItem
         void deleteProperty(unsigned int index);
         void deleteAllProperties();
 
+    private slots:
+        void propertyStrengthChanged();
+
     signals:
         void propertyAppended();
 
@@ -81,10 +94,18 @@ class TreeEntry : public QObject, public Q3ListViewItem
         QString             m_name;
         PropertyPtrList     m_properties;
         bool                m_isCategory;
-        bool                m_weak;
+        mutable Property::PasswordStrength m_weakest;
+        mutable bool        m_weakestValid;
+        mutable bool        m_hasReused;
+        bool                m_strengthMarkerDirty;
+        mutable PropertyLoader* m_loader;
+        quint32             m_loaderOffset;
 
     private:
         void init();
+        void loadProperties() const;
+        void watchProperty(Property* property) const;
+        void markStrengthMarkerDirty();
 
     private:
         TreeEntry(const TreeEntry&);
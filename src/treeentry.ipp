@@ -25,12 +25,18 @@ TreeEntry::TreeEntry(T* parent, const QString& name, bool isCategory)
     : Q3ListViewItem(parent)
     , m_name(name)
     , m_isCategory(isCategory)
-    , m_weak(false)
+    , m_weakest(Property::PUndefined)
+    , m_weakestValid(false)
+    , m_hasReused(false)
+    , m_strengthMarkerDirty(false)
+    , m_loader(0)
+    , m_loaderOffset(0)
 {
     setRenameEnabled(0, true);
     setDragEnabled(true);
     setDropEnabled(true);
     m_properties.setAutoDelete(true);
+    markStrengthMarkerDirty();
 }
 
 
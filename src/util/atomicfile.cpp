@@ -0,0 +1,318 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+
+#include "global.h"
+#include "atomicfile.h"
+#include "platformhelpers.h"
+
+/**
+ * @class AtomicFile
+ *
+ * @brief A QIODevice that replaces a file atomically
+ *
+ * All data is written to a temporary file in the same directory as the destination
+ * file. Only commit() replaces the destination, after the temporary file has been synced
+ * to the disk. So if the application crashes or the disk gets full while writing, the
+ * old file is still intact. If the object is closed or destroyed without commit(), the
+ * temporary file is removed.
+ *
+ * If the destination is a symbolic link, the file that it points to is replaced and the
+ * link is kept.
+ *
+ * Before the destination is replaced, a number of backups can be kept. The newest backup
+ * has the suffix <tt>.bak.1</tt>, the oldest one <tt>.bak.N</tt>.
+ *
+ * Data is collected in a big buffer and written to the disk in chunks of BUFFER_SIZE bytes,
+ * which avoids lots of small write() calls if the data is produced in small pieces
+ * (such as by QXmlStreamWriter).
+ *
+ * The device can only be opened for writing.
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @brief Size of the write buffer.
+ */
+const int AtomicFile::BUFFER_SIZE = 1024 * 1024;
+
+/**
+ * @brief Creates a new AtomicFile.
+ *
+ * @param fileName the name of the file which gets replaced on commit()
+ * @param backups the number of backups that should be kept
+ */
+AtomicFile::AtomicFile(const QString& fileName, int backups)
+    : m_fileName(resolveLinks(fileName))
+    , m_backups(backups)
+    , m_tempFile(m_fileName + ".XXXXXX")
+    , m_failed(false)
+{}
+
+
+/**
+ * @brief Deletes the object.
+ *
+ * If commit() was not called, the temporary file is removed.
+ */
+AtomicFile::~AtomicFile()
+{
+    close();
+}
+
+
+/**
+ * @brief Returns the name of the file which gets replaced.
+ *
+ * @return the file name, symbolic links are resolved
+ */
+QString AtomicFile::fileName() const
+{
+    return m_fileName;
+}
+
+
+/**
+ * @brief Returns the name of a backup file.
+ *
+ * @param number the number of the backup, 1 is the newest backup
+ * @return the file name
+ */
+QString AtomicFile::backupFileName(int number) const
+{
+    return m_fileName + ".bak." + QString::number(number);
+}
+
+
+/**
+ * @brief Creates the temporary file and opens the device.
+ *
+ * The temporary file gets the permissions of the destination file if that exists.
+ *
+ * @param mode must be QIODevice::WriteOnly, other modes are not supported
+ * @return @c true on success, @c false otherwise. Use errorString() to get the
+ *         error message.
+ */
+bool AtomicFile::open(OpenMode mode)
+{
+    if (mode != QIODevice::WriteOnly) {
+        qWarning() << CURRENT_FUNCTION << "Only QIODevice::WriteOnly is supported";
+        return false;
+    }
+
+    if (!m_tempFile.open()) {
+        setErrorString(m_tempFile.errorString());
+        return false;
+    }
+
+    if (QFile::exists(m_fileName))
+        m_tempFile.setPermissions(QFile::permissions(m_fileName));
+
+    m_buffer.reserve(BUFFER_SIZE);
+    m_failed = false;
+
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+
+/**
+ * @brief Closes the device.
+ *
+ * If commit() was not called before, all written data is discarded.
+ */
+void AtomicFile::close()
+{
+    if (!isOpen())
+        return;
+
+    discard();
+    QIODevice::close();
+}
+
+
+/**
+ * @brief The device is sequential.
+ *
+ * @return @c true
+ */
+bool AtomicFile::isSequential() const
+{
+    return true;
+}
+
+
+/**
+ * @brief Writes the data to the disk and replaces the destination file.
+ *
+ * After that call, the device is closed, regardless if the call was successful.
+ *
+ * @return @c true on success, @c false otherwise. If an error occured, the destination
+ *         file is unchanged. Use errorString() to get the error message.
+ */
+bool AtomicFile::commit()
+{
+    if (!isOpen())
+        return false;
+
+    if (m_failed || !flushBuffer() || !m_tempFile.flush()) {
+        close();
+        return false;
+    }
+
+    // QFile::handle() may return -1 on some platforms, the rename must be enough then
+    int fd = m_tempFile.handle();
+    if (fd >= 0 && !PlatformHelpers::syncFile(fd)) {
+        setErrorString(PlatformHelpers::lastError());
+        close();
+        return false;
+    }
+    m_tempFile.close();
+
+    rotateBackups();
+
+    if (!PlatformHelpers::replaceFile(m_tempFile.fileName(), m_fileName)) {
+        qDebug() << CURRENT_FUNCTION << "Replacing" << m_fileName << "failed";
+        setErrorString(PlatformHelpers::lastError());
+        close();
+        return false;
+    }
+
+    m_tempFile.setAutoRemove(false);
+    QIODevice::close();
+
+    return true;
+}
+
+
+/**
+ * @brief Not supported.
+ *
+ * @return -1
+ */
+qint64 AtomicFile::readData(char* data, qint64 maxSize)
+{
+    UNUSED(data);
+    UNUSED(maxSize);
+
+    return -1;
+}
+
+
+/**
+ * @brief Adds the data to the buffer and writes the buffer if it's full.
+ *
+ * @param data the data
+ * @param maxSize the number of bytes in @p data
+ * @return the number of bytes written or -1 on error
+ */
+qint64 AtomicFile::writeData(const char* data, qint64 maxSize)
+{
+    if (m_failed)
+        return -1;
+
+    if (m_buffer.size() + maxSize > BUFFER_SIZE && !flushBuffer())
+        return -1;
+
+    // don't copy data that doesn't fit in the buffer anyway
+    if (maxSize >= BUFFER_SIZE) {
+        if (m_tempFile.write(data, maxSize) != maxSize) {
+            setErrorString(m_tempFile.errorString());
+            m_failed = true;
+            return -1;
+        }
+    } else
+        m_buffer.append(data, maxSize);
+
+    return maxSize;
+}
+
+
+/**
+ * @brief Writes the buffer to the temporary file.
+ *
+ * @return @c true on success, @c false otherwise
+ */
+bool AtomicFile::flushBuffer()
+{
+    if (m_buffer.isEmpty())
+        return true;
+
+    if (m_tempFile.write(m_buffer) != m_buffer.size()) {
+        setErrorString(m_tempFile.errorString());
+        m_failed = true;
+        return false;
+    }
+    m_buffer.resize(0);
+    m_buffer.reserve(BUFFER_SIZE);
+
+    return true;
+}
+
+
+/**
+ * @brief Moves the backups one number up and copies the destination to the first backup.
+ *
+ * Errors are ignored, they should not prevent saving.
+ */
+void AtomicFile::rotateBackups()
+{
+    if (m_backups <= 0 || !QFile::exists(m_fileName))
+        return;
+
+    QFile::remove(backupFileName(m_backups));
+    for (int i = m_backups - 1; i >= 1; --i)
+        if (QFile::exists(backupFileName(i)))
+            QFile::rename(backupFileName(i), backupFileName(i+1));
+
+    if (!QFile::copy(m_fileName, backupFileName(1)))
+        qDebug() << CURRENT_FUNCTION << "Creating the backup of" << m_fileName << "failed";
+}
+
+
+/**
+ * @brief Returns the file that a symbolic link points to.
+ *
+ * Renaming the temporary file to the name of the link would replace the link by a file.
+ *
+ * @param fileName the file name
+ * @return the target of the link, @p fileName if it's no link
+ */
+QString AtomicFile::resolveLinks(const QString& fileName)
+{
+    QFileInfo info(fileName);
+    if (!info.isSymLink())
+        return fileName;
+
+    // the target of a dangling link doesn't exist, so it has no canonical path
+    QString target = info.canonicalFilePath();
+    return target.isEmpty() ? info.symLinkTarget() : target;
+}
+
+
+/**
+ * @brief Removes the temporary file and the buffered data.
+ */
+void AtomicFile::discard()
+{
+    m_buffer.clear();
+    if (m_tempFile.isOpen())
+        m_tempFile.close();
+    m_tempFile.remove();
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,66 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef ATOMICFILE_H
+#define ATOMICFILE_H
+
+#include <QIODevice>
+#include <QTemporaryFile>
+#include <QByteArray>
+#include <QString>
+
+class AtomicFile : public QIODevice
+{
+    public:
+        AtomicFile(const QString& fileName, int backups = 0);
+        virtual ~AtomicFile();
+
+    public:
+        QString fileName() const;
+        QString backupFileName(int number) const;
+
+        bool open(OpenMode mode);
+        void close();
+        bool isSequential() const;
+        bool commit();
+
+    protected:
+        qint64 readData(char* data, qint64 maxSize);
+        qint64 writeData(const char* data, qint64 maxSize);
+
+    private:
+        bool flushBuffer();
+        void rotateBackups();
+        void discard();
+
+        static QString resolveLinks(const QString& fileName);
+
+    private:
+        AtomicFile(const AtomicFile&);
+        AtomicFile& operator=(const AtomicFile&);
+
+    private:
+        static const int    BUFFER_SIZE;
+
+    private:
+        const QString       m_fileName;
+        const int           m_backups;
+        QTemporaryFile      m_tempFile;
+        QByteArray          m_buffer;
+        bool                m_failed;
+};
+
+#endif // ATOMICFILE_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,376 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "bytevector.h"
+#include "securearena.h"
+
+/**
+ * @class ByteVector
+ *
+ * @brief Contiguous byte buffer for keys, plain texts and cipher texts.
+ *
+ * The memory is taken from the SecureArena, so it's locked into memory if the platform
+ * supports that and it's overwritten with zeroes when it's given back. Bytes that are
+ * removed by resize() or clear() are overwritten immediately. The bytes between size() and
+ * capacity() are always zero.
+ *
+ * Unlike the Q3ValueVector that was used before, the buffer is not shared. Pass a ByteSpan
+ * to look at bytes without copying them, use reserve() before appending in a loop and
+ * swap() to hand over a buffer. If the compiler supports rvalue references, ByteVector
+ * objects are moved instead of copied when they are returned.
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @class ByteSpan
+ *
+ * @brief A view on bytes that belong to somebody else.
+ *
+ * A ByteVector converts to a ByteSpan implicitly. The span is only valid as long as the
+ * bytes are not changed, resized or freed.
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @brief Creates an empty ByteVector, nothing is allocated.
+ */
+ByteVector::ByteVector()
+    throw ()
+    : m_data(0)
+    , m_size(0)
+    , m_capacity(0)
+{}
+
+
+/**
+ * @brief Creates a ByteVector with @p size zero bytes.
+ *
+ * @param [in] size the number of bytes
+ * @throw std::bad_alloc if the memory cannot be allocated
+ */
+ByteVector::ByteVector(int size)
+    throw (std::bad_alloc)
+    : m_data(0)
+    , m_size(0)
+    , m_capacity(0)
+{
+    resize(size);
+}
+
+
+/**
+ * @brief Creates a ByteVector with a copy of @p size bytes at @p data.
+ *
+ * @param [in] data the bytes
+ * @param [in] size the number of bytes
+ * @throw std::bad_alloc if the memory cannot be allocated
+ */
+ByteVector::ByteVector(const unsigned char *data, int size)
+    throw (std::bad_alloc)
+    : m_data(0)
+    , m_size(0)
+    , m_capacity(0)
+{
+    append(ByteSpan(data, size));
+}
+
+
+/**
+ * @brief Creates a ByteVector with a copy of @p bytes.
+ *
+ * @param [in] bytes the bytes
+ * @throw std::bad_alloc if the memory cannot be allocated
+ */
+ByteVector::ByteVector(const ByteSpan &bytes)
+    throw (std::bad_alloc)
+    : m_data(0)
+    , m_size(0)
+    , m_capacity(0)
+{
+    append(bytes);
+}
+
+
+/**
+ * @brief Creates a copy of @p other.
+ *
+ * @param [in] other the ByteVector to copy
+ * @throw std::bad_alloc if the memory cannot be allocated
+ */
+ByteVector::ByteVector(const ByteVector &other)
+    throw (std::bad_alloc)
+    : m_data(0)
+    , m_size(0)
+    , m_capacity(0)
+{
+    append(other);
+}
+
+
+/**
+ * @brief Overwrites the bytes and gives the memory back.
+ */
+ByteVector::~ByteVector()
+    throw ()
+{
+    clear();
+}
+
+
+/**
+ * @brief Replaces the contents with a copy of @p other.
+ *
+ * The memory is reused if it's large enough.
+ *
+ * @param [in] other the ByteVector to copy
+ * @return this object
+ * @throw std::bad_alloc if the memory cannot be allocated
+ */
+ByteVector &ByteVector::operator=(const ByteVector &other)
+    throw (std::bad_alloc)
+{
+    if (&other != this) {
+        resize(0);
+        append(other);
+    }
+    return *this;
+}
+
+#ifdef Q_COMPILER_RVALUE_REFS
+
+/**
+ * @brief Moves a ByteVector.
+ *
+ * The memory of @p other is taken over. After that, @p other is empty.
+ *
+ * @param [in] other the ByteVector to move from
+ */
+ByteVector::ByteVector(ByteVector &&other)
+    throw ()
+    : m_data(other.m_data)
+    , m_size(other.m_size)
+    , m_capacity(other.m_capacity)
+{
+    other.m_data = 0;
+    other.m_size = 0;
+    other.m_capacity = 0;
+}
+
+
+/**
+ * @brief Move assignment of a ByteVector.
+ *
+ * The old contents is overwritten and released, then the memory of @p other is taken
+ * over. After that, @p other is empty.
+ *
+ * @param [in] other the ByteVector to move from
+ */
+ByteVector &ByteVector::operator=(ByteVector &&other)
+    throw ()
+{
+    if (&other != this) {
+        clear();
+        swap(other);
+    }
+    return *this;
+}
+
+#endif // Q_COMPILER_RVALUE_REFS
+
+
+/**
+ * @brief Exchanges the contents of two ByteVector objects.
+ *
+ * Nothing is allocated or copied.
+ *
+ * @param [in,out] other the other ByteVector
+ */
+void ByteVector::swap(ByteVector &other)
+    throw ()
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_capacity, other.m_capacity);
+}
+
+
+/**
+ * @brief Checks if both ByteVector objects contain the same bytes.
+ *
+ * @param [in] other the ByteVector to compare with
+ * @return @c true if the sizes and the bytes are equal
+ */
+bool ByteVector::operator==(const ByteVector &other) const
+    throw ()
+{
+    return m_size == other.m_size && (m_size == 0 || memcmp(m_data, other.m_data, m_size) == 0);
+}
+
+
+/**
+ * @brief Checks if the ByteVector objects differ.
+ *
+ * @param [in] other the ByteVector to compare with
+ * @return @c true if the sizes or the bytes are different
+ */
+bool ByteVector::operator!=(const ByteVector &other) const
+    throw ()
+{
+    return !(*this == other);
+}
+
+
+/**
+ * @brief Checks if @p bytes point into the memory of this ByteVector.
+ *
+ * @param [in] bytes the bytes
+ * @return @c true if at least one byte of @p bytes is in the allocated memory
+ */
+bool ByteVector::overlaps(const ByteSpan &bytes) const
+    throw ()
+{
+    return m_data && !bytes.isEmpty()
+        && bytes.data() < m_data + m_capacity && m_data < bytes.data() + bytes.size();
+}
+
+
+/**
+ * @brief Makes sure that @p capacity bytes fit without allocating again.
+ *
+ * @param [in] capacity the number of bytes
+ * @throw std::bad_alloc if the memory cannot be allocated
+ */
+void ByteVector::reserve(int capacity)
+    throw (std::bad_alloc)
+{
+    if (capacity > m_capacity)
+        reallocate(capacity);
+}
+
+
+/**
+ * @brief Changes the size.
+ *
+ * New bytes are zero, bytes that are removed are overwritten with zeroes. The memory is
+ * only allocated again if @p size is larger than capacity().
+ *
+ * @param [in] size the new number of bytes
+ * @throw std::bad_alloc if the memory cannot be allocated
+ */
+void ByteVector::resize(int size)
+    throw (std::bad_alloc)
+{
+    if (size > m_capacity)
+        reallocate(size);
+    else if (size < m_size)
+        std::fill(m_data + size, m_data + m_size, 0);
+    m_size = size;
+}
+
+
+/**
+ * @brief Appends a copy of @p bytes.
+ *
+ * The capacity grows exponentially, so appending in a loop is cheap.
+ *
+ * @param [in] bytes the bytes, may be part of this ByteVector
+ * @throw std::bad_alloc if the memory cannot be allocated
+ */
+void ByteVector::append(const ByteSpan &bytes)
+    throw (std::bad_alloc)
+{
+    if (bytes.isEmpty())
+        return;
+
+    const int newSize = m_size + bytes.size();
+    if (newSize > m_capacity) {
+        if (overlaps(bytes)) {
+            ByteVector copy(*this);
+            copy.append(bytes);
+            swap(copy);
+            return;
+        }
+        reallocate(qMax(newSize, 2 * m_capacity));
+    }
+
+    std::copy(bytes.begin(), bytes.end(), m_data + m_size);
+    m_size = newSize;
+}
+
+
+/**
+ * @brief Appends one byte.
+ *
+ * @param [in] byte the byte
+ * @throw std::bad_alloc if the memory cannot be allocated
+ */
+void ByteVector::append(unsigned char byte)
+    throw (std::bad_alloc)
+{
+    if (m_size == m_capacity)
+        reallocate(qMax(16, 2 * m_capacity));
+    m_data[m_size++] = byte;
+}
+
+
+/**
+ * @brief Overwrites the bytes and gives the memory back to the SecureArena.
+ *
+ * After that, the ByteVector is empty.
+ */
+void ByteVector::clear()
+    throw ()
+{
+    if (m_data) {
+        std::fill(m_data, m_data + m_size, 0);
+        SecureArena::instance().release(reinterpret_cast<char *>(m_data), m_capacity);
+    }
+    m_data = 0;
+    m_size = 0;
+    m_capacity = 0;
+}
+
+
+/**
+ * @brief Moves the bytes to a new block of @p capacity bytes.
+ *
+ * The old block is overwritten and given back.
+ *
+ * @param [in] capacity the new capacity, not smaller than size()
+ * @throw std::bad_alloc if the memory cannot be allocated
+ */
+void ByteVector::reallocate(int capacity)
+    throw (std::bad_alloc)
+{
+    bool locked;
+    unsigned char *data = reinterpret_cast<unsigned char *>(
+        SecureArena::instance().allocate(capacity, locked));
+
+    if (m_data)
+        std::copy(m_data, m_data + m_size, data);
+
+    const int size = m_size;
+    clear();
+    m_data = data;
+    m_size = size;
+    m_capacity = capacity;
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,221 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef BYTEVECTOR_H
+#define BYTEVECTOR_H
+
+#include <stdexcept>
+
+#include <QtGlobal>
+
+class ByteVector;
+
+class ByteSpan
+{
+    public:
+        ByteSpan()
+        throw ()
+            : m_data(0), m_size(0) {}
+
+        ByteSpan(const unsigned char *data, int size)
+        throw ()
+            : m_data(data), m_size(size) {}
+
+        inline ByteSpan(const ByteVector &vector)
+        throw ();
+
+    public:
+        const unsigned char *data() const
+        throw ()
+        { return m_data; }
+
+        int size() const
+        throw ()
+        { return m_size; }
+
+        bool isEmpty() const
+        throw ()
+        { return m_size == 0; }
+
+        const unsigned char *begin() const
+        throw ()
+        { return m_data; }
+
+        const unsigned char *end() const
+        throw ()
+        { return m_data + m_size; }
+
+        unsigned char operator[](int i) const
+        throw ()
+        { return m_data[i]; }
+
+        ByteSpan mid(int pos, int length) const
+        throw ()
+        { return ByteSpan(m_data + pos, length); }
+
+    private:
+        const unsigned char *m_data;
+        int m_size;
+};
+
+class ByteVector
+{
+    public:
+        typedef unsigned char           value_type;
+        typedef unsigned char           *iterator;
+        typedef const unsigned char     *const_iterator;
+        typedef iterator                Iterator;
+        typedef const_iterator          ConstIterator;
+
+    public:
+        ByteVector()
+        throw ();
+
+        explicit ByteVector(int size)
+        throw (std::bad_alloc);
+
+        ByteVector(const unsigned char *data, int size)
+        throw (std::bad_alloc);
+
+        explicit ByteVector(const ByteSpan &bytes)
+        throw (std::bad_alloc);
+
+        ByteVector(const ByteVector &other)
+        throw (std::bad_alloc);
+
+        ~ByteVector()
+        throw ();
+
+        ByteVector &operator=(const ByteVector &other)
+        throw (std::bad_alloc);
+
+#ifdef Q_COMPILER_RVALUE_REFS
+        ByteVector(ByteVector &&other)
+        throw ();
+
+        ByteVector &operator=(ByteVector &&other)
+        throw ();
+#endif
+
+        void swap(ByteVector &other)
+        throw ();
+
+        bool operator==(const ByteVector &other) const
+        throw ();
+
+        bool operator!=(const ByteVector &other) const
+        throw ();
+
+    public:
+        int size() const
+        throw ()
+        { return m_size; }
+
+        int capacity() const
+        throw ()
+        { return m_capacity; }
+
+        bool isEmpty() const
+        throw ()
+        { return m_size == 0; }
+
+        bool empty() const
+        throw ()
+        { return m_size == 0; }
+
+        unsigned char *data()
+        throw ()
+        { return m_data; }
+
+        const unsigned char *data() const
+        throw ()
+        { return m_data; }
+
+        const unsigned char *constData() const
+        throw ()
+        { return m_data; }
+
+        iterator begin()
+        throw ()
+        { return m_data; }
+
+        const_iterator begin() const
+        throw ()
+        { return m_data; }
+
+        iterator end()
+        throw ()
+        { return m_data + m_size; }
+
+        const_iterator end() const
+        throw ()
+        { return m_data + m_size; }
+
+        unsigned char &operator[](int i)
+        throw ()
+        { return m_data[i]; }
+
+        unsigned char operator[](int i) const
+        throw ()
+        { return m_data[i]; }
+
+        ByteSpan mid(int pos, int length) const
+        throw ()
+        { return ByteSpan(m_data + pos, length); }
+
+        bool overlaps(const ByteSpan &bytes) const
+        throw ();
+
+        void reserve(int capacity)
+        throw (std::bad_alloc);
+
+        void resize(int size)
+        throw (std::bad_alloc);
+
+        void append(const ByteSpan &bytes)
+        throw (std::bad_alloc);
+
+        void append(unsigned char byte)
+        throw (std::bad_alloc);
+
+        void clear()
+        throw ();
+
+    private:
+        void reallocate(int capacity)
+        throw (std::bad_alloc);
+
+    private:
+        unsigned char *m_data;
+        int m_size;
+        int m_capacity;
+};
+
+Q_DECLARE_TYPEINFO(ByteVector, Q_MOVABLE_TYPE);
+
+inline ByteSpan::ByteSpan(const ByteVector &vector)
+    throw ()
+    : m_data(vector.constData())
+    , m_size(vector.size())
+{}
+
+inline void swap(ByteVector &a, ByteVector &b)
+    throw ()
+{
+    a.swap(b);
+}
+
+#endif // BYTEVECTOR_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
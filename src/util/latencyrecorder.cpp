@@ -0,0 +1,116 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <algorithm>
+
+#include <QDebug>
+
+#include "global.h"
+#include "latencyrecorder.h"
+
+/**
+ * @class LatencyRecorder
+ *
+ * @brief Records the last durations of an operation and computes percentiles.
+ *
+ * Only the last \p window samples are kept, use percentile() to read them. If a
+ * \p reportInterval is given, the median and the 99th percentile are also printed with
+ * qDebug() every \p reportInterval samples. That's only meant for measurements, so it's
+ * disabled by default.
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @brief Creates a new recorder.
+ *
+ * @param name the name that is printed in the report
+ * @param window the number of samples that are kept
+ * @param reportInterval the number of samples between two reports, 0 (the default)
+ *        disables reports
+ */
+LatencyRecorder::LatencyRecorder(const QString& name, int window, int reportInterval)
+    : m_name(name)
+    , m_window(qMax(window, 1))
+    , m_next(0)
+    , m_count(0)
+    , m_reportInterval(reportInterval)
+{
+    m_samples.reserve(m_window);
+}
+
+
+/**
+ * @brief Adds a sample.
+ *
+ * @param milliseconds the duration
+ */
+void LatencyRecorder::add(int milliseconds)
+{
+    if (m_samples.size() < m_window)
+        m_samples.append(milliseconds);
+    else
+        m_samples[m_next] = milliseconds;
+    m_next = (m_next + 1) % m_window;
+    m_count++;
+
+    if (m_reportInterval > 0 && m_count % m_reportInterval == 0)
+        qDebug() << CURRENT_FUNCTION << m_name << "p50 =" << percentile(50) << "ms, p99 ="
+                 << percentile(99) << "ms, samples =" << m_samples.size();
+}
+
+
+/**
+ * @brief Returns the number of samples that have been added since the last clear().
+ *
+ * @return the number, may be larger than the window
+ */
+int LatencyRecorder::count() const
+{
+    return m_count;
+}
+
+
+/**
+ * @brief Returns a percentile of the samples in the window.
+ *
+ * The nearest-rank method is used.
+ *
+ * @param percent the percentile between 0 and 100
+ * @return the duration in milliseconds or -1 if there are no samples
+ */
+int LatencyRecorder::percentile(int percent) const
+{
+    if (m_samples.isEmpty())
+        return -1;
+
+    QVector<int> sorted = m_samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    int rank = (qBound(0, percent, 100) * sorted.size() + 99) / 100;
+    return sorted[qMax(rank, 1) - 1];
+}
+
+
+/**
+ * @brief Removes all samples.
+ */
+void LatencyRecorder::clear()
+{
+    m_samples.clear();
+    m_next = 0;
+    m_count = 0;
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -51,6 +51,8 @@
  * @author Bernhard Walle <bernhard@bwalle.de>
  */
 
+#include <QString>
+
 #ifndef DOXYGEN
 
 #ifdef Q_WS_X11
@@ -95,6 +97,10 @@ class PlatformHelpers
         };
 
         static bool isTerminal(FileChannel channel);
+        static bool setTerminalEcho(bool enabled);
+        static bool syncFile(int fd);
+        static bool replaceFile(const QString& source, const QString& destination);
+        static QString lastError();
 };
 
 #endif /* PLATFORMHELPERS_H */
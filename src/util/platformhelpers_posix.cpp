@@ -12,7 +12,16 @@
  *
  * -------------------------------------------------------------------------------------------------
  */
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
 #include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+
+#include <QFile>
+#include <QFileInfo>
 
 #include "platformhelpers.h"
 
@@ -86,4 +95,82 @@ bool PlatformHelpers::isTerminal(FileChannel channel)
     return isatty(fd);
 }
 
+/**
+ * @brief Switches the echo of the terminal on standard input on or off
+ *
+ * This is used to read passwords from the terminal.
+ *
+ * @param[in] enabled @c true if typed characters should be displayed, @c false otherwise
+ * @return @c true on success, @c false if standard input is no terminal
+ */
+bool PlatformHelpers::setTerminalEcho(bool enabled)
+{
+    struct termios attributes;
+    if (tcgetattr(STDIN_FILENO, &attributes) != 0)
+        return false;
+
+    if (enabled)
+        attributes.c_lflag |= ECHO;
+    else
+        attributes.c_lflag &= ~ECHO;
+
+    return tcsetattr(STDIN_FILENO, TCSANOW, &attributes) == 0;
+}
+
+/**
+ * @brief Writes all buffered data of a file to the disk
+ *
+ * Returns after the data of the file has been written to the storage device.
+ * This is an implementation of the fsync() function in POSIX.
+ *
+ * @param[in] fd the file descriptor, for example QFile::handle()
+ * @return @c true on success, @c false otherwise.
+ */
+bool PlatformHelpers::syncFile(int fd)
+{
+    return fsync(fd) == 0;
+}
+
+/**
+ * @brief Replaces a file atomically by another file
+ *
+ * After the call, @p destination has the contents of @p source and @p source
+ * doesn't exist any more. If @p destination exists, it's replaced atomically, i.e.
+ * there's no point in time where the file doesn't exist. Both files must be on the same
+ * file system.
+ *
+ * On POSIX, this is rename() followed by a sync of the directory.
+ *
+ * @param[in] source the file which should be renamed
+ * @param[in] destination the new name of the file
+ * @return @c true on success, @c false otherwise.
+ */
+bool PlatformHelpers::replaceFile(const QString& source, const QString& destination)
+{
+    if (std::rename(QFile::encodeName(source), QFile::encodeName(destination)) != 0)
+        return false;
+
+    // the new directory entry must also be on the disk
+    int dirfd = open(QFile::encodeName(QFileInfo(destination).absolutePath()), O_RDONLY);
+    if (dirfd >= 0) {
+        fsync(dirfd);
+        close(dirfd);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Returns the message of the last error
+ *
+ * Call this after one of the functions in this class has failed. On POSIX, this is the
+ * message of @c errno, on Windows the message of @c GetLastError().
+ *
+ * @return the error message in the language of the system
+ */
+QString PlatformHelpers::lastError()
+{
+    return QString::fromLocal8Bit(std::strerror(errno));
+}
+
 // vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -12,6 +12,9 @@
  *
  * -------------------------------------------------------------------------------------------------
  */
+#include <io.h>
+#include <windows.h>
+
 #include "platformhelpers.h"
 
 bool PlatformHelpers::isTerminal(FileChannel channel)
@@ -19,4 +22,46 @@ bool PlatformHelpers::isTerminal(FileChannel channel)
     return false;
 }
 
+bool PlatformHelpers::setTerminalEcho(bool enabled)
+{
+    HANDLE input = GetStdHandle(STD_INPUT_HANDLE);
+    DWORD mode;
+    if (!GetConsoleMode(input, &mode))
+        return false;
+
+    if (enabled)
+        mode |= ENABLE_ECHO_INPUT;
+    else
+        mode &= ~ENABLE_ECHO_INPUT;
+
+    return SetConsoleMode(input, mode) != 0;
+}
+
+bool PlatformHelpers::syncFile(int fd)
+{
+    return _commit(fd) == 0;
+}
+
+bool PlatformHelpers::replaceFile(const QString& source, const QString& destination)
+{
+    return MoveFileExW(reinterpret_cast<LPCWSTR>(source.utf16()),
+                       reinterpret_cast<LPCWSTR>(destination.utf16()),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+QString PlatformHelpers::lastError()
+{
+    DWORD error = GetLastError();
+    LPWSTR buffer = 0;
+    DWORD length = FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM |
+                                  FORMAT_MESSAGE_IGNORE_INSERTS, 0, error, 0,
+                                  reinterpret_cast<LPWSTR>(&buffer), 0, 0);
+    if (length == 0)
+        return QString("Error %1").arg(error);
+
+    QString message = QString::fromUtf16(reinterpret_cast<const ushort*>(buffer), length);
+    LocalFree(buffer);
+    return message.trimmed();
+}
+
 // vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
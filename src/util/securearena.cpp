@@ -0,0 +1,438 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+// before the include of <sys/mman.h> to get the Q_WS_X11 define
+#include <QDebug>
+#include <QMutexLocker>
+
+#if defined(Q_WS_X11) || defined(Q_WS_MAC)
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+#include "securearena.h"
+
+/**
+ * @class SecureArena
+ *
+ * @brief Allocator for the memory of SecureString objects
+ *
+ * Locking every string separately needs one heap allocation and one mlock() call per string,
+ * and with many passwords the locked memory limit (<tt>RLIMIT_MEMLOCK</tt>) is reached
+ * quickly because each call locks at least one page. The arena allocates chunks of
+ * CHUNK_SIZE bytes, locks each chunk once and hands out blocks of them. Chunks consist of
+ * whole pages and are mapped with mmap() where it's available, so unlocking a chunk never
+ * unlocks a page that belongs to other memory.
+ *
+ * Blocks have a size of a power of two between MIN_BLOCK_SIZE and MAX_BLOCK_SIZE. A
+ * released block is overwritten with zeroes and put on a free list for the next block of
+ * the same size. Chunks are never returned before the arena is destroyed. Requests that are
+ * larger than MAX_BLOCK_SIZE get a chunk of their own which is freed on release().
+ *
+ * The arena is thread-safe. Normally there's only one, see instance().
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @brief The size of a chunk that is allocated and locked at once.
+ */
+const size_t SecureArena::CHUNK_SIZE = 64 * 1024;
+
+/**
+ * @brief The smallest block that is handed out.
+ */
+const size_t SecureArena::MIN_BLOCK_SIZE = 16;
+
+/**
+ * @brief The largest block that is taken from a shared chunk.
+ */
+const size_t SecureArena::MAX_BLOCK_SIZE = 4096;
+
+/**
+ * @brief Returns the arena that is used by SecureString.
+ *
+ * @return the global instance
+ */
+SecureArena& SecureArena::instance()
+    throw ()
+{
+    static SecureArena arena;
+    return arena;
+}
+
+
+/**
+ * @brief Creates a new, empty SecureArena.
+ *
+ * No memory is allocated before the first call to allocate().
+ */
+SecureArena::SecureArena()
+    throw ()
+    : m_lockedBytes(0)
+    , m_reservedBytes(0)
+    , m_bytesInUse(0)
+    , m_blocksInUse(0)
+    , m_allocations(0)
+    , m_lockCalls(0)
+    , m_warned(false)
+{}
+
+
+/**
+ * @brief Overwrites, unlocks and frees all chunks.
+ */
+SecureArena::~SecureArena()
+    throw ()
+{
+    if (m_blocksInUse > 0)
+        qDebug() << "SecureArena destroyed with" << m_blocksInUse << "blocks in use";
+
+    for (int i = 0; i < m_chunks.size(); i++)
+        unmapChunk(m_chunks[i]);
+    for (int i = 0; i < m_largeBlocks.size(); i++)
+        unmapChunk(m_largeBlocks[i]);
+}
+
+
+/**
+ * @brief Allocates a block of at least @p size bytes.
+ *
+ * The contents of the block is zero.
+ *
+ * @param [in] size the number of bytes
+ * @param [out] locked set to @c true if the block is locked into memory, @c false if locking
+ *                     failed or is not supported on this platform
+ * @return the block that must be passed to release() with the same @p size
+ * @throw std::bad_alloc if no memory could be allocated
+ */
+char *SecureArena::allocate(size_t size, bool &locked)
+    throw (std::bad_alloc)
+{
+    QMutexLocker lock(&m_mutex);
+    m_allocations++;
+
+    // large blocks get their own chunk
+    if (size > MAX_BLOCK_SIZE) {
+        Chunk chunk = mapChunk(size);
+        chunk.used = size;
+        m_largeBlocks.append(chunk);
+        m_bytesInUse += size;
+        m_blocksInUse++;
+        locked = chunk.locked;
+        return chunk.memory;
+    }
+
+    int cls = sizeClass(size);
+    size_t bytes = blockSize(cls);
+    char *block = 0;
+
+    if (!m_freeLists[cls].isEmpty()) {
+        block = m_freeLists[cls].last();
+        m_freeLists[cls].pop_back();
+        locked = isLocked(block);
+    } else {
+        // the last chunk is the only one that may have space left
+        if (m_chunks.isEmpty() || m_chunks.last().size - m_chunks.last().used < bytes)
+            m_chunks.append(mapChunk(CHUNK_SIZE));
+
+        Chunk &chunk = m_chunks.last();
+        block = chunk.memory + chunk.used;
+        chunk.used += bytes;
+        locked = chunk.locked;
+    }
+
+    m_bytesInUse += bytes;
+    m_blocksInUse++;
+    return block;
+}
+
+
+/**
+ * @brief Overwrites a block with zeroes and gives it back to the arena.
+ *
+ * @param [in] block the block returned by allocate(), may be 0
+ * @param [in] size the size that was passed to allocate()
+ */
+void SecureArena::release(char *block, size_t size)
+    throw ()
+{
+    if (!block)
+        return;
+
+    QMutexLocker lock(&m_mutex);
+
+    if (size > MAX_BLOCK_SIZE) {
+        for (int i = 0; i < m_largeBlocks.size(); i++) {
+            if (m_largeBlocks[i].memory == block) {
+                unmapChunk(m_largeBlocks[i]);
+                m_largeBlocks.remove(i);
+                m_bytesInUse -= size;
+                m_blocksInUse--;
+                return;
+            }
+        }
+        Q_ASSERT(false);
+        return;
+    }
+
+    int cls = sizeClass(size);
+    size_t bytes = blockSize(cls);
+
+    std::fill(block, block + bytes, '\0');
+    m_freeLists[cls].append(block);
+    m_bytesInUse -= bytes;
+    m_blocksInUse--;
+}
+
+
+/**
+ * @brief Returns the number of bytes that are locked into memory.
+ *
+ * @return the size of all locked chunks
+ */
+size_t SecureArena::lockedBytes() const
+    throw ()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_lockedBytes;
+}
+
+
+/**
+ * @brief Returns the number of bytes that have been allocated, locked or not.
+ *
+ * @return the size of all chunks
+ */
+size_t SecureArena::reservedBytes() const
+    throw ()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_reservedBytes;
+}
+
+
+/**
+ * @brief Returns the number of bytes of the blocks that are in use.
+ *
+ * The size of a block is rounded up to its size class.
+ *
+ * @return the number of bytes
+ */
+size_t SecureArena::bytesInUse() const
+    throw ()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_bytesInUse;
+}
+
+
+/**
+ * @brief Returns the number of blocks that are in use.
+ *
+ * @return the number of blocks returned by allocate() and not yet released
+ */
+int SecureArena::blocksInUse() const
+    throw ()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_blocksInUse;
+}
+
+
+/**
+ * @brief Returns the number of calls to allocate().
+ *
+ * Together with lockCount() this shows how much work loading a file costs, see
+ * resetCounters().
+ *
+ * @return the number of allocations since the last resetCounters()
+ */
+int SecureArena::allocationCount() const
+    throw ()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_allocations;
+}
+
+
+/**
+ * @brief Returns the number of mlock() calls.
+ *
+ * @return the number of calls since the last resetCounters()
+ */
+int SecureArena::lockCount() const
+    throw ()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_lockCalls;
+}
+
+
+/**
+ * @brief Sets allocationCount() and lockCount() to zero.
+ */
+void SecureArena::resetCounters()
+    throw ()
+{
+    QMutexLocker lock(&m_mutex);
+    m_allocations = 0;
+    m_lockCalls = 0;
+}
+
+
+/**
+ * @brief Returns the size class for a block of @p size bytes.
+ *
+ * @param [in] size the size, not larger than MAX_BLOCK_SIZE
+ * @return the index in m_freeLists
+ */
+int SecureArena::sizeClass(size_t size)
+    throw ()
+{
+    int cls = 0;
+    while (blockSize(cls) < size)
+        cls++;
+    return cls;
+}
+
+
+/**
+ * @brief Returns the size of the blocks of a size class.
+ *
+ * @param [in] sizeClass the index in m_freeLists
+ * @return the size in bytes
+ */
+size_t SecureArena::blockSize(int sizeClass)
+    throw ()
+{
+    return MIN_BLOCK_SIZE << sizeClass;
+}
+
+
+/**
+ * @brief Returns the size of a memory page.
+ *
+ * @return the page size in bytes
+ */
+size_t SecureArena::pageSize()
+    throw ()
+{
+#if defined(Q_WS_X11) || defined(Q_WS_MAC)
+    static const size_t size = sysconf(_SC_PAGESIZE);
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+
+/**
+ * @brief Allocates and locks a new chunk.
+ *
+ * The size is rounded up to whole pages and the chunk starts at a page boundary. If the
+ * chunk cannot be locked, a warning is printed once and the chunk is used anyway.
+ *
+ * @param [in] size the minimum size of the chunk
+ * @return the chunk, nothing of it is used
+ * @throw std::bad_alloc if the memory could not be allocated
+ */
+SecureArena::Chunk SecureArena::mapChunk(size_t size)
+    throw (std::bad_alloc)
+{
+    const size_t page = pageSize();
+
+    Chunk chunk;
+    chunk.size = (size + page - 1) / page * page;
+    chunk.used = 0;
+    chunk.locked = false;
+
+#if defined(Q_WS_X11) || defined(Q_WS_MAC)
+    // anonymous mappings are zero
+    void *memory = mmap(0, chunk.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (memory == MAP_FAILED)
+        throw std::bad_alloc();
+    chunk.memory = static_cast<char *>(memory);
+#else
+    chunk.memory = new char[chunk.size];
+    std::fill(chunk.memory, chunk.memory + chunk.size, '\0');
+#endif
+
+#ifdef _POSIX_MEMLOCK_RANGE
+    m_lockCalls++;
+    if (mlock(chunk.memory, chunk.size) != 0) {
+        if (!m_warned) {
+            m_warned = true;
+            qWarning() << "Cannot lock memory:" << strerror(errno);
+        }
+    } else {
+        chunk.locked = true;
+        m_lockedBytes += chunk.size;
+    }
+#endif
+
+    m_reservedBytes += chunk.size;
+    return chunk;
+}
+
+
+/**
+ * @brief Overwrites, unlocks and frees a chunk.
+ *
+ * @param [in] chunk the chunk
+ */
+void SecureArena::unmapChunk(const Chunk &chunk)
+    throw ()
+{
+    std::fill(chunk.memory, chunk.memory + chunk.size, '\0');
+
+#ifdef _POSIX_MEMLOCK_RANGE
+    if (chunk.locked) {
+        if (munlock(chunk.memory, chunk.size) != 0)
+            qDebug() << "Cannot unlock memory " << strerror(errno);
+        m_lockedBytes -= chunk.size;
+    }
+#endif
+
+    m_reservedBytes -= chunk.size;
+#if defined(Q_WS_X11) || defined(Q_WS_MAC)
+    munmap(chunk.memory, chunk.size);
+#else
+    delete[] chunk.memory;
+#endif
+}
+
+
+/**
+ * @brief Checks whether @p block lies in a locked chunk.
+ *
+ * @param [in] block a block of a shared chunk
+ * @return @c true if the chunk is locked, @c false otherwise
+ */
+bool SecureArena::isLocked(const char *block) const
+    throw ()
+{
+    for (int i = 0; i < m_chunks.size(); i++) {
+        const Chunk &chunk = m_chunks[i];
+        if (block >= chunk.memory && block < chunk.memory + chunk.size)
+            return chunk.locked;
+    }
+    return false;
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
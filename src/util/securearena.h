@@ -0,0 +1,121 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef SECUREARENA_H
+#define SECUREARENA_H
+
+#include <cstddef>
+#include <stdexcept>
+
+#include <QVector>
+#include <QMutex>
+
+class SecureArena
+{
+    public:
+        static const size_t CHUNK_SIZE;
+        static const size_t MIN_BLOCK_SIZE;
+        static const size_t MAX_BLOCK_SIZE;
+
+    public:
+        static SecureArena& instance()
+        throw ();
+
+    public:
+        SecureArena()
+        throw ();
+
+        ~SecureArena()
+        throw ();
+
+    public:
+        char *allocate(size_t size, bool &locked)
+        throw (std::bad_alloc);
+
+        void release(char *block, size_t size)
+        throw ();
+
+        size_t lockedBytes() const
+        throw ();
+
+        size_t reservedBytes() const
+        throw ();
+
+        size_t bytesInUse() const
+        throw ();
+
+        int blocksInUse() const
+        throw ();
+
+        int allocationCount() const
+        throw ();
+
+        int lockCount() const
+        throw ();
+
+        void resetCounters()
+        throw ();
+
+    private:
+        // MIN_BLOCK_SIZE << (SIZE_CLASSES - 1) == MAX_BLOCK_SIZE
+        enum { SIZE_CLASSES = 9 };
+
+        struct Chunk
+        {
+            char    *memory;
+            size_t  size;
+            size_t  used;
+            bool    locked;
+        };
+
+    private:
+        static int sizeClass(size_t size)
+        throw ();
+
+        static size_t blockSize(int sizeClass)
+        throw ();
+
+        static size_t pageSize()
+        throw ();
+
+        Chunk mapChunk(size_t size)
+        throw (std::bad_alloc);
+
+        void unmapChunk(const Chunk &chunk)
+        throw ();
+
+        bool isLocked(const char *block) const
+        throw ();
+
+    private:
+        SecureArena(const SecureArena&);
+        SecureArena& operator=(const SecureArena&);
+
+    private:
+        mutable QMutex      m_mutex;
+        QVector<Chunk>      m_chunks;
+        QVector<Chunk>      m_largeBlocks;
+        QVector<char *>     m_freeLists[SIZE_CLASSES];
+        size_t              m_lockedBytes;
+        size_t              m_reservedBytes;
+        size_t              m_bytesInUse;
+        int                 m_blocksInUse;
+        int                 m_allocations;
+        int                 m_lockCalls;
+        bool                m_warned;
+};
+
+#endif // SECUREARENA_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -15,17 +15,12 @@
 #include <stdexcept>
 #include <string>
 #include <cstring>
-#include <cerrno>
 #include <algorithm>
 
-// before the include of <sys/mman.h> to get the Q_WS_X11 define
 #include <QDebug>
 
-#if defined(Q_WS_X11) || defined(Q_WS_MAC)
-#  include <sys/mman.h>
-#endif
-
 #include "securestring.h"
+#include "securearena.h"
 
 /**
  * \class SecureString
@@ -34,7 +29,8 @@
  *
  * This string class takes care that the data is not swapped out to disk but kept in memory.
  * How that is done depends on the operating system. Currently, only mlock() is supported
- * on Unix platforms.
+ * on Unix platforms. The memory is taken from the SecureArena, so not every string needs
+ * its own mlock() call.
  *
  * This class is Unicode-aware because it uses UTF-8 internally to store the data. If you use
  * QString or a UTF-8 C-String, you can use Unicode. If you use a local 8-bit encoding like
@@ -44,8 +40,6 @@
  * @author Bernhard Walle
  */
 
-bool SecureString::s_warned = false;
-
 /**
  * @brief Checks if the current platform (operating system) supports memory locking.
  *
@@ -150,18 +144,76 @@ SecureString::SecureString(const SecureString &text)
 SecureString &SecureString::operator=(const SecureString& text)
     throw (std::bad_alloc)
 {
-    if (m_text) {
-        unlock();
-        smash();
-        delete[] m_text;
-        m_text = NULL;
-    }
+    if (&text == this)
+        return *this;
 
+    release();
     fromCString(text.utf8());
     return *this;
 }
 
 
+#ifdef Q_COMPILER_RVALUE_REFS
+
+/**
+ * @brief Moves a SecureString.
+ *
+ * The memory of \p text is taken over, nothing is allocated or locked. After that,
+ * \p text is empty.
+ *
+ * @param [in] text the SecureString to move from
+ */
+SecureString::SecureString(SecureString &&text)
+    throw ()
+    : m_text(text.m_text)
+    , m_locked(text.m_locked)
+{
+    text.m_text = NULL;
+    text.m_locked = false;
+}
+
+
+/**
+ * @brief Move assignment of a SecureString.
+ *
+ * The old contents is overwritten and released, then the memory of \p text is taken
+ * over. After that, \p text is empty.
+ *
+ * @param [in] text the SecureString to move from
+ */
+SecureString &SecureString::operator=(SecureString &&text)
+    throw ()
+{
+    if (&text != this) {
+        release();
+        swap(text);
+    }
+    return *this;
+}
+
+#endif // Q_COMPILER_RVALUE_REFS
+
+
+/**
+ * @brief Exchanges the contents of two SecureString objects.
+ *
+ * Nothing is allocated, copied or locked, so this is the way to replace the value of a
+ * SecureString without a temporary copy:
+ *
+ * @code
+ * SecureString(newValue).swap(m_secret);
+ * @endcode
+ *
+ * @param [in,out] other the other string
+ */
+void SecureString::swap(SecureString &other)
+    throw ()
+{
+    std::swap(m_text, other.m_text);
+    std::swap(m_locked, other.m_locked);
+}
+
+
 /**
  * @brief Checks if \p text is less than this string.
  *
@@ -273,15 +325,12 @@ bool SecureString::operator!=(const SecureString &text) const
 
 
 /**
- * @brief Creates a new SecureString from a std::string representation.
+ * @brief Destroys the SecureString and overwrites the memory.
  */
 SecureString::~SecureString()
     throw ()
 {
-    unlock();
-    smash();
-    delete[] m_text;
-    m_text = NULL;
+    release();
 }
 
 
@@ -397,80 +446,25 @@ size_t SecureString::size() const
 void SecureString::fromCString(const char *text)
     throw (std::bad_alloc)
 {
-    // don't use strdup() to be able to allocate with new[] instead of malloc()
     size_t len = strlen(text);
-    m_text = new char[len+1];
+    m_text = SecureArena::instance().allocate(len+1, m_locked);
 
     std::copy(text, text+len+1, m_text);
-    lock();
 }
 
 
 /**
- * @brief Locks the string in m_text into memory.
+ * @brief Gives the memory of the string back to the SecureArena.
  *
- * If the string cannot be locked, the implementation does \b not throw any exception.
- * Instead, it issues a warning with qDebug(). If that is not sufficient for you, you can
- * check with SecureString::isLocked() if the memory is really locked.
- *
- * If m_isLocked is \c true which means that the string is already locked, the function
- * silently returns.
+ * The arena overwrites the data with zeroes. After that, the string is empty.
  */
-void SecureString::lock()
-    throw ()
-{
-    // do nothing if the string is already locked
-    if (m_locked)
-        return;
-
-#ifdef _POSIX_MEMLOCK_RANGE
-    // lock the whole string including the trailing newline
-    int ret = mlock(m_text, strlen(m_text)+1);
-    if (ret != 0) {
-        if (!s_warned) {
-            s_warned = true;
-            qWarning() << "Cannot lock memory:" << strerror(errno);
-        }
-    } else {
-        m_locked = true;
-    }
-#endif
-}
-
-
-/**
- * @brief Unlocks the string in m_text from memory.
- *
- * If m_isLocked is \c false which means that the string is not locked, the function
- * silently returns.
- */
-void SecureString::unlock()
-    throw ()
-{
-    // do nothing if the string is not locked
-    if (!m_locked)
-        return;
-
-#ifdef _POSIX_MEMLOCK_RANGE
-    int ret = munlock(m_text, strlen(m_text)+1);
-    if (ret != 0)
-        qDebug() << "Cannot unlock memory " << strerror(errno);
-#endif
-}
-
-
-/**
- * @brief Overwrites the data with garbage.
- *
- * This function should be called before the data is delete[]'d. Currently we overwrite
- * the contents of the data with zeroes, but we could change that to random data. Should
- * not matter because it's not a hard disk but only memory contents.
- */
-void SecureString::smash()
+void SecureString::release()
     throw ()
 {
     if (m_text) {
-        std::fill(m_text, m_text+strlen(m_text), '\0');
+        SecureArena::instance().release(m_text, strlen(m_text)+1);
+        m_text = NULL;
+        m_locked = false;
     }
 }
 
@@ -44,6 +44,17 @@ class SecureString
         SecureString &operator=(const SecureString &text)
         throw (std::bad_alloc);
 
+#ifdef Q_COMPILER_RVALUE_REFS
+        SecureString(SecureString &&text)
+        throw ();
+
+        SecureString &operator=(SecureString &&text)
+        throw ();
+#endif
+
+        void swap(SecureString &other)
+        throw ();
+
         bool operator<(const SecureString &text) const
         throw ();
 
@@ -86,21 +97,20 @@ class SecureString
         void fromCString(const char *text)
         throw (std::bad_alloc);
 
-        void lock()
-        throw ();
-
-        void unlock()
-        throw ();
-
-        void smash()
+        void release()
         throw ();
 
     private:
         char *m_text;
         bool m_locked;
-        static bool s_warned;
 };
 
+inline void swap(SecureString &a, SecureString &b)
+    throw ()
+{
+    a.swap(b);
+}
+
 #endif // SECURESTRING_H
 
 // vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
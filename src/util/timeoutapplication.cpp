@@ -148,6 +148,10 @@ void TimeoutApplication::init()
     connect(m_timer, SIGNAL(timeout()), SIGNAL(timedOut()));
 
 #ifdef Q_WS_X11
+    // there's no display without the GUI
+    if (type() == QApplication::Tty)
+        return;
+
     const int max = 20;
     Atom* atoms[max];
     char* names[max];
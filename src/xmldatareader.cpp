@@ -0,0 +1,227 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <stdexcept>
+
+#include <QFile>
+#include <QDebug>
+
+#include "global.h"
+#include "xmldatareader.h"
+
+/**
+ * @class XmlDataReader
+ *
+ * @brief Reads the XML data file in one pass and reports its contents to a DataHandler.
+ *
+ * In contrast to QDomDocument, this class never holds the whole document in memory.
+ * The file is parsed with a QXmlStreamReader, the passwords are decrypted while they are
+ * read and passed to the handler immediately. So the memory consumption while loading is
+ * only determined by what the handler builds from the data.
+ *
+ * You have to call readAppData() first. It reads the <tt>\<app-data\></tt> element and
+ * stops in front of the passwords, so the caller can check the password and set up the
+ * encryptor (maybe that requires reading the smartcard) before readPasswords() is called.
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @brief Creates a new instance of a XmlDataReader.
+ *
+ * @param device the device to read from, it must be open for reading and must stay valid
+ *        as long as this object exists
+ */
+XmlDataReader::XmlDataReader(QIODevice* device)
+    : m_reader(device)
+    , m_atPasswords(false)
+{
+    QFile* file = qobject_cast<QFile*>(device);
+    if (file)
+        m_fileName = file->fileName();
+}
+
+
+/**
+ * @brief Reads the application data.
+ *
+ * After this call the reader is positioned at the <tt>\<passwords\></tt> element.
+ *
+ * @return the application data
+ * @exception ReadWriteException if the file is no valid XML file
+ */
+AppData XmlDataReader::readAppData()
+    throw (ReadWriteException)
+{
+    AppData appData;
+
+    if (!m_reader.readNextStartElement() || m_reader.name() != QLatin1String("qpamat")) {
+        checkError();
+        m_reader.raiseError(QObject::tr("The root element must be <qpamat>."));
+        checkError();
+    }
+
+    while (m_reader.readNextStartElement()) {
+        if (m_reader.name() == QLatin1String("app-data")) {
+            while (m_reader.readNextStartElement()) {
+                QStringRef name = m_reader.name();
+                if (name == QLatin1String("version"))
+                    appData.version = m_reader.readElementText();
+                else if (name == QLatin1String("date"))
+                    appData.date = m_reader.readElementText();
+                else if (name == QLatin1String("crypt-algorithm"))
+                    appData.cryptAlgorithm = m_reader.readElementText();
+                else if (name == QLatin1String("kdf")) {
+                    QXmlStreamAttributes attributes = m_reader.attributes();
+                    appData.kdfAlgorithm = attributes.value("algorithm").toString();
+                    appData.kdfIterations = attributes.value("iterations").toString().toInt();
+                    appData.kdfSalt = QByteArray::fromBase64(
+                        attributes.value("salt").toString().toLatin1());
+                    m_reader.skipCurrentElement();
+                } else if (name == QLatin1String("passwordhash"))
+                    appData.passwordHash = m_reader.readElementText();
+                else if (name == QLatin1String("smartcard")) {
+                    QXmlStreamAttributes attributes = m_reader.attributes();
+                    appData.useCard = attributes.value("useCard").toString().toInt();
+                    appData.cardId = attributes.value("card-id").toString().toShort();
+                    m_reader.skipCurrentElement();
+                } else
+                    m_reader.skipCurrentElement();
+            }
+        } else if (m_reader.name() == QLatin1String("passwords")) {
+            m_atPasswords = true;
+            break;
+        } else
+            m_reader.skipCurrentElement();
+    }
+
+    checkError();
+    return appData;
+}
+
+
+/**
+ * @brief Reads the passwords and reports them to the handler.
+ *
+ * readAppData() must be called before.
+ *
+ * @param handler the handler that receives the data
+ * @param enc the encryptor used to decrypt the passwords, may be 0 if the passwords
+ *        should be passed as they are stored in the file
+ * @exception ReadWriteException if the file is no valid XML file or if a password
+ *            could not be decrypted
+ */
+void XmlDataReader::readPasswords(DataHandler& handler, StringEncryptor* enc)
+    throw (ReadWriteException)
+{
+    if (!m_atPasswords)
+        return;
+
+    try {
+        readCategoryContents(handler, enc);
+    } catch (const ReadWriteException&) {
+        throw;
+    } catch (const std::exception& e) {
+        qDebug() << CURRENT_FUNCTION << "Decryption failed:" << e.what();
+        m_reader.raiseError(QObject::tr("A password could not be decrypted."));
+    }
+    m_atPasswords = false;
+
+    checkError();
+}
+
+
+/**
+ * @brief Reads the children of a <tt>\<category\></tt> or <tt>\<passwords\></tt> element.
+ *
+ * @param handler the handler
+ * @param enc the encryptor, may be 0
+ */
+void XmlDataReader::readCategoryContents(DataHandler& handler, StringEncryptor* enc)
+{
+    while (m_reader.readNextStartElement()) {
+        QXmlStreamAttributes attributes = m_reader.attributes();
+        QString name = attributes.value("name").toString();
+        bool isSelected = attributes.value("isSelected") == QLatin1String("1");
+
+        if (m_reader.name() == QLatin1String("category")) {
+            handler.startCategory(name, attributes.value("wasOpen") == QLatin1String("1"),
+                isSelected);
+            readCategoryContents(handler, enc);
+            handler.endCategory();
+        } else if (m_reader.name() == QLatin1String("entry")) {
+            handler.startEntry(name, isSelected);
+            readEntryContents(handler, enc);
+            handler.endEntry();
+        } else
+            m_reader.skipCurrentElement();
+    }
+}
+
+
+/**
+ * @brief Reads the <tt>\<property\></tt> children of an <tt>\<entry\></tt> element.
+ *
+ * @param handler the handler
+ * @param enc the encryptor, may be 0
+ */
+void XmlDataReader::readEntryContents(DataHandler& handler, StringEncryptor* enc)
+{
+    while (m_reader.readNextStartElement()) {
+        if (m_reader.name() == QLatin1String("property")) {
+            QXmlStreamAttributes attributes = m_reader.attributes();
+            QString value = attributes.value("value").toString();
+            QStringRef typeString = attributes.value("type");
+
+            Property::Type type;
+            if (typeString == QLatin1String("USERNAME"))
+                type = Property::USERNAME;
+            else if (typeString == QLatin1String("PASSWORD"))
+                type = Property::PASSWORD;
+            else if (typeString == QLatin1String("URL"))
+                type = Property::URL;
+            else
+                type = Property::MISC;
+
+            if (enc && type == Property::PASSWORD && attributes.hasAttribute("value"))
+                value = enc->decryptStrFromStr(value);
+
+            handler.appendProperty(attributes.value("key").toString(), value, type,
+                attributes.value("encrypted") == QLatin1String("1"),
+                attributes.value("hidden") == QLatin1String("1"));
+        }
+        m_reader.skipCurrentElement();
+    }
+}
+
+
+/**
+ * @brief Throws a ReadWriteException if the underlying reader has an error.
+ *
+ * @exception ReadWriteException if an error occured
+ */
+void XmlDataReader::checkError() const
+    throw (ReadWriteException)
+{
+    if (!m_reader.hasError())
+        return;
+
+    qDebug() << CURRENT_FUNCTION << m_reader.errorString() << "at line" << m_reader.lineNumber();
+    throw ReadWriteException(QObject::tr("The XML file (%1) may be corrupted "
+        "and\ncould not be read (line %2: %3).\nCheck the file with a text editor.")
+        .arg(m_fileName).arg(m_reader.lineNumber()).arg(m_reader.errorString()),
+        ReadWriteException::CInvalidData);
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
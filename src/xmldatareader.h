@@ -0,0 +1,54 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef XMLDATAREADER_H
+#define XMLDATAREADER_H
+
+#include <QIODevice>
+#include <QXmlStreamReader>
+
+#include "dataformat.h"
+#include "security/encryptor.h"
+
+class XmlDataReader : public DataReader
+{
+    public:
+        XmlDataReader(QIODevice* device);
+
+    public:
+        AppData readAppData()
+            throw (ReadWriteException);
+
+        void readPasswords(DataHandler& handler, StringEncryptor* enc)
+            throw (ReadWriteException);
+
+    private:
+        void readCategoryContents(DataHandler& handler, StringEncryptor* enc);
+        void readEntryContents(DataHandler& handler, StringEncryptor* enc);
+        void checkError() const
+            throw (ReadWriteException);
+
+    private:
+        XmlDataReader(const XmlDataReader&);
+        XmlDataReader& operator=(const XmlDataReader&);
+
+    private:
+        QXmlStreamReader    m_reader;
+        QString             m_fileName;
+        bool                m_atPasswords;
+};
+
+#endif // XMLDATAREADER_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
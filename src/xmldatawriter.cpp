@@ -0,0 +1,189 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#include <QFile>
+#include <QApplication>
+#include <QDebug>
+
+#include "global.h"
+#include "xmldatawriter.h"
+
+/**
+ * @class XmlDataWriter
+ *
+ * @brief A DataWriter that writes the data file as XML.
+ *
+ * The XML is written with a QXmlStreamWriter directly to the device while the tree is
+ * walked, so no copy of the data is built in memory. Passwords are encrypted before
+ * they are written.
+ *
+ * The usage is:
+ *
+ *  -# writeAppData()
+ *  -# the DataHandler methods, normally called by Tree::writeData()
+ *  -# finish()
+ *
+ * @ingroup misc
+ */
+
+/**
+ * @brief Creates a new instance of a XmlDataWriter.
+ *
+ * @param device the device to write to, it must be open for writing and must stay valid
+ *        as long as this object exists
+ * @param enc the encryptor used to encrypt the passwords, may be 0 if the passwords should
+ *        be written as they are passed
+ */
+XmlDataWriter::XmlDataWriter(QIODevice* device, StringEncryptor* enc)
+    : m_writer(device)
+    , m_device(device)
+    , m_encryptor(enc)
+{
+    m_writer.setAutoFormatting(true);
+    m_writer.setAutoFormattingIndent(1);
+}
+
+
+/**
+ * @brief Writes the document header and the application data.
+ *
+ * After that, the <tt>\<passwords\></tt> element is opened.
+ *
+ * @param appData the application data
+ */
+void XmlDataWriter::writeAppData(const AppData& appData)
+    throw (ReadWriteException)
+{
+    m_writer.writeStartDocument();
+    m_writer.writeDTD("<!DOCTYPE qpamat SYSTEM \"http://qpamat.berlios.de/qpamat.dtd\">");
+    m_writer.writeStartElement("qpamat");
+
+    m_writer.writeStartElement("app-data");
+    m_writer.writeTextElement("version", appData.version);
+    m_writer.writeTextElement("date", appData.date);
+    m_writer.writeTextElement("crypt-algorithm", appData.cryptAlgorithm);
+    if (!appData.kdfAlgorithm.isEmpty()) {
+        m_writer.writeEmptyElement("kdf");
+        m_writer.writeAttribute("algorithm", appData.kdfAlgorithm);
+        m_writer.writeAttribute("iterations", QString::number(appData.kdfIterations));
+        m_writer.writeAttribute("salt", QString::fromLatin1(appData.kdfSalt.toBase64()));
+    }
+    m_writer.writeTextElement("passwordhash", appData.passwordHash);
+    m_writer.writeEmptyElement("smartcard");
+    m_writer.writeAttribute("useCard", QString::number(appData.useCard));
+    if (appData.useCard)
+        m_writer.writeAttribute("card-id", QString::number(appData.cardId));
+    m_writer.writeEndElement();
+
+    m_writer.writeStartElement("passwords");
+}
+
+
+/**
+ * @brief Closes all open elements and flushes the device.
+ *
+ * @exception ReadWriteException if the data could not be written
+ */
+void XmlDataWriter::finish()
+    throw (ReadWriteException)
+{
+    m_writer.writeEndDocument();
+
+    QFile* file = qobject_cast<QFile*>(m_device);
+    if (file && (!file->flush() || file->error() != QFile::NoError)) {
+        qDebug() << CURRENT_FUNCTION << file->errorString();
+        throw ReadWriteException(QObject::tr("The data could not be saved. There "
+            "was an\nerror while writing the file:\n%1").arg(qApp->translate("QFile",
+            file->errorString())), ReadWriteException::CIOError);
+    }
+}
+
+
+/**
+ * @copydoc DataHandler::startCategory(const QString&, bool, bool)
+ */
+void XmlDataWriter::startCategory(const QString& name, bool wasOpen, bool isSelected)
+{
+    m_writer.writeStartElement("category");
+    m_writer.writeAttribute("wasOpen", QString::number(wasOpen));
+    m_writer.writeAttribute("name", name);
+    m_writer.writeAttribute("isSelected", QString::number(isSelected));
+}
+
+
+/**
+ * @copydoc DataHandler::endCategory()
+ */
+void XmlDataWriter::endCategory()
+{
+    m_writer.writeEndElement();
+}
+
+
+/**
+ * @copydoc DataHandler::startEntry(const QString&, bool)
+ */
+void XmlDataWriter::startEntry(const QString& name, bool isSelected)
+{
+    m_writer.writeStartElement("entry");
+    m_writer.writeAttribute("name", name);
+    m_writer.writeAttribute("isSelected", QString::number(isSelected));
+}
+
+
+/**
+ * @copydoc DataHandler::endEntry()
+ */
+void XmlDataWriter::endEntry()
+{
+    m_writer.writeEndElement();
+}
+
+
+/**
+ * @copydoc DataHandler::appendProperty(const QString&, const QString&, Property::Type, bool, bool)
+ */
+void XmlDataWriter::appendProperty(const QString& key, const QString& value,
+                                   Property::Type type, bool encrypted, bool hidden)
+{
+    QString typeString;
+    switch (type) {
+        case Property::MISC:
+            typeString = "MISC";
+            break;
+
+        case Property::PASSWORD:
+            typeString = "PASSWORD";
+            break;
+
+        case Property::USERNAME:
+            typeString = "USERNAME";
+            break;
+
+        case Property::URL:
+            typeString = "URL";
+            break;
+    }
+
+    m_writer.writeEmptyElement("property");
+    m_writer.writeAttribute("key", key);
+    m_writer.writeAttribute("value", m_encryptor && type == Property::PASSWORD
+        ? m_encryptor->encryptStrToStr(value)
+        : value);
+    m_writer.writeAttribute("hidden", QString::number(hidden));
+    m_writer.writeAttribute("encrypted", QString::number(encrypted));
+    m_writer.writeAttribute("type", typeString);
+}
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,54 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation; You may only use
+ * version 2 of the License, you have no option to use any other version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program; if
+ * not, write to the Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * -------------------------------------------------------------------------------------------------
+ */
+#ifndef XMLDATAWRITER_H
+#define XMLDATAWRITER_H
+
+#include <QIODevice>
+#include <QXmlStreamWriter>
+
+#include "dataformat.h"
+#include "security/encryptor.h"
+
+class XmlDataWriter : public DataWriter
+{
+    public:
+        XmlDataWriter(QIODevice* device, StringEncryptor* enc);
+
+    public:
+        void writeAppData(const AppData& appData)
+            throw (ReadWriteException);
+        void finish()
+            throw (ReadWriteException);
+
+        void startCategory(const QString& name, bool wasOpen, bool isSelected);
+        void endCategory();
+        void startEntry(const QString& name, bool isSelected);
+        void endEntry();
+        void appendProperty(const QString& key, const QString& value,
+            Property::Type type, bool encrypted, bool hidden);
+
+    private:
+        XmlDataWriter(const XmlDataWriter&);
+        XmlDataWriter& operator=(const XmlDataWriter&);
+
+    private:
+        QXmlStreamWriter    m_writer;
+        QIODevice*          m_device;
+        StringEncryptor*    m_encryptor;
+};
+
+#endif // XMLDATAWRITER_H
+
+// vim: set sw=4 ts=4 et: :tabSize=4:indentSize=4:maxLineLen=100:
@@ -0,0 +1,56 @@
+#!/usr/bin/perl -w
+#
+# Builds the precompiled index of a dictionary for the password checker
+# (see DictionaryIndex in src/security/dictionaryindex.cpp).
+#
+# Usage: build_dictindex.pl dictionary.txt [index]
+#
+# The index defaults to dictionary.txt.idx. The dictionary must be encoded
+# in ISO-8859-1, HybridPasswordChecker reads the text file with that codec
+# if there is no index, so both give the same words.
+
+use strict;
+use Encode;
+use sort 'stable';
+
+my $encoding = 'iso-8859-1';
+
+die "Usage: $0 dictionary.txt [index]\n" if @ARGV < 1 || @ARGV > 2;
+my $input = $ARGV[0];
+my $output = $ARGV[1] || "$input.idx";
+
+# read the words like HybridPasswordChecker: stop at the first word with
+# only one character
+open(IN, '<', $input) or die "Cannot open $input: $!\n";
+my @words;
+while (my $line = <IN>) {
+	$line =~ s/\r?\n$//;
+	my $word = lc(decode($encoding, $line));
+	last if length($word) == 1;
+	push @words, encode('UTF-16LE', $word);
+}
+close(IN);
+
+# sorted by descending length, like util/sort.pl
+@words = sort { length($b) <=> length($a) } @words;
+
+my $max = @words ? length($words[0]) / 2 : 0;
+my @buckets = (0xffffffff) x ($max + 1);
+my @offsets;
+my $pool = '';
+for (my $i = 0; $i < @words; $i++) {
+	my $length = length($words[$i]) / 2;
+	$buckets[$length] = $i if $buckets[$length] == 0xffffffff;
+	push @offsets, length($pool) / 2;
+	$pool .= $words[$i];
+}
+push @offsets, length($pool) / 2;
+
+open(OUT, '>', $output) or die "Cannot create $output: $!\n";
+binmode(OUT);
+print OUT 'QPAMATDX';
+print OUT pack('V4', 1, scalar(@words), $max, length($pool) / 2);
+print OUT pack('V*', @buckets);
+print OUT pack('V*', @offsets);
+print OUT $pool;
+close(OUT) or die "Cannot write $output: $!\n";